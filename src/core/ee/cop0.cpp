@@ -16,13 +16,13 @@ namespace ee
 
     Cop0::~Cop0()
     {
-        delete[] kernel_vtlb;
-        delete[] sup_vtlb;
-        delete[] user_vtlb;
+        delete kernel_vtlb;
+        delete sup_vtlb;
+        delete user_vtlb;
         delete[] vtlb_info;
     }
 
-    uint8_t** Cop0::get_vtlb_map()
+    VTLB* Cop0::get_vtlb_map()
     {
         if (status.exception || status.error)
             return kernel_vtlb;
@@ -81,17 +81,17 @@ namespace ee
     void Cop0::init_tlb()
     {
         if (!kernel_vtlb)
-            kernel_vtlb = new uint8_t * [1024 * 1024];
+            kernel_vtlb = new VTLB;
         if (!sup_vtlb)
-            sup_vtlb = new uint8_t * [1024 * 1024];
+            sup_vtlb = new VTLB;
         if (!user_vtlb)
-            user_vtlb = new uint8_t * [1024 * 1024];
+            user_vtlb = new VTLB;
         if (!vtlb_info)
             vtlb_info = new VTLB_Info[1024 * 1024];
 
-        memset(kernel_vtlb, 0, 1024 * 1024 * sizeof(uint8_t*));
-        memset(sup_vtlb, 0, 1024 * 1024 * sizeof(uint8_t*));
-        memset(user_vtlb, 0, 1024 * 1024 * sizeof(uint8_t*));
+        kernel_vtlb->clear();
+        sup_vtlb->clear();
+        user_vtlb->clear();
         memset(vtlb_info, 0, 1024 * 1024 * sizeof(VTLB_Info));
 
         //Kernel segments are unmapped to TLB, so we must define them explicitly
@@ -99,12 +99,15 @@ namespace ee
         for (uint32_t i = unmapped_start; i < unmapped_end; i += 4096)
         {
             int map_index = i / 4096;
-            kernel_vtlb[map_index] = get_mem_pointer(i & 0x1FFFFFFF);
+            kernel_vtlb->set(map_index, get_mem_pointer(i & 0x1FFFFFFF));
             if (i < 0xA0000000)
                 vtlb_info[map_index].cache_mode = CACHED;
             else
                 vtlb_info[map_index].cache_mode = UNCACHED;
         }
+
+        //KSEG0 and KSEG1 map the same physical pages, and RDRAM is mirrored below 0x10000000
+        kernel_vtlb->compact();
     }
 
     uint32_t Cop0::mfc(int index)
@@ -383,9 +386,9 @@ namespace ee
                 for (uint32_t i = 0; i < 1024 * 16; i += 4096)
                 {
                     int map_index = i / 4096;
-                    kernel_vtlb[even_page + map_index] = nullptr;
-                    sup_vtlb[even_page + map_index] = nullptr;
-                    user_vtlb[even_page + map_index] = nullptr;
+                    kernel_vtlb->set(even_page + map_index, nullptr);
+                    sup_vtlb->set(even_page + map_index, nullptr);
+                    user_vtlb->set(even_page + map_index, nullptr);
                 }
             }
         }
@@ -396,9 +399,9 @@ namespace ee
                 for (uint32_t i = 0; i < entry->page_size; i += 4096)
                 {
                     int map_index = i / 4096;
-                    kernel_vtlb[even_page + map_index] = nullptr;
-                    sup_vtlb[even_page + map_index] = nullptr;
-                    user_vtlb[even_page + map_index] = nullptr;
+                    kernel_vtlb->set(even_page + map_index, nullptr);
+                    sup_vtlb->set(even_page + map_index, nullptr);
+                    user_vtlb->set(even_page + map_index, nullptr);
                 }
             }
 
@@ -407,9 +410,9 @@ namespace ee
                 for (uint32_t i = 0; i < entry->page_size; i += 4096)
                 {
                     int map_index = i / 4096;
-                    kernel_vtlb[odd_page + map_index] = nullptr;
-                    sup_vtlb[odd_page + map_index] = nullptr;
-                    user_vtlb[odd_page + map_index] = nullptr;
+                    kernel_vtlb->set(odd_page + map_index, nullptr);
+                    sup_vtlb->set(odd_page + map_index, nullptr);
+                    user_vtlb->set(odd_page + map_index, nullptr);
                 }
             }
         }
@@ -435,9 +438,9 @@ namespace ee
                 for (uint32_t i = 0; i < 1024 * 16; i += 4096)
                 {
                     int map_index = i / 4096;
-                    kernel_vtlb[even_virt_page + map_index] = spr + i;
-                    sup_vtlb[even_virt_page + map_index] = spr + i;
-                    user_vtlb[even_virt_page + map_index] = spr + i;
+                    kernel_vtlb->set(even_virt_page + map_index, spr + i);
+                    sup_vtlb->set(even_virt_page + map_index, spr + i);
+                    user_vtlb->set(even_virt_page + map_index, spr + i);
                     vtlb_info[even_virt_page + map_index].cache_mode = SPR;
                 }
             }
@@ -450,15 +453,15 @@ namespace ee
                 {
                     int map_index = i / 4096;
                     uint8_t* mem = get_mem_pointer(even_phy_addr + i);
-                    kernel_vtlb[even_virt_page + map_index] = mem;
+                    kernel_vtlb->set(even_virt_page + map_index, mem);
 
                     if (even_virt_addr < 0x80000000)
                     {
-                        sup_vtlb[even_virt_page + map_index] = mem;
-                        user_vtlb[even_virt_page + map_index] = mem;
+                        sup_vtlb->set(even_virt_page + map_index, mem);
+                        user_vtlb->set(even_virt_page + map_index, mem);
                     }
                     else if (even_virt_addr >= 0xC0000000 && even_virt_addr < 0xE0000000)
-                        sup_vtlb[even_virt_page + map_index] = mem;
+                        sup_vtlb->set(even_virt_page + map_index, mem);
 
                     vtlb_info[even_virt_page + map_index].cache_mode = entry->cache_mode[0];
                 }
@@ -470,15 +473,15 @@ namespace ee
                 {
                     int map_index = i / 4096;
                     uint8_t* mem = get_mem_pointer(odd_phy_addr + i);
-                    kernel_vtlb[odd_virt_page + map_index] = mem;
+                    kernel_vtlb->set(odd_virt_page + map_index, mem);
 
                     if (odd_virt_addr < 0x80000000)
                     {
-                        sup_vtlb[odd_virt_page + map_index] = mem;
-                        user_vtlb[odd_virt_page + map_index] = mem;
+                        sup_vtlb->set(odd_virt_page + map_index, mem);
+                        user_vtlb->set(odd_virt_page + map_index, mem);
                     }
                     else if (odd_virt_addr >= 0xC0000000 && odd_virt_addr < 0xE0000000)
-                        sup_vtlb[odd_virt_page + map_index] = mem;
+                        sup_vtlb->set(odd_virt_page + map_index, mem);
 
                     vtlb_info[odd_virt_page + map_index].cache_mode = entry->cache_mode[1];
                 }
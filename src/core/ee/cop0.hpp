@@ -1,6 +1,7 @@
 #pragma once
 #include <cstdint>
 #include <fstream>
+#include <ee/vtlb.hpp>
 
 namespace core
 {
@@ -93,9 +94,9 @@ namespace ee
     private:
         core::Emulator* e;
 
-        uint8_t** kernel_vtlb;
-        uint8_t** sup_vtlb;
-        uint8_t** user_vtlb;
+        VTLB* kernel_vtlb;
+        VTLB* sup_vtlb;
+        VTLB* user_vtlb;
 
         VTLB_Info* vtlb_info;
 
@@ -113,7 +114,7 @@ namespace ee
         Cop0(core::Emulator* e);
         ~Cop0();
 
-        uint8_t** get_vtlb_map();
+        VTLB* get_vtlb_map();
 
         bool is_cached(uint32_t address);
 
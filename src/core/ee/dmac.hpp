@@ -268,6 +268,7 @@ namespace ee
         DMAC(core::Emulator* e);
         void reset();
         void run(int cycles);
+        bool is_idle();
         void start_DMA(int index);
 
         template <typename T>
@@ -286,6 +287,12 @@ namespace ee
         void save_state(std::ofstream& state);
     };
     
+    //True when run() has no channel to transfer
+    inline bool DMAC::is_idle()
+    {
+        return !active_channel || !control.dma_enable || (master_disable & (1 << 16));
+    }
+
     template<typename T>
     inline T DMAC::read(uint32_t address)
     {
@@ -4,6 +4,7 @@
 #include <ee/interpreter/emotioninterpreter.hpp>
 #include <ee/vu/vu.hpp>
 #include <util/errors.hpp>
+#include <util/hostmem.hpp>
 #include <emulator.hpp>
 #include <sif.hpp>
 #include <fmt/core.h>
@@ -18,7 +19,7 @@ namespace ee
         fpu = std::make_unique<Cop1>();
 
         /* Allocate EE memory caches */
-        rdram = new uint8_t[32 * 1024 * 1024];
+        rdram = HostMemory::alloc_guest(32 * 1024 * 1024);
 
         tlb_map = nullptr;
         set_run_func(&EmotionEngine::run_interpreter);
@@ -26,7 +27,7 @@ namespace ee
 
     EmotionEngine::~EmotionEngine()
     {
-        delete[] rdram;
+        HostMemory::free_guest(rdram, 32 * 1024 * 1024);
     }
 
     const char* EmotionEngine::SYSCALL(int id)
@@ -409,7 +410,7 @@ namespace ee
                However, the EE loads two instructions at once. Since we only load a word, we divide the cycles in half. */
             cycles_to_run -= 16;
         }
-        uint8_t* mem = tlb_map[address / 4096];
+        uint8_t* mem = tlb_map->lookup(address);
         if (mem > (uint8_t*)1)
             return *(uint32_t*)&mem[address & 4095];
         else
@@ -418,7 +419,7 @@ namespace ee
 
     uint8_t EmotionEngine::read8(uint32_t address)
     {
-        uint8_t* mem = tlb_map[address / 4096];
+        uint8_t* mem = tlb_map->lookup(address);
         if (mem > (uint8_t*)1)
             return mem[address & 4095];
         else if (mem == (uint8_t*)1)
@@ -433,7 +434,7 @@ namespace ee
     {
         if (address & 0x1)
             Errors::die("[EE] Read16 from invalid address $%08X, PC: $%08X", address, PC);
-        uint8_t* mem = tlb_map[address / 4096];
+        uint8_t* mem = tlb_map->lookup(address);
         if (mem > (uint8_t*)1)
             return *(uint16_t*)&mem[address & 4095];
         else if (mem == (uint8_t*)1)
@@ -448,7 +449,7 @@ namespace ee
     {
         if (address & 0x3)
             Errors::die("[EE] Read32 from invalid address $%08X, PC: $%08X", address, PC);
-        uint8_t* mem = tlb_map[address / 4096];
+        uint8_t* mem = tlb_map->lookup(address);
         if (mem > (uint8_t*)1)
             return *(uint32_t*)&mem[address & 4095];
         else if (mem == (uint8_t*)1)
@@ -463,7 +464,7 @@ namespace ee
     {
         if (address & 0x7)
             Errors::die("[EE] Read64 from invalid address $%08X, PC: $%08X", address, PC);
-        uint8_t* mem = tlb_map[address / 4096];
+        uint8_t* mem = tlb_map->lookup(address);
         if (mem > (uint8_t*)1)
             return *(uint64_t*)&mem[address & 4095];
         else if (mem == (uint8_t*)1)
@@ -476,7 +477,7 @@ namespace ee
 
     uint128_t EmotionEngine::read128(uint32_t address)
     {
-        uint8_t* mem = tlb_map[address / 4096];
+        uint8_t* mem = tlb_map->lookup(address);
         if (mem > (uint8_t*)1)
             return *(uint128_t*)&mem[address & 4095];
         else if (mem == (uint8_t*)1)
@@ -495,7 +496,7 @@ namespace ee
 
     void EmotionEngine::write8(uint32_t address, uint8_t value)
     {
-        uint8_t* mem = tlb_map[address / 4096];
+        uint8_t* mem = tlb_map->lookup(address);
         if (mem > (uint8_t*)1)
         {
             cp0->set_tlb_modified(address / 4096);
@@ -511,7 +512,7 @@ namespace ee
     {
         if (address & 0x1)
             Errors::die("[EE] Write16 to invalid address $%08X: $%04X, PC: $%08X", address, value, PC);
-        uint8_t* mem = tlb_map[address / 4096];
+        uint8_t* mem = tlb_map->lookup(address);
         if (mem > (uint8_t*)1)
         {
             cp0->set_tlb_modified(address / 4096);
@@ -527,7 +528,7 @@ namespace ee
     {
         if (address & 0x3)
             Errors::die("[EE] Write32 to invalid address $%08X: $%08X, PC: $08X", address, value, PC);
-        uint8_t* mem = tlb_map[address / 4096];
+        uint8_t* mem = tlb_map->lookup(address);
         if (mem > (uint8_t*)1)
         {
             cp0->set_tlb_modified(address / 4096);
@@ -543,7 +544,7 @@ namespace ee
     {
         if (address & 0x7)
             Errors::die("[EE] Write64 to invalid address $%08X: %llX, PC: $%08X", address, value, PC);
-        uint8_t* mem = tlb_map[address / 4096];
+        uint8_t* mem = tlb_map->lookup(address);
         if (mem > (uint8_t*)1)
         {
             cp0->set_tlb_modified(address / 4096);
@@ -557,7 +558,7 @@ namespace ee
 
     void EmotionEngine::write128(uint32_t address, uint128_t value)
     {
-        uint8_t* mem = tlb_map[address / 4096];
+        uint8_t* mem = tlb_map->lookup(address);
         if (mem > (uint8_t*)1)
         {
             cp0->set_tlb_modified(address / 4096);
@@ -93,7 +93,7 @@ namespace ee
         std::unique_ptr<Cop0> cp0;
         std::unique_ptr<Cop1> fpu;
 
-        uint8_t** tlb_map;
+        VTLB* tlb_map;
 
         EE_OsdConfigParam osd_config_param;
 
@@ -219,6 +219,11 @@ namespace ipu
             dmac->set_DMA_request(ee::DMAC_CHANNELS::IPU_FROM);
     }
 
+    bool ImageProcessingUnit::is_busy()
+    {
+        return ctrl.busy;
+    }
+
     void ImageProcessingUnit::finish_command()
     {
         ctrl.busy = false;
@@ -242,6 +242,7 @@ namespace ipu
 
         void reset();
         void run();
+        bool is_busy();
 
         uint64_t read_command();
         uint32_t read_control();
@@ -76,6 +76,7 @@ namespace ee
             saved_int_regs = std::vector<REG_64>();
             saved_xmm_regs = std::vector<REG_64>();
             cycles_added = 0;
+            idle_loop = false;
             for (int i = 0; i < 16; i++)
             {
                 xmm_regs[i].used = false;
@@ -213,6 +214,8 @@ namespace ee
             cycles_added = 0;
             ee_branch = false;
             likely_branch = false;
+            idle_loop = block.is_idle_loop();
+            idle_loop_pc = ee.get_PC();
             saved_int_regs = std::vector<REG_64>();
             saved_xmm_regs = std::vector<REG_64>();
 
@@ -1543,6 +1546,9 @@ namespace ee
             emitter.ADD64_REG_IMM(cycles - cycles_added, REG_64::RAX);
             emitter.MOV64_TO_MEM(REG_64::RAX, REG_64::R15, offsetof(EmotionEngine, cycle_count));
 
+            if (idle_loop)
+                skip_idle_loop();
+
             //Clean up stack, has to be handled before we enter dispatcher
             emitter.ADD64_REG_IMM(0x1B8, REG_64::RSP);
             emitter.POP(REG_64::RBP);
@@ -1554,6 +1560,27 @@ namespace ee
                 emit_epilogue();
         }
 
+        void EE_JIT64::skip_idle_loop()
+        {
+            // If the loop branched back to itself, nothing it polls can change until the other components run,
+            // so spend the rest of the timeslice at once like WAIT does instead of spinning through it
+            emitter.CMP32_IMM_MEM(idle_loop_pc, REG_64::R15, offsetof(EmotionEngine, PC));
+            uint8_t* loop_exited = emitter.JCC_NEAR_DEFERRED(ConditionCode::NE);
+
+            emitter.MOV32_FROM_MEM(REG_64::R15, REG_64::RAX, offsetof(EmotionEngine, cycles_to_run));
+            emitter.TEST32_REG(REG_64::RAX, REG_64::RAX);
+            uint8_t* timeslice_over = emitter.JCC_NEAR_DEFERRED(ConditionCode::LE);
+
+            // cycle_count += cycles_to_run; cycles_to_run = 0
+            emitter.MOV64_FROM_MEM(REG_64::R15, REG_64::RCX, offsetof(EmotionEngine, cycle_count));
+            emitter.ADD64_REG(REG_64::RAX, REG_64::RCX);
+            emitter.MOV64_TO_MEM(REG_64::RCX, REG_64::R15, offsetof(EmotionEngine, cycle_count));
+            emitter.MOV32_IMM_MEM(0, REG_64::R15, offsetof(EmotionEngine, cycles_to_run));
+
+            emitter.set_jump_dest(loop_exited);
+            emitter.set_jump_dest(timeslice_over);
+        }
+
         void EE_JIT64::emit_prologue()
         {
             emitter.PUSH(REG_64::RBX);
@@ -93,6 +93,10 @@ namespace ee
             // Cycles added to the cycle count in the middle of the block, e.g. UpdateVU0
             uint64_t cycles_added;
 
+            // Set while recompiling a block the translator marked as an idle loop
+            bool idle_loop;
+            uint32_t idle_loop_pc;
+
             bool should_update_mac;
 
             //Pointer to the dispatcher prologue that begins execution of recompiled code
@@ -319,6 +323,7 @@ namespace ee
             void emit_instruction(EmotionEngine& ee, IR::Instruction& instr);
             EEJitBlockRecord* recompile_block(EmotionEngine& ee, IR::Block& block);
             void cleanup_recompiler(EmotionEngine& ee, bool clear_regs, bool dispatcher, uint64_t cycles);
+            void skip_idle_loop();
             void emit_epilogue();
         public:
             EE_JIT64();
@@ -119,9 +119,8 @@ namespace ee
                 if (instr.op != IR::Opcode::Null)
                     block.add_instr(instr);
 
-
-
             block.set_cycle_count(cycle_count);
+            block.set_idle_loop(is_idle_loop(ee, ee.get_PC(), instr_info));
 
             return block;
         }
@@ -491,6 +490,171 @@ namespace ee
             cycle_count += total_penalty;
         }
 
+        //Games often spin on INTC_STAT, D_STAT or a flag in RAM while they wait for an interrupt handler or a DMA.
+        //A block is one of those loops if it branches back to its own start and every pass does exactly the same thing:
+        //nothing is stored, loads come from fixed addresses, and no register carries a value from one pass to the next.
+        //Nothing it reads can change until the rest of the system runs, so the timeslice can be skipped once it loops.
+        bool EE_JitTranslator::is_idle_loop(EmotionEngine& ee, uint32_t pc, const std::vector<EE_InstrInfo>& instr_info) const
+        {
+            const size_t MAX_IDLE_LOOP_SIZE = 8;
+            if (instr_info.size() < 2 || instr_info.size() > MAX_IDLE_LOOP_SIZE)
+                return false;
+
+            //A block ends with a branch and its delay slot
+            size_t branch_index = instr_info.size() - 2;
+            uint32_t branch_pc = pc + (uint32_t)branch_index * 4;
+            uint32_t branch = ee.read32(branch_pc);
+            uint32_t dest;
+            switch (branch >> 26)
+            {
+                case 0x01: // BLTZ, BGEZ, BLTZL, BGEZL
+                    if (((branch >> 16) & 0x1F) > 0x03)
+                        return false;
+                    dest = branch_offset_ee(branch, branch_pc);
+                    break;
+                case 0x02: // J
+                    dest = jump_offset_ee(branch, branch_pc);
+                    break;
+                case 0x04: // BEQ
+                case 0x05: // BNE
+                case 0x06: // BLEZ
+                case 0x07: // BGTZ
+                case 0x14: // BEQL
+                case 0x15: // BNEL
+                case 0x16: // BLEZL
+                case 0x17: // BGTZL
+                    dest = branch_offset_ee(branch, branch_pc);
+                    break;
+                case 0x10: // BC0 - waiting on CPCOND0 for a DMA to finish
+                    if (((branch >> 21) & 0x1F) != 0x08)
+                        return false;
+                    dest = branch_offset_ee(branch, branch_pc);
+                    break;
+                default:
+                    return false;
+            }
+            if (dest != pc)
+                return false;
+
+            bool loop_writes[32] = {};
+            for (const EE_InstrInfo& info : instr_info)
+            {
+                for (size_t i = 0; i < info.write_dependencies.size(); i++)
+                {
+                    EE_DependencyInfo dep;
+                    info.get_dependency(dep, i, DependencyType::Write);
+                    if (dep.type == RegType::GPR)
+                        loop_writes[dep.reg] = true;
+                }
+            }
+
+            //Track constant register values so that every load's address is known. Registers the loop never writes
+            //keep the value they have now for as long as it spins.
+            bool known[32];
+            uint32_t value[32];
+            for (int i = 0; i < 32; i++)
+            {
+                known[i] = !loop_writes[i];
+                value[i] = ee.get_gpr<uint32_t>(i);
+            }
+            known[0] = true;
+            value[0] = 0;
+
+            bool written[32] = {};
+            for (size_t i = 0; i < instr_info.size(); i++)
+            {
+                uint32_t opcode = ee.read32(pc + (uint32_t)i * 4);
+                uint8_t op = opcode >> 26;
+                int rs = (opcode >> 21) & 0x1F;
+                uint32_t imm = opcode & 0xFFFF;
+
+                if (i != branch_index)
+                {
+                    switch (op)
+                    {
+                        case 0x00: // SPECIAL
+                            switch (opcode & 0x3F)
+                            {
+                                case 0x00: case 0x02: case 0x03: // SLL, SRL, SRA
+                                case 0x04: case 0x06: case 0x07: // SLLV, SRLV, SRAV
+                                case 0x0F: // SYNC
+                                case 0x14: case 0x16: case 0x17: // DSLLV, DSRLV, DSRAV
+                                case 0x21: case 0x23: // ADDU, SUBU
+                                case 0x24: case 0x25: case 0x26: case 0x27: // AND, OR, XOR, NOR
+                                case 0x2A: case 0x2B: // SLT, SLTU
+                                case 0x2D: case 0x2F: // DADDU, DSUBU
+                                case 0x38: case 0x3A: case 0x3B: // DSLL, DSRL, DSRA
+                                case 0x3C: case 0x3E: case 0x3F: // DSLL32, DSRL32, DSRA32
+                                    break;
+                                default:
+                                    return false;
+                            }
+                            break;
+                        case 0x09: case 0x0A: case 0x0B: // ADDIU, SLTI, SLTIU
+                        case 0x0C: case 0x0D: case 0x0E: // ANDI, ORI, XORI
+                        case 0x0F: case 0x19: // LUI, DADDIU
+                            break;
+                        case 0x1E: // LQ
+                        case 0x20: case 0x21: case 0x23: // LB, LH, LW
+                        case 0x24: case 0x25: case 0x27: // LBU, LHU, LWU
+                        case 0x37: // LD
+                        {
+                            if (!known[rs])
+                                return false;
+
+                            //Reading the VIF, GIF and IPU FIFOs pops them
+                            uint32_t addr = (value[rs] + (int16_t)imm) & 0x1FFFFFFF;
+                            if (addr >= 0x10004000 && addr < 0x10008000)
+                                return false;
+                            break;
+                        }
+                        default:
+                            return false;
+                    }
+                }
+
+                //A register read before the loop writes it would carry a value over from the previous pass
+                for (size_t j = 0; j < instr_info[i].read_dependencies.size(); j++)
+                {
+                    EE_DependencyInfo dep;
+                    instr_info[i].get_dependency(dep, j, DependencyType::Read);
+                    if (dep.type == RegType::GPR && dep.reg && loop_writes[dep.reg] && !written[dep.reg])
+                        return false;
+                }
+
+                for (size_t j = 0; j < instr_info[i].write_dependencies.size(); j++)
+                {
+                    EE_DependencyInfo dep;
+                    instr_info[i].get_dependency(dep, j, DependencyType::Write);
+                    if (dep.type != RegType::GPR || !dep.reg)
+                        continue;
+
+                    written[dep.reg] = true;
+                    switch (op)
+                    {
+                        case 0x09: // ADDIU
+                        case 0x19: // DADDIU
+                            known[dep.reg] = known[rs];
+                            value[dep.reg] = value[rs] + (int16_t)imm;
+                            break;
+                        case 0x0D: // ORI
+                            known[dep.reg] = known[rs];
+                            value[dep.reg] = value[rs] | imm;
+                            break;
+                        case 0x0F: // LUI
+                            known[dep.reg] = true;
+                            value[dep.reg] = imm << 16;
+                            break;
+                        default:
+                            known[dep.reg] = false;
+                            break;
+                    }
+                }
+            }
+
+            return true;
+        }
+
         void EE_JitTranslator::translate_op(uint32_t opcode, uint32_t PC, EE_InstrInfo& info, std::vector<IR::Instruction>& instrs)
         {
             uint8_t op = opcode >> 26;
@@ -0,0 +1,177 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <vector>
+
+namespace ee
+{
+    //A vtlb maps every 4 KB page of the EE's 4 GB virtual address space to host memory.
+    //Entries are nullptr for unmapped pages and (uint8_t*)1 for MMIO, which goes through the Emulator.
+
+    //One pointer per page: a single load per lookup, but 8 MB per map.
+    class FlatVTLB
+    {
+        private:
+            std::unique_ptr<uint8_t*[]> pages;
+        public:
+            constexpr static int PAGE_SHIFT = 12;
+            constexpr static uint32_t PAGE_COUNT = 1 << (32 - PAGE_SHIFT);
+
+            FlatVTLB();
+
+            void clear();
+            void compact() {}
+            std::size_t memory_used() const;
+
+            uint8_t* lookup(uint32_t address) const;
+            void set(uint32_t page, uint8_t* mem);
+    };
+
+    //A directory of 1024 tables, each covering 4 MB. Tables with the same contents are shared after compact(),
+    //so the RDRAM mirrors, the MMIO range and unmapped space cost one table each instead of megabytes of pointers.
+    //A shared table is copied the first time one of its pages changes.
+    class TwoLevelVTLB
+    {
+        public:
+            constexpr static int PAGE_SHIFT = 12;
+            constexpr static int TABLE_SHIFT = 22;
+            constexpr static uint32_t PAGE_COUNT = 1 << (32 - PAGE_SHIFT);
+            constexpr static uint32_t TABLE_COUNT = 1 << (32 - TABLE_SHIFT);
+            constexpr static uint32_t TABLE_ENTRIES = 1 << (TABLE_SHIFT - PAGE_SHIFT);
+        private:
+            uint8_t** tables[TABLE_COUNT];
+            bool shared[TABLE_COUNT];
+            std::vector<std::unique_ptr<uint8_t*[]>> storage;
+            std::unique_ptr<uint8_t*[]> empty_table;
+
+            uint8_t** new_table(uint8_t* const* contents);
+        public:
+            TwoLevelVTLB();
+
+            void clear();
+            void compact();
+            std::size_t memory_used() const;
+
+            uint8_t* lookup(uint32_t address) const;
+            void set(uint32_t page, uint8_t* mem);
+    };
+
+#ifdef DOBIE_TWO_LEVEL_VTLB
+    using VTLB = TwoLevelVTLB;
+#else
+    using VTLB = FlatVTLB;
+#endif
+
+    inline FlatVTLB::FlatVTLB() : pages(std::make_unique<uint8_t*[]>(PAGE_COUNT))
+    {
+
+    }
+
+    inline void FlatVTLB::clear()
+    {
+        std::memset(pages.get(), 0, PAGE_COUNT * sizeof(uint8_t*));
+    }
+
+    inline std::size_t FlatVTLB::memory_used() const
+    {
+        return PAGE_COUNT * sizeof(uint8_t*);
+    }
+
+    inline uint8_t* FlatVTLB::lookup(uint32_t address) const
+    {
+        return pages[address >> PAGE_SHIFT];
+    }
+
+    inline void FlatVTLB::set(uint32_t page, uint8_t* mem)
+    {
+        pages[page] = mem;
+    }
+
+    inline TwoLevelVTLB::TwoLevelVTLB() : empty_table(std::make_unique<uint8_t*[]>(TABLE_ENTRIES))
+    {
+        clear();
+    }
+
+    inline uint8_t** TwoLevelVTLB::new_table(uint8_t* const* contents)
+    {
+        storage.push_back(std::make_unique<uint8_t*[]>(TABLE_ENTRIES));
+        uint8_t** table = storage.back().get();
+        std::memcpy(table, contents, TABLE_ENTRIES * sizeof(uint8_t*));
+        return table;
+    }
+
+    inline void TwoLevelVTLB::clear()
+    {
+        storage.clear();
+        for (uint32_t i = 0; i < TABLE_COUNT; i++)
+        {
+            tables[i] = empty_table.get();
+            shared[i] = true;
+        }
+    }
+
+    inline void TwoLevelVTLB::compact()
+    {
+        std::vector<uint8_t**> unique_tables = { empty_table.get() };
+        for (uint32_t i = 0; i < TABLE_COUNT; i++)
+        {
+            if (shared[i])
+                continue;
+
+            bool duplicate = false;
+            for (uint8_t** table : unique_tables)
+            {
+                if (!std::memcmp(table, tables[i], TABLE_ENTRIES * sizeof(uint8_t*)))
+                {
+                    tables[i] = table;
+                    duplicate = true;
+                    break;
+                }
+            }
+            if (!duplicate)
+                unique_tables.push_back(tables[i]);
+        }
+
+        //Only keep the tables still in use, and mark every slot so that a write copies its table first
+        std::vector<std::unique_ptr<uint8_t*[]>> in_use;
+        for (auto& table : storage)
+        {
+            for (uint8_t** unique : unique_tables)
+            {
+                if (table.get() == unique)
+                {
+                    in_use.push_back(std::move(table));
+                    break;
+                }
+            }
+        }
+        storage = std::move(in_use);
+        for (uint32_t i = 0; i < TABLE_COUNT; i++)
+            shared[i] = true;
+    }
+
+    inline std::size_t TwoLevelVTLB::memory_used() const
+    {
+        return sizeof(tables) + sizeof(shared) + (storage.size() + 1) * TABLE_ENTRIES * sizeof(uint8_t*);
+    }
+
+    inline uint8_t* TwoLevelVTLB::lookup(uint32_t address) const
+    {
+        return tables[address >> TABLE_SHIFT][(address >> PAGE_SHIFT) & (TABLE_ENTRIES - 1)];
+    }
+
+    inline void TwoLevelVTLB::set(uint32_t page, uint8_t* mem)
+    {
+        uint32_t index = page >> (TABLE_SHIFT - PAGE_SHIFT);
+        if (shared[index])
+        {
+            if (tables[index][page & (TABLE_ENTRIES - 1)] == mem)
+                return;
+            tables[index] = new_table(tables[index]);
+            shared[index] = false;
+        }
+        tables[index][page & (TABLE_ENTRIES - 1)] = mem;
+    }
+}
@@ -133,6 +133,7 @@ namespace vu
 
         void reset();
         void update(int cycles);
+        bool is_idle();
         bool transfer_word(uint32_t value);
         bool transfer_DMAtag(uint128_t tag);
         bool feed_DMA(uint128_t quad);
@@ -159,4 +160,11 @@ namespace vu
     {
         return id;
     }
+
+    //True when update() has nothing to decode, transfer or wait for
+    inline bool VectorInterface::is_idle()
+    {
+        return !fifo_reverse && !vif_stalled && !stall_condition_active && vif_cmd_status == VIF_IDLE &&
+            (command & 0x60) != 0x60 && FIFO.empty() && internal_FIFO.empty();
+    }
 }
\ No newline at end of file
@@ -248,6 +248,7 @@ namespace vu
         std::function<void(VectorUnit&)> run_func;
 
         bool is_running();
+        bool is_idle();
         bool stopped_by_tbit();
         bool is_dirty();
         void clear_dirty();
@@ -468,6 +469,13 @@ namespace vu
         return running || (eecpu->get_cycle_count() < cycle_count);
     }
 
+    //Stopped with no XGKICK left to send. For VU1, run() would then only bring cycle_count
+    //up to the EE's, which start_program does anyway.
+    inline bool VectorUnit::is_idle()
+    {
+        return !running && !transferring_GIF;
+    }
+
     inline bool VectorUnit::stopped_by_tbit()
     {
         return tbit_stop;
@@ -11,6 +11,7 @@
 #include <iop/iop.hpp>
 #include <iop/dma.hpp>
 #include <iop/intc.hpp>
+#include <iop/jit/iop_jit.hpp>
 #include <iop/timers.hpp>
 #include <iop/sio2/memcard.hpp>
 #include <iop/sio2/sio2.hpp>
@@ -21,6 +22,7 @@
 #include <ee/vu/vu_jit.hpp>
 #include <ee/jit/ee_jit.hpp>
 #include <sif.hpp>
+#include <algorithm>
 #include <cfenv>
 #include <cstring>
 #include <cstdio>
@@ -50,7 +52,8 @@ constexpr uint32_t VBLANK_START_CYCLES = 4498391; // 4498391.041219564 EE cycles
 
 namespace core
 {
-    Emulator::Emulator()
+    //Both maps cover the 512 MB physical address space
+    Emulator::Emulator() : ee_mmio(0x20000000), iop_mmio(0x20000000)
     {
         BIOS = nullptr;
         SPU_RAM = nullptr;
@@ -62,7 +65,7 @@ namespace core
         cpu = std::make_unique<ee::EmotionEngine>(this);
         dmac = std::make_unique<ee::DMAC>(this);
         intc = std::make_unique<ee::INTC>(cpu.get(), scheduler.get());
-        gs = std::make_unique<gs::GraphicsSynthesizer>(intc.get());
+        gs = std::make_unique<gs::GraphicsSynthesizer>(intc.get(), scheduler.get());
         gif = std::make_unique<gs::GraphicsInterface>(gs.get(), dmac.get());
         iop = std::make_unique<iop::IOP>(this);
         iop_intc = std::make_unique<iop::INTC>(iop.get());
@@ -84,11 +87,18 @@ namespace core
         memcard = std::make_unique<sio2::Memcard>();
         sio2 = std::make_unique<sio2::SIO2>(iop_intc.get(), pad.get(), memcard.get());
 
+        map_ee_mmio();
+        map_iop_mmio();
+
         gsdump_single_frame = false;
         ee_log.open("ee_log.txt", std::ios::out);
         set_ee_mode(CPU_MODE::DONT_CARE);
         set_vu0_mode(CPU_MODE::DONT_CARE);
         set_vu1_mode(CPU_MODE::DONT_CARE);
+        set_iop_mode(CPU_MODE::DONT_CARE);
+        set_timeslice_mode(TimesliceMode::Fixed);
+        timeslice_stats = {};
+        last_timeslice_stats = {};
         spu->gaussianConstructTable();
     }
 
@@ -134,36 +144,90 @@ namespace core
         memcard->save_if_dirty();
 
         frame_ended = false;
+        timeslice_stats = {};
 
         scheduler->add_event(vblank_start_id, VBLANK_START_CYCLES);
         scheduler->add_event(vblank_end_id, CYCLES_PER_FRAME);
     
         while (!frame_ended)
         {
+            if (timeslice_mode == TimesliceMode::Adaptive)
+                scheduler->set_max_run_cycles(needs_short_timeslice() ? Scheduler::DEFAULT_RUN_CYCLES : timeslice_skew);
+
             int ee_cycles = scheduler->calculate_run_cycles();
             int bus_cycles = scheduler->get_bus_run_cycles();
             int iop_cycles = scheduler->get_iop_run_cycles();
             scheduler->update_cycle_counts();
 
+            timeslice_stats.timeslices++;
+            if (ee_cycles > (int)Scheduler::DEFAULT_RUN_CYCLES)
+                timeslice_stats.long_timeslices++;
+
+            //Components with nothing to do are skipped. Their run functions would return
+            //without changing any state, so this is the same in both timeslice modes.
             cpu->run(ee_cycles);
-            iop_dma->run(iop_cycles);
-            iop->run(iop_cycles);
+            if (!iop_dma->is_idle())
+            {
+                iop_dma->run(iop_cycles);
+                timeslice_stats.iop_dma++;
+            }
+            if (!iop->is_halted())
+            {
+                iop->run(iop_cycles);
+                timeslice_stats.iop++;
+            }
 
-            dmac->run(bus_cycles);
+            if (!dmac->is_idle())
+            {
+                dmac->run(bus_cycles);
+                timeslice_stats.dmac++;
+            }
+
+            //IPU also raises DMA requests for its FIFOs when it isn't decoding
+            if (ipu->is_busy())
+                timeslice_stats.ipu++;
             ipu->run();
-            vif0->update(bus_cycles);
-            vif1->update(bus_cycles);
+
+            if (!vif0->is_idle())
+            {
+                vif0->update(bus_cycles);
+                timeslice_stats.vif0++;
+            }
+            if (!vif1->is_idle())
+            {
+                vif1->update(bus_cycles);
+                timeslice_stats.vif1++;
+            }
+
+            //GIF can mask PATH3 with an empty FIFO
+            if (!gif->fifo_empty())
+                timeslice_stats.gif++;
             gif->run(bus_cycles);
         
             //VU's run at EE speed, however both maintain their own speed
+            //VU0 keeps COP2's pipelines up to date even when stopped
+            if (!vu0->is_idle())
+                timeslice_stats.vu0++;
             vu0->run_func(*vu0.get());
-            vu1->run_func(*vu1.get());
+            if (!vu1->is_idle())
+            {
+                vu1->run_func(*vu1.get());
+                timeslice_stats.vu1++;
+            }
 
             scheduler->process_events();
         }
+        last_timeslice_stats = timeslice_stats;
         fesetround(originalRounding);
     }
 
+    //Work that has the EE or other components waiting on it every few cycles
+    bool Emulator::needs_short_timeslice()
+    {
+        return !dmac->is_idle() || !iop_dma->is_idle() || ipu->is_busy() || !gif->fifo_empty() ||
+            !vif0->is_idle() || !vif1->is_idle() || !vu0->is_idle() || !vu1->is_idle();
+    }
+
     void Emulator::reset()
     {
         save_requested = false;
@@ -223,7 +287,7 @@ namespace core
         spu_event_id = scheduler->register_function([this] (uint64_t param) { gen_sound_sample(); });
         gs_vblank_event_id = scheduler->register_function([this](uint64_t param) { GS_vblank_event(); });
 
-        scheduler->add_event(hblank_event_id, HBLANK_CYCLES);
+        hblank_event_pending = false;
         start_sound_sample_event();
     }
 
@@ -237,8 +301,19 @@ namespace core
 
     void Emulator::hblank_event()
     {
+        hblank_event_pending = false;
         gs->assert_HBLANK();
-        scheduler->add_event(hblank_event_id, HBLANK_CYCLES);
+        schedule_HBLANK_event();
+    }
+
+    //CSR works out HBLANK from the EE cycle count, so an event is only needed to raise HSINT on time
+    void Emulator::schedule_HBLANK_event()
+    {
+        if (hblank_event_pending || !gs->HBLANK_irq_enabled())
+            return;
+
+        scheduler->add_event(hblank_event_id, HBLANK_CYCLES - scheduler->get_ee_cycles() % HBLANK_CYCLES);
+        hblank_event_pending = true;
     }
 
     void Emulator::GS_vblank_event()
@@ -412,6 +487,51 @@ namespace core
         vu::jit::reset(vu1.get());
     }
 
+    //The IOP recompiler is new, so unlike the EE the interpreter stays the default
+    void Emulator::set_iop_mode(CPU_MODE mode)
+    {
+        switch (mode)
+        {
+            case CPU_MODE::JIT:
+                iop->set_jit(true);
+                break;
+            case CPU_MODE::INTERPRETER:
+            default:
+                iop->set_jit(false);
+                break;
+        }
+
+        iop::jit::reset(true);
+    }
+
+    void Emulator::set_frameskip(gs::FrameskipMode mode, int interval)
+    {
+        gs->set_frameskip(mode, interval);
+    }
+
+    void Emulator::set_timeslice_mode(TimesliceMode mode, uint32_t max_skew)
+    {
+        timeslice_mode = mode;
+        timeslice_skew = std::max(max_skew, (uint32_t)Scheduler::DEFAULT_RUN_CYCLES);
+        scheduler->set_max_run_cycles(Scheduler::DEFAULT_RUN_CYCLES);
+    }
+
+    //Counters for the last frame run() finished
+    const TimesliceStats& Emulator::get_timeslice_stats() const
+    {
+        return last_timeslice_stats;
+    }
+
+    std::string TimesliceStats::to_json() const
+    {
+        char buffer[512];
+        snprintf(buffer, sizeof(buffer),
+            "{\"timeslices\": %u, \"long_timeslices\": %u, \"iop\": %u, \"iop_dma\": %u, \"dmac\": %u, "
+            "\"ipu\": %u, \"gif\": %u, \"vif0\": %u, \"vif1\": %u, \"vu0\": %u, \"vu1\": %u}",
+            timeslices, long_timeslices, iop, iop_dma, dmac, ipu, gif, vif0, vif1, vu0, vu1);
+        return buffer;
+    }
+
     void Emulator::load_BIOS(const uint8_t *BIOS_file)
     {
         if (!BIOS)
@@ -428,6 +548,7 @@ namespace core
             return;
         }
         fmt::print("[CORE] Valid ELF found.\n");
+        gs->load_jit_warmup("");
         delete[] ELF_file;
         ELF_file = new uint8_t[size];
         ELF_size = size;
@@ -436,7 +557,11 @@ namespace core
 
     bool Emulator::load_CDVD(const char *name, cdvd::CDVD_CONTAINER type)
     {
-        return cdvd->load_disc(name, type);
+        if (!cdvd->load_disc(name, type))
+            return false;
+
+        gs->load_jit_warmup(get_serial());
+        return true;
     }
 
     void Emulator::load_memcard(int port, const char *name)
@@ -532,531 +657,52 @@ namespace core
 
     uint8_t Emulator::read8(uint32_t address)
     {
-        if (address >= 0x1C000000 && address < 0x1C200000)
-            return iop->ram[address & 0x1FFFFF];
-        if (address >= 0x10000000 && address < 0x10002000)
-            return (timers->read32(address & ~0xF) >> (8 * (address & 0x3)));
-        if ((address & (0xFF000000)) == 0x12000000)
-            return (gs->read32_privileged(address & ~0x3) >> (8 * (address & 0x3)));
-        if (address >= 0x10008000 && address < 0x1000F000)
-            return dmac->read<uint8_t>(address);
-        if (address >= 0x11000000 && address < 0x11004000)
-            return vu0->read_instr<uint8_t>(address);
-        if (address >= 0x11004000 && address < 0x11008000)
-            return vu0->read_mem<uint8_t>(address);
-        if (address >= 0x11008000 && address < 0x1100C000)
-            return vu1->read_instr<uint8_t>(address);
-        if (address >= 0x1100C000 && address < 0x11010000)
-            return vu1->read_mem<uint8_t>(address);
-        switch (address)
-        {
-            case 0x1F40200F:
-                return cdvd->read_disc_type();
-            case 0x1F402017:
-                return cdvd->read_S_status();
-            case 0x1F402018:
-                return cdvd->read_S_data();
-        }
-    
-        fmt::print("[CORE] Unrecognized read8 at physical address {:#x}\n", address);
-        return 0;
+        return ee_mmio.read<uint8_t>(address);
     }
 
     uint16_t Emulator::read16(uint32_t address)
     {
-        if (address >= 0x10000000 && address < 0x10002000)
-            return (uint16_t)timers->read32(address);
-        if (address >= 0x10008000 && address < 0x1000F000)
-            return dmac->read<uint16_t>(address);
-        if ((address & (0xFF000000)) == 0x12000000)
-            return (gs->read32_privileged(address & ~0x3) >> (8 * (address & 0x2)));
-        if (address >= 0x1C000000 && address < 0x1C200000)
-            return *(uint16_t*)&iop->ram[address & 0x1FFFFF];
-        if (address >= 0x11000000 && address < 0x11004000)
-            return vu0->read_instr<uint16_t>(address);
-        if (address >= 0x11004000 && address < 0x11008000)
-            return vu0->read_mem<uint16_t>(address);
-        if (address >= 0x11008000 && address < 0x1100C000)
-            return vu1->read_instr<uint16_t>(address);
-        if (address >= 0x1100C000 && address < 0x11010000)
-            return vu1->read_mem<uint16_t>(address);
-        switch (address)
-        {
-            case 0x10003C30:
-                return vif1->get_mark() & 0xFFFF;
-            case 0x1A000006:
-                return 1;
-        }
-    
-        fmt::print("[CORE] Unrecognized read16 at physical address {:#x}\n", address);
-        return 0;
+        return ee_mmio.read<uint16_t>(address);
     }
 
     uint32_t Emulator::read32(uint32_t address)
     {
-        if (address >= 0x10000000 && address < 0x10002000)
-            return timers->read32(address);
-        if ((address & (0xFF000000)) == 0x12000000)
-            return gs->read32_privileged(address);
-        if (address >= 0x10008000 && address < 0x1000F000)
-            return dmac->read<uint32_t>(address);
-        if (address >= 0x1C000000 && address < 0x1C200000)
-            return *(uint32_t*)&iop->ram[address & 0x1FFFFF];
-        if (address >= 0x11000000 && address < 0x11004000)
-            return vu0->read_instr<uint32_t>(address);
-        if (address >= 0x11004000 && address < 0x11008000)
-            return vu0->read_mem<uint32_t>(address);
-        if (address >= 0x11008000 && address < 0x1100C000)
-            return vu1->read_instr<uint32_t>(address);
-        if (address >= 0x1100C000 && address < 0x11010000)
-            return vu1->read_mem<uint32_t>(address);
-        switch (address)
-        {
-            case 0x10002000:
-                return ipu->read_command();
-            case 0x10002010:
-                return ipu->read_control();
-            case 0x10002020:
-                return ipu->read_BP();
-            case 0x10002030:
-                return ipu->read_top();
-            case 0x10003020:
-                return gif->read_STAT();
-            case 0x10003800:
-                return vif0->get_stat();
-            case 0x10003850:
-                return vif0->get_mode();
-            case 0x10003900:
-            case 0x10003910:
-            case 0x10003920:
-            case 0x10003930:
-                return vif0->get_row(address);
-            case 0x10003C00:
-                return vif1->get_stat();
-            case 0x10003C20:
-                return vif1->get_err();
-            case 0x10003C30:
-                return vif1->get_mark();
-            case 0x10003C50:
-                return vif1->get_mode();
-            case 0x10003C80:
-                return vif1->get_code();
-            case 0x10003CE0:
-                return vif1->get_top();
-            case 0x10003D00:
-            case 0x10003D10:
-            case 0x10003D20:
-            case 0x10003D30:
-                return vif1->get_row(address);
-            case 0x1000F000:
-                //printf("\nRead32 INTC_STAT: $%08X", intc->read_stat());
-                return intc->read_stat();
-            case 0x1000F010:
-                printf("Read32 INTC_MASK: $%08X\n", intc->read_mask());
-                return intc->read_mask();
-            case 0x1000F130:
-                return 0;
-            case 0x1000F200:
-                return sif->get_mscom();
-            case 0x1000F210:
-                return sif->get_smcom();
-            case 0x1000F220:
-                return sif->get_msflag();
-            case 0x1000F230:
-                return sif->get_smflag();
-            case 0x1000F240:
-                printf("[EE] Read BD4: $%08X\n", sif->get_control() | 0xF0000102);
-                return sif->get_control() | 0xF0000102;
-            case 0x1000F430:
-                //printf("Read from MCH_RICM\n");
-                return 0;
-            case 0x1000F440:
-                //printf("Read from MCH_DRD\n");
-                if (!((MCH_RICM >> 6) & 0xF))
-                {
-                    switch ((MCH_RICM >> 16) & 0xFFF)
-                    {
-                        case 0x21:
-                            //printf("Init\n");
-                            if (rdram_sdevid < 2)
-                            {
-                                rdram_sdevid++;
-                                return 0x1F;
-                            }
-                            return 0;
-                        case 0x23:
-                            //printf("ConfigA\n");
-                            return 0x0D0D;
-                        case 0x24:
-                            //printf("ConfigB\n");
-                            return 0x0090;
-                        case 0x40:
-                            //printf("Devid\n");
-                            return MCH_RICM & 0x1F;
-                    }
-                }
-                return 0;
-            case 0x1000F520:
-                return dmac->read_master_disable();
-        }
-    
-        fmt::print("[CORE] Unrecognized read32 at physical addr {:#x}\n", address);
-        return 0;
+        return ee_mmio.read<uint32_t>(address);
     }
 
     uint64_t Emulator::read64(uint32_t address)
     {
-        if (address >= 0x10000000 && address < 0x10002000)
-            return timers->read32(address);
-        if (address >= 0x10008000 && address < 0x1000F000)
-            return dmac->read<uint32_t>(address);
-        if ((address & (0xFF000000)) == 0x12000000)
-            return gs->read64_privileged(address);
-        if (address >= 0x1C000000 && address < 0x1C200000)
-            return *(uint64_t*)&iop->ram[address & 0x1FFFFF];
-        if (address >= 0x11000000 && address < 0x11004000)
-            return vu0->read_instr<uint64_t>(address);
-        if (address >= 0x11004000 && address < 0x11008000)
-            return vu0->read_mem<uint64_t>(address);
-        if (address >= 0x11008000 && address < 0x1100C000)
-            return vu1->read_instr<uint64_t>(address);
-        if (address >= 0x1100C000 && address < 0x11010000)
-            return vu1->read_mem<uint64_t>(address);
-        switch (address)
-        {
-            case 0x10002000:
-                return ipu->read_command();
-            case 0x10002010:
-                return ipu->read_control();
-            case 0x10002020:
-                return ipu->read_BP();
-            case 0x10002030:
-                return ipu->read_top();
-        }
-        fmt::print("[CORE] Unrecognized read64 at physical address {:#x}\n", address);
-        return 0;
+        return ee_mmio.read<uint64_t>(address);
     }
 
     uint128_t Emulator::read128(uint32_t address)
     {
-        if (address >= 0x11000000 && address < 0x11004000)
-            return vu0->read_instr<uint128_t>(address);
-        if (address >= 0x11004000 && address < 0x11008000)
-            return vu0->read_mem<uint128_t>(address);
-        if (address >= 0x11008000 && address < 0x1100C000)
-            return vu1->read_instr<uint128_t>(address);
-        if (address >= 0x1100C000 && address < 0x11010000)
-            return vu1->read_mem<uint128_t>(address);
-
-        if (address == 0x10005000)
-            return std::get<0>(vif1->readFIFO());
-
-        fmt::print("[CORE] Unrecognized read128 at physical address {:#x}\n", address);
-        return uint128_t::from_u32(0);
+        return ee_mmio.read<uint128_t>(address);
     }
 
     void Emulator::write8(uint32_t address, uint8_t value)
     {
-        if (address >= 0x10008000 && address < 0x1000F000)
-        {
-            dmac->write<uint8_t>(address, value);
-            return;
-        }
-        if (address >= 0x1C000000 && address < 0x1C200000)
-        {
-            iop->ram[address & 0x1FFFFF] = value;
-            return;
-        }
-        if (address >= 0x11000000 && address < 0x11004000)
-        {
-            vu0->write_instr<uint8_t>(address, value);
-            return;
-        }
-        if (address >= 0x11004000 && address < 0x11008000)
-        {
-            vu0->write_mem<uint8_t>(address, value);
-            return;
-        }
-        if (address >= 0x11008000 && address < 0x1100C000)
-        {
-            vu1->write_instr<uint8_t>(address, value);
-            return;
-        }
-        if (address >= 0x1100C000 && address < 0x11010000)
-        {
-            vu1->write_mem<uint8_t>(address, value);
-            return;
-        }
-        switch (address)
-        {
-            case 0x1000F180:
-                ee_log << value;
-                ee_log.flush();
-                return;
-        }
-    
-        fmt::print("[CORE] Unrecognized write8 at physical address {:#x} of {:#x}\n", address, value);
+        ee_mmio.write<uint8_t>(address, value);
     }
 
     void Emulator::write16(uint32_t address, uint16_t value)
     {
-        if (address >= 0x10008000 && address < 0x1000F000)
-        {
-            dmac->write<uint16_t>(address, value);
-            return;
-        }
-        if (address >= 0x1C000000 && address < 0x1C200000)
-        {
-            *(uint16_t*)&iop->ram[address & 0x1FFFFF] = value;
-            return;
-        }
-        if (address >= 0x11000000 && address < 0x11004000)
-        {
-            vu0->write_instr<uint16_t>(address, value);
-            return;
-        }
-        if (address >= 0x11004000 && address < 0x11008000)
-        {
-            vu0->write_mem<uint16_t>(address, value);
-            return;
-        }
-        if (address >= 0x11008000 && address < 0x1100C000)
-        {
-            vu1->write_instr<uint16_t>(address, value);
-            return;
-        }
-        if (address >= 0x1100C000 && address < 0x11010000)
-        {
-            vu1->write_mem<uint16_t>(address, value);
-            return;
-        }
-        if (address >= 0x1A000000 && address < 0x1FC00000)
-        {
-            fmt::print("[EE] Unrecognized write16 to IOP address {:#x} of {:#x}\n", address, value);
-            return;
-        }
-    
-        fmt::print("[CORE] Unrecognized write16 at physical address {:#x} of {:#x}\n", address, value);
+        ee_mmio.write<uint16_t>(address, value);
     }
 
     void Emulator::write32(uint32_t address, uint32_t value)
     {
-        if (address >= 0x1C000000 && address < 0x1C200000)
-        {
-            *(uint32_t*)&iop->ram[address & 0x1FFFFF] = value;
-            return;
-        }
-        if (address >= 0x10000000 && address < 0x10002000)
-        {
-            timers->write32(address, value);
-            return;
-        }
-        if ((address & (0xFF000000)) == 0x12000000)
-        {
-            gs->write32_privileged(address, value);
-            gs->wake_gs_thread();
-            return;
-        }
-        if (address >= 0x10008000 && address < 0x1000F000)
-        {
-            dmac->write<uint32_t>(address, value);
-            return;
-        }
-        if (address >= 0x1A000000 && address < 0x1FC00000)
-        {
-            fmt::print("[EE] Unrecognized write32 to IOP address {:#x} of {:#x}\n", address, value);
-            return;
-        }
-        if (address >= 0x11000000 && address < 0x11004000)
-        {
-            vu0->write_instr<uint32_t>(address, value);
-            return;
-        }
-        if (address >= 0x11004000 && address < 0x11008000)
-        {
-            vu0->write_mem<uint32_t>(address, value);
-            return;
-        }
-        if (address >= 0x11008000 && address < 0x1100C000)
-        {
-            vu1->write_instr<uint32_t>(address, value);
-            return;
-        }
-        if (address >= 0x1100C000 && address < 0x11010000)
-        {
-            vu1->write_mem<uint32_t>(address, value);
-            return;
-        }
-
-        switch (address)
-        {
-            case 0x10002000:
-                ipu->write_command(value);
-                return;
-            case 0x10002010:
-                ipu->write_control(value);
-                return;
-            case 0x10003000:
-                gif->write_CTRL(value);
-                return;
-            case 0x10003010:
-                gif->write_MODE(value);
-                return;
-            case 0x10003810:
-                vif0->set_fbrst(value);
-                return;
-            case 0x10003820:
-                vif0->set_err(value);
-                return;
-            case 0x10003830:
-                vif0->set_mark(value);
-                return;
-            case 0x10003c00:
-                vif1->set_stat(value);
-                return;
-            case 0x10003C10:
-                vif1->set_fbrst(value);
-                return;
-            case 0x10003C20:
-                vif1->set_err(value);
-                return;
-            case 0x10003C30:
-                vif1->set_mark(value);
-                return;
-            case 0x10004000:
-                vif0->transfer_word(value);
-                return;
-            case 0x10005000:
-                vif1->transfer_word(value);
-                return;
-            case 0x1000F000:
-                printf("Write32 INTC_STAT: $%08X\n", value);
-                intc->write_stat(value);
-                return;
-            case 0x1000F010:
-                printf("Write32 INTC_MASK: $%08X\n", value);
-                intc->write_mask(value);
-                return;
-            case 0x1000F200:
-                sif->set_mscom(value);
-                return;
-            case 0x1000F210:
-                return;
-            case 0x1000F220:
-                printf("[EE] Write32 msflag: $%08X\n", value);
-                sif->set_msflag(value);
-                return;
-            case 0x1000F230:
-                printf("[EE] Write32 smflag: $%08X\n", value);
-                sif->reset_smflag(value);
-                return;
-            case 0x1000F240:
-                printf("[EE] Write BD4: $%08X\n", value);
-                sif->set_control_EE(value);
-                return;
-            case 0x1000F430:
-                //printf("Write to MCH_RICM: $%08X\n", value);
-                if ((((value >> 16) & 0xFFF) == 0x21) && (((value >> 6) & 0xF) == 1) &&
-                        (((MCH_DRD >> 7) & 1) == 0))
-                    rdram_sdevid = 0;
-                MCH_RICM = value & ~0x80000000;
-                return;
-            case 0x1000F440:
-                //printf("Write to MCH_DRD: $%08X\n", value);
-                MCH_DRD = value;
-                return;
-            case 0x1000F590:
-                dmac->write_master_disable(value);
-                return;
-        }
-        fmt::print("[CORE] Unrecognized write32 at physical address {:#x} of {:#x}\n", address, value);
+        ee_mmio.write<uint32_t>(address, value);
     }
 
     void Emulator::write64(uint32_t address, uint64_t value)
     {
-        if (address >= 0x1C000000 && address < 0x1C200000)
-        {
-            *(uint64_t*)&iop->ram[address & 0x1FFFFF] = value;
-            return;
-        }
-        if (address >= 0x10000000 && address < 0x10002000)
-        {
-            timers->write32(address, value);
-            return;
-        }
-        if (address >= 0x10008000 && address < 0x1000F000)
-        {
-            dmac->write<uint32_t>(address, value);
-            return;
-        }
-        if ((address & (0xFF000000)) == 0x12000000)
-        {
-            gs->write64_privileged(address, value);
-            gs->wake_gs_thread();
-            return;
-        }
-        if (address >= 0x11000000 && address < 0x11004000)
-        {
-            vu0->write_instr<uint64_t>(address, value);
-            return;
-        }
-        if (address >= 0x11004000 && address < 0x11008000)
-        {
-            vu0->write_mem<uint64_t>(address, value);
-            return;
-        }
-        if (address >= 0x11008000 && address < 0x1100C000)
-        {
-            vu1->write_instr<uint64_t>(address, value);
-            return;
-        }
-        if (address >= 0x1100C000 && address < 0x11010000)
-        {
-            vu1->write_mem<uint64_t>(address, value);
-            return;
-        }
-    
-        fmt::print("[CORE] Unrecognized write64 at physical address {:#x} of {:#x}\n", address, value);
+        ee_mmio.write<uint64_t>(address, value);
     }
 
     void Emulator::write128(uint32_t address, uint128_t value)
     {
-        if (address >= 0x11000000 && address < 0x11010000)
-        {
-            if (address < 0x11004000)
-            {
-                vu0->write_instr<uint128_t>(address & 0xFFF, value);
-                return;
-            }
-            if (address < 0x11008000)
-            {
-                vu0->write_mem<uint128_t>(address & 0xFFF, value);
-                return;
-            }
-            if (address < 0x1100C000)
-            {
-                vu1->write_instr<uint128_t>(address, value);
-                return;
-            }
-            vu1->write_mem<uint128_t>(address, value);
-            return;
-        }
-        switch (address)
-        {
-            case 0x10004000:
-                vif0->feed_DMA(value);
-                return;
-            case 0x10005000:
-                vif1->feed_DMA(value);
-                return;
-            case 0x10006000:
-                gif->send_PATH3_FIFO(value);
-                return;
-            case 0x10007010:
-                ipu->write_FIFO(value);
-                return;
-        }
-        fmt::print("[CORE] Unrecognized write128 at physical address {:#x} of {:#x}{:016x}\n", address, value._u64[1], value._u64[0]);
+        ee_mmio.write<uint128_t>(address, value);
     }
 
     void Emulator::ee_kputs(uint32_t param)
@@ -1094,662 +740,32 @@ namespace core
 
     uint8_t Emulator::iop_read8(uint32_t address)
     {
-        if (address < 0x00200000)
-        {
-            //printf("[IOP] Read8 from $%08X: $%02X\n", address, IOP_RAM[address]);
-            return iop->ram[address];
-        }
-        if (address >= 0x1FC00000 && address < 0x20000000)
-            return BIOS[address & 0x3FFFFF];
-        switch (address)
-        {
-            case 0x1F402004:
-                return cdvd->read_N_command();
-            case 0x1F402005:
-                return cdvd->read_N_status();
-            case 0x1F402008:
-                return cdvd->read_ISTAT();
-            case 0x1F40200A:
-                return cdvd->read_drive_status();
-            case 0x1F40200F:
-                return cdvd->read_disc_type();
-            case 0x1F402013:
-                return 4;
-            case 0x1F402016:
-                return cdvd->read_S_command();
-            case 0x1F402017:
-                return cdvd->read_S_status();
-            case 0x1F402018:
-                return cdvd->read_S_data();
-            case 0x1F402020:
-            case 0x1F402021:
-            case 0x1F402022:
-            case 0x1F402023:
-            case 0x1F402024:
-                return cdvd->read_cdkey(address - 0x1F402020);
-            case 0x1F402028:
-            case 0x1F402029:
-            case 0x1F40202A:
-            case 0x1F40202B:
-            case 0x1F40202C:
-                return cdvd->read_cdkey(address - 0x1F402023);
-            case 0x1F402030:
-            case 0x1F402031:
-            case 0x1F402032:
-            case 0x1F402033:
-            case 0x1F402034:
-                return cdvd->read_cdkey(address - 0x1F402026);
-            case 0x1F402038:
-                return cdvd->read_cdkey(15);
-            case 0x1F808264:
-                return sio2->read_serial();
-            case 0x1FA00000:
-                return IOP_POST;
-        }
-    
-        if (address >= iop->scratchpad_start && address < iop->scratchpad_start + 0x400)
-            return iop->scratchpad[address & 0x3FF];
-    
-        fmt::print("[CORE] Unrecognized IOP read8 from physical address {:#x}\n", address);
-    
-        return 0;
+        return iop_mmio.read<uint8_t>(address);
     }
 
     uint16_t Emulator::iop_read16(uint32_t address)
     {
-        if (address < 0x00200000)
-            return *(uint16_t*)&iop->ram[address];
-        if (address >= 0x1FC00000 && address < 0x20000000)
-            return *(uint16_t*)&BIOS[address & 0x3FFFFF];
-        if (address >= 0x1F900000 && address < 0x1F900400)
-            return spu->read16(address);
-        if (address >= 0x1F900400 && address < 0x1F900800)
-            return spu2->read16(address);
-        switch (address)
-        {
-            case 0x1F801100:
-                return iop_timers->read_counter(0);
-            case 0x1F801104:
-                return iop_timers->read_control(0);
-            case 0x1F801108:
-                return iop_timers->read_target(0);
-            case 0x1F801110:
-                return iop_timers->read_counter(1);
-            case 0x1F801114:
-                return iop_timers->read_control(1);
-            case 0x1F801118:
-                return iop_timers->read_target(1);
-            case 0x1F801120:
-                return iop_timers->read_counter(2);
-            case 0x1F801124:
-                return iop_timers->read_control(2);
-            case 0x1F801128:
-                return iop_timers->read_target(2);
-            case 0x1F801480:
-                return iop_timers->read_counter(3) & 0xFFFF;
-            case 0x1F801482:
-                return iop_timers->read_counter(3) >> 16;
-            case 0x1F801484:
-                return iop_timers->read_control(3);
-            case 0x1F801488:
-                return iop_timers->read_target(3) & 0xFFFF;
-            case 0x1F80148A:
-                return iop_timers->read_target(3) >> 16;
-            case 0x1F801490:
-                return iop_timers->read_counter(4) & 0xFFFF;
-            case 0x1F801492:
-                return iop_timers->read_counter(4) >> 16;
-            case 0x1F801494:
-                return iop_timers->read_control(4);
-            case 0x1F801498:
-                return iop_timers->read_target(4) & 0xFFFF;
-            case 0x1F80149A:
-                return iop_timers->read_target(4) >> 16;
-            case 0x1F8014A0:
-                return iop_timers->read_counter(5) & 0xFFFF;
-            case 0x1F8014A2:
-                return iop_timers->read_counter(5) >> 16;
-            case 0x1F8014A4:
-                return iop_timers->read_control(5);
-            case 0x1F8014A8:
-                return iop_timers->read_target(5) & 0xFFFF;
-            case 0x1F8014AA:
-                return iop_timers->read_target(5) >> 16;
-        }
-    
-        if (address >= iop->scratchpad_start && address < iop->scratchpad_start + 0x400)
-            return *(uint16_t*)&iop->scratchpad[address & 0x3FF];
-    
-        fmt::print("[CORE] Unrecognized IOP read16 from physical address {:#x}\n", address);
-        return 0;
+        return iop_mmio.read<uint16_t>(address);
     }
 
     uint32_t Emulator::iop_read32(uint32_t address)
     {
-        if (address < 0x00200000)
-            return *(uint32_t*)&iop->ram[address];
-        if (address >= 0x1FC00000 && address < 0x20000000)
-            return *(uint32_t*)&BIOS[address & 0x3FFFFF];
-        if (address >= 0x1F808400 && address < 0x1F808550)
-            return firewire->read32(address);
-        switch (address)
-        {
-            case 0x1D000000:
-                return sif->get_mscom();
-            case 0x1D000010:
-                return sif->get_smcom();
-            case 0x1D000020:
-                return sif->get_msflag();
-            case 0x1D000030:
-                return sif->get_smflag();
-            case 0x1D000040:
-                fmt::print("[IOP] Read BD4: {:#x}\n", sif->get_control() | 0xF0000002);
-                return sif->get_control() | 0xF0000002;
-            case 0x1F801070:
-                return iop_intc->read_istat();
-            case 0x1F801074:
-                return iop_intc->read_imask();
-            case 0x1F801078:
-                return iop_intc->read_ictrl();
-            case 0x1F8010B0:
-                return iop_dma->get_chan_addr(3);
-            case 0x1F8010B8:
-                return iop_dma->get_chan_control(3);
-            case 0x1F8010C0:
-                return iop_dma->get_chan_addr(4);
-            case 0x1F8010C8:
-                return iop_dma->get_chan_control(4);
-            case 0x1F8010F0:
-                return iop_dma->get_DPCR();
-            case 0x1F8010F4:
-                return iop_dma->get_DICR();
-            case 0x1F801100:
-                return iop_timers->read_counter(0);
-            case 0x1F801104:
-                return iop_timers->read_control(0);
-            case 0x1F801108:
-                return iop_timers->read_target(0);
-            case 0x1F801110:
-                return iop_timers->read_counter(1);
-            case 0x1F801114:
-                return iop_timers->read_control(1);
-            case 0x1F801118:
-                return iop_timers->read_target(1);
-            case 0x1F801120:
-                return iop_timers->read_counter(2);
-            case 0x1F801124:
-                return iop_timers->read_control(2);
-            case 0x1F801128:
-                return iop_timers->read_target(2);
-            case 0x1F801450:
-                return 0;
-            case 0x1F801480:
-                return iop_timers->read_counter(3);
-            case 0x1F801484:            
-                return iop_timers->read_control(3);
-            case 0x1F801488:            
-                return iop_timers->read_target(3);
-            case 0x1F801490:
-                return iop_timers->read_counter(4);
-            case 0x1F801494:
-                return iop_timers->read_control(4);
-            case 0x1F801498:
-                return iop_timers->read_target(4);
-            case 0x1F8014A0:
-                return iop_timers->read_counter(5);
-            case 0x1F8014A4:
-                return iop_timers->read_control(5);
-            case 0x1F8014A8:
-                return iop_timers->read_target(5);
-            case 0x1F801500:
-                return iop_dma->get_chan_addr(8);
-            case 0x1F801508:
-                return iop_dma->get_chan_control(8);
-            case 0x1F801528:
-                return iop_dma->get_chan_control(10);
-            case 0x1F801548:
-                return iop_dma->get_chan_control(12);
-            case 0x1F801558:
-                return iop_dma->get_chan_control(13);
-            case 0x1F801570:
-                return iop_dma->get_DPCR2();
-            case 0x1F801574:
-                return iop_dma->get_DICR2();
-            case 0x1F801578:
-                return 0; //No clue
-            case 0x1F808268:
-                return sio2->get_control();
-            case 0x1F80826C:
-                return sio2->get_RECV1();
-            case 0x1F808270:
-                return sio2->get_RECV2();
-            case 0x1F808274:
-                return sio2->get_RECV3();
-            case 0xFFFE0130: //Cache control?
-                return 0;
-        }
-        if (address >= iop->scratchpad_start && address < iop->scratchpad_start + 0x400)
-            return *(uint32_t*)&iop->scratchpad[address & 0x3FF];
-        fmt::print("[CORE] Unrecognized IOP read32 from physical addr {:#x}\n", address);
-        return 0;
+        return iop_mmio.read<uint32_t>(address);
     }
 
     void Emulator::iop_write8(uint32_t address, uint8_t value)
     {
-        if (address < 0x00200000)
-        {
-            //printf("[IOP] Write to $%08X of $%02X\n", address, value);
-            iop->ram[address] = value;
-            return;
-        }
-        switch (address)
-        {
-            case 0x1F402004:
-                cdvd->send_N_command(value);
-                return;
-            case 0x1F402005:
-                cdvd->write_N_data(value);
-                return;
-            case 0x1F402006:
-                printf("[CDVD] Write to mode: {:#x}\n", value);
-                return;
-            case 0x1F402007:
-                cdvd->write_BREAK();
-                return;
-            case 0x1F402008:
-                cdvd->write_ISTAT(value);
-                return;
-            case 0x1F402016:
-                cdvd->send_S_command(value);
-                return;
-            case 0x1F402017:
-                cdvd->write_S_data(value);
-                return;
-            case 0x1F40203A:
-                cdvd->write_mecha_decode(value);
-                return;
-            //POST2?
-            case 0x1F802070:
-                return;
-            case 0x1F808260:
-                sio2->write_serial(value);
-                return;
-            case 0x1FA00000:
-                //Register intended to be displayed on an external 7 segment display
-                //Used to indicate how far along the boot process is
-                IOP_POST = value;
-                fmt::print("[IOP] POST: {:#x}\n", value);
-                return;
-        }
-        if (address >= iop->scratchpad_start && address < iop->scratchpad_start + 0x400)
-        {
-            iop->scratchpad[address & 0x3FF] = value;
-            return;
-        }
-        fmt::print("[CORE] Unrecognized IOP write8 to physical address {:#x} of {:#x}\n", address, value);
+        iop_mmio.write<uint8_t>(address, value);
     }
 
     void Emulator::iop_write16(uint32_t address, uint16_t value)
     {
-        if (address < 0x00200000)
-        {
-            //printf("[IOP] Write16 to $%08X of $%08X\n", address, value);
-            *(uint16_t*)&iop->ram[address] = value;
-            return;
-        }
-        if ((address >= 0x1F900000 && address < 0x1F900400) || (address >= 0x1F900760 && address < 0x1F900788))
-        {
-            spu->write16(address, value);
-            return;
-        }
-        if (address >= 0x1F900400 && address < 0x1F900800)
-        {
-            spu2->write16(address, value);
-            return;
-        }
-        switch (address)
-        {
-            case 0x1F8010B4:
-                iop_dma->set_chan_size(3, value);
-                return;
-            case 0x1F8010B6:
-                iop_dma->set_chan_count(3, value);
-                return;
-            case 0x1F8010C4:
-                iop_dma->set_chan_size(4, value);
-                return;
-            case 0x1F8010C6:
-                iop_dma->set_chan_count(4, value);
-                return;
-            case 0x1F801100:
-                iop_timers->write_counter(0, value);
-                return;
-            case 0x1F801104:
-                iop_timers->write_control(0, value);
-                return;
-            case 0x1F801108:
-                iop_timers->write_target(0, value);
-                return;
-            case 0x1F801110:
-                iop_timers->write_counter(1, value);
-                return;
-            case 0x1F801114:
-                iop_timers->write_control(1, value);
-                return;
-            case 0x1F801118:
-                iop_timers->write_target(1, value);
-                return;
-            case 0x1F801120:
-                iop_timers->write_counter(2, value);
-                return;
-            case 0x1F801124:
-                iop_timers->write_control(2, value);
-                return;
-            case 0x1F801128:
-                iop_timers->write_target(2, value);
-                return;
-            case 0x1F801480:
-                iop_timers->write_counter(3, value | (iop_timers->read_counter(3) & 0xFFFF0000));
-                return;
-            case 0x1F801482:
-                iop_timers->write_counter(3, ((uint32_t)value << 16) | (iop_timers->read_counter(3) & 0xFFFF));
-                return;
-            case 0x1F801484:
-                iop_timers->write_control(3, value);
-                return;
-            case 0x1F801488:
-                iop_timers->write_target(3, value | (iop_timers->read_target(3) & 0xFFFF0000));
-                return;
-            case 0x1F80148A:
-                iop_timers->write_target(3, ((uint32_t)value << 16) | (iop_timers->read_target(3) & 0xFFFF));
-                return;
-            case 0x1F801490:
-                iop_timers->write_counter(4, value | (iop_timers->read_counter(4) & 0xFFFF0000));
-                return;
-            case 0x1F801492:
-                iop_timers->write_counter(4, ((uint32_t)value << 16) | (iop_timers->read_counter(4) & 0xFFFF));
-                return;
-            case 0x1F801494:
-                iop_timers->write_control(4, value);
-                return;
-            case 0x1F801498:
-                iop_timers->write_target(4, value | (iop_timers->read_target(4) & 0xFFFF0000));
-                return;
-            case 0x1F80149A:
-                iop_timers->write_target(4, (uint32_t)(value << 16) | (iop_timers->read_target(4) & 0xFFFF));
-                return;
-            case 0x1F8014A0:
-                iop_timers->write_counter(5, value | (iop_timers->read_counter(5) & 0xFFFF0000));
-                return;
-            case 0x1F8014A2:
-                iop_timers->write_counter(5, ((uint32_t)value << 16) | (iop_timers->read_counter(5) & 0xFFFF));
-                return;
-            case 0x1F8014A4:
-                iop_timers->write_control(5, value);
-                return;
-            case 0x1F8014A8:
-                iop_timers->write_target(5, value | (iop_timers->read_target(5) & 0xFFFF0000));
-                return;
-            case 0x1F8014AA:
-                iop_timers->write_target(5, ((uint32_t)value << 16) | (iop_timers->read_target(5) & 0xFFFF));
-                return;
-            case 0x1F801504:
-                iop_dma->set_chan_size(8, value);
-                return;
-            case 0x1F801506:
-                iop_dma->set_chan_count(8, value);
-                return;
-            case 0x1F801524:
-                iop_dma->set_chan_size(10, value);
-                return;
-            case 0x1F801534:
-                iop_dma->set_chan_size(11, value);
-                return;
-            case 0x1F801536:
-                iop_dma->set_chan_count(11, value);
-                return;
-        }
-        if (address >= iop->scratchpad_start && address < iop->scratchpad_start + 0x400)
-        {
-            *(uint16_t*)&iop->scratchpad[address & 0x3FF] = value;
-            return;
-        }
-
-        fmt::print("Unrecognized IOP write16 to physical address {:#x} of {:#x}\n", address, value);
+        iop_mmio.write<uint16_t>(address, value);
     }
 
     void Emulator::iop_write32(uint32_t address, uint32_t value)
     {
-        if (address < 0x00200000)
-        {
-            //printf("[IOP] Write to $%08X of $%08X\n", address, value);
-            *(uint32_t*)&iop->ram[address] = value;
-            return;
-        }
-        //SIO2 send buffers
-        if (address >= 0x1F808200 && address < 0x1F808240)
-        {
-            int index = address - 0x1F808200;
-            sio2->set_send3(index >> 2, value);
-            return;
-        }
-        if (address >= 0x1F808240 && address < 0x1F808260)
-        {
-            int index = address - 0x1F808240;
-            if (address & 0x4)
-                sio2->set_send2(index >> 3, value);
-            else
-                sio2->set_send1(index >> 3, value);
-            return;
-        }
-        if (address >= 0x1F808400 && address < 0x1F808550)
-        {
-            firewire->write32(address, value);
-            return;
-        }
-        switch (address)
-        {
-            case 0x1D000000:
-                //Read only
-                return;
-            case 0x1D000010:
-                sif->set_smcom(value);
-                return;
-            case 0x1D000020:
-                sif->reset_msflag(value);
-                return;
-            case 0x1D000030:
-                printf("[IOP] Set smflag: {:#x}\n", value);
-                sif->set_smflag(value);
-                return;
-            case 0x1D000040:
-                printf("[IOP] Write BD4: {:#x}\n", value);
-                sif->set_control_IOP(value);
-                return;
-            case 0x1F801010:
-                printf("[IOP] SIF2/GPU SSBUS: {:#x}\n", value);
-                return;
-            case 0x1F801014:
-                printf("[IOP] SPU SSBUS: {:#x}\n", value);
-                return;
-            case 0x1F801070:
-                iop_intc->write_istat(value);
-                return;
-            case 0x1F801074:
-                iop_intc->write_imask(value);
-                return;
-            case 0x1F801078:
-                iop_intc->write_ictrl(value);
-                return;
-            //CDVD DMA
-            case 0x1F8010B0:
-                iop_dma->set_chan_addr(3, value);
-                return;
-            case 0x1F8010B4:
-                iop_dma->set_chan_block(3, value);
-                return;
-            case 0x1F8010B8:
-                iop_dma->set_chan_control(3, value);
-                return;
-            //SPU DMA
-            case 0x1F8010C0:
-                iop_dma->set_chan_addr(4, value);
-                return;
-            case 0x1F8010C4:
-                iop_dma->set_chan_block(4, value);
-                return;
-            case 0x1F8010C8:
-                iop_dma->set_chan_control(4, value);
-                return;
-            case 0x1F8010F0:
-                iop_dma->set_DPCR(value);
-                return;
-            case 0x1F8010F4:
-                iop_dma->set_DICR(value);
-                return;
-            case 0x1F801100:
-                iop_timers->write_counter(0, value);
-                return;
-            case 0x1F801104:
-                iop_timers->write_control(0, value);
-                return;
-            case 0x1F801108:
-                iop_timers->write_target(0, value);
-                return;
-            case 0x1F801110:
-                iop_timers->write_counter(1, value);
-                return;
-            case 0x1F801114:
-                iop_timers->write_control(1, value);
-                return;
-            case 0x1F801118:
-                iop_timers->write_target(1, value);
-                return;
-            case 0x1F801120:
-                iop_timers->write_counter(2, value);
-                return;
-            case 0x1F801124:
-                iop_timers->write_control(2, value);
-                return;
-            case 0x1F801128:
-                iop_timers->write_target(2, value);
-                return;
-            case 0x1F801404:
-                return;
-            case 0x1F801450:
-                //Config reg? Do nothing to prevent log spam
-                return;
-            case 0x1F801480:
-                iop_timers->write_counter(3, value);
-                return;
-            case 0x1F801484:
-                iop_timers->write_control(3, value);
-                return;
-            case 0x1F801488:
-                iop_timers->write_target(3, value);
-                return;
-            case 0x1F801490:
-                iop_timers->write_counter(4, value);
-                return;
-            case 0x1F801494:
-                iop_timers->write_control(4, value);
-                return;
-            case 0x1F801498:
-                iop_timers->write_target(4, value);
-                return;
-            case 0x1F8014A0:
-                iop_timers->write_counter(5, value);
-                return;
-            case 0x1F8014A4:
-                iop_timers->write_control(5, value);
-                return;
-            case 0x1F8014A8:
-                iop_timers->write_target(5, value);
-                return;
-            //SPU2 DMA
-            case 0x1F801500:
-                iop_dma->set_chan_addr(8, value);
-                return;
-            case 0x1F801504:
-                iop_dma->set_chan_block(8, value);
-                return;
-            case 0x1F801508:
-                iop_dma->set_chan_control(8, value);
-                return;
-            //SIF0 DMA
-            case 0x1F801520:
-                iop_dma->set_chan_addr(10, value);
-                return;
-            case 0x1F801524:
-                iop_dma->set_chan_block(10, value);
-                return;
-            case 0x1F801528:
-                iop_dma->set_chan_control(10, value);
-                return;
-            case 0x1F80152C:
-                iop_dma->set_chan_tag_addr(10, value);
-                return;
-            //SIF1 DMA
-            case 0x1F801530:
-                iop_dma->set_chan_addr(11, value);
-                return;
-            case 0x1F801534:
-                iop_dma->set_chan_block(11, value);
-                return;
-            case 0x1F801538:
-                iop_dma->set_chan_control(11, value);
-                return;
-            //SIO2in DMA
-            case 0x1F801540:
-                iop_dma->set_chan_addr(12, value);
-                return;
-            case 0x1F801544:
-                iop_dma->set_chan_block(12, value);
-                return;
-            case 0x1F801548:
-                iop_dma->set_chan_control(12, value);
-                return;
-            //SIO2out DMA
-            case 0x1F801550:
-                iop_dma->set_chan_addr(13, value);
-                return;
-            case 0x1F801554:
-                iop_dma->set_chan_block(13, value);
-                return;
-            case 0x1F801558:
-                iop_dma->set_chan_control(13, value);
-                return;
-            case 0x1F801570:
-                iop_dma->set_DPCR2(value);
-                return;
-            case 0x1F801574:
-                iop_dma->set_DICR2(value);
-                return;
-            case 0x1F801578:
-                return;
-            case 0x1F808268:
-                sio2->set_control(value);
-                return;
-            //POST2?
-            case 0x1F802070:
-                return;
-            //Cache control?
-            case 0xFFFE0130:
-                return;
-        }
-        if (address == 0xFFFE0144)
-        {
-            fmt::print("[IOP] Scratchpad start: {:#x}\n", value);
-            iop->scratchpad_start = value;
-            return;
-        }
-        if (address >= iop->scratchpad_start && address < iop->scratchpad_start + 0x400)
-        {
-            *(uint32_t*)&iop->scratchpad[address & 0x3FF] = value;
-            return;
-        }
-    
-        fmt::print("[CORE] Unrecognized IOP write32 to physical address {:#x} of {:#x}\n", address, value);
+        iop_mmio.write<uint32_t>(address, value);
     }
 
     void Emulator::iop_ksprintf()
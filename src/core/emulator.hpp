@@ -3,6 +3,7 @@
 #include <functional>
 #include <memory>
 #include <util/int128.hpp>
+#include <util/mmio.hpp>
 #include <iop/sio2/gamepad.hpp>
 #include <iop/cdvd/cdvd.hpp>
 
@@ -40,6 +41,7 @@ namespace gs
 {
     class GraphicsSynthesizer;
     class GraphicsInterface;
+    enum class FrameskipMode :uint8_t;
 }
 
 namespace ipu
@@ -92,6 +94,33 @@ namespace core
         INTERPRETER
     };
 
+    //Fixed: every component runs at most Scheduler::DEFAULT_RUN_CYCLES at a time.
+    //Adaptive: while no DMA, VIF, GIF, IPU or VU work is pending, the EE and IOP get
+    //timeslices of up to the maximum skew.
+    enum class TimesliceMode :uint8_t
+    {
+        Fixed,
+        Adaptive
+    };
+
+    constexpr uint32_t DEFAULT_TIMESLICE_SKEW = 256;
+
+    //Counters for one frame of Emulator::run. Each component counts the timeslices it had work in.
+    struct TimesliceStats
+    {
+        uint32_t timeslices;
+        uint32_t long_timeslices; //Longer than Scheduler::DEFAULT_RUN_CYCLES
+        uint32_t iop, iop_dma;
+        uint32_t dmac, ipu, gif;
+        uint32_t vif0, vif1;
+        uint32_t vu0, vu1;
+
+        std::string to_json() const;
+    };
+
+    using EEMMIOMap = MMIOMap<uint8_t, uint16_t, uint32_t, uint64_t, uint128_t>;
+    using IOPMMIOMap = MMIOMap<uint8_t, uint16_t, uint32_t>;
+
     class Emulator
     {
     public:
@@ -125,6 +154,7 @@ namespace core
         int vblank_start_id, vblank_end_id, spu_event_id, hblank_event_id, gs_vblank_event_id;
 
         bool VBLANK_sent;
+        bool hblank_event_pending;
         bool cop2_interlock, vu_interlock;
 
         std::ofstream ee_log;
@@ -138,13 +168,24 @@ namespace core
 
         uint8_t IOP_POST;
 
+        //Registers behind Emulator::read*/write* and iop_read*/iop_write*, set up by map_ee_mmio and map_iop_mmio
+        EEMMIOMap ee_mmio;
+        IOPMMIOMap iop_mmio;
+
         SKIP_HACK skip_BIOS_hack;
 
         uint8_t* ELF_file;
         uint32_t ELF_size;
 
+        TimesliceMode timeslice_mode;
+        uint32_t timeslice_skew;
+        TimesliceStats timeslice_stats, last_timeslice_stats;
+
         void iop_IRQ_check(uint32_t new_stat, uint32_t new_mask);
         void start_sound_sample_event();
+        bool needs_short_timeslice();
+        void map_ee_mmio();
+        void map_iop_mmio();
 
         bool frame_ended;
     public:
@@ -162,6 +203,10 @@ namespace core
         void set_ee_mode(CPU_MODE mode);
         void set_vu0_mode(CPU_MODE mode);
         void set_vu1_mode(CPU_MODE mode);
+        void set_iop_mode(CPU_MODE mode);
+        void set_frameskip(gs::FrameskipMode mode, int interval);
+        void set_timeslice_mode(TimesliceMode mode, uint32_t max_skew = DEFAULT_TIMESLICE_SKEW);
+        const TimesliceStats& get_timeslice_stats() const;
         void load_BIOS(const uint8_t* BIOS);
         void load_ELF(const uint8_t* ELF, uint32_t size);
         bool load_CDVD(const char* name, cdvd::CDVD_CONTAINER type);
@@ -174,6 +219,7 @@ namespace core
 
         //Events
         void hblank_event();
+        void schedule_HBLANK_event();
         void GS_vblank_event();
         void vblank_start();
         void vblank_end();
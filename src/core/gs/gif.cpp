@@ -90,6 +90,8 @@ namespace gs
         gif_temporary_stop = value & 0x2;
     }
 
+    //The GS thread decodes PACKED data itself. We only follow Q so that it can be handed over
+    //with the next gif_data_t record, and A+D writes for SIGNAL/FINISH/LABEL interrupts.
     void GraphicsInterface::process_PACKED(uint128_t data)
     {
         uint64_t data1 = data._u64[0];
@@ -99,74 +101,14 @@ namespace gs
         uint8_t reg = (path[active_path].current_tag.regs >> reg_offset) & 0xF;
         switch (reg)
         {
-        case 0x0:
-            //PRIM
-            gs->write64(0, data1);
-            break;
-        case 0x1:
-            //RGBAQ - set RGBA
-            //Q is taken from the ST command
-        {
-            uint8_t r = data1 & 0xFF;
-            uint8_t g = (data1 >> 32) & 0xFF;
-            uint8_t b = data2 & 0xFF;
-            uint8_t a = (data2 >> 32) & 0xFF;
-            gs->set_RGBA(r, g, b, a, internal_Q);
-        }
-        break;
         case 0x2:
         {
-            //ST - set ST coordinates and Q
-            uint32_t s = data1 & 0xFFFFFF00;
-            uint32_t t = (data1 >> 32) & 0xFFFFFF00;
+            //ST - set Q
             uint32_t q = data2 & 0xFFFFFF00;
 
-            if ((s & 0x7F800000) == 0x7F800000)
-                s = (s & 0x80000000) | 0x7F7FFFFF;
-
-            if ((t & 0x7F800000) == 0x7F800000)
-                t = (t & 0x80000000) | 0x7F7FFFFF;
-
             if ((q & 0x7F800000) == 0x7F800000)
                 q = (q & 0x80000000) | 0x7F7FFFFF;
             internal_Q = *(float*)&q;
-            gs->set_ST(s, t);
-        }
-        break;
-        case 0x3:
-            //UV - set UV coordinates
-        {
-            uint16_t u = data1 & 0x3FFF;
-            uint16_t v = (data1 >> 32) & 0x3FFF;
-            gs->set_UV(u, v);
-        }
-        break;
-        case 0x4:
-            //XYZF2 - set XYZ and fog coefficient. Optionally disable drawing kick through bit 111
-        {
-            uint32_t x = data1 & 0xFFFF;
-            uint32_t y = (data1 >> 32) & 0xFFFF;
-            uint32_t z = (data2 >> 4) & 0xFFFFFF;
-            bool disable_drawing = (data2 >> (111 - 64)) & 0x1;
-            uint8_t fog = (data2 >> (100 - 64)) & 0xFF;
-            gs->set_XYZF(x, y, z, fog, !disable_drawing);
-        }
-        break;
-        case 0x5:
-            //XYZ2 - set XYZ. Optionally disable drawing kick through bit 111
-        {
-            uint32_t x = data1 & 0xFFFF;
-            uint32_t y = (data1 >> 32) & 0xFFFF;
-            uint32_t z = data2 & 0xFFFFFFFF;
-            bool disable_drawing = (data2 >> (111 - 64)) & 0x1;
-            gs->set_XYZ(x, y, z, !disable_drawing);
-        }
-        break;
-        case 0xA:
-        {
-            //FOG
-            uint64_t value = data2 << 20;
-            gs->write64(0xA, value);
         }
         break;
         case 0xE:
@@ -174,14 +116,10 @@ namespace gs
             //A+D: output data to address
             uint32_t addr = data2 & 0xFF;
             if (addr != 0x7F)
-                gs->write64(addr, data1);
+                gs->preprocess_write64(addr, data1);
         }
         break;
-        case 0xF:
-            //NOP
-            break;
         default:
-            gs->write64(reg, data1);
             break;
         }
     }
@@ -191,13 +129,6 @@ namespace gs
         //printf("[GIF] Reglist: $%08X_%08X_%08X_%08X\n", data._u32[3], data._u32[2], data._u32[1], data._u32[0]);
         for (int i = 0; i < 2; i++)
         {
-            uint64_t reg_offset = (path[active_path].current_tag.reg_count - path[active_path].current_tag.regs_left) << 2;
-            uint8_t reg = (path[active_path].current_tag.regs >> reg_offset) & 0xF;
-
-            //A+D is a NOP in REGLIST mode
-            if (reg != 0xE)
-                gs->write64(reg, data._u64[i]);
-
             path[active_path].current_tag.regs_left--;
             if (!path[active_path].current_tag.regs_left)
             {
@@ -217,6 +148,12 @@ namespace gs
         uint64_t data1 = data._u64[0];
         uint64_t data2 = data._u64[1];
         outputting_path = true;
+
+        //Ship the quadword, tag or data, to the GS thread before we advance the path's state
+        GIFtag& tag = path[active_path].current_tag;
+        gs->send_GIF_data({ tag.regs, tag.data_left, internal_Q, tag.format,
+            tag.reg_count, tag.regs_left, active_path }, data);
+
         if (!path[active_path].current_tag.data_left)
         {
             //Read new GIFtag
@@ -251,15 +188,9 @@ namespace gs
             }*/
 
             //NOP GIFTags ignore all fields except EOP
+            //PRIM output is done by the GS thread when it decodes the tag
             if (path[active_path].current_tag.data_left != 0)
-            {
                 gs->set_CSR_FIFO(0x2); //FIFO Full
-
-                if (path[active_path].current_tag.output_PRIM && path[active_path].current_tag.format == 0)
-                {
-                    gs->write64(0, path[active_path].current_tag.PRIM);
-                }
-            }
         }
         else
         {
@@ -279,8 +210,6 @@ namespace gs
                 break;
             case 2:
             case 3:
-                gs->write64(0x54, data1);
-                gs->write64(0x54, data2);
                 path[active_path].current_tag.data_left--;
                 break;
             default:
@@ -5,6 +5,8 @@
 #include <fstream>
 #include "ee/intc.hpp"
 #include "gs.hpp"
+#include <emulator.hpp>
+#include <scheduler.hpp>
 #include <util/errors.hpp>
 
 /**
@@ -15,10 +17,11 @@ registers.
 
 namespace gs
 {
-    GraphicsSynthesizer::GraphicsSynthesizer(ee::INTC* intc)
-        : intc(intc), frame_complete(false),
+    GraphicsSynthesizer::GraphicsSynthesizer(ee::INTC* intc, core::Scheduler* scheduler)
+        : intc(intc), scheduler(scheduler), frame_complete(false),
         output_buffer1(nullptr), output_buffer2(nullptr),
-        gs_download_buffer(nullptr)
+        gs_download_buffer(nullptr), gs_download_pending(false),
+        frameskip_mode(FrameskipMode::Off), frameskip_interval(1), frame_stats()
     {
     }
 
@@ -46,12 +49,15 @@ namespace gs
 
         gs_download_qwc = 0;
         gs_download_addr = 0;
+        gs_download_pending = false;
 
         current_lock = std::unique_lock<std::mutex>();
         using_first_buffer = true;
         frame_count = 0;
         set_CRT(false, 0x2, false);
         reg.reset(false);
+        sync_HBLANK();
+        set_frameskip(frameskip_mode, frameskip_interval);
     }
 
     void GraphicsSynthesizer::start_frame()
@@ -80,6 +86,11 @@ namespace gs
         GSReturnMessage data;
 
         gs_thread.wait_for_return(GSReturn::render_complete_t, data);
+        frame_stats = data.payload.render_payload.stats;
+
+        //Nothing was drawn in a skipped frame, keep showing the buffer we already hold
+        if (data.payload.render_payload.skipped && current_lock.owns_lock())
+            return using_first_buffer ? output_buffer2 : output_buffer1;
 
         if (using_first_buffer)
         {
@@ -105,6 +116,12 @@ namespace gs
         return out;
     }
 
+    //Statistics for the frame last returned by get_framebuffer
+    const GSFrameStats& GraphicsSynthesizer::get_frame_stats() const
+    {
+        return frame_stats;
+    }
+
     void GraphicsSynthesizer::set_CSR_FIFO(uint8_t value)
     {
         reg.CSR.FIFO_status = value;
@@ -136,17 +153,36 @@ namespace gs
         }
     }
 
-    void GraphicsSynthesizer::assert_HBLANK()
+    //HBLANK starts every HBLANK_CYCLES EE cycles. Rather than an event setting CSR.HBLANK every scanline,
+    //the bit is worked out from the EE cycle count when CSR is accessed. The GS thread never reads it.
+    void GraphicsSynthesizer::update_HBLANK()
     {
-        GSMessagePayload payload;
-        payload.no_payload = {};
-
-        gs_thread.send_message({ GSCommand::assert_hblank_t, payload });
+        uint64_t count = scheduler->get_ee_cycles() / core::HBLANK_CYCLES;
+        if (count == hblank_count)
+            return;
 
+        hblank_count = count;
         if (reg.assert_HBLANK())
             intc->assert_IRQ((int)ee::Interrupt::GS);
     }
 
+    //Only needed on time when HSINT is unmasked, the HBLANK event calls this then
+    void GraphicsSynthesizer::assert_HBLANK()
+    {
+        update_HBLANK();
+    }
+
+    bool GraphicsSynthesizer::HBLANK_irq_enabled()
+    {
+        return !reg.IMR.hsync;
+    }
+
+    //Counts HBLANKs from the current EE cycle without setting CSR.HBLANK, after a reset or loading a state
+    void GraphicsSynthesizer::sync_HBLANK()
+    {
+        hblank_count = scheduler->get_ee_cycles() / core::HBLANK_CYCLES;
+    }
+
     void GraphicsSynthesizer::assert_VSYNC()
     {
         GSMessagePayload payload;
@@ -169,6 +205,26 @@ namespace gs
             intc->assert_IRQ((int)ee::Interrupt::GS);
     }
 
+    void GraphicsSynthesizer::set_frameskip(FrameskipMode mode, int interval)
+    {
+        frameskip_mode = mode;
+        frameskip_interval = interval;
+
+        GSMessagePayload payload;
+        payload.frameskip_payload = { mode, (uint8_t)std::min(std::max(interval, 1), 255) };
+        gs_thread.send_message({ GSCommand::set_frameskip_t, payload });
+    }
+
+    //Starts recording the JIT pipelines used by a game, and precompiles the ones it used last time
+    void GraphicsSynthesizer::load_jit_warmup(const std::string& serial)
+    {
+        GSMessagePayload payload;
+        memset(payload.jit_warmup_payload.serial, 0, sizeof(payload.jit_warmup_payload.serial));
+        serial.copy(payload.jit_warmup_payload.serial, sizeof(payload.jit_warmup_payload.serial) - 1);
+        gs_thread.send_message({ GSCommand::jit_warmup_t, payload });
+        gs_thread.wake_thread();
+    }
+
     void GraphicsSynthesizer::render_CRT()
     {
         GSMessagePayload payload;
@@ -229,7 +285,12 @@ namespace gs
         payload.write64_payload = { addr, value };
 
         gs_thread.send_message({ GSCommand::write64_t, payload });
+        preprocess_write64(addr, value);
+    }
 
+    //Updates our copy of the registers for a write the GS thread will also perform
+    void GraphicsSynthesizer::preprocess_write64(uint32_t addr, uint64_t value)
+    {
         //Check for interrupt pre-processing
         reg.write64(addr, value);
 
@@ -256,6 +317,7 @@ namespace gs
         if (addr == 0x12001040 && !reg.BUSDIR && value)
             request_gs_download();
 
+        update_HBLANK();
         bool old_IMR = reg.IMR.signal;
         reg.write64_privileged(addr, value);
 
@@ -277,6 +339,7 @@ namespace gs
         if (addr == 0x12001040 && !reg.BUSDIR && value)
             request_gs_download();
 
+        update_HBLANK();
         bool old_IMR = reg.IMR.signal;
         reg.write32_privileged(addr, value);
         //When SIGNAL is written to twice, the interrupt will not be processed until IMR.signal is flipped from 1 to 0.
@@ -294,11 +357,13 @@ namespace gs
 
     uint32_t GraphicsSynthesizer::read32_privileged(uint32_t addr)
     {
+        update_HBLANK();
         return reg.read32_privileged(addr);
     }
 
     uint64_t GraphicsSynthesizer::read64_privileged(uint32_t addr)
     {
+        update_HBLANK();
         return reg.read64_privileged(addr);
     }
 
@@ -344,6 +409,9 @@ namespace gs
 
     void GraphicsSynthesizer::load_state(std::ifstream& state)
     {
+        if (gs_download_pending)
+            finish_gs_download();
+
         GSMessagePayload payload;
         payload.load_state_payload = { &state };
         gs_thread.send_message({ GSCommand::load_state_t, payload });
@@ -356,6 +424,12 @@ namespace gs
 
     void GraphicsSynthesizer::save_state(std::ofstream& state)
     {
+        if (gs_download_pending)
+            finish_gs_download();
+
+        //CSR has to hold every HBLANK so far, loading recounts them from the cycle count
+        update_HBLANK();
+
         GSMessagePayload payload;
         payload.save_state_payload = { &state };
 
@@ -381,21 +455,41 @@ namespace gs
         gs_thread.send_message(message);
     }
 
+    void GraphicsSynthesizer::send_GIF_data(const GIFDataHeader& header, const uint128_t& data)
+    {
+        if (!gs_thread.append_gif_data(header.path, data))
+            gs_thread.send_gif_data(header, data);
+    }
+
     void GraphicsSynthesizer::wake_gs_thread()
     {
         gs_thread.wake_thread();
     }
 
+    //The GS thread performs the transfer in the background. We only wait for it
+    //once the data is actually read, so the EE can keep running until then.
     void GraphicsSynthesizer::request_gs_download()
     {
+        if (gs_download_pending)
+            finish_gs_download();
+
         GSMessagePayload payload;
-        GSReturnMessage return_packet;
 
         payload.download_payload = { gs_download_buffer, &download_mutex };
         gs_thread.send_message({ GSCommand::request_local_host_tx, payload });
         gs_thread.wake_thread();
 
+        gs_download_pending = true;
+        gs_download_addr = 0;
+        gs_download_qwc = 0;
+    }
+
+    void GraphicsSynthesizer::finish_gs_download()
+    {
+        GSReturnMessage return_packet;
+
         gs_thread.wait_for_return(GSReturn::local_host_transfer, return_packet);
+        gs_download_pending = false;
 
         while (!download_mutex.try_lock())
         {
@@ -413,6 +507,9 @@ namespace gs
         bool have_data;
         uint128_t quad_data;
 
+        if (gs_download_pending)
+            finish_gs_download();
+
         if (gs_download_qwc)
         {
             quad_data._u64[0] = gs_download_buffer[gs_download_addr]._u64[0];
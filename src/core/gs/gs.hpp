@@ -10,6 +10,11 @@ namespace ee
     class INTC;
 };
 
+namespace core
+{
+    class Scheduler;
+};
+
 namespace gs
 {
 
@@ -17,6 +22,7 @@ namespace gs
     {
     private:
         ee::INTC* intc;
+        core::Scheduler* scheduler;
         bool frame_complete;
         int frame_count;
         uint32_t* output_buffer1;
@@ -24,21 +30,31 @@ namespace gs
         uint128_t* gs_download_buffer;
         uint32_t gs_download_qwc;
         uint32_t gs_download_addr;
+        bool gs_download_pending;
         std::mutex output_buffer1_mutex, output_buffer2_mutex, download_mutex;
         bool using_first_buffer;
         std::unique_lock<std::mutex> current_lock;
 
+        FrameskipMode frameskip_mode;
+        int frameskip_interval;
+        GSFrameStats frame_stats;
+
         GS_REGISTERS reg;
+        //HBLANKs since reset that CSR has seen
+        uint64_t hblank_count;
 
         GraphicsSynthesizerThread gs_thread;
+
+        void update_HBLANK();
     public:
-        GraphicsSynthesizer(ee::INTC* intc);
+        GraphicsSynthesizer(ee::INTC* intc, core::Scheduler* scheduler);
         ~GraphicsSynthesizer();
 
         void reset();
         void start_frame();
         bool is_frame_complete() const;
         uint32_t* get_framebuffer();
+        const GSFrameStats& get_frame_stats() const;
         void render_CRT();
         uint32_t* render_partial_frame(uint16_t& width, uint16_t& height);
         void get_resolution(int& w, int& h);
@@ -52,8 +68,12 @@ namespace gs
         void assert_FINISH();
         void assert_HBLANK();
         void assert_VSYNC();
+        bool HBLANK_irq_enabled();
+        void sync_HBLANK();
 
         void set_CRT(bool interlaced, int mode, bool frame_mode);
+        void set_frameskip(FrameskipMode mode, int interval);
+        void load_jit_warmup(const std::string& serial);
 
         uint32_t get_busdir();
         uint32_t read32_privileged(uint32_t addr);
@@ -61,6 +81,7 @@ namespace gs
         void write32_privileged(uint32_t addr, uint32_t value);
         void write64_privileged(uint32_t addr, uint64_t value);
         void write64(uint32_t addr, uint64_t value);
+        void preprocess_write64(uint32_t addr, uint64_t value);
 
         void set_RGBA(uint8_t r, uint8_t g, uint8_t b, uint8_t a, float q);
         void set_ST(uint32_t s, uint32_t t);
@@ -73,9 +94,11 @@ namespace gs
         void send_dump_request();
 
         void send_message(GSMessage message);
+        void send_GIF_data(const GIFDataHeader& header, const uint128_t& data);
         void wake_gs_thread();
 
         void request_gs_download();
+        void finish_gs_download();
         std::tuple<uint128_t, bool>read_gs_download();
     };
 }
\ No newline at end of file
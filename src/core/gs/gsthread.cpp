@@ -2,12 +2,21 @@
 #include <cstdio>
 #include <cstdlib>
 #include <cstring>
+#include <cctype>
 #include <cmath>
 #include <fstream>
+#include <vector>
+#ifdef _WIN32
+#include <intrin.h>
+#else
+#include <x86intrin.h>
+#endif
 
 #include "gsthread.hpp"
 #include "gsmem.hpp"
 #include <util/errors.hpp>
+#include <util/hostmem.hpp>
+#include <util/simd.hpp>
 
 namespace gs
 {
@@ -150,13 +159,31 @@ namespace gs
 
     GraphicsSynthesizerThread::~GraphicsSynthesizerThread()
     {
-        delete[] local_mem;
+        HostMemory::free_guest(local_mem, 1024 * 1024 * 4);
+    }
+
+    //Spinning only helps when the other thread can run at the same time
+    static bool can_spin()
+    {
+        static const bool multicore = std::thread::hardware_concurrency() > 1;
+        return multicore;
     }
 
     void GraphicsSynthesizerThread::wait_for_return(GSReturn type, GSReturnMessage &data)
     {
         printf("[GS] Waiting for return\n");
 
+        for (auto it = stashed_returns.begin(); it != stashed_returns.end(); ++it)
+        {
+            if (it->type == type)
+            {
+                data = *it;
+                stashed_returns.erase(it);
+                return;
+            }
+        }
+
+        int spins = 0;
         while (true)
         {
             if (return_queue->pop(data))
@@ -173,44 +200,205 @@ namespace gs
 
                 if (data.type == type)
                     return;
-                else
-                {
-                    if (return_queue->was_empty())
-                    {
-                        //Last message in the queue, so we don't want this one so we need to sleep
-                        return_queue->push(data); //Put it back on the queue, something else probably wants it
-                        printf("[GS] Waiting for return message, pushed last message on to queue type %d expecting %d\n", data.type, type);
-                        std::unique_lock<std::mutex> lk(data_mutex);
-                        notifier.wait(lk, [this] {return recieve_data; });
-                        recieve_data = false;
-                    }
-                    else
-                        return_queue->push(data); //Put it back on the queue, something else probably wants it
-                }
-                  //Errors::die("[GS] return message expected %d but was %d!\n", type, data.type);
+
+                //Something else probably wants it, keep it on our side of the queue
+                printf("[GS] Waiting for return message, stashed message type %d expecting %d\n", data.type, type);
+                stashed_returns.push_back(data);
+                continue;
             }
-            else
+
+            //Most requests are answered quickly, so spin before paying for a sleep
+            if (spins < RETURN_SPIN_COUNT && can_spin())
+            {
+                spins++;
+                _mm_pause();
+                continue;
+            }
+
+            std::unique_lock<std::mutex> lk(data_mutex);
+            if (!notifier.wait_for(lk, std::chrono::milliseconds(100), [this] { return recieve_data; }))
+                printf("[GS] Still waiting for return message type %d\n", type);
+            recieve_data = false;
+        }
+    }
+
+    //Number of payload bytes each command carries in the message queue
+    static size_t get_payload_size(GSCommand type)
+    {
+        GSMessagePayload p;
+        switch (type)
+        {
+            case write64_privileged_t:
+                return sizeof(p.write64_payload);
+            case write32_privileged_t:
+                return sizeof(p.write32_payload);
+            case set_rgba_t:
+                return sizeof(p.rgba_payload);
+            case set_st_t:
+                return sizeof(p.st_payload);
+            case set_uv_t:
+                return sizeof(p.uv_payload);
+            case set_xyz_t:
+                return sizeof(p.xyz_payload);
+            case set_xyzf_t:
+                return sizeof(p.xyzf_payload);
+            case set_crt_t:
+                return sizeof(p.crt_payload);
+            case render_crt_t:
+            case memdump_t:
+                return sizeof(p.render_payload);
+            case request_local_host_tx:
+                return sizeof(p.download_payload);
+            case save_state_t:
+                return sizeof(p.save_state_payload);
+            case load_state_t:
+                return sizeof(p.load_state_payload);
+            case set_frameskip_t:
+                return sizeof(p.frameskip_payload);
+            case jit_warmup_t:
+                return sizeof(p.jit_warmup_payload);
+            case set_pixel_stats_t:
+                return sizeof(p.pixel_stats_payload);
+            case assert_finish_t:
+            case assert_hblank_t:
+            case assert_vsync_t:
+            case swap_field_t:
+            case die_t:
+            case gsdump_t:
+                return 0;
+            default:
+                Errors::die("[GS] Unknown command %d sent to GS thread", type);
+        }
+    }
+
+    uint8_t* GraphicsSynthesizerThread::reserve_message(GSCommand type, size_t size)
+    {
+        packed_write_addr = NO_PACKED_WRITE;
+        gif_data_path = -1;
+
+        uint8_t* payload = message_queue->reserve(type, size);
+        while (!payload)
+        {
+            //The GS thread is behind, give it everything we have and wait for room
+            wake_thread();
+            if (thread_died)
+            {
+                GSReturnMessage data;
+                wait_for_return(GSReturn::death_error_t, data);
+            }
+            std::this_thread::yield();
+            payload = message_queue->reserve(type, size);
+        }
+        return payload;
+    }
+
+    void GraphicsSynthesizerThread::publish_messages()
+    {
+        packed_write_addr = NO_PACKED_WRITE;
+        gif_data_path = -1;
+        message_queue->publish();
+
+        //Pairs with the fence in wait_for_messages: either we see the GS thread asleep, or it sees our data
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (thread_sleeping.load(std::memory_order_relaxed))
+        {
+            message_signal.fetch_add(1);
+            message_signal.notify_one();
+        }
+    }
+
+    //GS thread side. Returns once messages may be available.
+    void GraphicsSynthesizerThread::wait_for_messages(int& spin_count)
+    {
+        gs_fifo::Record record;
+        for (int i = 0; i < spin_count && can_spin(); i++)
+        {
+            _mm_pause();
+            if (message_queue->peek(record))
             {
-                printf("[GS] No Messages, waiting for return message\n");
-                std::unique_lock<std::mutex> lk(data_mutex);
-                notifier.wait(lk, [this] {return recieve_data;});
-                recieve_data = false;
+                spin_count = std::min(spin_count * 2, MAX_SPIN_COUNT);
+                return;
             }
         }
+        spin_count = std::max(spin_count / 2, MIN_SPIN_COUNT);
+
+        uint32_t signal = message_signal.load();
+        thread_sleeping = true;
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        if (!message_queue->peek(record))
+            message_signal.wait(signal);
+        thread_sleeping = false;
+    }
+
+    void GraphicsSynthesizerThread::send_return(GSReturnMessage data)
+    {
+        return_queue->push(data);
+        std::unique_lock<std::mutex> lk(data_mutex);
+        recieve_data = true;
+        notifier.notify_one();
     }
 
     void GraphicsSynthesizerThread::send_message(GSMessage message)
     {
         //printf("[GS] Notifying gs thread of new data\n");
-        message_queue->push(message);
-        send_data = true;
+        if (message.type == write64_t)
+        {
+            auto p = message.payload.write64_payload;
+            uint8_t* value = nullptr;
+
+            if (p.addr == packed_write_addr)
+                value = message_queue->extend(sizeof(p.value));
+
+            if (!value)
+            {
+                uint8_t* record = reserve_message(write64_t, sizeof(p.addr) + sizeof(p.value));
+                memcpy(record, &p.addr, sizeof(p.addr));
+                value = record + sizeof(p.addr);
+                packed_write_addr = p.addr;
+            }
+            memcpy(value, &p.value, sizeof(p.value));
+        }
+        else
+        {
+            size_t size = get_payload_size(message.type);
+            memcpy(reserve_message(message.type, size), &message.payload, size);
+        }
+
+        if (message_queue->pending() >= MESSAGE_BATCH_SIZE)
+            publish_messages();
+    }
+
+    //Adds a quadword to the open gif_data_t record if it belongs to the same path
+    bool GraphicsSynthesizerThread::append_gif_data(int path, const uint128_t& data)
+    {
+        if (path != gif_data_path)
+            return false;
+
+        uint8_t* quad = message_queue->extend(sizeof(data));
+        if (!quad)
+            return false;
+
+        memcpy(quad, &data, sizeof(data));
+        if (message_queue->pending() >= MESSAGE_BATCH_SIZE)
+            publish_messages();
+        return true;
+    }
+
+    void GraphicsSynthesizerThread::send_gif_data(const GIFDataHeader& header, const uint128_t& data)
+    {
+        uint8_t* record = reserve_message(gif_data_t, sizeof(header) + sizeof(data));
+        memcpy(record, &header, sizeof(header));
+        memcpy(record + sizeof(header), &data, sizeof(data));
+        gif_data_path = header.path;
+
+        if (message_queue->pending() >= MESSAGE_BATCH_SIZE)
+            publish_messages();
     }
 
     void GraphicsSynthesizerThread::wake_thread()
     {
-        printf("[GS] Waking GS Thread\n");
-        std::unique_lock<std::mutex> lk(data_mutex);
-        notifier.notify_one();
+        //printf("[GS] Waking GS Thread\n");
+        publish_messages();
     }
 
     void GraphicsSynthesizerThread::exit()
@@ -232,30 +420,69 @@ namespace gs
 
         bool gsdump_recording = false;
         std::ofstream gsdump_file;
+        int spin_count = MIN_SPIN_COUNT;
 
         try
         {
             while (true)
             {
-                GSMessage data;
+                gs_fifo::Record record;
 
-                if (message_queue->pop(data))
+                if (message_queue->peek(record))
                 {
-                    if (gsdump_recording)
-                        gsdump_file.write((char*)&data, sizeof(data));
+                    GSMessage data;
+                    data.type = (GSCommand)record.type;
 
-                    switch (data.type)
+                    //Time spent on records that carry image data counts as transfer time
+                    uint64_t record_start = __rdtsc();
+                    uint64_t timed_start = raster_ticks + transfer_ticks;
+                    hwreg_written = false;
+
+                    if (data.type == write64_t)
                     {
-                        case write64_t:
+                        //Packed record: one address followed by every value written to it
+                        auto& p = data.payload.write64_payload;
+                        memcpy(&p.addr, record.data, sizeof(p.addr));
+                        for (uint32_t i = sizeof(p.addr); i < record.size; i += sizeof(p.value))
                         {
-                            auto p = data.payload.write64_payload;
+                            memcpy(&p.value, record.data + i, sizeof(p.value));
+                            if (gsdump_recording)
+                                gsdump_file.write((char*)&data, sizeof(data));
                             write64(p.addr, p.value);
-                            break;
                         }
+                        message_queue->pop(record);
+                        if (hwreg_written)
+                            transfer_ticks += __rdtsc() - record_start - (raster_ticks + transfer_ticks - timed_start);
+                        continue;
+                    }
+
+                    if (data.type == gif_data_t)
+                    {
+                        process_gif_data(record.data, record.size, gsdump_recording ? &gsdump_file : nullptr);
+                        message_queue->pop(record);
+                        if (hwreg_written)
+                            transfer_ticks += __rdtsc() - record_start - (raster_ticks + transfer_ticks - timed_start);
+                        continue;
+                    }
+
+                    memcpy(&data.payload, record.data, record.size);
+                    message_queue->pop(record);
+
+                    if (gsdump_recording)
+                        gsdump_file.write((char*)&data, sizeof(data));
+
+                    //Only vertex data can go into the middle of a batch
+                    if (data.type < set_rgba_t || data.type > set_xyzf_t)
+                        flush_draw_batch();
+
+                    switch (data.type)
+                    {
                         case write64_privileged_t:
                         {
                             auto p = data.payload.write64_payload;
                             reg.write64_privileged(p.addr, p.value);
+                            if (p.addr < 0x12001000)
+                                crt_registers_changed = true;
                             if (p.addr == 0x12001000 && (p.value & 0x200))
                                 soft_reset();
                             break;
@@ -264,64 +491,47 @@ namespace gs
                         {
                             auto p = data.payload.write32_payload;
                             reg.write32_privileged(p.addr, p.value);
+                            if (p.addr < 0x12001000)
+                                crt_registers_changed = true;
                             if (p.addr == 0x12001000 && (p.value & 0x200))
                                 soft_reset();
                             break;
                         }
                         case set_rgba_t:
-                        {
-                            auto p = data.payload.rgba_payload;
-                            set_RGBA(p.r, p.g, p.b, p.a, p.q);
-                            break;
-                        }
                         case set_st_t:
-                        {
-                            auto p = data.payload.st_payload;
-                            set_ST(p.s, p.t);
-                            break;
-                        }
                         case set_uv_t:
-                        {
-                            auto p = data.payload.uv_payload;
-                            set_UV(p.u, p.v);
-                            break;
-                        }
                         case set_xyz_t:
-                        {
-                            auto p = data.payload.xyz_payload;
-                            set_XYZ(p.x, p.y, p.z, p.drawing_kick);
-                            break;
-                        }
                         case set_xyzf_t:
-                        {
-                            auto p = data.payload.xyzf_payload;
-                            set_XYZF(p.x, p.y, p.z, p.fog, p.drawing_kick);
-                            break;
-                        }
+                            process_register_message(data, nullptr);
                             break;
                         case set_crt_t:
                         {
                             auto p = data.payload.crt_payload;
                             reg.set_CRT(p.interlaced, p.mode, p.frame_mode);
+                            crt_registers_changed = true;
                             break;
                         }
                         case render_crt_t:
                         {
                             auto p = data.payload.render_payload;
+                            GSReturnMessagePayload return_payload;
+                            uint64_t crt_start = __rdtsc();
+                            return_payload.render_payload.skipped = end_frameskip_frame();
 
-                            while (!p.target_mutex->try_lock())
+                            //A skipped frame left the displayed buffer stale, the main thread shows the last frame instead
+                            if (!return_payload.render_payload.skipped)
                             {
-                                printf("[GS_t] buffer lock failed!\n");
-                                std::this_thread::yield();
+                                while (!p.target_mutex->try_lock())
+                                {
+                                    printf("[GS_t] buffer lock failed!\n");
+                                    std::this_thread::yield();
+                                }
+                                std::lock_guard<std::mutex> lock(*p.target_mutex, std::adopt_lock);
+                                render_CRT(p.target);
                             }
-                            std::lock_guard<std::mutex> lock(*p.target_mutex, std::adopt_lock);
-                            render_CRT(p.target);
-                            GSReturnMessagePayload return_payload;
-                            return_payload.no_payload = { 0 };
-                            return_queue->push({ GSReturn::render_complete_t,return_payload });
-                            std::unique_lock<std::mutex> lk(data_mutex);
-                            recieve_data = true;
-                            notifier.notify_one();
+                            crt_ticks += __rdtsc() - crt_start;
+                            finish_frame_stats(return_payload.render_payload.stats);
+                            send_return({ GSReturn::render_complete_t,return_payload });
                             break;
                         }
                         case assert_finish_t:
@@ -330,6 +540,7 @@ namespace gs
                         case assert_vsync_t:
                             reg.assert_VSYNC();
                             break;
+                        //Only in older gsdumps, CSR.HBLANK is now worked out on the EE side
                         case assert_hblank_t:
                             reg.assert_HBLANK();
                             break;
@@ -350,10 +561,7 @@ namespace gs
                             memdump(p.target, width, height);
                             GSReturnMessagePayload return_payload;
                             return_payload.xy_payload = { width, height };
-                            return_queue->push({ GSReturn::gsdump_render_partial_done_t,return_payload });
-                            std::unique_lock<std::mutex> lk(data_mutex);
-                            recieve_data = true;
-                            notifier.notify_one();
+                            send_return({ GSReturn::gsdump_render_partial_done_t,return_payload });
                             break;
                         }
                         case die_t:
@@ -363,10 +571,7 @@ namespace gs
                             load_state(data.payload.load_state_payload.state);
                             GSReturnMessagePayload return_payload;
                             return_payload.no_payload = { 0 };
-                            return_queue->push({ GSReturn::load_state_done_t,return_payload });
-                            std::unique_lock<std::mutex> lk(data_mutex);
-                            recieve_data = true;
-                            notifier.notify_one();
+                            send_return({ GSReturn::load_state_done_t,return_payload });
                             break;
                         }
                         case save_state_t:
@@ -374,9 +579,7 @@ namespace gs
                             save_state(data.payload.save_state_payload.state);
                             GSReturnMessagePayload return_payload;
                             return_payload.no_payload = { 0 };
-                            return_queue->push({ GSReturn::save_state_done_t,return_payload });
-                            recieve_data = true;
-                            notifier.notify_one();
+                            send_return({ GSReturn::save_state_done_t,return_payload });
                             break;
                         }
                         case gsdump_t:
@@ -411,24 +614,35 @@ namespace gs
                             }
                             std::lock_guard<std::mutex> lock(*p.target_mutex, std::adopt_lock);
                             GSReturnMessagePayload return_payload;
+                            uint64_t transfer_start = __rdtsc();
                             return_payload.download_payload.quad_count = local_to_host(p.target);
-                            return_queue->push({ GSReturn::local_host_transfer, return_payload });
-                            std::unique_lock<std::mutex> lk(data_mutex);
-                            recieve_data = true;
-                            notifier.notify_one();
+                            transfer_ticks += __rdtsc() - transfer_start;
+                            frame_stats.local_to_host_bytes += return_payload.download_payload.quad_count * 16ULL;
+                            send_return({ GSReturn::local_host_transfer, return_payload });
+                            break;
+                        }
+                        case set_frameskip_t:
+                        {
+                            auto p = data.payload.frameskip_payload;
+                            set_frameskip(p.mode, p.interval);
                             break;
                         }
+                        case jit_warmup_t:
+                            load_jit_warmup(data.payload.jit_warmup_payload.serial);
+                            break;
+                        case set_pixel_stats_t:
+                            //The open batch looked up pipelines with the old keys
+                            flush_draw_batch();
+                            pixel_stats = data.payload.pixel_stats_payload.enabled;
+                            update_draw_pixel_state();
+                            update_tex_lookup_state();
+                            break;
                         default:
                             Errors::die("corrupted command sent to GS thread");
                     }
                 }
-                else
-                {
-                    printf("GS Thread: No messages waiting, going to sleep\n");
-                    std::unique_lock<std::mutex> lk(data_mutex);
-                    notifier.wait(lk, [this] {return send_data;});
-                    send_data = false;
-                }
+                else if (!warm_up_jit())
+                    wait_for_messages(spin_count);
             }
         }
         catch (Emulation_error &e)
@@ -437,9 +651,230 @@ namespace gs
             char* copied_string = new char[ERROR_STRING_MAX_LENGTH];
             strncpy(copied_string, e.what(), ERROR_STRING_MAX_LENGTH);
             return_payload.death_error_payload.error_str = { copied_string };
-            return_queue->push({ GSReturn::death_error_t, return_payload });
-            recieve_data = true;
-            notifier.notify_one();
+            thread_died = true;
+            send_return({ GSReturn::death_error_t, return_payload });
+        }
+    }
+
+    void GraphicsSynthesizerThread::process_register_message(const GSMessage& data, std::ofstream* gsdump)
+    {
+        if (gsdump)
+            gsdump->write((char*)&data, sizeof(data));
+
+        switch (data.type)
+        {
+            case write64_t:
+            {
+                auto p = data.payload.write64_payload;
+                write64(p.addr, p.value);
+                break;
+            }
+            case set_rgba_t:
+            {
+                auto p = data.payload.rgba_payload;
+                set_RGBA(p.r, p.g, p.b, p.a, p.q);
+                break;
+            }
+            case set_st_t:
+            {
+                auto p = data.payload.st_payload;
+                set_ST(p.s, p.t);
+                break;
+            }
+            case set_uv_t:
+            {
+                auto p = data.payload.uv_payload;
+                set_UV(p.u, p.v);
+                break;
+            }
+            case set_xyz_t:
+            {
+                auto p = data.payload.xyz_payload;
+                set_XYZ(p.x, p.y, p.z, p.drawing_kick);
+                break;
+            }
+            case set_xyzf_t:
+            {
+                auto p = data.payload.xyzf_payload;
+                set_XYZF(p.x, p.y, p.z, p.fog, p.drawing_kick);
+                break;
+            }
+            default:
+                Errors::die("[GS_t] Unexpected register message %d", data.type);
+        }
+    }
+
+    //Decodes GIFtags and PACKED/REGLIST/IMAGE data shipped whole by the GIF.
+    //The GIF tracks the same counters on the emu thread to find the end of each packet.
+    void GraphicsSynthesizerThread::process_gif_data(const uint8_t* data, uint32_t size, std::ofstream* gsdump)
+    {
+        GIFDataHeader tag;
+        memcpy(&tag, data, sizeof(tag));
+
+        GSMessage msg;
+        for (uint32_t offset = sizeof(tag); offset < size; offset += sizeof(uint128_t))
+        {
+            uint64_t data1, data2;
+            memcpy(&data1, data + offset, sizeof(data1));
+            memcpy(&data2, data + offset + sizeof(data1), sizeof(data2));
+
+            if (!tag.data_left)
+            {
+                tag.data_left = data1 & 0x7FFF;
+                tag.format = (data1 >> 58) & 0x3;
+                tag.reg_count = data1 >> 60;
+                if (!tag.reg_count)
+                    tag.reg_count = 16;
+                tag.regs = data2;
+                tag.regs_left = tag.reg_count;
+
+                //Q is initialized to 1.0 upon reading a GIFtag
+                tag.Q = 1.0f;
+
+                //NOP GIFTags ignore all fields except EOP
+                if (tag.data_left && ((data1 >> 46) & 0x1) && tag.format == 0)
+                {
+                    msg.type = write64_t;
+                    msg.payload.write64_payload = { 0, (data1 >> 47) & 0x7FF };
+                    process_register_message(msg, gsdump);
+                }
+                continue;
+            }
+
+            switch (tag.format)
+            {
+                case 0:
+                {
+                    uint8_t reg = (tag.regs >> ((tag.reg_count - tag.regs_left) << 2)) & 0xF;
+                    switch (reg)
+                    {
+                        case 0x0:
+                            //PRIM
+                            msg.type = write64_t;
+                            msg.payload.write64_payload = { 0, data1 };
+                            process_register_message(msg, gsdump);
+                            break;
+                        case 0x1:
+                            //RGBAQ - set RGBA
+                            //Q is taken from the ST command
+                            msg.type = set_rgba_t;
+                            msg.payload.rgba_payload = { (uint8_t)data1, (uint8_t)(data1 >> 32),
+                                (uint8_t)data2, (uint8_t)(data2 >> 32), tag.Q };
+                            process_register_message(msg, gsdump);
+                            break;
+                        case 0x2:
+                        {
+                            //ST - set ST coordinates and Q
+                            uint32_t s = data1 & 0xFFFFFF00;
+                            uint32_t t = (data1 >> 32) & 0xFFFFFF00;
+                            uint32_t q = data2 & 0xFFFFFF00;
+
+                            if ((s & 0x7F800000) == 0x7F800000)
+                                s = (s & 0x80000000) | 0x7F7FFFFF;
+
+                            if ((t & 0x7F800000) == 0x7F800000)
+                                t = (t & 0x80000000) | 0x7F7FFFFF;
+
+                            if ((q & 0x7F800000) == 0x7F800000)
+                                q = (q & 0x80000000) | 0x7F7FFFFF;
+                            memcpy(&tag.Q, &q, sizeof(q));
+
+                            msg.type = set_st_t;
+                            msg.payload.st_payload = { s, t };
+                            process_register_message(msg, gsdump);
+                            break;
+                        }
+                        case 0x3:
+                            //UV - set UV coordinates
+                            msg.type = set_uv_t;
+                            msg.payload.uv_payload = { (uint16_t)(data1 & 0x3FFF), (uint16_t)((data1 >> 32) & 0x3FFF) };
+                            process_register_message(msg, gsdump);
+                            break;
+                        case 0x4:
+                            //XYZF2 - set XYZ and fog coefficient. Optionally disable drawing kick through bit 111
+                            msg.type = set_xyzf_t;
+                            msg.payload.xyzf_payload = { (uint32_t)(data1 & 0xFFFF), (uint32_t)((data1 >> 32) & 0xFFFF),
+                                (uint32_t)((data2 >> 4) & 0xFFFFFF), (uint8_t)(data2 >> (100 - 64)),
+                                !((data2 >> (111 - 64)) & 0x1) };
+                            process_register_message(msg, gsdump);
+                            break;
+                        case 0x5:
+                            //XYZ2 - set XYZ. Optionally disable drawing kick through bit 111
+                            msg.type = set_xyz_t;
+                            msg.payload.xyz_payload = { (uint32_t)(data1 & 0xFFFF), (uint32_t)((data1 >> 32) & 0xFFFF),
+                                (uint32_t)data2, !((data2 >> (111 - 64)) & 0x1) };
+                            process_register_message(msg, gsdump);
+                            break;
+                        case 0xA:
+                            //FOG
+                            msg.type = write64_t;
+                            msg.payload.write64_payload = { 0xA, data2 << 20 };
+                            process_register_message(msg, gsdump);
+                            break;
+                        case 0xE:
+                            //A+D: output data to address
+                            if ((data2 & 0xFF) != 0x7F)
+                            {
+                                msg.type = write64_t;
+                                msg.payload.write64_payload = { (uint32_t)(data2 & 0xFF), data1 };
+                                process_register_message(msg, gsdump);
+                            }
+                            break;
+                        case 0xF:
+                            //NOP
+                            break;
+                        default:
+                            msg.type = write64_t;
+                            msg.payload.write64_payload = { reg, data1 };
+                            process_register_message(msg, gsdump);
+                            break;
+                    }
+
+                    tag.regs_left--;
+                    if (!tag.regs_left)
+                    {
+                        tag.regs_left = tag.reg_count;
+                        tag.data_left--;
+                    }
+                    break;
+                }
+                case 1:
+                {
+                    uint64_t quad[2] = { data1, data2 };
+                    for (int i = 0; i < 2; i++)
+                    {
+                        uint8_t reg = (tag.regs >> ((tag.reg_count - tag.regs_left) << 2)) & 0xF;
+
+                        //A+D is a NOP in REGLIST mode
+                        if (reg != 0xE)
+                        {
+                            msg.type = write64_t;
+                            msg.payload.write64_payload = { reg, quad[i] };
+                            process_register_message(msg, gsdump);
+                        }
+
+                        tag.regs_left--;
+                        if (!tag.regs_left)
+                        {
+                            tag.regs_left = tag.reg_count;
+                            tag.data_left--;
+
+                            //If NREGS * NLOOP is odd, discard the last 64 bits of data
+                            if (!tag.data_left && i == 0)
+                                break;
+                        }
+                    }
+                    break;
+                }
+                default:
+                    msg.type = write64_t;
+                    msg.payload.write64_payload = { 0x54, data1 };
+                    process_register_message(msg, gsdump);
+                    msg.payload.write64_payload = { 0x54, data2 };
+                    process_register_message(msg, gsdump);
+                    tag.data_left--;
+                    break;
+            }
         }
     }
 
@@ -448,7 +883,19 @@ namespace gs
         exit();
 
         if (!local_mem)
-            local_mem = new uint8_t[1024 * 1024 * 4];
+            local_mem = HostMemory::alloc_guest(1024 * 1024 * 4);
+        reset_zbounds();
+        download_cache.valid = false;
+        reset_clut_palettes();
+        clut_rgba_valid = false;
+        frameskip_mode = FrameskipMode::Off;
+        set_frameskip(FrameskipMode::Off, 1);
+        memset(crt_dirty_pages, 0, sizeof(crt_dirty_pages));
+        memset(crt_outputs, 0, sizeof(crt_outputs));
+        memset(crt_field_render, 0, sizeof(crt_field_render));
+        crt_registers_changed = true;
+        crt_render_count = 0;
+        crt_last_change = 0;
 
         pixels_transferred = 0;
         num_vertices = 0;
@@ -478,10 +925,21 @@ namespace gs
         recompile_tex_lookup_prologue();
         recompile_draw_pixel_prologue();
 
+        //The heaps were flushed, so everything on the warm-up list is worth compiling again
+        jit_warmup_pos = 0;
+        batch_open = false;
+
+        reset_frame_stats();
+        pixel_stats = false;
+
         memset(screen_buffer, 0, sizeof(screen_buffer));
 
         message_queue = std::make_unique<gs_fifo>();
         return_queue = std::make_unique<gs_return_fifo>();
+        packed_write_addr = NO_PACKED_WRITE;
+        thread_died = false;
+        thread_sleeping = false;
+        stashed_returns.clear();
         thread = std::thread(&GraphicsSynthesizerThread::event_loop, this);
     }
 
@@ -506,6 +964,13 @@ namespace gs
 
     void GraphicsSynthesizerThread::memdump(uint32_t* target, uint16_t& width, uint16_t& height)
     {
+        //target no longer holds a CRT render, so the next render_CRT into it has to draw
+        for (int i = 0; i < 2; i++)
+        {
+            if (crt_outputs[i].target == target)
+                crt_outputs[i].source_render = 0;
+        }
+
         SCISSOR s = current_ctx->scissor;
         width = std::min(static_cast<uint16_t>(s.x2 - s.x1), (uint16_t)current_ctx->frame.width);
         height = std::min(static_cast<uint16_t>(s.y2 - s.y1), (uint16_t)480);
@@ -576,6 +1041,61 @@ namespace gs
         }
     }
 
+    //Reads count pixels of a line of a displayed buffer, converted to 32-bit colors like get_CRT_color.
+    //Pixels are laid out the same way in every block, so only the block address is swizzled per pixel.
+    void GraphicsSynthesizerThread::read_CRT_row(const DISPFB& dispfb, int32_t x, int32_t y, int32_t count, uint32_t* row)
+    {
+        switch (dispfb.format)
+        {
+            case 0x0:
+            case 0x1:
+            case 0x2:
+            case 0xA:
+                break;
+            default:
+                Errors::die("Unknown framebuffer format (%x)", dispfb.format);
+        }
+
+        const PSMLayout& layout = *get_PSM_layout(dispfb.format);
+        const uint32_t base = dispfb.frame_base * 4;
+        const uint32_t block_mask = layout.block_width - 1;
+
+        uint32_t block_row[16];
+        for (uint32_t i = 0; i < layout.block_width; i++)
+            block_row[i] = layout.addr(0, 1, i, y % layout.block_height);
+
+        for (int32_t i = 0; i < count; )
+        {
+            uint32_t block = layout.block_offset(base, dispfb.width, x + i, y);
+            uint32_t first = (x + i) & block_mask;
+            uint32_t run = std::min(layout.block_width - first, (uint32_t)(count - i));
+            if (layout.bpp == 32)
+            {
+                for (uint32_t j = 0; j < run; j++)
+                    row[i + j] = *(uint32_t*)&local_mem[block + block_row[first + j]];
+            }
+            else
+            {
+                for (uint32_t j = 0; j < run; j++)
+                    row[i + j] = *(uint16_t*)&local_mem[block + block_row[first + j]];
+            }
+            i += run;
+        }
+
+        if (dispfb.format == 0x0)
+            return;
+
+        for (int32_t i = 0; i < count; i += 8)
+        {
+            auto color = simd::load<uint32_t>(&row[i]);
+            if (dispfb.format == 0x1)
+                color = (color & 0xFFFFFF) | 0x80000000;
+            else
+                color = ((color & 0x1F) << 3) | ((color & 0x3E0) << 6) | ((color & 0x7C00) << 9) | ((color & 0x8000) << 16);
+            simd::store(color, &row[i]);
+        }
+    }
+
     void GraphicsSynthesizerThread::render_CRT(uint32_t* target)
     {
         int32_t width;
@@ -654,118 +1174,121 @@ namespace gs
             }
         }
 
+        if (crt_output_unchanged(target, field_offset, reg.SMODE2.interlaced && y_increment == 2))
+            return;
+
+        //Each circuit reads a contiguous span of every line it's enabled on
+        int32_t span1_x1 = std::max(display1_xoffset, 0);
+        int32_t span1_x2 = std::min(display1_xoffset + reg.DISPLAY1.width, width);
+        int32_t span2_x1 = std::max(display2_xoffset, 0);
+        int32_t span2_x2 = std::min(display2_xoffset + reg.DISPLAY2.width, width);
+
+        alignas(32) uint32_t row1[4096 + 8];
+        alignas(32) uint32_t row2[4096 + 8];
+        alignas(32) uint32_t line[4096 + 8];
+        const int32_t vec_width = (width + 7) & ~7;
+
+        auto lane = simd::broadcast<uint32_t>(0, 1, 2, 3, 4, 5, 6, 7);
+        auto bgcolor = simd::fill<uint32_t>(reg.BGCOLOR);
+        auto alp = simd::fill<uint32_t>(reg.PMODE.ALP);
+        auto full_alpha = simd::fill<uint32_t>(0xFF);
+        auto zero = simd::fill<uint32_t>(0);
+
+        //Channels and alphas fit in the low halves of the lanes, and so do their products
+        auto mul16 = [](const simd::Vec256<uint32_t>& a, const simd::Vec256<uint32_t>& b)
+        {
+            return simd::reinterpret<uint32_t>(simd::reinterpret<uint16_t>(a) * simd::reinterpret<uint16_t>(b));
+        };
+
         for (int y = start_scanline; y < height; y += y_increment)
         {
-            for (int x = 0; x < width; x++)
+            int32_t pixel_y = y;
+            int32_t pixel_y_disp1 = pixel_y - display1_yoffset;
+            int32_t pixel_y_disp2 = pixel_y - display2_yoffset;
+
+            //Calculate Frame buffer Coordinates
+            int32_t scaled_y1 = (int32_t)reg.DISPFB1.y + fb_offset + ((pixel_y_disp1 >> (y_increment - 1)) << (frame_line_increment - 1));
+            int32_t scaled_y2 = (int32_t)reg.DISPFB2.y + fb_offset + ((pixel_y_disp2 >> (y_increment - 1)) << (frame_line_increment - 1));
+
+            //Disable the outputs if the x, y are not in the display bounding box
+            enable_circuit1 = reg.PMODE.circuit1 && span1_x1 < span1_x2 &&
+                              pixel_y >= display1_yoffset && pixel_y < display1_yoffset + reg.DISPLAY1.height;
+            enable_circuit2 = reg.PMODE.circuit2 && span2_x1 < span2_x2 &&
+                              pixel_y >= display2_yoffset && pixel_y < display2_yoffset + reg.DISPLAY2.height;
+
+            if (enable_circuit1)
+                read_CRT_row(reg.DISPFB1, (int32_t)reg.DISPFB1.x + span1_x1 - display1_xoffset, scaled_y1,
+                             span1_x2 - span1_x1, &row1[span1_x1]);
+            if (enable_circuit2)
+                read_CRT_row(reg.DISPFB2, (int32_t)reg.DISPFB2.x + span2_x1 - display2_xoffset, scaled_y2,
+                             span2_x2 - span2_x1, &row2[span2_x1]);
+
+            auto line_circuit1 = simd::fill<uint32_t>(enable_circuit1 ? 0xFFFFFFFF : 0);
+            auto line_circuit2 = simd::fill<uint32_t>(enable_circuit2 ? 0xFFFFFFFF : 0);
+            for (int32_t x = 0; x < vec_width; x += 8)
             {
-                int32_t pixel_x = x;
-                int32_t pixel_y = y;
-                int32_t pixel_x_disp1 = pixel_x - display1_xoffset;
-                int32_t pixel_x_disp2 = pixel_x - display2_xoffset;
-                int32_t pixel_y_disp1 = pixel_y - display1_yoffset;
-                int32_t pixel_y_disp2 = pixel_y - display2_yoffset;
-
-                //Calculate Frame buffer Coordinates
-                int32_t scaled_x1 = (int32_t)reg.DISPFB1.x + pixel_x_disp1;
-                int32_t scaled_x2 = (int32_t)reg.DISPFB2.x + pixel_x_disp2;
-                int32_t scaled_y1 = (int32_t)reg.DISPFB1.y + fb_offset + ((pixel_y_disp1 >> (y_increment - 1)) << (frame_line_increment - 1));
-                int32_t scaled_y2 = (int32_t)reg.DISPFB2.y + fb_offset + ((pixel_y_disp2 >> (y_increment - 1)) << (frame_line_increment - 1));
-
-                //Disable the outputs if the x, y are not in the display bounding box
-                enable_circuit1 = reg.PMODE.circuit1 && is_in_display(reg.DISPLAY1, display1_xoffset, display1_yoffset, pixel_x, pixel_y);
-                enable_circuit2 = reg.PMODE.circuit2 && is_in_display(reg.DISPLAY2, display2_xoffset, display2_yoffset, pixel_x, pixel_y);
-
-                uint32_t output1 = enable_circuit1 ? get_CRT_color(reg.DISPFB1, scaled_x1, scaled_y1) : 0;
-                uint32_t output2 = enable_circuit2 ? get_CRT_color(reg.DISPFB2, scaled_x2, scaled_y2) : reg.BGCOLOR;
+                auto pixel_x = lane + (uint32_t)x;
+                auto in_circuit1 = line_circuit1 & (pixel_x >= (uint32_t)span1_x1) & (pixel_x < (uint32_t)span1_x2);
+                auto in_circuit2 = line_circuit2 & (pixel_x >= (uint32_t)span2_x1) & (pixel_x < (uint32_t)span2_x2);
 
+                auto output1 = simd::load<uint32_t>(&row1[x]) & in_circuit1;
+                auto output2 = simd::select(bgcolor, simd::load<uint32_t>(&row2[x]), in_circuit2);
                 if (reg.PMODE.blend_with_bg)
-                    output2 = reg.BGCOLOR;
-
-                uint32_t r = 0, g = 0, b = 0;
-                uint32_t r1, g1, b1, r2, g2, b2;
-                uint32_t final_color;
+                    output2 = bgcolor;
 
                 //If Circuit 1 is disabled, we can skip alpha blending on Circuit 2
                 //Some games (like Devil May Cry) will use Circuit 2 with an ALP of 255, making it effectively blank.
                 //However we think that on real hardware it will either skip the blending or duplicate Circuit 2 in the Circuit 1 output
                 //which effectively means output2 is outputted at full alpha
                 //Downhill Domination also has a dark screen if you do not follow this behaviour.  ALP 128 only circuit 2
-                if (enable_circuit1)
-                {
-                    uint32_t alpha;
+                auto alpha = reg.PMODE.use_ALP ? alp : simd::min((output1 >> 24) << 1, full_alpha);
+                auto inv_alpha = full_alpha - alpha;
 
-                    if (reg.PMODE.use_ALP)
-                        alpha = reg.PMODE.ALP;
-                    else
-                        alpha = (output1 >> 24) * 2;
-
-                    if (alpha > 0xFF)
-                        alpha = 0xFF;
-
-                    r1 = output1 & 0xFF; r2 = output2 & 0xFF;
-                    g1 = (output1 >> 8) & 0xFF; g2 = (output2 >> 8) & 0xFF;
-                    b1 = (output1 >> 16) & 0xFF; b2 = (output2 >> 16) & 0xFF;
-
-                    r = ((r1 * alpha) + (r2 * (0xFF - alpha))) >> 8;
-                    if (r > 0xFF)
-                        r = 0xFF;
+                auto r = (mul16(output1 & 0xFF, alpha) + mul16(output2 & 0xFF, inv_alpha)) >> 8;
+                auto g = (mul16((output1 >> 8) & 0xFF, alpha) + mul16((output2 >> 8) & 0xFF, inv_alpha)) >> 8;
+                auto b = (mul16((output1 >> 16) & 0xFF, alpha) + mul16((output2 >> 16) & 0xFF, inv_alpha)) >> 8;
 
-                    g = ((g1 * alpha) + (g2 * (0xFF - alpha))) >> 8;
-                    if (g > 0xFF)
-                        g = 0xFF;
+                auto color = simd::select(zero, output2 & 0xFFFFFF, in_circuit2);
+                color = simd::select(color, r | (g << 8) | (b << 16), in_circuit1);
+                simd::store(color | 0xFF000000, &line[x]);
+            }
 
-                    b = ((b1 * alpha) + (b2 * (0xFF - alpha))) >> 8;
-                    if (b > 0xFF)
-                        b = 0xFF;
-                }
-                else if(enable_circuit2)
+            const size_t line_size = width * sizeof(uint32_t);
+            if (reg.SMODE2.interlaced)
+            {
+                switch (reg.deinterlace_method)
                 {
-                    r = output2 & 0xFF;
-                    g = (output2 >> 8) & 0xFF;
-                    b = (output2 >> 16) & 0xFF;
-                }
-
-                final_color = 0xFF000000 | r | (g << 8) | (b << 16);
-
-                if (reg.SMODE2.interlaced)
-                {
-                    switch (reg.deinterlace_method)
+                    case BOB_DEINTERLACE:
                     {
-                        case BOB_DEINTERLACE:
+                        if (reg.SMODE2.frame_mode)
                         {
-                            if (reg.SMODE2.frame_mode)
-                            {
-                                pixel_y *= 2;
-                                target[pixel_x + (pixel_y * width)] = final_color;
-                                target[pixel_x + ((pixel_y + 1)* width)] = final_color;
-                            }
-                            else
-                            {
-                                target[pixel_x + (pixel_y * width)] = final_color;
-                            }
-                            break;
+                            pixel_y *= 2;
+                            memcpy(&target[pixel_y * width], line, line_size);
+                            memcpy(&target[(pixel_y + 1) * width], line, line_size);
                         }
-                        default: //No Deinterlacing
+                        else
                         {
-                            screen_buffer[pixel_x + (pixel_y * width)] = final_color;
+                            memcpy(&target[pixel_y * width], line, line_size);
+                        }
+                        break;
+                    }
+                    default: //No Deinterlacing
+                    {
+                        memcpy(&screen_buffer[pixel_y * width], line, line_size);
 
-                            target[pixel_x + (pixel_y * width)] = final_color;
+                        memcpy(&target[pixel_y * width], line, line_size);
 
-                            if (reg.SMODE2.interlaced)
-                            {
-                                if (!field_offset)
-                                    target[pixel_x + ((pixel_y + 1) * width)] = screen_buffer[pixel_x + ((pixel_y + 1) * width)];
-                                else if (pixel_y > 0)
-                                    target[pixel_x + ((pixel_y - 1) * width)] = screen_buffer[pixel_x + ((pixel_y - 1) * width)];
-                            }
-                            break;
-                        }
+                        if (!field_offset)
+                            memcpy(&target[(pixel_y + 1) * width], &screen_buffer[(pixel_y + 1) * width], line_size);
+                        else if (pixel_y > 0)
+                            memcpy(&target[(pixel_y - 1) * width], &screen_buffer[(pixel_y - 1) * width], line_size);
+                        break;
                     }
                 }
-                else
-                {
-                    target[pixel_x + (pixel_y * width)] = final_color;
-                }
+            }
+            else
+            {
+                memcpy(&target[pixel_y * width], line, line_size);
             }
         }
     }
@@ -776,6 +1299,23 @@ namespace gs
             return;
 
         addr &= 0x7F;
+        switch (addr)
+        {
+            case 0x0001:
+            case 0x0002:
+            case 0x0003:
+            case 0x0004:
+            case 0x0005:
+            case 0x000A:
+            case 0x000C:
+            case 0x000D:
+                break;
+            default:
+                //Anything other than vertex data can change what the batch was set up for
+                flush_draw_batch();
+                break;
+        }
+
         switch (addr)
         {
             case 0x0000:
@@ -1121,18 +1661,38 @@ namespace gs
                     PSMCT24_unpacked_count = 0;
                     PSMCT24_color = 0;
                     //printf("Transfer addr: $%08X\n", transfer_addr);
+
+                    //Anything written to local memory makes the hierarchical z bounds there stale.
+                    //Host transfers write whole doublewords, which can spill onto the row after the last one.
+                    if (TRXDIR != 1)
+                        local_mem_written(get_PSM_layout(BITBLTBUF.dest_format), BITBLTBUF.dest_base, BITBLTBUF.dest_width,
+                                          TRXPOS.dest_x, TRXPOS.dest_y,
+                                          TRXPOS.dest_x + TRXREG.width, TRXPOS.dest_y + TRXREG.height + 1);
+                    if (TRXDIR != 0)
+                        mark_sampled_pages(get_PSM_layout(BITBLTBUF.source_format), BITBLTBUF.source_base, BITBLTBUF.source_width,
+                                           TRXPOS.source_x, TRXPOS.source_y,
+                                           TRXPOS.source_x + TRXREG.width, TRXPOS.source_y + TRXREG.height);
                     if (TRXDIR == 2)
                     {
                         //VRAM-to-VRAM transfer
                         //More than likely not instantaneous
+                        const PSMLayout* source_layout = get_PSM_layout(BITBLTBUF.source_format);
+                        if (source_layout)
+                            frame_stats.local_to_local_bytes += (uint64_t)TRXREG.width * TRXREG.height * source_layout->bpp / 8;
+                        uint64_t transfer_start = __rdtsc();
                         local_to_local();
+                        transfer_ticks += __rdtsc() - transfer_start;
                         TRXDIR = 3;
                     }
                 }
                 break;
             case 0x0054:
                 if (TRXDIR == 0)
+                {
+                    frame_stats.host_to_local_bytes += sizeof(value);
+                    hwreg_written = true;
                     write_HWREG(value);
+                }
                 break;
             default:
                 Errors::print_warning("[GS_t] Unrecognized write64 to reg $%04X: $%08X_%08X\n", addr, value >> 32, value);
@@ -1276,6 +1836,46 @@ namespace gs
         return addr & 0x007FFFFF;
     }
 
+    static const PSMLayout layout_PSMCT32 = { addr_PSMCT32, 8, 8, 64, 32, 32 };
+    static const PSMLayout layout_PSMCT32Z = { addr_PSMCT32Z, 8, 8, 64, 32, 32 };
+    static const PSMLayout layout_PSMCT16 = { addr_PSMCT16, 16, 8, 64, 64, 16 };
+    static const PSMLayout layout_PSMCT16S = { addr_PSMCT16S, 16, 8, 64, 64, 16 };
+    static const PSMLayout layout_PSMCT16Z = { addr_PSMCT16Z, 16, 8, 64, 64, 16 };
+    static const PSMLayout layout_PSMCT16SZ = { addr_PSMCT16SZ, 16, 8, 64, 64, 16 };
+    static const PSMLayout layout_PSMCT8 = { addr_PSMCT8, 16, 16, 128, 64, 8 };
+    static const PSMLayout layout_PSMCT4 = { addr_PSMCT4, 32, 16, 128, 128, 4 };
+
+    const PSMLayout* get_PSM_layout(uint8_t format)
+    {
+        switch (format)
+        {
+            //PSMCT32, PSMCT24, PSMT8H, PSMT4HL, PSMT4HH all share the 32-bit layout
+            case 0x00:
+            case 0x01:
+            case 0x1B:
+            case 0x24:
+            case 0x2C:
+                return &layout_PSMCT32;
+            case 0x02:
+                return &layout_PSMCT16;
+            case 0x0A:
+                return &layout_PSMCT16S;
+            case 0x13:
+                return &layout_PSMCT8;
+            case 0x14:
+                return &layout_PSMCT4;
+            case 0x30:
+            case 0x31:
+                return &layout_PSMCT32Z;
+            case 0x32:
+                return &layout_PSMCT16Z;
+            case 0x3A:
+                return &layout_PSMCT16SZ;
+            default:
+                return nullptr;
+        }
+    }
+
     uint32_t GraphicsSynthesizerThread::read_PSMCT32_block(uint32_t base, uint32_t width, uint32_t x, uint32_t y)
     {
         uint32_t addr = addr_PSMCT32(base / 256, width / 64, x, y);
@@ -1472,1410 +2072,2558 @@ namespace gs
         if (current_ctx->scissor.empty())
             return;
 
-    #ifdef GS_JIT
-        jit_draw_pixel_func = get_jitted_draw_pixel(draw_pixel_state);
-        //No need to recompile tex_lookup if texture mapping is disabled. TEX0 can contain bad data
-        if(current_PRMODE->texture_mapping)
-            jit_tex_lookup_func = get_jitted_tex_lookup(tex_lookup_state);
-    #endif
-        switch (prim_type)
+        uint64_t start = __rdtsc();
+
+        //Lines widen the area they draw to by their vertices, so they can't share setup
+        bool batched = prim_type != 1 && prim_type != 2;
+        if (!batched || !batch_open)
         {
-            case 0:
-                render_point();
-                break;
-            case 1:
-            case 2:
-                render_line();
-                break;
-            case 3:
-            case 4:
-            case 5:
-                render_triangle2();
-                break;
-            case 6:
-                render_sprite();
-                break;
+            flush_draw_batch();
+            begin_draw_batch();
+        }
+        else
+            hz_valid = false;
+
+        if (batch_skipped)
+            frame_stats.primitives_skipped++;
+        else
+        {
+            frame_stats.primitives[prim_type]++;
+            batch_drawn = true;
+            switch (prim_type)
+            {
+                case 0:
+                    render_point();
+                    break;
+                case 1:
+                case 2:
+                    render_line();
+                    break;
+                case 3:
+                case 4:
+                case 5:
+                    render_triangle2();
+                    break;
+                case 6:
+                    render_sprite();
+                    break;
+            }
+            set_depth_test_bypass(false);
         }
+
+        if (!batched)
+            flush_draw_batch();
+        raster_ticks += __rdtsc() - start;
     }
 
-    bool GraphicsSynthesizerThread::depth_test(int32_t x, int32_t y, uint32_t z)
+    //Setup for a run of primitives. It stays valid until a register write changes draw state,
+    //as the texture, pipelines, and the scissor area the primitives draw to are all fixed until then.
+    void GraphicsSynthesizerThread::begin_draw_batch()
     {
-        uint32_t base = current_ctx->zbuf.base_pointer;
-        uint32_t width = current_ctx->frame.width;
-        switch (current_ctx->test.depth_method)
+        if (current_PRMODE->texture_mapping)
         {
-            case 0: //FAIL
-                return false;
-            case 1: //PASS
-                return true;
-            case 2: //GEQUAL
-                switch (current_ctx->zbuf.format)
-                {
-                    case 0x00:
-                        return z >= read_PSMCT32_block(base, width, x, y);
-                    case 0x01:
-                        z = std::min(z, 0xFFFFFFU);
-                        return z >= (read_PSMCT32_block(base, width, x, y) & 0xFFFFFF);
-                    case 0x02:
-                        z = std::min(z, 0xFFFFU);
-                        return z >= read_PSMCT16_block(base, width, x, y);
-                    case 0x0A:
-                        z = std::min(z, 0xFFFFU);
-                        return z >= read_PSMCT16S_block(base, width, x, y);
-                    case 0x30:
-                        return z >= read_PSMCT32Z_block(base, width, x, y);
-                    case 0x31:
-                        z = std::min(z, 0xFFFFFFU);
-                        return z >= (read_PSMCT32Z_block(base, width, x, y) & 0xFFFFFF);
-                    case 0x32:
-                        z = std::min(z, 0xFFFFU);
-                        return z >= read_PSMCT16Z_block(base, width, x, y);
-                    case 0x3A:
-                        z = std::min(z, 0xFFFFU);
-                        return z >= read_PSMCT16SZ_block(base, width, x, y);
-                    default:
-                        Errors::die("[GS_t] Unrecognized zbuf format $%02X\n", current_ctx->zbuf.format);
-                }
-                break;
-            case 3: //GREATER
-                switch (current_ctx->zbuf.format)
+            TEX0& tex0 = current_ctx->tex0;
+            TEX1& tex1 = current_ctx->tex1;
+            const PSMLayout* tex_layout = get_PSM_layout(tex0.format);
+            bool mipmapped = tex1.max_MIP_level && tex1.filter_smaller >= 2;
+
+            //With MTBA, levels 1-3 are packed right after the base level and take up less than its size again
+            int tex_rows = (mipmapped && tex1.MTBA) ? tex0.tex_height * 2 : tex0.tex_height;
+            mark_sampled_pages(tex_layout, tex0.texture_base, std::max(tex0.width, 64U),
+                               0, 0, tex0.tex_width, tex_rows);
+
+            if (mipmapped)
+            {
+                int max_level = std::min((int)tex1.max_MIP_level, 6);
+                for (int level = (tex1.MTBA) ? 4 : 1; level <= max_level; level++)
                 {
-                    case 0x00:
-                        return z > read_PSMCT32_block(base, width, x, y);
-                    case 0x01:
-                        z = std::min(z, 0xFFFFFFU);
-                        return z > (read_PSMCT32_block(base, width, x, y) & 0xFFFFFF);
-                    case 0x02:
-                        z = std::min(z, 0xFFFFU);
-                        return z > read_PSMCT16_block(base, width, x, y);
-                    case 0x0A:
-                        z = std::min(z, 0xFFFFU);
-                        return z > read_PSMCT16S_block(base, width, x, y);
-                    case 0x30:
-                        return z > read_PSMCT32Z_block(base, width, x, y);
-                    case 0x31:
-                        z = std::min(z, 0xFFFFFFU);
-                        return z > (read_PSMCT32Z_block(base, width, x, y) & 0xFFFFFF);
-                    case 0x32:
-                        z = std::min(z, 0xFFFFU);
-                        return z > read_PSMCT16Z_block(base, width, x, y);
-                    case 0x3A:
-                        z = std::min(z, 0xFFFFU);
-                        return z > read_PSMCT16SZ_block(base, width, x, y);
-                    default:
-                        Errors::die("[GS_t] Unrecognized zbuf format $%02X\n", current_ctx->zbuf.format);
+                    mark_sampled_pages(tex_layout, current_ctx->miptbl.texture_base[level - 1],
+                                       current_ctx->miptbl.width[level - 1], 0, 0,
+                                       std::max(tex0.tex_width >> level, 1), std::max(tex0.tex_height >> level, 1));
                 }
-                break;
+            }
+
+            switch (tex0.format)
+            {
+                case 0x13:
+                case 0x14:
+                case 0x1B:
+                case 0x24:
+                case 0x2C:
+                    update_clut_rgba();
+                    break;
+            }
         }
-        return false;
+
+    #ifdef GS_JIT
+        jit_draw_pixel_func = get_jitted_draw_pixel(draw_pixel_state);
+        //No need to recompile tex_lookup if texture mapping is disabled. TEX0 can contain bad data
+        if(current_PRMODE->texture_mapping)
+            jit_tex_lookup_func = get_jitted_tex_lookup(tex_lookup_state);
+    #endif
+        begin_zbounds_primitive();
+
+        batch_open = true;
+        batch_drawn = false;
+        batch_skipped = skip_frame && can_skip_primitive();
     }
 
-    uint32_t GraphicsSynthesizerThread::lookup_frame_color(int32_t x, int32_t y)
+    //Marks everything the primitives of the batch drew over. This has to happen before anything
+    //else looks at local memory: transfers, downloads, render_CRT, or primitives with other state.
+    void GraphicsSynthesizerThread::flush_draw_batch()
     {
-        if (frame_color_looked_up)
+        if (!batch_open)
+            return;
+
+        batch_open = false;
+        if (batch_drawn)
+            end_zbounds_primitive();
+    }
+
+    //Conservative range of pages a rectangle of a buffer can touch.
+    //Page numbers grow linearly with x and y, so the corners bound everything in between.
+    static void get_page_range(const PSMLayout* layout, uint32_t base, uint32_t width,
+                               int32_t x1, int32_t y1, int32_t x2, int32_t y2, uint32_t& first, uint32_t& last)
+    {
+        first = 0;
+        last = 511;
+        if (!layout || x1 < 0 || y1 < 0 || x2 > 2048 || y2 > 2048)
+            return;
+
+        uint32_t pages_per_row = width / layout->page_width;
+        uint32_t first_page = (base / 8192) + (y1 / layout->page_height) * pages_per_row + (x1 / layout->page_width);
+        uint32_t last_page = (base / 8192) + ((y2 - 1) / layout->page_height) * pages_per_row + ((x2 - 1) / layout->page_width);
+
+        //A base pointer that isn't page aligned spills into the next page
+        if (base & 0x1FFF)
+            last_page++;
+
+        //Addresses wrap around local memory
+        if (last_page >= 512)
+            return;
+
+        first = first_page;
+        last = last_page;
+    }
+
+    void GraphicsSynthesizerThread::reset_zbounds()
+    {
+        for (ZBlockBounds& bounds : zblock_bounds)
+            bounds.format = 0xFF;
+        memset(zbounds_pages, 0, sizeof(zbounds_pages));
+    }
+
+    void GraphicsSynthesizerThread::invalidate_zbounds(uint32_t first_page, uint32_t last_page)
+    {
+        for (uint32_t page = first_page; page <= last_page; page++)
         {
-            return frame_color;
+            uint64_t& pages = zbounds_pages[page / 64];
+            if (!pages)
+            {
+                page |= 63;
+                continue;
+            }
+
+            uint64_t bit = 1ULL << (page & 63);
+            if (!(pages & bit))
+                continue;
+
+            pages &= ~bit;
+            for (uint32_t block = page * 32; block < (page + 1) * 32; block++)
+                zblock_bounds[block].format = 0xFF;
         }
+    }
 
-        switch (current_ctx->frame.format)
+    void GraphicsSynthesizerThread::invalidate_zbounds(const PSMLayout* layout, uint32_t base, uint32_t width,
+                                                       int32_t x1, int32_t y1, int32_t x2, int32_t y2)
+    {
+        if (x1 >= x2 || y1 >= y2)
+            return;
+
+        uint32_t first, last;
+        get_page_range(layout, base, width, x1, y1, x2, y2, first, last);
+        invalidate_zbounds(first, last);
+    }
+
+    void GraphicsSynthesizerThread::begin_zbounds_primitive()
+    {
+        TEST& test = current_ctx->test;
+        hz_layout = get_PSM_layout(current_ctx->zbuf.format);
+        hz_depth_method = test.depth_method;
+        hz_z_writes = test.depth_test && test.depth_method != 0 && !current_ctx->zbuf.no_update && hz_layout;
+        hz_frame_writes = current_ctx->frame.mask != 0xFFFFFFFF;
+        hz_valid = false;
+        hz_bypass = false;
+        switch (current_ctx->zbuf.format)
         {
-            case 0x0:
-                frame_color = read_PSMCT32_block(current_ctx->frame.base_pointer, current_ctx->frame.width, x, y);
-                break;
-            case 0x1://24
-                frame_color = read_PSMCT32_block(current_ctx->frame.base_pointer, current_ctx->frame.width, x, y)
-                    & 0xFFFFFF;
-                frame_color |= 1 << 31;
-                break;
-            case 0x2:
-                frame_color = convert_color_up(read_PSMCT16_block(current_ctx->frame.base_pointer, current_ctx->frame.width, x, y));
-                break;
-            case 0xA:
-                frame_color = convert_color_up(read_PSMCT16S_block(current_ctx->frame.base_pointer, current_ctx->frame.width, x, y));
-                break;
-            case 0x30:
-                frame_color = read_PSMCT32Z_block(current_ctx->frame.base_pointer, current_ctx->frame.width, x, y);
-                break;
-            case 0x31://24Z
-                frame_color = read_PSMCT32Z_block(current_ctx->frame.base_pointer, current_ctx->frame.width, x, y)
-                    & 0xFFFFFF;
-                frame_color |= 1 << 31;
+            case 0x01:
+            case 0x31:
+                hz_format_max = 0xFFFFFF;
                 break;
+            case 0x02:
+            case 0x0A:
             case 0x32:
-                frame_color = convert_color_up(read_PSMCT16Z_block(current_ctx->frame.base_pointer, current_ctx->frame.width, x, y));
-                break;
             case 0x3A:
-                frame_color = convert_color_up(read_PSMCT16SZ_block(current_ctx->frame.base_pointer, current_ctx->frame.width, x, y));
+                hz_format_max = 0xFFFF;
                 break;
             default:
-                Errors::die("Unknown FRAME format (%x) read attempted", current_ctx->frame.format);
+                hz_format_max = 0xFFFFFFFF;
+                break;
+        }
+        jit_draw_pixel_depth_func = jit_draw_pixel_func;
+        jit_draw_pixel_nodepth_func = nullptr;
+
+        //Area the primitive can draw to. Lines don't clip their minor axis, so widen it to their vertices.
+        hz_x1 = current_ctx->scissor.x1 >> 4;
+        hz_y1 = current_ctx->scissor.y1 >> 4;
+        hz_x2 = (current_ctx->scissor.x2 >> 4) + 1;
+        hz_y2 = (current_ctx->scissor.y2 >> 4) + 1;
+        if (prim_type == 1 || prim_type == 2)
+        {
+            for (int i = 0; i < 2; i++)
+            {
+                Vertex v = vtx_queue[i]; v.to_relative(current_ctx->xyoffset);
+                hz_x1 = std::min(hz_x1, (v.x >> 4) - 1);
+                hz_y1 = std::min(hz_y1, (v.y >> 4) - 1);
+                hz_x2 = std::max(hz_x2, (v.x >> 4) + 2);
+                hz_y2 = std::max(hz_y2, (v.y >> 4) + 2);
+            }
         }
-        frame_color_looked_up = true;
 
-        return frame_color;
+        //If the frame overlaps the z buffer, the bounds would go stale halfway through the primitive
+        hz_aliased = false;
+        if (hz_frame_writes && hz_layout)
+        {
+            uint32_t frame_first, frame_last, z_first, z_last;
+            get_page_range(get_PSM_layout(current_ctx->frame.format), current_ctx->frame.base_pointer,
+                           current_ctx->frame.width, hz_x1, hz_y1, hz_x2, hz_y2, frame_first, frame_last);
+            get_page_range(hz_layout, current_ctx->zbuf.base_pointer, current_ctx->frame.width,
+                           hz_x1, hz_y1, hz_x2, hz_y2, z_first, z_last);
+            hz_aliased = frame_first <= z_last && z_first <= frame_last;
+        }
+
+        hz_enabled = test.depth_test && (test.depth_method == 2 || test.depth_method == 3) && hz_layout && !hz_aliased;
     }
 
-    bool GraphicsSynthesizerThread::is_32bit_texture()
+    void GraphicsSynthesizerThread::end_zbounds_primitive()
     {
-        switch (current_ctx->tex0.format)
-        {
-            case 0:
-                return true;
-                break;
-            case 0x13:
-            case 0x14:
-            case 0x1B:
-            case 0x24:
-            case 0x2C:
-                return current_ctx->tex0.CLUT_format == 0;
-                break;
-        }
-        return false;
+        if (hz_frame_writes)
+            local_mem_written(get_PSM_layout(current_ctx->frame.format), current_ctx->frame.base_pointer,
+                              current_ctx->frame.width, hz_x1, hz_y1, hz_x2, hz_y2);
+
+        //Z writes keep the z bounds up to date themselves, except for lines which don't work out their z range
+        if (!current_ctx->zbuf.no_update)
+            local_mem_written(hz_layout, current_ctx->zbuf.base_pointer, current_ctx->frame.width,
+                              hz_x1, hz_y1, hz_x2, hz_y2, hz_z_writes && (prim_type == 1 || prim_type == 2));
     }
 
+    //Tells everything cached from local memory that the given rectangle of a buffer was written to
+    void GraphicsSynthesizerThread::local_mem_written(const PSMLayout* layout, uint32_t base, uint32_t width,
+                                                      int32_t x1, int32_t y1, int32_t x2, int32_t y2, bool zbounds)
+    {
+        if (x1 >= x2 || y1 >= y2)
+            return;
 
-    void GraphicsSynthesizerThread::draw_pixel(int32_t x, int32_t y, uint32_t z, RGBAQ_REG& color)
+        uint32_t first, last;
+        get_page_range(layout, base, width, x1, y1, x2, y2, first, last);
+        if (zbounds)
+            invalidate_zbounds(first, last);
+        invalidate_download_cache(first, last);
+        mark_crt_dirty(first, last);
+        invalidate_clut_palettes(first, last);
+    }
+
+    //Sets the range of z values the current primitive can store, given the range its z is interpolated in.
+    //Kept inline: a call between render_triangle2's AVX vertex copies and the JIT leaves the upper
+    //register halves dirty, which makes every SSE instruction in the jitted pixel pipeline pay a penalty.
+    inline void GraphicsSynthesizerThread::set_zbounds_range(int64_t min, int64_t max)
     {
-        frame_color_looked_up = false;
-        x >>= 4;
-        y >>= 4;
+        //The JIT clamps z with a signed compare, which lets values with bit 31 set through unclamped
+        hz_valid = hz_layout && min >= 0 && max <= 0xFFFFFFFF && (hz_format_max == 0xFFFFFFFF || max < 0x80000000);
+        hz_min = std::min((uint32_t)min, hz_format_max);
+        hz_max = std::min((uint32_t)max, hz_format_max);
+    }
 
-        //SCANMSK prohibits drawing on even or odd y-coordinates
-        if (SCANMSK == 2 && (y & 0x1) == 0)
-            return;
-        else if (SCANMSK == 3 && (y & 0x1) == 1)
+    //Merges the current primitive's z range into the blocks under a rectangle.
+    //When exact is set, blocks the rectangle fully covers are known to hold nothing but that range.
+    void GraphicsSynthesizerThread::update_zbounds(int32_t x1, int32_t y1, int32_t x2, int32_t y2, bool exact)
+    {
+        if (!hz_z_writes || x1 >= x2 || y1 >= y2)
             return;
-        TEST* test = &current_ctx->test;
-        bool update_frame = true;
-        bool update_alpha = true;
-        bool update_z = !current_ctx->zbuf.no_update;
-        int fb, fg, fr;
 
-        if (test->alpha_test)
+        if (x1 < 0 || y1 < 0)
         {
-            bool fail = false;
-            switch (test->alpha_method)
-            {
-                case 0: //NEVER
-                    fail = true;
-                    break;
-                case 1: //ALWAYS
-                    break;
-                case 2: //LESS
-                    if (color.a >= test->alpha_ref)
-                        fail = true;
-                    break;
-                case 3: //LEQUAL
-                    if (color.a > test->alpha_ref)
-                        fail = true;
-                    break;
-                case 4: //EQUAL
-                    if (color.a != test->alpha_ref)
-                        fail = true;
-                    break;
-                case 5: //GEQUAL
-                    if (color.a < test->alpha_ref)
-                        fail = true;
-                    break;
-                case 6: //GREATER
-                    if (color.a <= test->alpha_ref)
-                        fail = true;
-                    break;
-                case 7: //NOTEQUAL
-                    if (color.a == test->alpha_ref)
-                        fail = true;
-                    break;
-            }
+            invalidate_zbounds(hz_layout, current_ctx->zbuf.base_pointer, current_ctx->frame.width, x1, y1, x2, y2);
+            return;
+        }
 
-            if (fail)
+        const uint8_t format = current_ctx->zbuf.format;
+        const uint32_t base = current_ctx->zbuf.base_pointer;
+        const uint32_t width = current_ctx->frame.width;
+        const int32_t block_width = hz_layout->block_width;
+        const int32_t block_height = hz_layout->block_height;
+        const bool known = hz_valid && !hz_aliased;
+        //GEQUAL and GREATER only ever replace z with something at least as large, so the minimum holds
+        const bool keeps_min = hz_depth_method == 2 || hz_depth_method == 3;
+
+        for (int32_t y = y1 & ~(block_height - 1); y < y2; y += block_height)
+        {
+            for (int32_t x = x1 & ~(block_width - 1); x < x2; x += block_width)
             {
-                switch (test->alpha_fail_method)
+                uint32_t block = (hz_layout->block_offset(base, width, x, y) >> 8) & 0x3FFF;
+                ZBlockBounds& bounds = zblock_bounds[block];
+                if (known && exact && x >= x1 && y >= y1 && x + block_width <= x2 && y + block_height <= y2)
                 {
-                    case 0: //KEEP - Update nothing
-                        return;
-                    case 1: //FB_ONLY - Only update framebuffer
-                        update_z = false;
-                        break;
-                    case 2: //ZB_ONLY - Only update z-buffer
-                        update_frame = false;
-                        break;
-                    case 3: //RGB_ONLY - Same as FB_ONLY, but ignore alpha unless the color format is not RGB32, then it's treated as FB_ONLY
-                        update_z = false;
-                        if(is_32bit_texture())
-                            update_alpha = false;
-                        break;
+                    bounds.min = hz_min;
+                    bounds.max = hz_max;
+                    bounds.format = format;
+                    zbounds_pages[block / 2048] |= 1ULL << ((block / 32) & 63);
                 }
+                else if (known && bounds.format == format)
+                {
+                    if (!keeps_min)
+                        bounds.min = std::min(bounds.min, hz_min);
+                    bounds.max = std::max(bounds.max, hz_max);
+                }
+                else
+                    bounds.format = 0xFF;
             }
         }
+    }
 
-        bool pass_depth_test = true;
-        if (test->depth_test)
-            pass_depth_test = depth_test(x, y, z);
-        else
-            update_z = false;
-
-        if (!pass_depth_test)
-            return;
+    //Returns true if every pixel the current primitive draws also writes z
+    bool GraphicsSynthesizerThread::zbounds_exact_writes()
+    {
+        TEST& test = current_ctx->test;
+        if (test.depth_method != 1 || test.dest_alpha_test || SCANMSK >= 2)
+            return false;
+        return !test.alpha_test || test.alpha_method == 1 || test.alpha_fail_method == 2;
+    }
 
-        uint32_t final_color = 0;
+    ZBlockTest GraphicsSynthesizerThread::test_zblock(int32_t x, int32_t y)
+    {
+        uint32_t block = (hz_layout->block_offset(current_ctx->zbuf.base_pointer, current_ctx->frame.width, x, y) >> 8) & 0x3FFF;
+        const ZBlockBounds& bounds = zblock_bounds[block];
+        if (bounds.format != current_ctx->zbuf.format)
+            return ZBlockTest::Test;
 
-        if (test->dest_alpha_test && !(current_ctx->frame.format & 0x1))
+        if (hz_depth_method == 2) //GEQUAL
         {
-            bool alpha = lookup_frame_color(x, y) & (1 << 31);
-            if (test->dest_alpha_method ^ alpha)
-                return;
+            if (hz_max < bounds.min)
+                return ZBlockTest::Reject;
+            if (hz_min >= bounds.max)
+                return ZBlockTest::Pass;
         }
+        else //GREATER
+        {
+            if (hz_max <= bounds.min)
+                return ZBlockTest::Reject;
+            if (hz_min > bounds.max)
+                return ZBlockTest::Pass;
+        }
+        return ZBlockTest::Test;
+    }
 
-        if (update_frame)
+    //Switches the pixel pipeline to a depth test of PASS, which stores z exactly like a passing GEQUAL/GREATER
+    void GraphicsSynthesizerThread::set_depth_test_bypass(bool bypass)
+    {
+        if (bypass == hz_bypass)
+            return;
+        hz_bypass = bypass;
+
+    #ifdef GS_JIT
+        if (bypass && !jit_draw_pixel_nodepth_func)
         {
-            //PABE - MSB of source alpha must be set to enable alpha blending
-            if (current_PRMODE->alpha_blend && (!PABE || (color.a & 0x80)))
-            {
-                uint32_t r1, g1, b1;
-                uint32_t r2, g2, b2;
-                uint32_t cr, cg, cb;
-                uint32_t alpha;
+            current_ctx->test.depth_method = 1;
+            update_draw_pixel_state();
+            jit_draw_pixel_nodepth_func = get_jitted_draw_pixel(draw_pixel_state);
+            current_ctx->test.depth_method = hz_depth_method;
+            update_draw_pixel_state();
+
+            //Recompiling may have flushed the heap
+            jit_draw_pixel_depth_func = get_jitted_draw_pixel(draw_pixel_state);
+        }
+        jit_draw_pixel_func = bypass ? jit_draw_pixel_nodepth_func : jit_draw_pixel_depth_func;
+    #else
+        current_ctx->test.depth_method = bypass ? 1 : hz_depth_method;
+    #endif
+    }
 
-                switch (current_ctx->alpha.spec_A)
-                {
-                    case 0:
-                        r1 = color.r;
-                        g1 = color.g;
-                        b1 = color.b;
-                        break;
-                    case 1:
-                        r1 = lookup_frame_color(x, y) & 0xFF;
-                        g1 = (lookup_frame_color(x, y) >> 8) & 0xFF;
-                        b1 = (lookup_frame_color(x, y) >> 16) & 0xFF;
-                        break;
-                    case 2:
-                    case 3:
-                        r1 = 0;
-                        g1 = 0;
-                        b1 = 0;
-                        break;
-                }
+    //Mask of the pages first..last that fall in word of a 512-page bitmap
+    static uint64_t page_word_mask(uint32_t word, uint32_t first, uint32_t last)
+    {
+        uint64_t mask = ~0ULL;
+        if (word == first / 64)
+            mask &= ~0ULL << (first & 63);
+        if (word == last / 64)
+            mask &= ~0ULL >> (63 - (last & 63));
+        return mask;
+    }
 
-                switch (current_ctx->alpha.spec_B)
-                {
-                    case 0:
-                        r2 = color.r;
-                        g2 = color.g;
-                        b2 = color.b;
-                        break;
-                    case 1:
-                        r2 = lookup_frame_color(x, y) & 0xFF;
-                        g2 = (lookup_frame_color(x, y) >> 8) & 0xFF;
-                        b2 = (lookup_frame_color(x, y) >> 16) & 0xFF;
-                        break;
-                    case 2:
-                    case 3:
-                        r2 = 0;
-                        g2 = 0;
-                        b2 = 0;
-                        break;
-                }
+    static void set_pages(uint64_t* pages, uint32_t first, uint32_t last)
+    {
+        for (uint32_t word = first / 64; word <= last / 64; word++)
+            pages[word] |= page_word_mask(word, first, last);
+    }
 
-                switch (current_ctx->alpha.spec_C)
-                {
-                    case 0:
-                        alpha = color.a;
-                        break;
-                    case 1:
-                        alpha = lookup_frame_color(x, y) >> 24;
-                        break;
-                    case 2:
-                    case 3:
-                        alpha = current_ctx->alpha.fixed_alpha;
-                        break;
-                }
+    static bool any_pages_set(const uint64_t* pages, uint32_t first, uint32_t last)
+    {
+        for (uint32_t word = first / 64; word <= last / 64; word++)
+        {
+            if (pages[word] & page_word_mask(word, first, last))
+                return true;
+        }
+        return false;
+    }
 
-                switch (current_ctx->alpha.spec_D)
-                {
-                    case 0:
-                        cr = color.r;
-                        cg = color.g;
-                        cb = color.b;
-                        break;
-                    case 1:
-                        cr = lookup_frame_color(x, y) & 0xFF;
-                        cg = (lookup_frame_color(x, y) >> 8) & 0xFF;
-                        cb = (lookup_frame_color(x, y) >> 16) & 0xFF;
-                        break;
-                    case 2:
-                    case 3:
-                        cr = 0;
-                        cg = 0;
-                        cb = 0;
-                        break;
-                }
+    static bool all_pages_set(const uint64_t* pages, uint32_t first, uint32_t last)
+    {
+        for (uint32_t word = first / 64; word <= last / 64; word++)
+        {
+            uint64_t mask = page_word_mask(word, first, last);
+            if ((pages[word] & mask) != mask)
+                return false;
+        }
+        return true;
+    }
 
-                fb = (int)b1 - (int)b2;
-                fg = (int)g1 - (int)g2;
-                fr = (int)r1 - (int)r2;
+    //Sets the pages the enabled read circuits scan out. Circuits whose pages can't be worked out are left out,
+    //in which case this returns false.
+    bool GraphicsSynthesizerThread::get_displayed_pages(uint64_t* pages)
+    {
+        bool complete = true;
+        DISPFB* dispfb[] = { &reg.DISPFB1, &reg.DISPFB2 };
+        DISPLAY* display[] = { &reg.DISPLAY1, &reg.DISPLAY2 };
+        bool enabled[] = { reg.PMODE.circuit1, reg.PMODE.circuit2 };
+        for (int i = 0; i < 2; i++)
+        {
+            if (!enabled[i])
+                continue;
 
-                //Color values are 9-bit after an alpha blending operation
-                fb = (((fb * (int)alpha) >> 7) + cb);
-                fg = (((fg * (int)alpha) >> 7) + cg);
-                fr = (((fr * (int)alpha) >> 7) + cr);
-            }
-            else
+            //Interlaced output can start a line further down for the odd field
+            const PSMLayout* layout = get_PSM_layout(dispfb[i]->format);
+            int32_t x2 = dispfb[i]->x + display[i]->width;
+            int32_t y2 = dispfb[i]->y + display[i]->height + 1;
+            if (!layout || display[i]->width <= 0 || display[i]->height <= 0 || x2 > 2048 || y2 > 2048)
             {
-                fb = color.b;
-                fg = color.g;
-                fr = color.r;
+                complete = false;
+                continue;
             }
 
-            //Dithering
-            if (DTHE)
+            uint32_t first, last;
+            get_page_range(layout, dispfb[i]->frame_base * 4, dispfb[i]->width, dispfb[i]->x, dispfb[i]->y,
+                           x2, y2, first, last);
+            if (first == 0 && last == 511)
             {
-                uint8_t dither = dither_mtx[y % 4][x % 4];
-                uint8_t dither_amount = dither & 0x3;
-                if (dither & 0x4)
-                {
-                    dither_amount += 1;
-                    fb -= dither_amount;
-                    fg -= dither_amount;
-                    fr -= dither_amount;
-                }
-                else
-                {
-                    fb += dither_amount;
-                    fg += dither_amount;
-                    fr += dither_amount;
-                }
+                complete = false;
+                continue;
             }
+            set_pages(pages, first, last);
+        }
+        return complete;
+    }
 
-            if (COLCLAMP)
-            {
-                if (fb < 0)
-                    fb = 0;
-                if (fg < 0)
-                    fg = 0;
-                if (fr < 0)
-                    fr = 0;
-                if (fb > 0xFF)
-                    fb = 0xFF;
-                if (fg > 0xFF)
-                    fg = 0xFF;
-                if (fr > 0xFF)
-                    fr = 0xFF;
-            }
-            else
-            {
-                fb &= 0xFF;
-                fg &= 0xFF;
-                fr &= 0xFF;
-            }
-
-            if (!update_alpha)
-                final_color = lookup_frame_color(x, y) & 0xFF000000;
-            else
-            {
-                final_color = color.a << 24;
+    void GraphicsSynthesizerThread::mark_crt_dirty(uint32_t first_page, uint32_t last_page)
+    {
+        set_pages(crt_dirty_pages, first_page, last_page);
+    }
 
-                //FBA performs "alpha correction" - MSB of alpha is always set when writing to frame buffer
-                final_color |= current_ctx->FBA << 31;
-            }
+    //Works out whether target already holds what render_CRT is about to draw into it.
+    //An output buffer shows local memory as of the render that drew it, and with weave deinterlacing,
+    //as of the previous field too. It's still current if nothing it shows was written since then.
+    bool GraphicsSynthesizerThread::crt_output_unchanged(uint32_t* target, bool field, bool weave)
+    {
+        crt_render_count++;
 
-            final_color |= fb << 16;
-            final_color |= fg << 8;
-            final_color |= fr;
+        uint64_t pages[512 / 64] = {};
+        bool changed = crt_registers_changed || !get_displayed_pages(pages);
+        for (int i = 0; i < 512 / 64; i++)
+        {
+            if (pages[i] & crt_dirty_pages[i])
+                changed = true;
+        }
+        memset(crt_dirty_pages, 0, sizeof(crt_dirty_pages));
+        crt_registers_changed = false;
+        if (changed)
+            crt_last_change = crt_render_count;
 
-            uint32_t mask = current_ctx->frame.mask;
-            final_color = (final_color & ~mask) | (lookup_frame_color(x, y) & mask);
+        CRTOutput* output = &crt_outputs[0];
+        if (crt_outputs[1].target == target || (crt_outputs[0].target != target &&
+            crt_outputs[1].render < crt_outputs[0].render))
+            output = &crt_outputs[1];
 
-            //printf("[GS_t] Write $%08X (%d, %d)\n", final_color, x, y);
-            switch (current_ctx->frame.format)
-            {
-                case 0x0:
-                    write_PSMCT32_block(current_ctx->frame.base_pointer, current_ctx->frame.width, x, y, final_color);
-                    break;
-                case 0x1:
-                    write_PSMCT24_block(current_ctx->frame.base_pointer, current_ctx->frame.width, x, y, final_color);
-                    break;
-                case 0x2:
-                    write_PSMCT16_block(current_ctx->frame.base_pointer, current_ctx->frame.width, x, y, convert_color_down(final_color));
-                    break;
-                case 0xA:
-                    write_PSMCT16S_block(current_ctx->frame.base_pointer, current_ctx->frame.width, x, y, convert_color_down(final_color));
-                    break;
-                case 0x30:
-                    write_PSMCT32Z_block(current_ctx->frame.base_pointer, current_ctx->frame.width, x, y, final_color);
-                    break;
-                case 0x31:
-                    write_PSMCT24Z_block(current_ctx->frame.base_pointer, current_ctx->frame.width, x, y, final_color);
-                    break;
-                case 0x32:
-                    write_PSMCT16Z_block(current_ctx->frame.base_pointer, current_ctx->frame.width, x, y, convert_color_down(final_color));
-                    break;
-                case 0x3A:
-                    write_PSMCT16SZ_block(current_ctx->frame.base_pointer, current_ctx->frame.width, x, y, convert_color_down(final_color));
-                    break;
-                default:
-                    Errors::die("Unknown FRAME format (%x) write attempted", current_ctx->frame.format);
-            }
-        }
+        bool unchanged = output->target == target && output->source_render && output->weave == weave &&
+                         (!weave || output->field == field) && crt_last_change <= output->source_render;
 
-        if (update_z)
+        if (!unchanged)
         {
-            switch (current_ctx->zbuf.format)
-            {
-                case 0x00:
-                    write_PSMCT32_block(current_ctx->zbuf.base_pointer, current_ctx->frame.width, x, y, z);
-                    break;
-                case 0x01:
-                    z = std::min(z, 0xFFFFFFU);
-                    write_PSMCT24_block(current_ctx->zbuf.base_pointer, current_ctx->frame.width, x, y, z & 0xFFFFFF);
-                    break;
-                case 0x02:
-                    z = std::min(z, 0xFFFFU);
-                    write_PSMCT16_block(current_ctx->zbuf.base_pointer, current_ctx->frame.width, x, y, z & 0xFFFF);
-                    break;
-                case 0x0A:
-                    z = std::min(z, 0xFFFFU);
-                    write_PSMCT16S_block(current_ctx->zbuf.base_pointer, current_ctx->frame.width, x, y, z & 0xFFFF);
-                    break;
-                case 0x30:
-                    write_PSMCT32Z_block(current_ctx->zbuf.base_pointer, current_ctx->frame.width, x, y, z);
-                    break;
-                case 0x31:
-                    z = std::min(z, 0xFFFFFFU);
-                    write_PSMCT24Z_block(current_ctx->zbuf.base_pointer, current_ctx->frame.width, x, y, z & 0xFFFFFF);
-                    break;
-                case 0x32:
-                    z = std::min(z, 0xFFFFU);
-                    write_PSMCT16Z_block(current_ctx->zbuf.base_pointer, current_ctx->frame.width, x, y, z & 0xFFFF);
-                    break;
-                case 0x3A:
-                    z = std::min(z, 0xFFFFU);
-                    write_PSMCT16SZ_block(current_ctx->zbuf.base_pointer, current_ctx->frame.width, x, y, z & 0xFFFF);
-                    break;
-            }
+            output->target = target;
+            output->field = field;
+            output->weave = weave;
+            output->source_render = weave ? crt_field_render[!field] : crt_render_count;
         }
+        output->render = crt_render_count;
+        crt_field_render[field] = crt_render_count;
+        return unchanged;
     }
 
-    void GraphicsSynthesizerThread::recompile_draw_pixel_prologue()
+    void GraphicsSynthesizerThread::set_frameskip(FrameskipMode mode, int interval)
     {
-        jit_draw_pixel_block.clear();
+        //Reads from before frameskip was turned on weren't tracked, so give it a couple of frames to see them
+        if (mode != frameskip_mode)
+        {
+            memset(displayed_pages, 0, sizeof(displayed_pages));
+            memset(last_displayed_pages, 0, sizeof(last_displayed_pages));
+            memset(sampled_pages, 0, sizeof(sampled_pages));
+            memset(last_sampled_pages, 0, sizeof(last_sampled_pages));
+            frameskip_warmup = 2;
+        }
 
-        emitter_dp.PUSH(REG_64::RBP);
-        emitter_dp.MOV64_MR(REG_64::RSP, REG_64::RBP);
-        emitter_dp.PUSH(REG_64::R12);
-        emitter_dp.PUSH(REG_64::R13);
-        emitter_dp.PUSH(REG_64::R14);
-        emitter_dp.PUSH(REG_64::R15);
+        frameskip_mode = mode;
+        frameskip_interval = std::max(interval, 1);
+        frameskip_counter = 0;
+        frameskip_lag = 0.0;
+        skip_frame = false;
+        last_frame_time = std::chrono::steady_clock::now();
+    }
 
-    #ifdef _WIN32
-        emitter_dp.MOV32_REG(REG_64::RCX, REG_64::R12);
-        emitter_dp.MOV32_REG(REG_64::RDX, REG_64::R13);
-        emitter_dp.MOV32_REG(REG_64::R8, REG_64::R14);
-        emitter_dp.MOV64_FROM_MEM(REG_64::R9, REG_64::R15);
-    #else
-        emitter_dp.MOV32_REG(REG_64::RDI, REG_64::R12);
-        emitter_dp.MOV32_REG(REG_64::RSI, REG_64::R13);
-        emitter_dp.MOV32_REG(REG_64::RDX, REG_64::R14);
-        emitter_dp.MOV64_FROM_MEM(REG_64::RCX, REG_64::R15);
-    #endif
+    //Called when a frame is sent to the screen. Records which pages were scanned out, decides whether
+    //the next frame is skipped, and returns whether the frame that just ended was.
+    bool GraphicsSynthesizerThread::end_frameskip_frame()
+    {
+        bool skipped = skip_frame;
+        skip_frame = false;
+        if (frameskip_mode == FrameskipMode::Off)
+            return skipped;
 
-        emitter_dp.SUB64_REG_IMM(0x20, REG_64::RSP);
-        emitter_dp.load_addr((uint64_t)&jit_draw_pixel_func, REG_64::RAX);
-        emitter_dp.MOV64_FROM_MEM(REG_64::RAX, REG_64::RAX);
-        emitter_dp.CALL_INDIR(REG_64::RAX);
-        emitter_dp.ADD64_REG_IMM(0x20, REG_64::RSP);
+        //Double buffered games flip DISPFB every frame, so the buffer being drawn is the one shown last frame
+        uint64_t current_pages[512 / 64] = {};
+        get_displayed_pages(current_pages);
 
-        emitter_dp.POP(REG_64::R15);
-        emitter_dp.POP(REG_64::R14);
-        emitter_dp.POP(REG_64::R13);
-        emitter_dp.POP(REG_64::R12);
-        emitter_dp.POP(REG_64::RBP);
-        emitter_dp.RET();
+        for (int i = 0; i < 512 / 64; i++)
+        {
+            displayed_pages[i] = current_pages[i] | last_displayed_pages[i];
+            last_displayed_pages[i] = current_pages[i];
+            last_sampled_pages[i] = sampled_pages[i];
+            sampled_pages[i] = 0;
+        }
 
-        jit_draw_pixel_prologue = (GSDrawPixelPrologue)jit_draw_pixel_heap.
-                insert_block(~0ULL, &jit_draw_pixel_block)->code_start;
-    }
+        auto now = std::chrono::steady_clock::now();
+        std::chrono::duration<double> frame_time = now - last_frame_time;
+        last_frame_time = now;
 
-    void GraphicsSynthesizerThread::render_point()
-    {
-        Vertex v1 = vtx_queue[0]; v1.to_relative(current_ctx->xyoffset);
-        if (v1.x < current_ctx->scissor.x1 || v1.x > current_ctx->scissor.x2 ||
-            v1.y < current_ctx->scissor.y1 || v1.y > current_ctx->scissor.y2)
-            return;
-        printf("[GS_t] Rendering point!\n");
-        printf("Coords: (%d, %d, %d)\n", v1.x >> 4, v1.y >> 4, v1.z);
-        TexLookupInfo tex_info;
-        tex_info.new_lookup = true;
-    
-        tex_info.vtx_color = v1.rgbaq;
-        tex_info.fog = v1.fog;
-        tex_info.tex_base = current_ctx->tex0.texture_base;
-        tex_info.buffer_width = current_ctx->tex0.width;
-        tex_info.tex_width = current_ctx->tex0.tex_width;
-        tex_info.tex_height = current_ctx->tex0.tex_height;
+        if (frameskip_warmup)
+        {
+            frameskip_warmup--;
+            return skipped;
+        }
 
-        if (current_PRMODE->texture_mapping)
+        switch (frameskip_mode)
         {
-            int32_t u, v;
-            calculate_LOD(tex_info);
-            if (!current_PRMODE->use_UV)
-            {
-                u = (v1.s * tex_info.tex_width) / v1.rgbaq.q;
-                v = (v1.t * tex_info.tex_height) / v1.rgbaq.q;
-                u <<= 4;
-                v <<= 4;
-            }
-            else
+            case FrameskipMode::Fixed:
+                frameskip_counter = (frameskip_counter + 1) % frameskip_interval;
+                skip_frame = frameskip_counter != 0;
+                break;
+            case FrameskipMode::Auto:
             {
-                u = (uint32_t) v1.uv.u;
-                v = (uint32_t) v1.uv.v;
+                //Skipped frames run faster than real time and pay the lag back.
+                //Clamp it so a pause or a loading screen doesn't turn into a long run of skips.
+                double target = (reg.CRT_mode == 0x3) ? 1.0 / 50.0 : 1.0 / 60.0;
+                frameskip_lag = std::min(std::max(frameskip_lag + frame_time.count() - target, 0.0),
+                                         target * MAX_AUTO_FRAMESKIP);
+                skip_frame = frameskip_lag > target && frameskip_counter < MAX_AUTO_FRAMESKIP;
+                frameskip_counter = skip_frame ? frameskip_counter + 1 : 0;
+                break;
             }
-    #ifdef GS_JIT
-            jit_tex_lookup_prologue(u, v, &tex_info);
-    #else
-            tex_lookup(u, v, tex_info);
-    #endif
-    #ifdef GS_JIT
-            jit_draw_pixel_prologue(v1.x, v1.y, v1.z, tex_info.tex_color);
-    #else
-            draw_pixel(v1.x, v1.y, v1.z, tex_info.tex_color);
-    #endif
-        }
-        else
-        {
-    #ifdef GS_JIT
-            jit_draw_pixel_prologue(v1.x, v1.y, v1.z, tex_info.vtx_color);
-    #else
-            draw_pixel(v1.x, v1.y, v1.z, tex_info.vtx_color);
-    #endif
+            default:
+                break;
         }
+        return skipped;
     }
 
-    void GraphicsSynthesizerThread::render_line()
+    //Adds pages that are read back from local memory this frame - by textures, CLUTs, and transfers
+    void GraphicsSynthesizerThread::mark_sampled_pages(const PSMLayout* layout, uint32_t base, uint32_t width,
+                                                       int32_t x1, int32_t y1, int32_t x2, int32_t y2)
     {
-        printf("[GS_t] Rendering line!\n");
-        Vertex v1 = vtx_queue[1]; v1.to_relative(current_ctx->xyoffset);
-        Vertex v2 = vtx_queue[0]; v2.to_relative(current_ctx->xyoffset);
+        if (frameskip_mode == FrameskipMode::Off || x1 >= x2 || y1 >= y2)
+            return;
 
-        int32_t min_y = ((std::max(std::min(v1.y, v2.y), (int32_t)current_ctx->scissor.y1) + 8) >> 4) << 4;
-        int32_t min_x = ((std::max(std::min(v1.x, v2.x), (int32_t)current_ctx->scissor.x1) + 8) >> 4) << 4;
-        int32_t max_y = ((std::min(std::max(v1.y, v2.y), (int32_t)current_ctx->scissor.y2 + 0x10) + 8) >> 4) << 4;
-        int32_t max_x = ((std::min(std::max(v1.x, v2.x), (int32_t)current_ctx->scissor.x2 + 0x10) + 8) >> 4) << 4;
-    
+        uint32_t first, last;
+        get_page_range(layout, base, width, x1, y1, x2, y2, first, last);
+        set_pages(sampled_pages, first, last);
+    }
 
-        //Transpose line if it's steep
-        bool is_steep = false;
-        if (abs(v2.x - v1.x) < abs(v2.y - v1.y))
+    //In a skipped frame, a primitive can be dropped when all it draws to is scanned out and never read back.
+    //Its z writes go with it, which keeps the depth buffer consistent with the colors that weren't drawn.
+    //Must be called after begin_zbounds_primitive, which works out what the primitive writes.
+    bool GraphicsSynthesizerThread::can_skip_primitive()
+    {
+        uint32_t first, last;
+        if (hz_frame_writes)
         {
-            std::swap(v1.x, v1.y);
-            std::swap(v2.x, v2.y);
-            is_steep = true;
-            printf("Steep\n");
-            min_x = min_y;
-            max_x = max_y;
+            get_page_range(get_PSM_layout(current_ctx->frame.format), current_ctx->frame.base_pointer,
+                           current_ctx->frame.width, hz_x1, hz_y1, hz_x2, hz_y2, first, last);
+            if (!all_pages_set(displayed_pages, first, last) || any_pages_set(sampled_pages, first, last) ||
+                any_pages_set(last_sampled_pages, first, last))
+                return false;
         }
 
-        //Make line left-to-right (or top to bottom in steep cases)
-        if (v1.x > v2.x)
+        if (hz_z_writes)
         {
-            std::swap(v1, v2);
+            get_page_range(hz_layout, current_ctx->zbuf.base_pointer, current_ctx->frame.width,
+                           hz_x1, hz_y1, hz_x2, hz_y2, first, last);
+            if (any_pages_set(sampled_pages, first, last) || any_pages_set(last_sampled_pages, first, last))
+                return false;
         }
+        return true;
+    }
 
-        TexLookupInfo tex_info;
-        tex_info.new_lookup = true;
-        tex_info.vtx_color = vtx_queue[0].rgbaq;
-        tex_info.tex_base = current_ctx->tex0.texture_base;
-        tex_info.buffer_width = current_ctx->tex0.width;
-        tex_info.tex_width = current_ctx->tex0.tex_width;
-        tex_info.tex_height = current_ctx->tex0.tex_height;
-        float q = vtx_queue[0].rgbaq.q;
+    void GraphicsSynthesizerThread::reset_frame_stats()
+    {
+        memset(&frame_stats, 0, sizeof(frame_stats));
+        raster_ticks = 0;
+        transfer_ticks = 0;
+        crt_ticks = 0;
+        hwreg_written = false;
+        stats_start_ticks = __rdtsc();
+        stats_start_time = std::chrono::steady_clock::now();
+    }
 
-        printf("Coords: (%d, %d, %d) (%d, %d, %d)\n", v1.x >> 4, v1.y >> 4, v1.z, v2.x >> 4, v2.y >> 4, v2.z);
+    void GraphicsSynthesizerThread::finish_frame_stats(GSFrameStats& stats)
+    {
+        //Convert ticks with the TSC rate measured over the frame
+        uint64_t ticks = __rdtsc() - stats_start_ticks;
+        double elapsed_ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - stats_start_time).count();
+        double ns_per_tick = ticks ? elapsed_ns / ticks : 0.0;
 
-        for (int32_t x = min_x; x < max_x; x += 0x10)
-        {
-            int32_t y = interpolate(x, v1.y, v1.x, v2.y, v2.x);
-            uint32_t z = interpolate(x, v1.z, v1.x, v2.z, v2.x);
+        frame_stats.raster_ns = raster_ticks * ns_per_tick;
+        frame_stats.transfer_ns = transfer_ticks * ns_per_tick;
+        frame_stats.crt_ns = crt_ticks * ns_per_tick;
+        stats = frame_stats;
 
-            /*if (y < min_y || y > max_y)
-                continue;
-                */
-            tex_info.fog = interpolate(x, v1.fog, v1.x, v2.fog, v2.x);
-            if (current_PRMODE->gourand_shading)
-            {
-                tex_info.vtx_color.r = interpolate(x, v1.rgbaq.r, v1.x, v2.rgbaq.r, v2.x);
-                tex_info.vtx_color.g = interpolate(x, v1.rgbaq.g, v1.x, v2.rgbaq.g, v2.x);
-                tex_info.vtx_color.b = interpolate(x, v1.rgbaq.b, v1.x, v2.rgbaq.b, v2.x);
-                tex_info.vtx_color.a = interpolate(x, v1.rgbaq.a, v1.x, v2.rgbaq.a, v2.x);
-            }
-            if (current_PRMODE->texture_mapping)
-            {
-                int32_t u, v;
-                calculate_LOD(tex_info);
-                if (!current_PRMODE->use_UV)
-                {
-                    float tex_s, tex_t;
-                    if (is_steep)
-                    {
-                        tex_s = interpolate_f(y, v1.s, v1.y, v2.s, v2.y);
-                        tex_t = interpolate_f(x, v1.t, v1.x, v2.t, v2.x);
-                    }
-                    else
-                    {
-                        tex_s = interpolate_f(x, v1.s, v1.x, v2.s, v2.x);
-                        tex_t = interpolate_f(y, v1.t, v1.y, v2.t, v2.y);
+        reset_frame_stats();
+    }
+
+    std::string GSFrameStats::to_json() const
+    {
+        char buffer[1024];
+        snprintf(buffer, sizeof(buffer),
+            "{\"primitives\": {\"point\": %u, \"line\": %u, \"line_strip\": %u, \"triangle\": %u, "
+            "\"triangle_strip\": %u, \"triangle_fan\": %u, \"sprite\": %u, \"invalid\": %u}, "
+            "\"primitives_skipped\": %u, \"pixels_tested\": %llu, \"pixels_written\": %llu, \"texels_fetched\": %llu, "
+            "\"jit_compiles\": %u, \"host_to_local_bytes\": %llu, \"local_to_host_bytes\": %llu, "
+            "\"local_to_local_bytes\": %llu, \"clut_reloads\": %u, "
+            "\"time_ms\": {\"raster\": %.3f, \"transfer\": %.3f, \"crt\": %.3f}}",
+            primitives[0], primitives[1], primitives[2], primitives[3],
+            primitives[4], primitives[5], primitives[6], primitives[7],
+            primitives_skipped, (unsigned long long)pixels_tested, (unsigned long long)pixels_written,
+            (unsigned long long)texels_fetched, jit_compiles, (unsigned long long)host_to_local_bytes,
+            (unsigned long long)local_to_host_bytes, (unsigned long long)local_to_local_bytes, clut_reloads,
+            raster_ns / 1e6, transfer_ns / 1e6, crt_ns / 1e6);
+        return buffer;
+    }
+
+    bool GraphicsSynthesizerThread::depth_test(int32_t x, int32_t y, uint32_t z)
+    {
+        uint32_t base = current_ctx->zbuf.base_pointer;
+        uint32_t width = current_ctx->frame.width;
+        switch (current_ctx->test.depth_method)
+        {
+            case 0: //FAIL
+                return false;
+            case 1: //PASS
+                return true;
+            case 2: //GEQUAL
+                switch (current_ctx->zbuf.format)
+                {
+                    case 0x00:
+                        return z >= read_PSMCT32_block(base, width, x, y);
+                    case 0x01:
+                        z = std::min(z, 0xFFFFFFU);
+                        return z >= (read_PSMCT32_block(base, width, x, y) & 0xFFFFFF);
+                    case 0x02:
+                        z = std::min(z, 0xFFFFU);
+                        return z >= read_PSMCT16_block(base, width, x, y);
+                    case 0x0A:
+                        z = std::min(z, 0xFFFFU);
+                        return z >= read_PSMCT16S_block(base, width, x, y);
+                    case 0x30:
+                        return z >= read_PSMCT32Z_block(base, width, x, y);
+                    case 0x31:
+                        z = std::min(z, 0xFFFFFFU);
+                        return z >= (read_PSMCT32Z_block(base, width, x, y) & 0xFFFFFF);
+                    case 0x32:
+                        z = std::min(z, 0xFFFFU);
+                        return z >= read_PSMCT16Z_block(base, width, x, y);
+                    case 0x3A:
+                        z = std::min(z, 0xFFFFU);
+                        return z >= read_PSMCT16SZ_block(base, width, x, y);
+                    default:
+                        Errors::die("[GS_t] Unrecognized zbuf format $%02X\n", current_ctx->zbuf.format);
+                }
+                break;
+            case 3: //GREATER
+                switch (current_ctx->zbuf.format)
+                {
+                    case 0x00:
+                        return z > read_PSMCT32_block(base, width, x, y);
+                    case 0x01:
+                        z = std::min(z, 0xFFFFFFU);
+                        return z > (read_PSMCT32_block(base, width, x, y) & 0xFFFFFF);
+                    case 0x02:
+                        z = std::min(z, 0xFFFFU);
+                        return z > read_PSMCT16_block(base, width, x, y);
+                    case 0x0A:
+                        z = std::min(z, 0xFFFFU);
+                        return z > read_PSMCT16S_block(base, width, x, y);
+                    case 0x30:
+                        return z > read_PSMCT32Z_block(base, width, x, y);
+                    case 0x31:
+                        z = std::min(z, 0xFFFFFFU);
+                        return z > (read_PSMCT32Z_block(base, width, x, y) & 0xFFFFFF);
+                    case 0x32:
+                        z = std::min(z, 0xFFFFU);
+                        return z > read_PSMCT16Z_block(base, width, x, y);
+                    case 0x3A:
+                        z = std::min(z, 0xFFFFU);
+                        return z > read_PSMCT16SZ_block(base, width, x, y);
+                    default:
+                        Errors::die("[GS_t] Unrecognized zbuf format $%02X\n", current_ctx->zbuf.format);
+                }
+                break;
+        }
+        return false;
+    }
+
+    uint32_t GraphicsSynthesizerThread::lookup_frame_color(int32_t x, int32_t y)
+    {
+        if (frame_color_looked_up)
+        {
+            return frame_color;
+        }
+
+        switch (current_ctx->frame.format)
+        {
+            case 0x0:
+                frame_color = read_PSMCT32_block(current_ctx->frame.base_pointer, current_ctx->frame.width, x, y);
+                break;
+            case 0x1://24
+                frame_color = read_PSMCT32_block(current_ctx->frame.base_pointer, current_ctx->frame.width, x, y)
+                    & 0xFFFFFF;
+                frame_color |= 1 << 31;
+                break;
+            case 0x2:
+                frame_color = convert_color_up(read_PSMCT16_block(current_ctx->frame.base_pointer, current_ctx->frame.width, x, y));
+                break;
+            case 0xA:
+                frame_color = convert_color_up(read_PSMCT16S_block(current_ctx->frame.base_pointer, current_ctx->frame.width, x, y));
+                break;
+            case 0x30:
+                frame_color = read_PSMCT32Z_block(current_ctx->frame.base_pointer, current_ctx->frame.width, x, y);
+                break;
+            case 0x31://24Z
+                frame_color = read_PSMCT32Z_block(current_ctx->frame.base_pointer, current_ctx->frame.width, x, y)
+                    & 0xFFFFFF;
+                frame_color |= 1 << 31;
+                break;
+            case 0x32:
+                frame_color = convert_color_up(read_PSMCT16Z_block(current_ctx->frame.base_pointer, current_ctx->frame.width, x, y));
+                break;
+            case 0x3A:
+                frame_color = convert_color_up(read_PSMCT16SZ_block(current_ctx->frame.base_pointer, current_ctx->frame.width, x, y));
+                break;
+            default:
+                Errors::die("Unknown FRAME format (%x) read attempted", current_ctx->frame.format);
+        }
+        frame_color_looked_up = true;
+
+        return frame_color;
+    }
+
+    bool GraphicsSynthesizerThread::is_32bit_texture()
+    {
+        switch (current_ctx->tex0.format)
+        {
+            case 0:
+                return true;
+                break;
+            case 0x13:
+            case 0x14:
+            case 0x1B:
+            case 0x24:
+            case 0x2C:
+                return current_ctx->tex0.CLUT_format == 0;
+                break;
+        }
+        return false;
+    }
+
+
+    void GraphicsSynthesizerThread::draw_pixel(int32_t x, int32_t y, uint32_t z, RGBAQ_REG& color)
+    {
+        frame_color_looked_up = false;
+        x >>= 4;
+        y >>= 4;
+
+        //SCANMSK prohibits drawing on even or odd y-coordinates
+        if (SCANMSK == 2 && (y & 0x1) == 0)
+            return;
+        else if (SCANMSK == 3 && (y & 0x1) == 1)
+            return;
+        TEST* test = &current_ctx->test;
+        bool update_frame = true;
+        bool update_alpha = true;
+        bool update_z = !current_ctx->zbuf.no_update;
+        int fb, fg, fr;
+
+        if (test->alpha_test)
+        {
+            bool fail = false;
+            switch (test->alpha_method)
+            {
+                case 0: //NEVER
+                    fail = true;
+                    break;
+                case 1: //ALWAYS
+                    break;
+                case 2: //LESS
+                    if (color.a >= test->alpha_ref)
+                        fail = true;
+                    break;
+                case 3: //LEQUAL
+                    if (color.a > test->alpha_ref)
+                        fail = true;
+                    break;
+                case 4: //EQUAL
+                    if (color.a != test->alpha_ref)
+                        fail = true;
+                    break;
+                case 5: //GEQUAL
+                    if (color.a < test->alpha_ref)
+                        fail = true;
+                    break;
+                case 6: //GREATER
+                    if (color.a <= test->alpha_ref)
+                        fail = true;
+                    break;
+                case 7: //NOTEQUAL
+                    if (color.a == test->alpha_ref)
+                        fail = true;
+                    break;
+            }
+
+            if (fail)
+            {
+                switch (test->alpha_fail_method)
+                {
+                    case 0: //KEEP - Update nothing
+                        return;
+                    case 1: //FB_ONLY - Only update framebuffer
+                        update_z = false;
+                        break;
+                    case 2: //ZB_ONLY - Only update z-buffer
+                        update_frame = false;
+                        break;
+                    case 3: //RGB_ONLY - Same as FB_ONLY, but ignore alpha unless the color format is not RGB32, then it's treated as FB_ONLY
+                        update_z = false;
+                        if(is_32bit_texture())
+                            update_alpha = false;
+                        break;
+                }
+            }
+        }
+
+        bool pass_depth_test = true;
+        if (test->depth_test)
+            pass_depth_test = depth_test(x, y, z);
+        else
+            update_z = false;
+
+        if (!pass_depth_test)
+            return;
+
+        uint32_t final_color = 0;
+
+        if (test->dest_alpha_test && !(current_ctx->frame.format & 0x1))
+        {
+            bool alpha = lookup_frame_color(x, y) & (1 << 31);
+            if (test->dest_alpha_method ^ alpha)
+                return;
+        }
+
+        if (update_frame)
+        {
+            //PABE - MSB of source alpha must be set to enable alpha blending
+            if (current_PRMODE->alpha_blend && (!PABE || (color.a & 0x80)))
+            {
+                uint32_t r1, g1, b1;
+                uint32_t r2, g2, b2;
+                uint32_t cr, cg, cb;
+                uint32_t alpha;
+
+                switch (current_ctx->alpha.spec_A)
+                {
+                    case 0:
+                        r1 = color.r;
+                        g1 = color.g;
+                        b1 = color.b;
+                        break;
+                    case 1:
+                        r1 = lookup_frame_color(x, y) & 0xFF;
+                        g1 = (lookup_frame_color(x, y) >> 8) & 0xFF;
+                        b1 = (lookup_frame_color(x, y) >> 16) & 0xFF;
+                        break;
+                    case 2:
+                    case 3:
+                        r1 = 0;
+                        g1 = 0;
+                        b1 = 0;
+                        break;
+                }
+
+                switch (current_ctx->alpha.spec_B)
+                {
+                    case 0:
+                        r2 = color.r;
+                        g2 = color.g;
+                        b2 = color.b;
+                        break;
+                    case 1:
+                        r2 = lookup_frame_color(x, y) & 0xFF;
+                        g2 = (lookup_frame_color(x, y) >> 8) & 0xFF;
+                        b2 = (lookup_frame_color(x, y) >> 16) & 0xFF;
+                        break;
+                    case 2:
+                    case 3:
+                        r2 = 0;
+                        g2 = 0;
+                        b2 = 0;
+                        break;
+                }
+
+                switch (current_ctx->alpha.spec_C)
+                {
+                    case 0:
+                        alpha = color.a;
+                        break;
+                    case 1:
+                        alpha = lookup_frame_color(x, y) >> 24;
+                        break;
+                    case 2:
+                    case 3:
+                        alpha = current_ctx->alpha.fixed_alpha;
+                        break;
+                }
+
+                switch (current_ctx->alpha.spec_D)
+                {
+                    case 0:
+                        cr = color.r;
+                        cg = color.g;
+                        cb = color.b;
+                        break;
+                    case 1:
+                        cr = lookup_frame_color(x, y) & 0xFF;
+                        cg = (lookup_frame_color(x, y) >> 8) & 0xFF;
+                        cb = (lookup_frame_color(x, y) >> 16) & 0xFF;
+                        break;
+                    case 2:
+                    case 3:
+                        cr = 0;
+                        cg = 0;
+                        cb = 0;
+                        break;
+                }
+
+                fb = (int)b1 - (int)b2;
+                fg = (int)g1 - (int)g2;
+                fr = (int)r1 - (int)r2;
+
+                //Color values are 9-bit after an alpha blending operation
+                fb = (((fb * (int)alpha) >> 7) + cb);
+                fg = (((fg * (int)alpha) >> 7) + cg);
+                fr = (((fr * (int)alpha) >> 7) + cr);
+            }
+            else
+            {
+                fb = color.b;
+                fg = color.g;
+                fr = color.r;
+            }
+
+            //Dithering
+            if (DTHE)
+            {
+                uint8_t dither = dither_mtx[y % 4][x % 4];
+                uint8_t dither_amount = dither & 0x3;
+                if (dither & 0x4)
+                {
+                    dither_amount += 1;
+                    fb -= dither_amount;
+                    fg -= dither_amount;
+                    fr -= dither_amount;
+                }
+                else
+                {
+                    fb += dither_amount;
+                    fg += dither_amount;
+                    fr += dither_amount;
+                }
+            }
+
+            if (COLCLAMP)
+            {
+                if (fb < 0)
+                    fb = 0;
+                if (fg < 0)
+                    fg = 0;
+                if (fr < 0)
+                    fr = 0;
+                if (fb > 0xFF)
+                    fb = 0xFF;
+                if (fg > 0xFF)
+                    fg = 0xFF;
+                if (fr > 0xFF)
+                    fr = 0xFF;
+            }
+            else
+            {
+                fb &= 0xFF;
+                fg &= 0xFF;
+                fr &= 0xFF;
+            }
+
+            if (!update_alpha)
+                final_color = lookup_frame_color(x, y) & 0xFF000000;
+            else
+            {
+                final_color = color.a << 24;
+
+                //FBA performs "alpha correction" - MSB of alpha is always set when writing to frame buffer
+                final_color |= current_ctx->FBA << 31;
+            }
+
+            final_color |= fb << 16;
+            final_color |= fg << 8;
+            final_color |= fr;
+
+            uint32_t mask = current_ctx->frame.mask;
+            final_color = (final_color & ~mask) | (lookup_frame_color(x, y) & mask);
+
+            //printf("[GS_t] Write $%08X (%d, %d)\n", final_color, x, y);
+            switch (current_ctx->frame.format)
+            {
+                case 0x0:
+                    write_PSMCT32_block(current_ctx->frame.base_pointer, current_ctx->frame.width, x, y, final_color);
+                    break;
+                case 0x1:
+                    write_PSMCT24_block(current_ctx->frame.base_pointer, current_ctx->frame.width, x, y, final_color);
+                    break;
+                case 0x2:
+                    write_PSMCT16_block(current_ctx->frame.base_pointer, current_ctx->frame.width, x, y, convert_color_down(final_color));
+                    break;
+                case 0xA:
+                    write_PSMCT16S_block(current_ctx->frame.base_pointer, current_ctx->frame.width, x, y, convert_color_down(final_color));
+                    break;
+                case 0x30:
+                    write_PSMCT32Z_block(current_ctx->frame.base_pointer, current_ctx->frame.width, x, y, final_color);
+                    break;
+                case 0x31:
+                    write_PSMCT24Z_block(current_ctx->frame.base_pointer, current_ctx->frame.width, x, y, final_color);
+                    break;
+                case 0x32:
+                    write_PSMCT16Z_block(current_ctx->frame.base_pointer, current_ctx->frame.width, x, y, convert_color_down(final_color));
+                    break;
+                case 0x3A:
+                    write_PSMCT16SZ_block(current_ctx->frame.base_pointer, current_ctx->frame.width, x, y, convert_color_down(final_color));
+                    break;
+                default:
+                    Errors::die("Unknown FRAME format (%x) write attempted", current_ctx->frame.format);
+            }
+        }
+
+        if (update_z)
+        {
+            switch (current_ctx->zbuf.format)
+            {
+                case 0x00:
+                    write_PSMCT32_block(current_ctx->zbuf.base_pointer, current_ctx->frame.width, x, y, z);
+                    break;
+                case 0x01:
+                    z = std::min(z, 0xFFFFFFU);
+                    write_PSMCT24_block(current_ctx->zbuf.base_pointer, current_ctx->frame.width, x, y, z & 0xFFFFFF);
+                    break;
+                case 0x02:
+                    z = std::min(z, 0xFFFFU);
+                    write_PSMCT16_block(current_ctx->zbuf.base_pointer, current_ctx->frame.width, x, y, z & 0xFFFF);
+                    break;
+                case 0x0A:
+                    z = std::min(z, 0xFFFFU);
+                    write_PSMCT16S_block(current_ctx->zbuf.base_pointer, current_ctx->frame.width, x, y, z & 0xFFFF);
+                    break;
+                case 0x30:
+                    write_PSMCT32Z_block(current_ctx->zbuf.base_pointer, current_ctx->frame.width, x, y, z);
+                    break;
+                case 0x31:
+                    z = std::min(z, 0xFFFFFFU);
+                    write_PSMCT24Z_block(current_ctx->zbuf.base_pointer, current_ctx->frame.width, x, y, z & 0xFFFFFF);
+                    break;
+                case 0x32:
+                    z = std::min(z, 0xFFFFU);
+                    write_PSMCT16Z_block(current_ctx->zbuf.base_pointer, current_ctx->frame.width, x, y, z & 0xFFFF);
+                    break;
+                case 0x3A:
+                    z = std::min(z, 0xFFFFU);
+                    write_PSMCT16SZ_block(current_ctx->zbuf.base_pointer, current_ctx->frame.width, x, y, z & 0xFFFF);
+                    break;
+            }
+        }
+    }
+
+    void GraphicsSynthesizerThread::recompile_draw_pixel_prologue()
+    {
+        jit_draw_pixel_block.clear();
+
+        emitter_dp.PUSH(REG_64::RBP);
+        emitter_dp.MOV64_MR(REG_64::RSP, REG_64::RBP);
+        emitter_dp.PUSH(REG_64::R12);
+        emitter_dp.PUSH(REG_64::R13);
+        emitter_dp.PUSH(REG_64::R14);
+        emitter_dp.PUSH(REG_64::R15);
+
+    #ifdef _WIN32
+        emitter_dp.MOV32_REG(REG_64::RCX, REG_64::R12);
+        emitter_dp.MOV32_REG(REG_64::RDX, REG_64::R13);
+        emitter_dp.MOV32_REG(REG_64::R8, REG_64::R14);
+        emitter_dp.MOV64_FROM_MEM(REG_64::R9, REG_64::R15);
+    #else
+        emitter_dp.MOV32_REG(REG_64::RDI, REG_64::R12);
+        emitter_dp.MOV32_REG(REG_64::RSI, REG_64::R13);
+        emitter_dp.MOV32_REG(REG_64::RDX, REG_64::R14);
+        emitter_dp.MOV64_FROM_MEM(REG_64::RCX, REG_64::R15);
+    #endif
+
+        emitter_dp.SUB64_REG_IMM(0x20, REG_64::RSP);
+        emitter_dp.load_addr((uint64_t)&jit_draw_pixel_func, REG_64::RAX);
+        emitter_dp.MOV64_FROM_MEM(REG_64::RAX, REG_64::RAX);
+        emitter_dp.CALL_INDIR(REG_64::RAX);
+        emitter_dp.ADD64_REG_IMM(0x20, REG_64::RSP);
+
+        emitter_dp.POP(REG_64::R15);
+        emitter_dp.POP(REG_64::R14);
+        emitter_dp.POP(REG_64::R13);
+        emitter_dp.POP(REG_64::R12);
+        emitter_dp.POP(REG_64::RBP);
+        emitter_dp.RET();
+
+        jit_draw_pixel_prologue = (GSDrawPixelPrologue)jit_draw_pixel_heap.
+                insert_block(~0ULL, &jit_draw_pixel_block)->code_start;
+    }
+
+    void GraphicsSynthesizerThread::render_point()
+    {
+        Vertex v1 = vtx_queue[0]; v1.to_relative(current_ctx->xyoffset);
+        if (v1.x < current_ctx->scissor.x1 || v1.x > current_ctx->scissor.x2 ||
+            v1.y < current_ctx->scissor.y1 || v1.y > current_ctx->scissor.y2)
+            return;
+        printf("[GS_t] Rendering point!\n");
+        printf("Coords: (%d, %d, %d)\n", v1.x >> 4, v1.y >> 4, v1.z);
+
+        set_zbounds_range(v1.z, v1.z);
+        update_zbounds(v1.x >> 4, v1.y >> 4, (v1.x >> 4) + 1, (v1.y >> 4) + 1, false);
+        TexLookupInfo tex_info;
+        tex_info.new_lookup = true;
+    
+        tex_info.vtx_color = v1.rgbaq;
+        tex_info.fog = v1.fog;
+        tex_info.tex_base = current_ctx->tex0.texture_base;
+        tex_info.buffer_width = current_ctx->tex0.width;
+        tex_info.tex_width = current_ctx->tex0.tex_width;
+        tex_info.tex_height = current_ctx->tex0.tex_height;
+
+        if (current_PRMODE->texture_mapping)
+        {
+            int32_t u, v;
+            calculate_LOD(tex_info);
+            if (!current_PRMODE->use_UV)
+            {
+                u = (v1.s * tex_info.tex_width) / v1.rgbaq.q;
+                v = (v1.t * tex_info.tex_height) / v1.rgbaq.q;
+                u <<= 4;
+                v <<= 4;
+            }
+            else
+            {
+                u = (uint32_t) v1.uv.u;
+                v = (uint32_t) v1.uv.v;
+            }
+    #ifdef GS_JIT
+            jit_tex_lookup_prologue(u, v, &tex_info);
+    #else
+            tex_lookup(u, v, tex_info);
+    #endif
+    #ifdef GS_JIT
+            jit_draw_pixel_prologue(v1.x, v1.y, v1.z, tex_info.tex_color);
+    #else
+            draw_pixel(v1.x, v1.y, v1.z, tex_info.tex_color);
+    #endif
+        }
+        else
+        {
+    #ifdef GS_JIT
+            jit_draw_pixel_prologue(v1.x, v1.y, v1.z, tex_info.vtx_color);
+    #else
+            draw_pixel(v1.x, v1.y, v1.z, tex_info.vtx_color);
+    #endif
+        }
+    }
+
+    void GraphicsSynthesizerThread::render_line()
+    {
+        printf("[GS_t] Rendering line!\n");
+        Vertex v1 = vtx_queue[1]; v1.to_relative(current_ctx->xyoffset);
+        Vertex v2 = vtx_queue[0]; v2.to_relative(current_ctx->xyoffset);
+
+        int32_t min_y = ((std::max(std::min(v1.y, v2.y), (int32_t)current_ctx->scissor.y1) + 8) >> 4) << 4;
+        int32_t min_x = ((std::max(std::min(v1.x, v2.x), (int32_t)current_ctx->scissor.x1) + 8) >> 4) << 4;
+        int32_t max_y = ((std::min(std::max(v1.y, v2.y), (int32_t)current_ctx->scissor.y2 + 0x10) + 8) >> 4) << 4;
+        int32_t max_x = ((std::min(std::max(v1.x, v2.x), (int32_t)current_ctx->scissor.x2 + 0x10) + 8) >> 4) << 4;
+    
+
+        //Transpose line if it's steep
+        bool is_steep = false;
+        if (abs(v2.x - v1.x) < abs(v2.y - v1.y))
+        {
+            std::swap(v1.x, v1.y);
+            std::swap(v2.x, v2.y);
+            is_steep = true;
+            printf("Steep\n");
+            min_x = min_y;
+            max_x = max_y;
+        }
+
+        //Make line left-to-right (or top to bottom in steep cases)
+        if (v1.x > v2.x)
+        {
+            std::swap(v1, v2);
+        }
+
+        TexLookupInfo tex_info;
+        tex_info.new_lookup = true;
+        tex_info.vtx_color = vtx_queue[0].rgbaq;
+        tex_info.tex_base = current_ctx->tex0.texture_base;
+        tex_info.buffer_width = current_ctx->tex0.width;
+        tex_info.tex_width = current_ctx->tex0.tex_width;
+        tex_info.tex_height = current_ctx->tex0.tex_height;
+        float q = vtx_queue[0].rgbaq.q;
+
+        printf("Coords: (%d, %d, %d) (%d, %d, %d)\n", v1.x >> 4, v1.y >> 4, v1.z, v2.x >> 4, v2.y >> 4, v2.z);
+
+        for (int32_t x = min_x; x < max_x; x += 0x10)
+        {
+            int32_t y = interpolate(x, v1.y, v1.x, v2.y, v2.x);
+            uint32_t z = interpolate(x, v1.z, v1.x, v2.z, v2.x);
+
+            /*if (y < min_y || y > max_y)
+                continue;
+                */
+            tex_info.fog = interpolate(x, v1.fog, v1.x, v2.fog, v2.x);
+            if (current_PRMODE->gourand_shading)
+            {
+                tex_info.vtx_color.r = interpolate(x, v1.rgbaq.r, v1.x, v2.rgbaq.r, v2.x);
+                tex_info.vtx_color.g = interpolate(x, v1.rgbaq.g, v1.x, v2.rgbaq.g, v2.x);
+                tex_info.vtx_color.b = interpolate(x, v1.rgbaq.b, v1.x, v2.rgbaq.b, v2.x);
+                tex_info.vtx_color.a = interpolate(x, v1.rgbaq.a, v1.x, v2.rgbaq.a, v2.x);
+            }
+            if (current_PRMODE->texture_mapping)
+            {
+                int32_t u, v;
+                calculate_LOD(tex_info);
+                if (!current_PRMODE->use_UV)
+                {
+                    float tex_s, tex_t;
+                    if (is_steep)
+                    {
+                        tex_s = interpolate_f(y, v1.s, v1.y, v2.s, v2.y);
+                        tex_t = interpolate_f(x, v1.t, v1.x, v2.t, v2.x);
+                    }
+                    else
+                    {
+                        tex_s = interpolate_f(x, v1.s, v1.x, v2.s, v2.x);
+                        tex_t = interpolate_f(y, v1.t, v1.y, v2.t, v2.y);
+                    }
+                    tex_s /= q;
+                    tex_t /= q;
+                    u = (tex_s * tex_info.tex_width) * 16.0;
+                    v = (tex_t * tex_info.tex_height) * 16.0;
+                }
+                else
+                {
+                    if (is_steep)
+                    {
+                        u = interpolate(y, v1.uv.u, v1.y, v2.uv.u, v2.y);
+                        v = interpolate(x, v1.uv.v, v1.x, v2.uv.v, v2.x);
+                    }
+                    else
+                    {
+                        v = interpolate(y, v1.uv.v, v1.y, v2.uv.v, v2.y);
+                        u = interpolate(x, v1.uv.u, v1.x, v2.uv.u, v2.x);
+                    }
+                }
+    #ifdef GS_JIT
+                jit_tex_lookup_prologue(u, v, &tex_info);
+    #else
+                tex_lookup(u, v, tex_info);
+    #endif
+                tex_info.vtx_color = tex_info.tex_color;
+            }
+    #ifdef GS_JIT
+            if (is_steep)
+                jit_draw_pixel_prologue(y, x, z, tex_info.vtx_color);
+            else
+                jit_draw_pixel_prologue(x, y, z, tex_info.vtx_color);
+    #else
+            if (is_steep)
+                draw_pixel(y, x, z, tex_info.vtx_color);
+            else
+                draw_pixel(x, y, z, tex_info.vtx_color);
+    #endif
+        }
+    }
+
+
+    // Returns positive value if the points are in counter-clockwise order
+    // 0 if they it's on the same line
+    // Negative value if they are in a clockwise order
+    // Basicly the cross product of (v2 - v1) and (v3 - v1) vectors
+    int32_t GraphicsSynthesizerThread::orient2D(const Vertex &v1, const Vertex &v2, const Vertex &v3)
+    {
+        return (v2.x - v1.x) * (v3.y - v1.y) - (v3.x - v1.x) * (v2.y - v1.y);
+    }
+
+    // this is garbage, possible to go way faster.
+    static void order3(int32_t a, int32_t b, int32_t c, uint8_t* order)
+    {
+        if(a > b) {
+            if(b > c) {
+                order[0] = 2;
+                order[1] = 1;
+                order[2] = 0;
+            } else {
+                // a > b, b < c
+                order[0] = 1;
+                if(a > c) {
+                    order[2] = 0;
+                    order[1] = 2;
+                } else {
+                    // c > a
+                    order[2] = 2;
+                    order[1] = 0;
+                }
+            }
+        } else {
+            // b > a
+            if(a > c) {
+                order[0] = 2;
+                order[1] = 0;
+                order[2] = 1;
+            } else {
+                // b > a, c > a
+                order[0] = 0; // a
+                if(b > c) {
+                    order[1] = 2;
+                    order[2] = 1;
+                } else {
+                    order[1] = 1;
+                    order[2] = 2;
+                }
+            }
+        }
+    }
+
+    void GraphicsSynthesizerThread::render_triangle2() {
+        // This is a "scanline" algorithm which reduces flops/pixel
+        //  at the cost of a longer setup time.
+
+        // per-pixel work:
+        //         add   mult   div
+        // stupid  13     7      1
+        // old      5     3      1
+        // scan     3     0      0
+        //
+        // per-line work:
+        //         add   mult   div
+        // stupid  0     0      0
+        // old     3     0      0
+        // scan    1     1      0   (possible to do 1 add, but rounding issues with floats occur)
+
+        // it divides a triangle like this:
+
+        //             * v0
+        //
+        //     v1  * ----
+        //
+        //
+        //               * v2
+
+        // where v0, v1, v2 are floating point pixel locations, ordered from low to high
+        // (this triangles also has a positive area because the vertices are CCW)
+
+
+        Vertex unsortedVerts[3]; // vertices in the order they were sent to GS
+        unsortedVerts[0] = vtx_queue[2]; unsortedVerts[0].to_relative(current_ctx->xyoffset);
+        unsortedVerts[1] = vtx_queue[1]; unsortedVerts[1].to_relative(current_ctx->xyoffset);
+        unsortedVerts[2] = vtx_queue[0]; unsortedVerts[2].to_relative(current_ctx->xyoffset);
+
+        if (!current_PRMODE->gourand_shading)
+        {
+            //Flatten the colors
+            unsortedVerts[0].rgbaq.r = unsortedVerts[2].rgbaq.r;
+            unsortedVerts[1].rgbaq.r = unsortedVerts[2].rgbaq.r;
+
+            unsortedVerts[0].rgbaq.g = unsortedVerts[2].rgbaq.g;
+            unsortedVerts[1].rgbaq.g = unsortedVerts[2].rgbaq.g;
+
+            unsortedVerts[0].rgbaq.b = unsortedVerts[2].rgbaq.b;
+            unsortedVerts[1].rgbaq.b = unsortedVerts[2].rgbaq.b;
+
+            unsortedVerts[0].rgbaq.a = unsortedVerts[2].rgbaq.a;
+            unsortedVerts[1].rgbaq.a = unsortedVerts[2].rgbaq.a;
+        }
+
+        TexLookupInfo tex_info;
+        tex_info.new_lookup = true;
+        tex_info.tex_base = current_ctx->tex0.texture_base;
+        tex_info.buffer_width = current_ctx->tex0.width;
+        tex_info.tex_width = current_ctx->tex0.tex_width;
+        tex_info.tex_height = current_ctx->tex0.tex_height;
+
+
+        // fast reject - some games like to spam triangles that don't have any pixels
+        if(unsortedVerts[0].y == unsortedVerts[1].y && unsortedVerts[1].y == unsortedVerts[2].y)
+        {
+            return;
+        }
+
+
+        // sort the three vertices by their y coordinate (increasing)
+        uint8_t order[3];
+        order3(unsortedVerts[0].y, unsortedVerts[1].y, unsortedVerts[2].y, order);
+
+        // convert all vertex data to floating point, converts position to floating point pixels
+        VertexF v0(unsortedVerts[order[0]]);
+        VertexF v1(unsortedVerts[order[1]]);
+        VertexF v2(unsortedVerts[order[2]]);
+
+        // COMMONLY USED VALUES
+
+        // check if we only have a single triangle like this:
+        //     v0  * ----*  v1         v1 *-----* v0
+        //                        OR
+        //             * v2                 * v2
+        // the other orientations of single triangle (where v1 v2 is horizontal) works fine.
+        bool lower_tri_only = (v0.y == v1.y);
+
+        // the edge e21 is the edge from v1 -> v2.  So v1 + e21 = v2
+        // edges (difference of the ENTIRE vertex properties, not just position)
+        VertexF e21 = v2 - v1;
+        VertexF e20 = v2 - v0;
+        VertexF e10 = v1 - v0;
+
+        // interpolating z (or any value) at point P in a triangle can be done by computing the barycentric coordinates
+        // (w0, w1, w2) and using P_z = w0 * v1_z + w1 * v2_z + w2 * v3_z
+
+        // derivative of P_z wrt x and y is constant everywhere
+        // dP_z/dx = dw0/dx * v1_z + dw1/dx * v2_z + dw2/dx * v3_z
+
+        // w0 = (v2_y - v3_y)*(P_x - v3_x) + (v3_x - v2_x) * (P_y - v3_y)
+        //      ----------------------------------------------------------
+        //      (v1_y - v0_y)*(v2_x - v0_x) + (v1_x - v0_x)*(v2_y - v0_y)
+
+        // dw0/dx =           v2_y - v3_y
+        //          ------------------------------
+        //           the same denominator as above
+
+        // The denominator of this fraction shows up everywhere, so we compute it once.
+        float div = (e10.y * e20.x - e10.x * e20.y);
+
+        // If the vertices of the triangle are CCW, the denominator will be negative
+        // if the triangle is degenerate (has 0 area), it will be zero.
+        bool reversed = div < 0.f;
+
+        if(div == 0.f)
+        {
+            return;
+        }
+
+        // next we need to determine the horizontal scanlines that will have pixels.
+        // GS pixel draw condition for scissor
+        //   >= minimum value, <= maximum value (draw left/top, but not right/bottom)
+        // Our scanline loop
+        //   >= minimum value, < maximum value
+
+        // MINIMUM SCISSOR
+        // -------------------  y = 0.0 (pixel)
+        //
+        //  XXXXXXXXXXXXXXXXXX  scissor minimum (y = 0.125 to y = 0.875)
+        //                           (round to y = 1.0 - the first scanline we should consider)
+        // -------------------- y = 1.0 (pixel)
+        int scissorY1 = (current_ctx->scissor.y1 + 15) / 16; // min y coordinate, round up because we don't draw px below scissor
+        int scissorX1 = (current_ctx->scissor.x1 + 15) / 16;
+
+        // MAXIMUM SCISSOR
+        // -------------------  y = 3.0 (pixel)
+        //
+        //  XXXXXXXXXXXXXXXXXX  scissor maximum (y = 3.125 to y = 3.875)
+        //                           (round to y = 4.0 - will do scanlines at y = 1, 2, 3)
+        // -------------------- y = 4.0 (pixel)
+
+        // however, if SCISSOR = 4, we should round that up to 5 because we do want to draw pixels on y = 4 (<= max value)
+        int scissorY2 = (current_ctx->scissor.y2 + 16) / 16;
+        int scissorX2 = (current_ctx->scissor.x2 + 16) / 16;
+
+        // scissor triangle top/bottoms
+        // we can get away with only checking min scissor for tops and max scissors for bottom
+        // because it will give negative height triangles for completely scissored half tris
+        // and the correct answer for half tris that aren't completely killed
+        int upperTop = std::max((int)std::ceil(v0.y), scissorY1); // we draw this
+        int upperBot = std::min((int)std::ceil(v1.y), scissorY2); // we don't draw this, (< max value, different from scissor)
+        int lowerTop = std::max((int)std::ceil(v1.y), scissorY1); // we draw this
+        int lowerBot = std::min((int)std::ceil(v2.y), scissorY2); // we don't draw this, (< max value, different from scissor)
+
+
+        // compute the derivatives of the weights, like shown in the formula above
+        float ndw2dy = e10.x / div; // n is negative
+        float dw2dx  = e10.y / div;
+        float dw1dy  = e20.x / div;
+        float ndw1dx = e20.y / div; // also negative
+
+        // derivatives wrt x and y would normally be computed as dz/dx = dw0/dx * z0 + dw1/dx * z1 + dw2/dx * z2
+        // however, w0 + w1 + w2 = 1 so dw0/dx + dw1/dx + dw2/dx = 0,
+        //   and we can use some clever rearranging and reuse of the edges to simplify this
+        //   we can replace dw0/dx with (-dw1/dx - dw2/dx):
+
+        // dz/dx = dw0/dx*z0 + dw1/dx*z1 + dw2/dx*z2
+        // dz/dx = (-dw1/dx - dw2/dx)*z0 + dw1/dx*z1 + dw2/dx*z2
+        // dz/dx = -dw1/dx*z0 - dw2/dx*z0 + dw1/dx*z1 + dw2/dx*z2
+        // dz/dx = dw1/dx*(z1 - z0) + dw2/dx*(z2 - z0)
+
+        // the value to step per field per x/y pixel
+        VertexF dvdx = e20 * dw2dx - e10 * ndw1dx;
+        VertexF dvdy = e10 * dw1dy - e20 * ndw2dy;
+
+        // slopes of the edges
+        float e20dxdy = e20.x / e20.y;
+        float e21dxdy = e21.x / e21.y;
+        float e10dxdy = e10.x / e10.y;
+
+        // we need to know the left/right side slopes. They can be different if v1 is on the opposite side of e20
+        float lowerLeftEdgeStep  = reversed ? e20dxdy : e21dxdy;
+        float lowerRightEdgeStep = reversed ? e21dxdy : e20dxdy;
+
+        // bound the z values the triangle can store for hierarchical z. Pixel centers can sit a little outside the
+        // triangle and stepping accumulates float error, so widen the range by a pixel's worth of slope plus the error.
+        double z_min = std::min({v0.z, v1.z, v2.z});
+        double z_max = std::max({v0.z, v1.z, v2.z});
+        if (z_min != z_max)
+        {
+            double slope = std::abs(dvdx.z) + std::abs(dvdy.z);
+            double magnitude = std::max(std::abs(z_min), std::abs(z_max)) + slope;
+            double margin = 2.0 * slope + magnitude / 4096.0 + 2.0;
+            z_min -= margin;
+            z_max += margin;
+        }
+
+        //Pixels store z truncated to an integer, and anything at or below -1 wraps around
+        bool z_in_range = z_min > -1.0 && z_max <= 4294967295.0;
+        set_zbounds_range(z_in_range ? (int64_t)z_min : -1, z_in_range ? (int64_t)z_max : -1);
+
+        // draw triangles
+        if(lower_tri_only)
+        {
+            if(lowerTop < lowerBot) // if we weren't killed by scissoring
+            {
+                // we don't know which vertex is on the left or right, but the two configures have opposite sign areas:
+                //     v0  * ----*  v1         v1 *-----* v0
+                //                        OR
+                //             * v2                 * v2
+                VertexF& left_vertex = reversed ? v0 : v1;
+                VertexF& right_vertex = reversed ? v1 : v0;
+                render_half_triangle(left_vertex.x,    // upper edge left vertex, floating point pixels
+                                     right_vertex.x,   // upper edge right vertex, floating point pixels
+                                     upperTop,         // start scanline (included)
+                                     lowerBot,         // end scanline   (not included)
+                                     dvdx,             // derivative of values wrt x coordinate
+                                     dvdy,             // derivative of values wrt y coordinate
+                                     left_vertex,      // one point to interpolate from
+                                     lowerLeftEdgeStep, // slope of left edge
+                                     lowerRightEdgeStep,  // slope of right edge
+                                     scissorX1,        // x scissor (integer pixels, do draw this px)
+                                     scissorX2,        // x scissor (integer pixels, don't draw this px)
+                                     tex_info);        // texture
+            }
+        }
+        else
+        {
+            // again, left/right slopes
+            float upperLeftEdgeStep = reversed ? e20dxdy : e10dxdy;
+            float upperRightEdgeStep = reversed ? e10dxdy : e20dxdy;
+
+            // upper triangle
+            if(upperTop < upperBot) // if we weren't killed by scissoring
+            {
+                render_half_triangle(v0.x, v0.x,          // upper edge is just the highest point on triangle
+                                     upperTop, upperBot,  // scanline bounds
+                                     dvdx, dvdy,          // derivatives of values
+                                     v0,                  // interpolate from this vertex
+                                     upperLeftEdgeStep, upperRightEdgeStep, // slopes
+                                     scissorX1, scissorX2,  // integer x scissor
+                                     tex_info);
+            }
+
+            if(lowerTop < lowerBot)
+            {
+                //             * v0
+                //
+                //     v1  * ----
+                //
+                //
+                //               * v2
+                render_half_triangle(v0.x + upperLeftEdgeStep * e10.y, // one of our upper edge vertices isn't v0,v1,v2, but we don't know which. todo is this faster than branch?
+                                     v0.x + upperRightEdgeStep * e10.y,
+                                     lowerTop, lowerBot, dvdx, dvdy, v1,
+                                     lowerLeftEdgeStep, lowerRightEdgeStep, scissorX1, scissorX2, tex_info);
+            }
+
+        }
+
+        // merge our z range into the hierarchical z bounds of everything we may have drawn over
+        int boundsX1 = std::max((int)std::floor(std::min({v0.x, v1.x, v2.x})), scissorX1);
+        int boundsX2 = std::min((int)std::ceil(std::max({v0.x, v1.x, v2.x})) + 1, scissorX2);
+        update_zbounds(boundsX1, upperTop, boundsX2, lowerBot, false);
+
+    }
+
+    /*!
+     * Render a "half-triangle" which has a horizontal edge
+     * @param x0 - the x coordinate of the upper left most point of the triangle. floating point pixels
+     * @param x1 - the x coordinate of the upper right most point of the triangle (can be the same as x0), floating point px
+     * @param y0 - the y coordinate of the first scanline which will contain the triangle (integer pixels)
+     * @param y1 - the y coordinate of the last scanline which will contain the triangle (integer pixels)
+     * @param x_step - the derivatives of all parameters wrt x
+     * @param y_step - the derivatives of all parameters wrt y
+     * @param init   - the vertex we interpolate from
+     * @param step_x0 - how far to step to the left on each step down (floating point px)
+     * @param step_x1 - how far to step to the right on each step down (floating point px)
+     * @param scx1    - left x scissor (fp px)
+     * @param scx2    - right x scissor (fp px)
+     * @param tex_info - texture data
+     */
+    void GraphicsSynthesizerThread::render_half_triangle(float x0, float x1, int y0, int y1, VertexF &x_step,
+                                                         VertexF &y_step, VertexF &init, float step_x0, float step_x1,
+                                                         float scx1, float scx2, TexLookupInfo& tex_info) {
+
+        bool tmp_tex = current_PRMODE->texture_mapping;
+        bool tmp_uv = !current_PRMODE->use_UV;
+        bool use_hz = hz_enabled && hz_valid;
+        int hz_block_mask = use_hz ? hz_layout->block_width - 1 : 0;
+
+        for(int y = y0; y < y1; y++) // loop over scanlines of triangle
+        {
+            float height = y - init.y; // how far down we've made it
+            VertexF vtx = init + y_step * height;       // interpolate to point (x_init, y)
+            float x0l = x0 + step_x0 * height;          // start x coordinates of scanline from interpolation
+            float x1l = x1 + step_x1 * height;          // end   x coordinate of scanline from interpolation
+            x0l = std::max(scx1, std::ceil(x0l));       // round and scissor
+            x1l = std::min(scx2, std::ceil(x1l));       // round and scissor
+            int xStop = x1l;                            // integer start/stop pixels
+            int xStart = x0l;
+
+            if(xStop == xStart) continue;               // skip rows of zero length
+
+            vtx += (x_step * (x0l - init.x));           // interpolate to point (x0l, y)
+
+            for(int x = x0l; x < xStop; x++)            // loop over x pixels of scanline
+            {
+                // once per z block, check if its z bounds decide the depth test for the whole run of pixels
+                if (use_hz && (x == xStart || !(x & hz_block_mask)))
+                {
+                    ZBlockTest result = test_zblock(x, y);
+                    if (result == ZBlockTest::Reject)
+                    {
+                        // step one pixel at a time so the interpolated values match drawing every pixel
+                        int block_end = std::min(xStop, (x | hz_block_mask) + 1);
+                        for (; x < block_end - 1; x++)
+                            vtx += x_step;
+                        vtx += x_step;
+                        continue;
                     }
-                    tex_s /= q;
-                    tex_t /= q;
-                    u = (tex_s * tex_info.tex_width) * 16.0;
-                    v = (tex_t * tex_info.tex_height) * 16.0;
+                    set_depth_test_bypass(result == ZBlockTest::Pass);
                 }
-                else
+
+                //vtx = init + y_step * height + (x_step * (x - init.x));
+                tex_info.vtx_color.r = vtx.r;           // set most recently interpolated stuff
+                tex_info.vtx_color.g = vtx.g;
+                tex_info.vtx_color.b = vtx.b;
+                tex_info.vtx_color.a = vtx.a;
+                tex_info.vtx_color.q = vtx.q;
+                tex_info.fog = vtx.fog;
+                if (tmp_tex)
                 {
-                    if (is_steep)
+                    int32_t u, v;
+                    calculate_LOD(tex_info);
+                    if (tmp_uv)
                     {
-                        u = interpolate(y, v1.uv.u, v1.y, v2.uv.u, v2.y);
-                        v = interpolate(x, v1.uv.v, v1.x, v2.uv.v, v2.x);
+                        float s, t, q;
+                        s = vtx.s * 16.f;
+                        t = vtx.t * 16.f;
+                        q = vtx.q * 16.f;
+
+                        s /= q;
+                        t /= q;
+                        u = (s * tex_info.tex_width) * 16.f;
+                        v = (t * tex_info.tex_height) * 16.f;
+                        //fprintf(stderr, "q: %f, u: %d, v: %d, a: %d\n", vtx.q, u,v, tex_info.vtx_color.a);
                     }
                     else
                     {
-                        v = interpolate(y, v1.uv.v, v1.y, v2.uv.v, v2.y);
-                        u = interpolate(x, v1.uv.u, v1.x, v2.uv.u, v2.x);
+                        u = (uint32_t) vtx.u;
+                        v = (uint32_t) vtx.v;
                     }
-                }
     #ifdef GS_JIT
-                jit_tex_lookup_prologue(u, v, &tex_info);
+                    jit_tex_lookup_prologue(u, v, &tex_info);
+                    jit_draw_pixel_prologue(x * 16, y * 16, (uint32_t)vtx.z, tex_info.tex_color);
     #else
-                tex_lookup(u, v, tex_info);
+                    tex_lookup(u, v, tex_info);
+                    draw_pixel(x * 16, y * 16, (uint32_t)vtx.z, tex_info.tex_color);
     #endif
-                tex_info.vtx_color = tex_info.tex_color;
-            }
+
+                }
+                else
+                {
     #ifdef GS_JIT
-            if (is_steep)
-                jit_draw_pixel_prologue(y, x, z, tex_info.vtx_color);
-            else
-                jit_draw_pixel_prologue(x, y, z, tex_info.vtx_color);
+                    jit_draw_pixel_prologue(x * 16, y * 16, (uint32_t)vtx.z, tex_info.vtx_color);
     #else
-            if (is_steep)
-                draw_pixel(y, x, z, tex_info.vtx_color);
-            else
-                draw_pixel(x, y, z, tex_info.vtx_color);
+                    draw_pixel(x * 16, y * 16, (uint32_t)vtx.z, tex_info.vtx_color);
     #endif
-        }
-    }
-
-
-    // Returns positive value if the points are in counter-clockwise order
-    // 0 if they it's on the same line
-    // Negative value if they are in a clockwise order
-    // Basicly the cross product of (v2 - v1) and (v3 - v1) vectors
-    int32_t GraphicsSynthesizerThread::orient2D(const Vertex &v1, const Vertex &v2, const Vertex &v3)
-    {
-        return (v2.x - v1.x) * (v3.y - v1.y) - (v3.x - v1.x) * (v2.y - v1.y);
-    }
-
-    // this is garbage, possible to go way faster.
-    static void order3(int32_t a, int32_t b, int32_t c, uint8_t* order)
-    {
-        if(a > b) {
-            if(b > c) {
-                order[0] = 2;
-                order[1] = 1;
-                order[2] = 0;
-            } else {
-                // a > b, b < c
-                order[0] = 1;
-                if(a > c) {
-                    order[2] = 0;
-                    order[1] = 2;
-                } else {
-                    // c > a
-                    order[2] = 2;
-                    order[1] = 0;
-                }
-            }
-        } else {
-            // b > a
-            if(a > c) {
-                order[0] = 2;
-                order[1] = 0;
-                order[2] = 1;
-            } else {
-                // b > a, c > a
-                order[0] = 0; // a
-                if(b > c) {
-                    order[1] = 2;
-                    order[2] = 1;
-                } else {
-                    order[1] = 1;
-                    order[2] = 2;
                 }
+
+                vtx += x_step;                       // get values for the adjacent pixel
             }
         }
-    }
-
-    void GraphicsSynthesizerThread::render_triangle2() {
-        // This is a "scanline" algorithm which reduces flops/pixel
-        //  at the cost of a longer setup time.
-
-        // per-pixel work:
-        //         add   mult   div
-        // stupid  13     7      1
-        // old      5     3      1
-        // scan     3     0      0
-        //
-        // per-line work:
-        //         add   mult   div
-        // stupid  0     0      0
-        // old     3     0      0
-        // scan    1     1      0   (possible to do 1 add, but rounding issues with floats occur)
-
-        // it divides a triangle like this:
-
-        //             * v0
-        //
-        //     v1  * ----
-        //
-        //
-        //               * v2
-
-        // where v0, v1, v2 are floating point pixel locations, ordered from low to high
-        // (this triangles also has a positive area because the vertices are CCW)
 
+    }
 
-        Vertex unsortedVerts[3]; // vertices in the order they were sent to GS
-        unsortedVerts[0] = vtx_queue[2]; unsortedVerts[0].to_relative(current_ctx->xyoffset);
-        unsortedVerts[1] = vtx_queue[1]; unsortedVerts[1].to_relative(current_ctx->xyoffset);
-        unsortedVerts[2] = vtx_queue[0]; unsortedVerts[2].to_relative(current_ctx->xyoffset);
+    void GraphicsSynthesizerThread::render_triangle()
+    {
+        printf("[GS_t] Rendering triangle!\n");
+
+        Vertex v1 = vtx_queue[2]; v1.to_relative(current_ctx->xyoffset);
+        Vertex v2 = vtx_queue[1]; v2.to_relative(current_ctx->xyoffset);
+        Vertex v3 = vtx_queue[0]; v3.to_relative(current_ctx->xyoffset);
 
         if (!current_PRMODE->gourand_shading)
         {
             //Flatten the colors
-            unsortedVerts[0].rgbaq.r = unsortedVerts[2].rgbaq.r;
-            unsortedVerts[1].rgbaq.r = unsortedVerts[2].rgbaq.r;
-
-            unsortedVerts[0].rgbaq.g = unsortedVerts[2].rgbaq.g;
-            unsortedVerts[1].rgbaq.g = unsortedVerts[2].rgbaq.g;
-
-            unsortedVerts[0].rgbaq.b = unsortedVerts[2].rgbaq.b;
-            unsortedVerts[1].rgbaq.b = unsortedVerts[2].rgbaq.b;
-
-            unsortedVerts[0].rgbaq.a = unsortedVerts[2].rgbaq.a;
-            unsortedVerts[1].rgbaq.a = unsortedVerts[2].rgbaq.a;
-        }
+            v1.rgbaq.r = v3.rgbaq.r;
+            v2.rgbaq.r = v3.rgbaq.r;
 
-        TexLookupInfo tex_info;
-        tex_info.new_lookup = true;
-        tex_info.tex_base = current_ctx->tex0.texture_base;
-        tex_info.buffer_width = current_ctx->tex0.width;
-        tex_info.tex_width = current_ctx->tex0.tex_width;
-        tex_info.tex_height = current_ctx->tex0.tex_height;
+            v1.rgbaq.g = v3.rgbaq.g;
+            v2.rgbaq.g = v3.rgbaq.g;
 
+            v1.rgbaq.b = v3.rgbaq.b;
+            v2.rgbaq.b = v3.rgbaq.b;
 
-        // fast reject - some games like to spam triangles that don't have any pixels
-        if(unsortedVerts[0].y == unsortedVerts[1].y && unsortedVerts[1].y == unsortedVerts[2].y)
-        {
-            return;
+            v1.rgbaq.a = v3.rgbaq.a;
+            v2.rgbaq.a = v3.rgbaq.a;
         }
 
+        //The triangle rasterization code uses an approach with barycentric coordinates
+        //Clear explanation can be read below:
+        //https://fgiesen.wordpress.com/2013/02/06/the-barycentric-conspirac/
 
-        // sort the three vertices by their y coordinate (increasing)
-        uint8_t order[3];
-        order3(unsortedVerts[0].y, unsortedVerts[1].y, unsortedVerts[2].y, order);
+        //Order by counter-clockwise winding order
+        if (orient2D(v1, v2, v3) < 0)
+            std::swap(v2, v3);
 
-        // convert all vertex data to floating point, converts position to floating point pixels
-        VertexF v0(unsortedVerts[order[0]]);
-        VertexF v1(unsortedVerts[order[1]]);
-        VertexF v2(unsortedVerts[order[2]]);
+        int32_t divider = orient2D(v1, v2, v3);
+        //Calculate bounding box of triangle
+        int32_t min_x = std::min({v1.x, v2.x, v3.x});
+        int32_t min_y = std::min({v1.y, v2.y, v3.y});
+        int32_t max_x = std::max({v1.x, v2.x, v3.x});
+        int32_t max_y = std::max({v1.y, v2.y, v3.y});
+    
+        //Automatic scissoring test
+        min_x = std::max(min_x, (int32_t)current_ctx->scissor.x1);
+        min_y = std::max(min_y, (int32_t)current_ctx->scissor.y1);
+        max_x = std::min(max_x, (int32_t)current_ctx->scissor.x2 + 0x10);
+        max_y = std::min(max_y, (int32_t)current_ctx->scissor.y2 + 0x10);
 
-        // COMMONLY USED VALUES
+        if (max_y == min_y && min_x == max_x)
+            return;
+        //We'll process the pixels in blocks, set the blocksize
+        const int32_t BLOCKSIZE = 1 << 4; // Must be power of 2
 
-        // check if we only have a single triangle like this:
-        //     v0  * ----*  v1         v1 *-----* v0
-        //                        OR
-        //             * v2                 * v2
-        // the other orientations of single triangle (where v1 v2 is horizontal) works fine.
-        bool lower_tri_only = (v0.y == v1.y);
+        //Round down to make starting corner's coordinates a multiple of BLOCKSIZE with bitwise magic
+        min_x &= ~(BLOCKSIZE - 1);
+        min_y &= ~(BLOCKSIZE - 1);
 
-        // the edge e21 is the edge from v1 -> v2.  So v1 + e21 = v2
-        // edges (difference of the ENTIRE vertex properties, not just position)
-        VertexF e21 = v2 - v1;
-        VertexF e20 = v2 - v0;
-        VertexF e10 = v1 - v0;
+        //Calculate incremental steps for the weights
+        //Reference: https://fgiesen.wordpress.com/2013/02/10/optimizing-the-basic-rasterizer/
+        const int32_t A12 = v1.y - v2.y;
+        const int32_t B12 = v2.x - v1.x;
+        const int32_t A23 = v2.y - v3.y;
+        const int32_t B23 = v3.x - v2.x;
+        const int32_t A31 = v3.y - v1.y;
+        const int32_t B31 = v1.x - v3.x;
 
-        // interpolating z (or any value) at point P in a triangle can be done by computing the barycentric coordinates
-        // (w0, w1, w2) and using P_z = w0 * v1_z + w1 * v2_z + w2 * v3_z
+        const int32_t block_A23 = (BLOCKSIZE - 1) * A23;
+        const int32_t block_A31 = (BLOCKSIZE - 1) * A31;
+        const int32_t block_A12 = (BLOCKSIZE - 1) * A12;
+        const int32_t block_B23 = (BLOCKSIZE - 1) * B23;
+        const int32_t block_B31 = (BLOCKSIZE - 1) * B31;
+        const int32_t block_B12 = (BLOCKSIZE - 1) * B12;
 
-        // derivative of P_z wrt x and y is constant everywhere
-        // dP_z/dx = dw0/dx * v1_z + dw1/dx * v2_z + dw2/dx * v3_z
+        Vertex min_corner;
+        min_corner.x = min_x; min_corner.y = min_y;
+        int32_t w1_row = orient2D(v2, v3, min_corner);
+        int32_t w2_row = orient2D(v3, v1, min_corner);
+        int32_t w3_row = orient2D(v1, v2, min_corner);
+        int32_t w1_row_block = w1_row;
+        int32_t w2_row_block = w2_row;
+        int32_t w3_row_block = w3_row;
 
-        // w0 = (v2_y - v3_y)*(P_x - v3_x) + (v3_x - v2_x) * (P_y - v3_y)
-        //      ----------------------------------------------------------
-        //      (v1_y - v0_y)*(v2_x - v0_x) + (v1_x - v0_x)*(v2_y - v0_y)
 
-        // dw0/dx =           v2_y - v3_y
-        //          ------------------------------
-        //           the same denominator as above
 
-        // The denominator of this fraction shows up everywhere, so we compute it once.
-        float div = (e10.y * e20.x - e10.x * e20.y);
+        TexLookupInfo tex_info;
+        tex_info.new_lookup = true;
+        tex_info.tex_base = current_ctx->tex0.texture_base;
+        tex_info.buffer_width = current_ctx->tex0.width;
+        tex_info.tex_width = current_ctx->tex0.tex_width;
+        tex_info.tex_height = current_ctx->tex0.tex_height;
 
-        // If the vertices of the triangle are CCW, the denominator will be negative
-        // if the triangle is degenerate (has 0 area), it will be zero.
-        bool reversed = div < 0.f;
+        bool tmp_tex = current_PRMODE->texture_mapping;
+        bool tmp_uv = !current_PRMODE->use_UV;//allow for loop unswitching
 
-        if(div == 0.f)
+        //TODO: Parallelize this
+        //Iterate through the bounding rectangle using BLOCKSIZE * BLOCKSIZE large blocks
+        //This way we can throw out blocks which are totally outside the triangle way faster
+        //Thanks you, Dolphin code for the idea
+        //https://github.com/dolphin-emu/dolphin/blob/master/Source/Core/VideoBackends/Software/Rasterizer.cpp#L388
+        for (int32_t y_block = min_y; y_block < max_y; y_block += BLOCKSIZE)
         {
-            return;
-        }
+            int32_t w1_block = w1_row_block;
+            int32_t w2_block = w2_row_block;
+            int32_t w3_block = w3_row_block;
+            for (int32_t x_block = min_x; x_block < max_x; x_block += BLOCKSIZE)
+            {
+                //Store barycentric coordinates for the corners of a block
+                //tl = top left, tr = top right, etc.
+                int32_t w1_tl, w1_tr, w1_bl, w1_br;
+                int32_t w2_tl, w2_tr, w2_bl, w2_br;
+                int32_t w3_tl, w3_tr, w3_bl, w3_br;
+                //Calculate the weight offsets for the corners
+                w1_tl = w1_block; w2_tl = w2_block, w3_tl = w3_block;
+                w1_tr = w1_tl + block_A23;
+                w2_tr = w2_tl + block_A31;
+                w3_tr = w3_tl + block_A12;
+                w1_bl = w1_tl + block_B23;
+                w2_bl = w2_tl + block_B31;
+                w3_bl = w3_tl + block_B12;
+                w1_br = w1_tl + block_B23 + block_A23;
+                w2_br = w2_tl + block_B31 + block_A31;
+                w3_br = w3_tl + block_B12 + block_A12;
 
-        // next we need to determine the horizontal scanlines that will have pixels.
-        // GS pixel draw condition for scissor
-        //   >= minimum value, <= maximum value (draw left/top, but not right/bottom)
-        // Our scanline loop
-        //   >= minimum value, < maximum value
+                //Check if any of the corners are in the positive half-space of a weight
+                bool w1_tl_check = w1_tl > 0;
+                bool w1_tr_check = w1_tr > 0;
+                bool w1_bl_check = w1_bl > 0;
+                bool w1_br_check = w1_br > 0;
+                bool w2_tl_check = w2_tl > 0;
+                bool w2_tr_check = w2_tr > 0;
+                bool w2_bl_check = w2_bl > 0;
+                bool w2_br_check = w2_br > 0;
+                bool w3_tl_check = w3_tl > 0;
+                bool w3_tr_check = w3_tr > 0;
+                bool w3_bl_check = w3_bl > 0;
+                bool w3_br_check = w3_br > 0;
 
-        // MINIMUM SCISSOR
-        // -------------------  y = 0.0 (pixel)
-        //
-        //  XXXXXXXXXXXXXXXXXX  scissor minimum (y = 0.125 to y = 0.875)
-        //                           (round to y = 1.0 - the first scanline we should consider)
-        // -------------------- y = 1.0 (pixel)
-        int scissorY1 = (current_ctx->scissor.y1 + 15) / 16; // min y coordinate, round up because we don't draw px below scissor
-        int scissorX1 = (current_ctx->scissor.x1 + 15) / 16;
 
-        // MAXIMUM SCISSOR
-        // -------------------  y = 3.0 (pixel)
-        //
-        //  XXXXXXXXXXXXXXXXXX  scissor maximum (y = 3.125 to y = 3.875)
-        //                           (round to y = 4.0 - will do scanlines at y = 1, 2, 3)
-        // -------------------- y = 4.0 (pixel)
+                //Combine all checks for a barycentric coordinate into one
+                //If for one half-space checks for each corner --> all corners lie outside the triangle --> block can be skipped
+                uint8_t w1_mask = (w1_tl_check << 0) | (w1_tr_check << 1) | (w1_bl_check << 2) | (w1_br_check << 3);
+                uint8_t w2_mask = (w2_tl_check << 0) | (w2_tr_check << 1) | (w2_bl_check << 2) | (w2_br_check << 3);
+                uint8_t w3_mask = (w3_tl_check << 0) | (w3_tr_check << 1) | (w3_bl_check << 2) | (w3_br_check << 3);
+                //However in other cases, we process the block pixel-by-pixel as usual
+                //TODO: In the case where all corners lie inside the triangle the code below could be slightly simplified
+                if (w1_mask != 0 && w2_mask != 0 && w3_mask != 0)
+                {
+                    //Process a BLOCKSIZE * BLOCKSIZE block as normal
+                    int32_t w1_row = w1_block;
+                    int32_t w2_row = w2_block;
+                    int32_t w3_row = w3_block;
+                    for (int32_t y = y_block; y < y_block + BLOCKSIZE; y += 0x10)
+                    {
+                        int32_t w1 = w1_row;
+                        int32_t w2 = w2_row;
+                        int32_t w3 = w3_row;
+                        for (int32_t x = x_block; x < x_block + BLOCKSIZE; x += 0x10)
+                        {
+                            //Is inside triangle?
+                            if ((w1 | w2 | w3) >= 0)
+                            {
+                                //Interpolate Z
+                                double z = (double) v1.z * w1 + (double) v2.z * w2 + (double) v3.z * w3;
+                                z /= divider;
 
-        // however, if SCISSOR = 4, we should round that up to 5 because we do want to draw pixels on y = 4 (<= max value)
-        int scissorY2 = (current_ctx->scissor.y2 + 16) / 16;
-        int scissorX2 = (current_ctx->scissor.x2 + 16) / 16;
+                                //Gourand shading calculations
+                                float r = (float) v1.rgbaq.r * w1 + (float) v2.rgbaq.r * w2 + (float) v3.rgbaq.r * w3;
+                                float g = (float) v1.rgbaq.g * w1 + (float) v2.rgbaq.g * w2 + (float) v3.rgbaq.g * w3;
+                                float b = (float) v1.rgbaq.b * w1 + (float) v2.rgbaq.b * w2 + (float) v3.rgbaq.b * w3;
+                                float a = (float) v1.rgbaq.a * w1 + (float) v2.rgbaq.a * w2 + (float) v3.rgbaq.a * w3;
+                                float q = v1.rgbaq.q * w1 + v2.rgbaq.q * w2 + v3.rgbaq.q * w3;
+                                float fog = (float) v1.fog * w1 + (float) v2.fog * w2 + (float) v3.fog * w3;
+                                tex_info.vtx_color.r = r / divider;
+                                tex_info.vtx_color.g = g / divider;
+                                tex_info.vtx_color.b = b / divider;
+                                tex_info.vtx_color.a = a / divider;
+                                tex_info.vtx_color.q = q / divider;
+                                tex_info.fog = fog / divider;
 
-        // scissor triangle top/bottoms
-        // we can get away with only checking min scissor for tops and max scissors for bottom
-        // because it will give negative height triangles for completely scissored half tris
-        // and the correct answer for half tris that aren't completely killed
-        int upperTop = std::max((int)std::ceil(v0.y), scissorY1); // we draw this
-        int upperBot = std::min((int)std::ceil(v1.y), scissorY2); // we don't draw this, (< max value, different from scissor)
-        int lowerTop = std::max((int)std::ceil(v1.y), scissorY1); // we draw this
-        int lowerBot = std::min((int)std::ceil(v2.y), scissorY2); // we don't draw this, (< max value, different from scissor)
+                                if (tmp_tex)
+                                {
+                                    int32_t u, v;
+                                    calculate_LOD(tex_info);
+                                    if (tmp_uv)
+                                    {
+                                        float s, t, q;
+                                        s = v1.s * w1 + v2.s * w2 + v3.s * w3;
+                                        t = v1.t * w1 + v2.t * w2 + v3.t * w3;
+                                        q = v1.rgbaq.q * w1 + v2.rgbaq.q * w2 + v3.rgbaq.q * w3;
 
+                                        //We don't divide s and t by "divider" because dividing by Q effectively
+                                        //cancels that out
+                                        s /= q;
+                                        t /= q;
+                                        u = (s * tex_info.tex_width) * 16.0;
+                                        v = (t * tex_info.tex_height) * 16.0;
+                                    }
+                                    else
+                                    {
+                                        float temp_u = (float) v1.uv.u * w1 + (float) v2.uv.u * w2 + (float) v3.uv.u * w3;
+                                        float temp_v = (float) v1.uv.v * w1 + (float) v2.uv.v * w2 + (float) v3.uv.v * w3;
+                                        temp_u /= divider;
+                                        temp_v /= divider;
+                                        u = (uint32_t) temp_u;
+                                        v = (uint32_t) temp_v;
+                                    }
+    #ifdef GS_JIT
+                                    jit_tex_lookup_prologue(u, v, &tex_info);
+                                    jit_draw_pixel_prologue(x, y, (uint32_t)z, tex_info.tex_color);
+    #else
+                                    tex_lookup(u, v, tex_info);
+                                    draw_pixel(x, y, (uint32_t)z, tex_info.tex_color);
+    #endif
+                                }
+                                else
+                                {
+    #ifdef GS_JIT
+                                    jit_draw_pixel_prologue(x, y, (uint32_t)z, tex_info.vtx_color);
+    #else
+                                    draw_pixel(x, y, (uint32_t)z, tex_info.vtx_color);
+    #endif
+                                }
+                            }
+                            else
+                                break;
+                            //Horizontal step
+                            w1 += A23 << 4;
+                            w2 += A31 << 4;
+                            w3 += A12 << 4;
+                        }
+                        //Vertical step
+                        w1_row += B23 << 4;
+                        w2_row += B31 << 4;
+                        w3_row += B12 << 4;
+                    }
+                }
 
-        // compute the derivatives of the weights, like shown in the formula above
-        float ndw2dy = e10.x / div; // n is negative
-        float dw2dx  = e10.y / div;
-        float dw1dy  = e20.x / div;
-        float ndw1dx = e20.y / div; // also negative
+                w1_block += BLOCKSIZE * A23;
+                w2_block += BLOCKSIZE * A31;
+                w3_block += BLOCKSIZE * A12;
 
-        // derivatives wrt x and y would normally be computed as dz/dx = dw0/dx * z0 + dw1/dx * z1 + dw2/dx * z2
-        // however, w0 + w1 + w2 = 1 so dw0/dx + dw1/dx + dw2/dx = 0,
-        //   and we can use some clever rearranging and reuse of the edges to simplify this
-        //   we can replace dw0/dx with (-dw1/dx - dw2/dx):
+            }
+            w1_row_block += BLOCKSIZE * B23;
+            w2_row_block += BLOCKSIZE * B31;
+            w3_row_block += BLOCKSIZE * B12;
+        }
 
-        // dz/dx = dw0/dx*z0 + dw1/dx*z1 + dw2/dx*z2
-        // dz/dx = (-dw1/dx - dw2/dx)*z0 + dw1/dx*z1 + dw2/dx*z2
-        // dz/dx = -dw1/dx*z0 - dw2/dx*z0 + dw1/dx*z1 + dw2/dx*z2
-        // dz/dx = dw1/dx*(z1 - z0) + dw2/dx*(z2 - z0)
+    }
 
-        // the value to step per field per x/y pixel
-        VertexF dvdx = e20 * dw2dx - e10 * ndw1dx;
-        VertexF dvdy = e10 * dw1dy - e20 * ndw2dy;
+    void GraphicsSynthesizerThread::render_sprite()
+    {
+        printf("[GS_t] Rendering sprite!\n");
+        Vertex v1 = vtx_queue[1]; v1.to_relative(current_ctx->xyoffset);
+        Vertex v2 = vtx_queue[0]; v2.to_relative(current_ctx->xyoffset);
+        TexLookupInfo tex_info;
+        tex_info.new_lookup = true;
 
-        // slopes of the edges
-        float e20dxdy = e20.x / e20.y;
-        float e21dxdy = e21.x / e21.y;
-        float e10dxdy = e10.x / e10.y;
+        tex_info.vtx_color = vtx_queue[0].rgbaq;
+        tex_info.tex_base = current_ctx->tex0.texture_base;
+        tex_info.buffer_width = current_ctx->tex0.width;
+        tex_info.tex_width = current_ctx->tex0.tex_width;
+        tex_info.tex_height = current_ctx->tex0.tex_height;
 
-        // we need to know the left/right side slopes. They can be different if v1 is on the opposite side of e20
-        float lowerLeftEdgeStep  = reversed ? e20dxdy : e21dxdy;
-        float lowerRightEdgeStep = reversed ? e21dxdy : e20dxdy;
+        calculate_LOD(tex_info);
 
-        // draw triangles
-        if(lower_tri_only)
-        {
-            if(lowerTop < lowerBot) // if we weren't killed by scissoring
-            {
-                // we don't know which vertex is on the left or right, but the two configures have opposite sign areas:
-                //     v0  * ----*  v1         v1 *-----* v0
-                //                        OR
-                //             * v2                 * v2
-                VertexF& left_vertex = reversed ? v0 : v1;
-                VertexF& right_vertex = reversed ? v1 : v0;
-                render_half_triangle(left_vertex.x,    // upper edge left vertex, floating point pixels
-                                     right_vertex.x,   // upper edge right vertex, floating point pixels
-                                     upperTop,         // start scanline (included)
-                                     lowerBot,         // end scanline   (not included)
-                                     dvdx,             // derivative of values wrt x coordinate
-                                     dvdy,             // derivative of values wrt y coordinate
-                                     left_vertex,      // one point to interpolate from
-                                     lowerLeftEdgeStep, // slope of left edge
-                                     lowerRightEdgeStep,  // slope of right edge
-                                     scissorX1,        // x scissor (integer pixels, do draw this px)
-                                     scissorX2,        // x scissor (integer pixels, don't draw this px)
-                                     tex_info);        // texture
-            }
-        }
-        else
-        {
-            // again, left/right slopes
-            float upperLeftEdgeStep = reversed ? e20dxdy : e10dxdy;
-            float upperRightEdgeStep = reversed ? e10dxdy : e20dxdy;
+        //Automatic scissoring test
+        const int32_t min_y = ((std::max(std::min(v1.y, v2.y), (int32_t)current_ctx->scissor.y1) + 8) >> 4) << 4;
+        const int32_t min_x = ((std::max(std::min(v1.x, v2.x), (int32_t)current_ctx->scissor.x1) + 8) >> 4) << 4;
+        const int32_t max_y = ((std::min(std::max(v1.y, v2.y), (int32_t)current_ctx->scissor.y2 + 0x10) + 8) >> 4) << 4;
+        const int32_t max_x = ((std::min(std::max(v1.x, v2.x), (int32_t)current_ctx->scissor.x2 + 0x10) + 8) >> 4) << 4;
 
-            // upper triangle
-            if(upperTop < upperBot) // if we weren't killed by scissoring
-            {
-                render_half_triangle(v0.x, v0.x,          // upper edge is just the highest point on triangle
-                                     upperTop, upperBot,  // scanline bounds
-                                     dvdx, dvdy,          // derivatives of values
-                                     v0,                  // interpolate from this vertex
-                                     upperLeftEdgeStep, upperRightEdgeStep, // slopes
-                                     scissorX1, scissorX2,  // integer x scissor
-                                     tex_info);
-            }
+        printf("Coords: (%d, %d) (%d, %d)\n", min_x >> 4, min_y >> 4, max_x >> 4, max_y >> 4);
 
-            if(lowerTop < lowerBot)
-            {
-                //             * v0
-                //
-                //     v1  * ----
-                //
-                //
-                //               * v2
-                render_half_triangle(v0.x + upperLeftEdgeStep * e10.y, // one of our upper edge vertices isn't v0,v1,v2, but we don't know which. todo is this faster than branch?
-                                     v0.x + upperRightEdgeStep * e10.y,
-                                     lowerTop, lowerBot, dvdx, dvdy, v1,
-                                     lowerLeftEdgeStep, lowerRightEdgeStep, scissorX1, scissorX2, tex_info);
-            }
+        float pix_t = interpolate_f(min_y, v1.t, v1.y, v2.t, v2.y);
+        int32_t pix_v = (int32_t)interpolate(min_y, v1.uv.v, v1.y, v2.uv.v, v2.y) << 16;
+        float pix_s_init = interpolate_f(min_x, v1.s, v1.x, v2.s, v2.x);
+        int32_t pix_u_init = (int32_t)interpolate(min_x, v1.uv.u, v1.x, v2.uv.u, v2.x) << 16;
 
-        }
+        float pix_t_step = stepsize(v1.t, v1.y, v2.t, v2.y, 0x10);
+        int32_t pix_v_step = stepsize((int32_t)v1.uv.v, v1.y, (int32_t)v2.uv.v, v2.y, 0x100000);
+        float pix_s_step = stepsize(v1.s, v1.x, v2.s, v2.x, 0x10);
+        int32_t pix_u_step = stepsize((int32_t)v1.uv.u, v1.x, (int32_t)v2.uv.u, v2.x, 0x100000);
 
-    }
+        //Sprites store a single z value, so their bounds are known up front
+        set_zbounds_range(v2.z, v2.z);
+        update_zbounds(min_x >> 4, min_y >> 4, max_x >> 4, max_y >> 4, zbounds_exact_writes());
 
-    /*!
-     * Render a "half-triangle" which has a horizontal edge
-     * @param x0 - the x coordinate of the upper left most point of the triangle. floating point pixels
-     * @param x1 - the x coordinate of the upper right most point of the triangle (can be the same as x0), floating point px
-     * @param y0 - the y coordinate of the first scanline which will contain the triangle (integer pixels)
-     * @param y1 - the y coordinate of the last scanline which will contain the triangle (integer pixels)
-     * @param x_step - the derivatives of all parameters wrt x
-     * @param y_step - the derivatives of all parameters wrt y
-     * @param init   - the vertex we interpolate from
-     * @param step_x0 - how far to step to the left on each step down (floating point px)
-     * @param step_x1 - how far to step to the right on each step down (floating point px)
-     * @param scx1    - left x scissor (fp px)
-     * @param scx2    - right x scissor (fp px)
-     * @param tex_info - texture data
-     */
-    void GraphicsSynthesizerThread::render_half_triangle(float x0, float x1, int y0, int y1, VertexF &x_step,
-                                                         VertexF &y_step, VertexF &init, float step_x0, float step_x1,
-                                                         float scx1, float scx2, TexLookupInfo& tex_info) {
+        //Simple fills, clears and 1:1 blits can skip the pixel pipeline entirely
+        if (render_sprite_fast(min_x >> 4, min_y >> 4, max_x >> 4, max_y >> 4, v2, tex_info,
+                               pix_u_init, pix_v, pix_u_step, pix_v_step))
+            return;
 
         bool tmp_tex = current_PRMODE->texture_mapping;
-        bool tmp_uv = !current_PRMODE->use_UV;
+        bool tmp_st = !current_PRMODE->use_UV;//allow for loop unswitching
 
-        for(int y = y0; y < y1; y++) // loop over scanlines of triangle
+        for (int32_t y = min_y; y < max_y; y += 0x10)
         {
-            float height = y - init.y; // how far down we've made it
-            VertexF vtx = init + y_step * height;       // interpolate to point (x_init, y)
-            float x0l = x0 + step_x0 * height;          // start x coordinates of scanline from interpolation
-            float x1l = x1 + step_x1 * height;          // end   x coordinate of scanline from interpolation
-            x0l = std::max(scx1, std::ceil(x0l));       // round and scissor
-            x1l = std::min(scx2, std::ceil(x1l));       // round and scissor
-            int xStop = x1l;                            // integer start/stop pixels
-            int xStart = x0l;
-
-            if(xStop == xStart) continue;               // skip rows of zero length
-
-            vtx += (x_step * (x0l - init.x));           // interpolate to point (x0l, y)
-
-            for(int x = x0l; x < xStop; x++)            // loop over x pixels of scanline
+            float pix_s = pix_s_init;
+            uint32_t pix_u = pix_u_init;
+            for (int32_t x = min_x; x < max_x; x += 0x10)
             {
-                //vtx = init + y_step * height + (x_step * (x - init.x));
-                tex_info.vtx_color.r = vtx.r;           // set most recently interpolated stuff
-                tex_info.vtx_color.g = vtx.g;
-                tex_info.vtx_color.b = vtx.b;
-                tex_info.vtx_color.a = vtx.a;
-                tex_info.vtx_color.q = vtx.q;
-                tex_info.fog = vtx.fog;
                 if (tmp_tex)
                 {
-                    int32_t u, v;
-                    calculate_LOD(tex_info);
-                    if (tmp_uv)
+                    tex_info.fog = v2.fog;
+                    if (tmp_st)
                     {
-                        float s, t, q;
-                        s = vtx.s * 16.f;
-                        t = vtx.t * 16.f;
-                        q = vtx.q * 16.f;
-
-                        s /= q;
-                        t /= q;
-                        u = (s * tex_info.tex_width) * 16.f;
-                        v = (t * tex_info.tex_height) * 16.f;
-                        //fprintf(stderr, "q: %f, u: %d, v: %d, a: %d\n", vtx.q, u,v, tex_info.vtx_color.a);
+                        pix_v = ((pix_t / v2.rgbaq.q) * tex_info.tex_height) * 16.0;
+                        pix_u = ((pix_s / v2.rgbaq.q) * tex_info.tex_width) * 16.0;
+    #ifdef GS_JIT
+                        jit_tex_lookup_prologue(pix_u, pix_v, &tex_info);
+    #else
+                        tex_lookup(pix_u, pix_v, tex_info);
+    #endif
                     }
                     else
                     {
-                        u = (uint32_t) vtx.u;
-                        v = (uint32_t) vtx.v;
-                    }
     #ifdef GS_JIT
-                    jit_tex_lookup_prologue(u, v, &tex_info);
-                    jit_draw_pixel_prologue(x * 16, y * 16, (uint32_t)vtx.z, tex_info.tex_color);
+                        jit_tex_lookup_prologue(pix_u >> 16, pix_v >> 16, &tex_info);
     #else
-                    tex_lookup(u, v, tex_info);
-                    draw_pixel(x * 16, y * 16, (uint32_t)vtx.z, tex_info.tex_color);
+                        tex_lookup(pix_u >> 16, pix_v >> 16, tex_info);
     #endif
+                    }
 
+    #ifdef GS_JIT
+                    jit_draw_pixel_prologue(x, y, v2.z, tex_info.tex_color);
+    #else
+                    draw_pixel(x, y, v2.z, tex_info.tex_color);
+    #endif
                 }
                 else
                 {
     #ifdef GS_JIT
-                    jit_draw_pixel_prologue(x * 16, y * 16, (uint32_t)vtx.z, tex_info.vtx_color);
+                    jit_draw_pixel_prologue(x, y, v2.z, tex_info.vtx_color);
     #else
-                    draw_pixel(x * 16, y * 16, (uint32_t)vtx.z, tex_info.vtx_color);
+                    draw_pixel(x, y, v2.z, tex_info.vtx_color);
     #endif
                 }
-
-                vtx += x_step;                       // get values for the adjacent pixel
+                pix_s += pix_s_step;
+                pix_u += pix_u_step;
             }
+            pix_t += pix_t_step;
+            pix_v += pix_v_step;
+        }
+    }
+
+    //Converts a 32-bit frame color and write mask into the storage format of the frame buffer.
+    //Returns false if the format isn't handled by the sprite fast paths.
+    static bool get_frame_storage(uint8_t format, uint32_t& value, uint32_t& keep_mask)
+    {
+        switch (format)
+        {
+            case 0x00:
+            case 0x30:
+                return true;
+            case 0x01:
+            case 0x31:
+                keep_mask |= 0xFF000000;
+                return true;
+            case 0x02:
+            case 0x0A:
+            case 0x32:
+            case 0x3A:
+                //Downconversion drops bits independently of each other, so the mask converts the same way
+                value = convert_color_down(value);
+                keep_mask = convert_color_down(keep_mask);
+                return true;
+            default:
+                return false;
         }
-
     }
 
-    void GraphicsSynthesizerThread::render_triangle()
+    //Attempts to draw a sprite without going through draw_pixel.
+    //Handles untextured fills, frame/z clears and point-sampled 1:1 texture copies that don't blend or test per pixel.
+    //Returns false if the sprite needs the full pixel pipeline.
+    bool GraphicsSynthesizerThread::render_sprite_fast(int32_t x1, int32_t y1, int32_t x2, int32_t y2,
+        const Vertex& vtx, TexLookupInfo& tex_info, int32_t u, int32_t v, int32_t u_step, int32_t v_step)
     {
-        printf("[GS_t] Rendering triangle!\n");
-
-        Vertex v1 = vtx_queue[2]; v1.to_relative(current_ctx->xyoffset);
-        Vertex v2 = vtx_queue[1]; v2.to_relative(current_ctx->xyoffset);
-        Vertex v3 = vtx_queue[0]; v3.to_relative(current_ctx->xyoffset);
-
-        if (!current_PRMODE->gourand_shading)
-        {
-            //Flatten the colors
-            v1.rgbaq.r = v3.rgbaq.r;
-            v2.rgbaq.r = v3.rgbaq.r;
+        if (x1 >= x2 || y1 >= y2)
+            return true;
 
-            v1.rgbaq.g = v3.rgbaq.g;
-            v2.rgbaq.g = v3.rgbaq.g;
+        TEST* test = &current_ctx->test;
+        const RGBAQ_REG& color = tex_info.vtx_color;
+        const bool textured = current_PRMODE->texture_mapping;
 
-            v1.rgbaq.b = v3.rgbaq.b;
-            v2.rgbaq.b = v3.rgbaq.b;
+        if (DTHE || SCANMSK >= 2)
+            return false;
+        if (test->dest_alpha_test && !(current_ctx->frame.format & 0x1))
+            return false;
+        if (current_PRMODE->alpha_blend && (textured || !PABE || (color.a & 0x80)))
+            return false;
 
-            v1.rgbaq.a = v3.rgbaq.a;
-            v2.rgbaq.a = v3.rgbaq.a;
-        }
+        bool update_frame = true;
+        bool update_alpha = true;
+        bool update_z = !current_ctx->zbuf.no_update;
 
-        //The triangle rasterization code uses an approach with barycentric coordinates
-        //Clear explanation can be read below:
-        //https://fgiesen.wordpress.com/2013/02/06/the-barycentric-conspirac/
+        if (test->alpha_test && test->alpha_method != 1)
+        {
+            //Textured sprites can have a different alpha on every pixel
+            if (textured)
+                return false;
 
-        //Order by counter-clockwise winding order
-        if (orient2D(v1, v2, v3) < 0)
-            std::swap(v2, v3);
+            bool fail = false;
+            switch (test->alpha_method)
+            {
+                case 0: //NEVER
+                    fail = true;
+                    break;
+                case 2: //LESS
+                    fail = color.a >= test->alpha_ref;
+                    break;
+                case 3: //LEQUAL
+                    fail = color.a > test->alpha_ref;
+                    break;
+                case 4: //EQUAL
+                    fail = color.a != test->alpha_ref;
+                    break;
+                case 5: //GEQUAL
+                    fail = color.a < test->alpha_ref;
+                    break;
+                case 6: //GREATER
+                    fail = color.a <= test->alpha_ref;
+                    break;
+                case 7: //NOTEQUAL
+                    fail = color.a == test->alpha_ref;
+                    break;
+            }
 
-        int32_t divider = orient2D(v1, v2, v3);
-        //Calculate bounding box of triangle
-        int32_t min_x = std::min({v1.x, v2.x, v3.x});
-        int32_t min_y = std::min({v1.y, v2.y, v3.y});
-        int32_t max_x = std::max({v1.x, v2.x, v3.x});
-        int32_t max_y = std::max({v1.y, v2.y, v3.y});
-    
-        //Automatic scissoring test
-        min_x = std::max(min_x, (int32_t)current_ctx->scissor.x1);
-        min_y = std::max(min_y, (int32_t)current_ctx->scissor.y1);
-        max_x = std::min(max_x, (int32_t)current_ctx->scissor.x2 + 0x10);
-        max_y = std::min(max_y, (int32_t)current_ctx->scissor.y2 + 0x10);
+            if (fail)
+            {
+                switch (test->alpha_fail_method)
+                {
+                    case 0: //KEEP
+                        return true;
+                    case 1: //FB_ONLY
+                        update_z = false;
+                        break;
+                    case 2: //ZB_ONLY
+                        update_frame = false;
+                        break;
+                    case 3: //RGB_ONLY
+                        //The JIT always preserves alpha here, leave the disputed case to the pixel pipeline
+                        if (!is_32bit_texture())
+                            return false;
+                        update_z = false;
+                        update_alpha = false;
+                        break;
+                }
+            }
+        }
 
-        if (max_y == min_y && min_x == max_x)
-            return;
-        //We'll process the pixels in blocks, set the blocksize
-        const int32_t BLOCKSIZE = 1 << 4; // Must be power of 2
+        if (test->depth_test)
+        {
+            switch (test->depth_method)
+            {
+                case 0: //FAIL
+                    return true;
+                case 1: //PASS
+                    break;
+                default:
+                    return false;
+            }
+        }
+        else
+            update_z = false;
 
-        //Round down to make starting corner's coordinates a multiple of BLOCKSIZE with bitwise magic
-        min_x &= ~(BLOCKSIZE - 1);
-        min_y &= ~(BLOCKSIZE - 1);
+        //Work out the z value as it is stored in memory
+        uint32_t z = vtx.z;
+        uint32_t z_keep_mask = 0;
+        const PSMLayout* z_layout = get_PSM_layout(current_ctx->zbuf.format);
 
-        //Calculate incremental steps for the weights
-        //Reference: https://fgiesen.wordpress.com/2013/02/10/optimizing-the-basic-rasterizer/
-        const int32_t A12 = v1.y - v2.y;
-        const int32_t B12 = v2.x - v1.x;
-        const int32_t A23 = v2.y - v3.y;
-        const int32_t B23 = v3.x - v2.x;
-        const int32_t A31 = v3.y - v1.y;
-        const int32_t B31 = v1.x - v3.x;
+        //The JIT clamps z with a signed compare, so huge values aren't clamped the same way
+        if (update_z && (z & 0x80000000) && (current_ctx->zbuf.format & 0xF))
+            return false;
+        switch (current_ctx->zbuf.format)
+        {
+            case 0x00:
+            case 0x30:
+                break;
+            case 0x01:
+            case 0x31:
+                z = std::min(z, 0xFFFFFFU);
+                z_keep_mask = 0xFF000000;
+                break;
+            case 0x02:
+            case 0x0A:
+            case 0x32:
+            case 0x3A:
+                z = std::min(z, 0xFFFFU);
+                break;
+            default:
+                //draw_pixel silently skips z writes with an unknown format
+                update_z = false;
+                break;
+        }
 
-        const int32_t block_A23 = (BLOCKSIZE - 1) * A23;
-        const int32_t block_A31 = (BLOCKSIZE - 1) * A31;
-        const int32_t block_A12 = (BLOCKSIZE - 1) * A12;
-        const int32_t block_B23 = (BLOCKSIZE - 1) * B23;
-        const int32_t block_B31 = (BLOCKSIZE - 1) * B31;
-        const int32_t block_B12 = (BLOCKSIZE - 1) * B12;
+        const int32_t width = x2 - x1;
+        const int32_t height = y2 - y1;
+        const PSMLayout* frame_layout = get_PSM_layout(current_ctx->frame.format);
+        if (!frame_layout || frame_layout->bpp < 16 || (update_z && !z_layout))
+            return false;
 
-        Vertex min_corner;
-        min_corner.x = min_x; min_corner.y = min_y;
-        int32_t w1_row = orient2D(v2, v3, min_corner);
-        int32_t w2_row = orient2D(v3, v1, min_corner);
-        int32_t w3_row = orient2D(v1, v2, min_corner);
-        int32_t w1_row_block = w1_row;
-        int32_t w2_row_block = w2_row;
-        int32_t w3_row_block = w3_row;
+        uint32_t frame_start, frame_end;
+        if (!get_local_mem_range(*frame_layout, current_ctx->frame.base_pointer, current_ctx->frame.width,
+                                 x1, y1, width, height, frame_start, frame_end))
+            return false;
 
+        //draw_pixel writes the frame and the z buffer pixel by pixel, so their order only matters if they alias
+        uint32_t z_start = 0, z_end = 0;
+        if (update_z)
+        {
+            if (!get_local_mem_range(*z_layout, current_ctx->zbuf.base_pointer, current_ctx->frame.width,
+                                     x1, y1, width, height, z_start, z_end))
+                return false;
+            if (update_frame && z_start < frame_end && frame_start < z_end)
+                return false;
+        }
 
+        uint32_t frame_keep_mask = current_ctx->frame.mask;
+        if (!update_alpha)
+            frame_keep_mask |= 0xFF000000;
 
-        TexLookupInfo tex_info;
-        tex_info.new_lookup = true;
-        tex_info.tex_base = current_ctx->tex0.texture_base;
-        tex_info.buffer_width = current_ctx->tex0.width;
-        tex_info.tex_width = current_ctx->tex0.tex_width;
-        tex_info.tex_height = current_ctx->tex0.tex_height;
+        if (!textured)
+        {
+            if (update_frame)
+            {
+                uint32_t r, g, b;
+                if (COLCLAMP)
+                {
+                    r = std::clamp((int)color.r, 0, 0xFF);
+                    g = std::clamp((int)color.g, 0, 0xFF);
+                    b = std::clamp((int)color.b, 0, 0xFF);
+                }
+                else
+                {
+                    r = color.r & 0xFF;
+                    g = color.g & 0xFF;
+                    b = color.b & 0xFF;
+                }
 
-        bool tmp_tex = current_PRMODE->texture_mapping;
-        bool tmp_uv = !current_PRMODE->use_UV;//allow for loop unswitching
+                uint32_t value = ((uint32_t)color.a << 24) | (current_ctx->FBA << 31) | (b << 16) | (g << 8) | r;
+                uint32_t keep_mask = frame_keep_mask;
+                if (!get_frame_storage(current_ctx->frame.format, value, keep_mask))
+                    return false;
 
-        //TODO: Parallelize this
-        //Iterate through the bounding rectangle using BLOCKSIZE * BLOCKSIZE large blocks
-        //This way we can throw out blocks which are totally outside the triangle way faster
-        //Thanks you, Dolphin code for the idea
-        //https://github.com/dolphin-emu/dolphin/blob/master/Source/Core/VideoBackends/Software/Rasterizer.cpp#L388
-        for (int32_t y_block = min_y; y_block < max_y; y_block += BLOCKSIZE)
+                fill_rect(*frame_layout, current_ctx->frame.base_pointer, current_ctx->frame.width,
+                          x1, y1, x2, y2, value, keep_mask);
+            }
+        }
+        else
         {
-            int32_t w1_block = w1_row_block;
-            int32_t w2_block = w2_row_block;
-            int32_t w3_block = w3_row_block;
-            for (int32_t x_block = min_x; x_block < max_x; x_block += BLOCKSIZE)
-            {
-                //Store barycentric coordinates for the corners of a block
-                //tl = top left, tr = top right, etc.
-                int32_t w1_tl, w1_tr, w1_bl, w1_br;
-                int32_t w2_tl, w2_tr, w2_bl, w2_br;
-                int32_t w3_tl, w3_tr, w3_bl, w3_br;
-                //Calculate the weight offsets for the corners
-                w1_tl = w1_block; w2_tl = w2_block, w3_tl = w3_block;
-                w1_tr = w1_tl + block_A23;
-                w2_tr = w2_tl + block_A31;
-                w3_tr = w3_tl + block_A12;
-                w1_bl = w1_tl + block_B23;
-                w2_bl = w2_tl + block_B31;
-                w3_bl = w3_tl + block_B12;
-                w1_br = w1_tl + block_B23 + block_A23;
-                w2_br = w2_tl + block_B31 + block_A31;
-                w3_br = w3_tl + block_B12 + block_A12;
+            if (!current_PRMODE->use_UV || current_PRMODE->fog || tex_info.mipmap_level)
+                return false;
 
-                //Check if any of the corners are in the positive half-space of a weight
-                bool w1_tl_check = w1_tl > 0;
-                bool w1_tr_check = w1_tr > 0;
-                bool w1_bl_check = w1_bl > 0;
-                bool w1_br_check = w1_br > 0;
-                bool w2_tl_check = w2_tl > 0;
-                bool w2_tr_check = w2_tr > 0;
-                bool w2_bl_check = w2_bl > 0;
-                bool w2_br_check = w2_br > 0;
-                bool w3_tl_check = w3_tl > 0;
-                bool w3_tr_check = w3_tr > 0;
-                bool w3_bl_check = w3_bl > 0;
-                bool w3_br_check = w3_br > 0;
+            //Only one texel per pixel, sampled from the same subtexel position every time
+            if (u_step != 0x100000 || v_step != 0x100000 || u < 0 || v < 0)
+                return false;
 
+            if (tex_info.tex_height >= 8 && tex_info.tex_width >= 8)
+            {
+                if (current_ctx->tex1.filter_larger && tex_info.LOD < 0.0)
+                    return false;
+                if ((current_ctx->tex1.filter_smaller == 0x1 || current_ctx->tex1.filter_smaller >= 4) && tex_info.LOD >= 0.0)
+                    return false;
+            }
 
-                //Combine all checks for a barycentric coordinate into one
-                //If for one half-space checks for each corner --> all corners lie outside the triangle --> block can be skipped
-                uint8_t w1_mask = (w1_tl_check << 0) | (w1_tr_check << 1) | (w1_bl_check << 2) | (w1_br_check << 3);
-                uint8_t w2_mask = (w2_tl_check << 0) | (w2_tr_check << 1) | (w2_bl_check << 2) | (w2_br_check << 3);
-                uint8_t w3_mask = (w3_tl_check << 0) | (w3_tr_check << 1) | (w3_bl_check << 2) | (w3_br_check << 3);
-                //However in other cases, we process the block pixel-by-pixel as usual
-                //TODO: In the case where all corners lie inside the triangle the code below could be slightly simplified
-                if (w1_mask != 0 && w2_mask != 0 && w3_mask != 0)
-                {
-                    //Process a BLOCKSIZE * BLOCKSIZE block as normal
-                    int32_t w1_row = w1_block;
-                    int32_t w2_row = w2_block;
-                    int32_t w3_row = w3_block;
-                    for (int32_t y = y_block; y < y_block + BLOCKSIZE; y += 0x10)
-                    {
-                        int32_t w1 = w1_row;
-                        int32_t w2 = w2_row;
-                        int32_t w3 = w3_row;
-                        for (int32_t x = x_block; x < x_block + BLOCKSIZE; x += 0x10)
-                        {
-                            //Is inside triangle?
-                            if ((w1 | w2 | w3) >= 0)
-                            {
-                                //Interpolate Z
-                                double z = (double) v1.z * w1 + (double) v2.z * w2 + (double) v3.z * w3;
-                                z /= divider;
+            //The color function has to leave the texel untouched
+            bool use_tex_alpha = current_ctx->tex0.use_alpha;
+            switch (current_ctx->tex0.color_function)
+            {
+                case 0: //Modulate
+                    if (color.r != 0x80 || color.g != 0x80 || color.b != 0x80)
+                        return false;
+                    if (use_tex_alpha && color.a != 0x80)
+                        return false;
+                    break;
+                case 1: //Decal
+                    break;
+                default:
+                    return false;
+            }
 
-                                //Gourand shading calculations
-                                float r = (float) v1.rgbaq.r * w1 + (float) v2.rgbaq.r * w2 + (float) v3.rgbaq.r * w3;
-                                float g = (float) v1.rgbaq.g * w1 + (float) v2.rgbaq.g * w2 + (float) v3.rgbaq.g * w3;
-                                float b = (float) v1.rgbaq.b * w1 + (float) v2.rgbaq.b * w2 + (float) v3.rgbaq.b * w3;
-                                float a = (float) v1.rgbaq.a * w1 + (float) v2.rgbaq.a * w2 + (float) v3.rgbaq.a * w3;
-                                float q = v1.rgbaq.q * w1 + v2.rgbaq.q * w2 + v3.rgbaq.q * w3;
-                                float fog = (float) v1.fog * w1 + (float) v2.fog * w2 + (float) v3.fog * w3;
-                                tex_info.vtx_color.r = r / divider;
-                                tex_info.vtx_color.g = g / divider;
-                                tex_info.vtx_color.b = b / divider;
-                                tex_info.vtx_color.a = a / divider;
-                                tex_info.vtx_color.q = q / divider;
-                                tex_info.fog = fog / divider;
+            const PSMLayout* tex_layout = get_PSM_layout(current_ctx->tex0.format);
+            switch (current_ctx->tex0.format)
+            {
+                case 0x00:
+                case 0x01:
+                case 0x02:
+                case 0x0A:
+                case 0x30:
+                case 0x31:
+                case 0x32:
+                case 0x3A:
+                    break;
+                default:
+                    return false;
+            }
 
-                                if (tmp_tex)
-                                {
-                                    int32_t u, v;
-                                    calculate_LOD(tex_info);
-                                    if (tmp_uv)
-                                    {
-                                        float s, t, q;
-                                        s = v1.s * w1 + v2.s * w2 + v3.s * w3;
-                                        t = v1.t * w1 + v2.t * w2 + v3.t * w3;
-                                        q = v1.rgbaq.q * w1 + v2.rgbaq.q * w2 + v3.rgbaq.q * w3;
+            //Stay inside the texture so that REPEAT and CLAMP are no-ops
+            const int32_t u1 = (u >> 16) >> 4;
+            const int32_t v1 = (v >> 16) >> 4;
+            if (current_ctx->clamp.wrap_s > 1 || current_ctx->clamp.wrap_t > 1)
+                return false;
+            if (u1 + width > tex_info.tex_width || v1 + height > tex_info.tex_height)
+                return false;
 
-                                        //We don't divide s and t by "divider" because dividing by Q effectively
-                                        //cancels that out
-                                        s /= q;
-                                        t /= q;
-                                        u = (s * tex_info.tex_width) * 16.0;
-                                        v = (t * tex_info.tex_height) * 16.0;
-                                    }
-                                    else
-                                    {
-                                        float temp_u = (float) v1.uv.u * w1 + (float) v2.uv.u * w2 + (float) v3.uv.u * w3;
-                                        float temp_v = (float) v1.uv.v * w1 + (float) v2.uv.v * w2 + (float) v3.uv.v * w3;
-                                        temp_u /= divider;
-                                        temp_v /= divider;
-                                        u = (uint32_t) temp_u;
-                                        v = (uint32_t) temp_v;
-                                    }
-    #ifdef GS_JIT
-                                    jit_tex_lookup_prologue(u, v, &tex_info);
-                                    jit_draw_pixel_prologue(x, y, (uint32_t)z, tex_info.tex_color);
-    #else
-                                    tex_lookup(u, v, tex_info);
-                                    draw_pixel(x, y, (uint32_t)z, tex_info.tex_color);
-    #endif
-                                }
-                                else
-                                {
-    #ifdef GS_JIT
-                                    jit_draw_pixel_prologue(x, y, (uint32_t)z, tex_info.vtx_color);
-    #else
-                                    draw_pixel(x, y, (uint32_t)z, tex_info.vtx_color);
-    #endif
-                                }
-                            }
-                            else
-                                break;
-                            //Horizontal step
-                            w1 += A23 << 4;
-                            w2 += A31 << 4;
-                            w3 += A12 << 4;
-                        }
-                        //Vertical step
-                        w1_row += B23 << 4;
-                        w2_row += B31 << 4;
-                        w3_row += B12 << 4;
-                    }
-                }
+            uint32_t tex_start, tex_end;
+            if (!get_local_mem_range(*tex_layout, tex_info.tex_base, tex_info.buffer_width, u1, v1, width, height,
+                                     tex_start, tex_end))
+                return false;
+            if (update_frame && tex_start < frame_end && frame_start < tex_end)
+                return false;
 
-                w1_block += BLOCKSIZE * A23;
-                w2_block += BLOCKSIZE * A31;
-                w3_block += BLOCKSIZE * A12;
+            if (update_z && tex_start < z_end && z_start < tex_end)
+                return false;
+
+            if (update_frame)
+            {
+                uint32_t dummy = 0;
+                uint32_t keep_mask = frame_keep_mask;
+                if (!get_frame_storage(current_ctx->frame.format, dummy, keep_mask))
+                    return false;
 
+                blit_sprite(*frame_layout, x1, y1, x2, y2, u1, v1, tex_info, use_tex_alpha, color.a, keep_mask);
             }
-            w1_row_block += BLOCKSIZE * B23;
-            w2_row_block += BLOCKSIZE * B31;
-            w3_row_block += BLOCKSIZE * B12;
         }
 
+        if (update_z)
+            fill_rect(*z_layout, current_ctx->zbuf.base_pointer, current_ctx->frame.width, x1, y1, x2, y2, z, z_keep_mask);
+
+        if (pixel_stats)
+        {
+            uint64_t area = (uint64_t)width * height;
+            frame_stats.pixels_tested += area;
+            frame_stats.pixels_written += area;
+            if (textured && update_frame)
+                frame_stats.texels_fetched += area;
+        }
+        return true;
     }
 
-    void GraphicsSynthesizerThread::render_sprite()
+    //Fills a rectangle with a constant value, a whole block at a time wherever the rectangle covers one.
+    //Bits set in keep_mask are left untouched.
+    void GraphicsSynthesizerThread::fill_rect(const PSMLayout& layout, uint32_t base, uint32_t width,
+        int32_t x1, int32_t y1, int32_t x2, int32_t y2, uint32_t value, uint32_t keep_mask)
     {
-        printf("[GS_t] Rendering sprite!\n");
-        Vertex v1 = vtx_queue[1]; v1.to_relative(current_ctx->xyoffset);
-        Vertex v2 = vtx_queue[0]; v2.to_relative(current_ctx->xyoffset);
-        TexLookupInfo tex_info;
-        tex_info.new_lookup = true;
+        if (layout.bpp == 16)
+        {
+            value = (value & 0xFFFF) | (value << 16);
+            keep_mask = (keep_mask & 0xFFFF) | (keep_mask << 16);
+        }
+        value &= ~keep_mask;
 
-        tex_info.vtx_color = vtx_queue[0].rgbaq;
-        tex_info.tex_base = current_ctx->tex0.texture_base;
-        tex_info.buffer_width = current_ctx->tex0.width;
-        tex_info.tex_width = current_ctx->tex0.tex_width;
-        tex_info.tex_height = current_ctx->tex0.tex_height;
+        auto vvalue = simd::fill<uint32_t>(value);
+        auto vkeep = simd::fill<uint32_t>(keep_mask);
 
-        calculate_LOD(tex_info);
+        const int32_t bw = layout.block_width;
+        const int32_t bh = layout.block_height;
+        for (int32_t by = y1 - (y1 % bh); by < y2; by += bh)
+        {
+            int32_t ty1 = std::max(by, y1);
+            int32_t ty2 = std::min(by + bh, y2);
+            for (int32_t bx = x1 - (x1 % bw); bx < x2; bx += bw)
+            {
+                int32_t tx1 = std::max(bx, x1);
+                int32_t tx2 = std::min(bx + bw, x2);
 
-        //Automatic scissoring test
-        const int32_t min_y = ((std::max(std::min(v1.y, v2.y), (int32_t)current_ctx->scissor.y1) + 8) >> 4) << 4;
-        const int32_t min_x = ((std::max(std::min(v1.x, v2.x), (int32_t)current_ctx->scissor.x1) + 8) >> 4) << 4;
-        const int32_t max_y = ((std::min(std::max(v1.y, v2.y), (int32_t)current_ctx->scissor.y2 + 0x10) + 8) >> 4) << 4;
-        const int32_t max_x = ((std::min(std::max(v1.x, v2.x), (int32_t)current_ctx->scissor.x2 + 0x10) + 8) >> 4) << 4;
+                if (tx2 - tx1 == bw && ty2 - ty1 == bh)
+                {
+                    uint8_t* block = &local_mem[layout.block_offset(base, width, bx, by)];
+                    for (int i = 0; i < 256; i += 32)
+                    {
+                        if (keep_mask)
+                        {
+                            auto old = simd::load<uint32_t>(block + i);
+                            simd::store((old & vkeep) | vvalue, block + i);
+                        }
+                        else
+                            simd::store(vvalue, block + i);
+                    }
+                    continue;
+                }
 
-        printf("Coords: (%d, %d) (%d, %d)\n", min_x >> 4, min_y >> 4, max_x >> 4, max_y >> 4);
+                for (int32_t y = ty1; y < ty2; y++)
+                {
+                    for (int32_t x = tx1; x < tx2; x++)
+                    {
+                        uint32_t addr = layout.addr(base / 256, width / 64, x, y);
+                        if (layout.bpp == 32)
+                        {
+                            uint32_t* pixel = (uint32_t*)&local_mem[addr];
+                            *pixel = (*pixel & keep_mask) | value;
+                        }
+                        else
+                        {
+                            uint16_t* pixel = (uint16_t*)&local_mem[addr];
+                            *pixel = (*pixel & keep_mask) | (value & 0xFFFF);
+                        }
+                    }
+                }
+            }
+        }
+    }
 
-        float pix_t = interpolate_f(min_y, v1.t, v1.y, v2.t, v2.y);
-        int32_t pix_v = (int32_t)interpolate(min_y, v1.uv.v, v1.y, v2.uv.v, v2.y) << 16;
-        float pix_s_init = interpolate_f(min_x, v1.s, v1.x, v2.s, v2.x);
-        int32_t pix_u_init = (int32_t)interpolate(min_x, v1.uv.u, v1.x, v2.uv.u, v2.x) << 16;
+    //Copies a texture rectangle to the frame buffer with one texel per pixel.
+    //keep_mask is in the storage format of the frame buffer.
+    void GraphicsSynthesizerThread::blit_sprite(const PSMLayout& frame_layout, int32_t x1, int32_t y1, int32_t x2, int32_t y2,
+        int32_t u1, int32_t v1, TexLookupInfo& tex_info, bool use_tex_alpha, uint8_t vtx_alpha, uint32_t keep_mask)
+    {
+        const uint8_t tex_format = current_ctx->tex0.format;
+        const uint8_t frame_format = current_ctx->frame.format;
+        const PSMLayout& tex_layout = *get_PSM_layout(tex_format);
+        const uint32_t frame_base = current_ctx->frame.base_pointer;
+        const uint32_t frame_width = current_ctx->frame.width;
+        const int32_t width = x2 - x1;
+        const int32_t height = y2 - y1;
+
+        //Untouched 32-bit texels going into a 32-bit frame buffer with the same layout are a straight block copy
+        bool raw_copy = (tex_format == 0x00 || tex_format == 0x30) && (frame_format == 0x00 || frame_format == 0x30) &&
+                        &tex_layout == &frame_layout && use_tex_alpha && !current_ctx->FBA && !keep_mask;
+        if (raw_copy && !((x1 | y1 | u1 | v1 | width | height) & 0x7))
+        {
+            for (int32_t y = 0; y < height; y += 8)
+            {
+                for (int32_t x = 0; x < width; x += 8)
+                {
+                    memcpy(&local_mem[frame_layout.block_offset(frame_base, frame_width, x1 + x, y1 + y)],
+                           &local_mem[tex_layout.block_offset(tex_info.tex_base, tex_info.buffer_width, u1 + x, v1 + y)],
+                           256);
+                }
+            }
+            return;
+        }
 
-        float pix_t_step = stepsize(v1.t, v1.y, v2.t, v2.y, 0x10);
-        int32_t pix_v_step = stepsize((int32_t)v1.uv.v, v1.y, (int32_t)v2.uv.v, v2.y, 0x100000);
-        float pix_s_step = stepsize(v1.s, v1.x, v2.s, v2.x, 0x10);
-        int32_t pix_u_step = stepsize((int32_t)v1.uv.u, v1.x, (int32_t)v2.uv.u, v2.x, 0x100000);
+        alignas(32) uint32_t row[2048 + 8];
+        uint32_t frame_addr[2048 + 8];
 
-        bool tmp_tex = current_PRMODE->texture_mapping;
-        bool tmp_st = !current_PRMODE->use_UV;//allow for loop unswitching
+        auto alpha0 = simd::fill<uint32_t>((uint32_t)TEXA.alpha0 << 24);
+        auto alpha1 = simd::fill<uint32_t>((uint32_t)TEXA.alpha1 << 24);
+        auto trans_black = simd::fill<uint32_t>(TEXA.trans_black ? 0xFFFFFFFF : 0);
+        auto fixed_alpha = simd::fill<uint32_t>((uint32_t)vtx_alpha << 24);
+        auto fba = simd::fill<uint32_t>(current_ctx->FBA ? 0x80000000 : 0);
+        auto zero = simd::fill<uint32_t>(0);
+        const int32_t vec_width = (width + 7) & ~7;
 
-        for (int32_t y = min_y; y < max_y; y += 0x10)
+        for (int32_t y = 0; y < height; y++)
         {
-            float pix_s = pix_s_init;
-            uint32_t pix_u = pix_u_init;
-            for (int32_t x = min_x; x < max_x; x += 0x10)
+            for (int32_t x = 0; x < width; x++)
             {
-                if (tmp_tex)
+                uint32_t addr = tex_layout.addr(tex_info.tex_base / 256, tex_info.buffer_width / 64, u1 + x, v1 + y);
+                if (tex_layout.bpp == 32)
+                    row[x] = *(uint32_t*)&local_mem[addr];
+                else
+                    row[x] = *(uint16_t*)&local_mem[addr];
+            }
+
+            for (int32_t x = 0; x < vec_width; x += 8)
+            {
+                auto color = simd::load<uint32_t>(&row[x]);
+                switch (tex_format)
                 {
-                    tex_info.fog = v2.fog;
-                    if (tmp_st)
+                    case 0x01:
+                    case 0x31:
                     {
-                        pix_v = ((pix_t / v2.rgbaq.q) * tex_info.tex_height) * 16.0;
-                        pix_u = ((pix_s / v2.rgbaq.q) * tex_info.tex_width) * 16.0;
-    #ifdef GS_JIT
-                        jit_tex_lookup_prologue(pix_u, pix_v, &tex_info);
-    #else
-                        tex_lookup(pix_u, pix_v, tex_info);
-    #endif
+                        //PSMCT24 takes its alpha from TEXA
+                        color = color & 0x00FFFFFF;
+                        auto black = (color == 0) & trans_black;
+                        color = color | simd::select(alpha0, zero, black);
+                        break;
                     }
-                    else
+                    case 0x02:
+                    case 0x0A:
+                    case 0x32:
+                    case 0x3A:
                     {
-    #ifdef GS_JIT
-                        jit_tex_lookup_prologue(pix_u >> 16, pix_v >> 16, &tex_info);
-    #else
-                        tex_lookup(pix_u >> 16, pix_v >> 16, tex_info);
-    #endif
+                        auto black = (color == 0) & trans_black;
+                        auto alpha = simd::select(alpha0, zero, black);
+                        alpha = simd::select(alpha, alpha1, (color & 0x8000) == 0x8000);
+                        color = ((color & 0x1F) << 3) | ((color & 0x3E0) << 6) | ((color & 0x7C00) << 9) | alpha;
+                        break;
                     }
+                }
 
-    #ifdef GS_JIT
-                    jit_draw_pixel_prologue(x, y, v2.z, tex_info.tex_color);
-    #else
-                    draw_pixel(x, y, v2.z, tex_info.tex_color);
-    #endif
+                if (!use_tex_alpha)
+                    color = (color & 0x00FFFFFF) | fixed_alpha;
+                color = color | fba;
+
+                if (frame_layout.bpp == 16)
+                {
+                    color = ((color >> 3) & 0x1F) | ((color >> 6) & 0x3E0) | ((color >> 9) & 0x7C00) |
+                            ((color >> 16) & 0x8000);
                 }
-                else
+                simd::store(color, &row[x]);
+            }
+
+            for (int32_t x = 0; x < width; x++)
+                frame_addr[x] = frame_layout.addr(frame_base / 256, frame_width / 64, x1 + x, y1 + y);
+
+            if (frame_layout.bpp == 32)
+            {
+                for (int32_t x = 0; x < width; x++)
                 {
-    #ifdef GS_JIT
-                    jit_draw_pixel_prologue(x, y, v2.z, tex_info.vtx_color);
-    #else
-                    draw_pixel(x, y, v2.z, tex_info.vtx_color);
-    #endif
+                    uint32_t* pixel = (uint32_t*)&local_mem[frame_addr[x]];
+                    *pixel = (*pixel & keep_mask) | (row[x] & ~keep_mask);
+                }
+            }
+            else
+            {
+                for (int32_t x = 0; x < width; x++)
+                {
+                    uint16_t* pixel = (uint16_t*)&local_mem[frame_addr[x]];
+                    *pixel = (*pixel & keep_mask) | (row[x] & ~keep_mask);
                 }
-                pix_s += pix_s_step;
-                pix_u += pix_u_step;
             }
-            pix_t += pix_t_step;
-            pix_v += pix_v_step;
         }
     }
 
@@ -3082,6 +4830,29 @@ namespace gs
             return return_qwc;
         }
 
+        //Games often read the same area back every frame without drawing to it in between
+        if (download_cache_matches())
+        {
+            return_qwc = download_cache.qwc;
+            memcpy(target, download_cache.data.data(), return_qwc * sizeof(uint128_t));
+            TRXPOS.int_source_x = download_cache.end_pos.int_source_x;
+            TRXPOS.int_source_y = download_cache.end_pos.int_source_y;
+            PSMCT24_color = download_cache.end_PSMCT24_color;
+            PSMCT24_unpacked_count = download_cache.end_PSMCT24_count;
+            printf("[GS_t] Local to Host transfer served from cache\n");
+            TRXDIR = 3;
+            pixels_transferred = 0;
+            return return_qwc;
+        }
+
+        download_cache.valid = false;
+        download_cache.BITBLTBUF = BITBLTBUF;
+        download_cache.TRXREG = TRXREG;
+        download_cache.start_pos = TRXPOS;
+        download_cache.pixels_transferred = pixels_transferred;
+        download_cache.start_PSMCT24_color = PSMCT24_color;
+        download_cache.start_PSMCT24_count = PSMCT24_unpacked_count;
+
         switch (BITBLTBUF.source_format)
         {
             //PSMCT32
@@ -3212,6 +4983,16 @@ namespace gs
             return_qwc++;
         }
 
+        download_cache.end_pos = TRXPOS;
+        download_cache.end_PSMCT24_color = PSMCT24_color;
+        download_cache.end_PSMCT24_count = PSMCT24_unpacked_count;
+        download_cache.qwc = return_qwc;
+        download_cache.data.assign(target, target + return_qwc);
+        get_page_range(get_PSM_layout(BITBLTBUF.source_format), BITBLTBUF.source_base, BITBLTBUF.source_width,
+                       TRXPOS.source_x, TRXPOS.source_y, TRXPOS.source_x + TRXREG.width, TRXPOS.source_y + TRXREG.height,
+                       download_cache.first_page, download_cache.last_page);
+        download_cache.valid = true;
+
         //Deactivate the transmisssion
         printf("[GS_t] Local to Host transfer ended\n");
         TRXDIR = 3;
@@ -3220,6 +5001,31 @@ namespace gs
         return return_qwc;
     }
 
+    bool GraphicsSynthesizerThread::download_cache_matches()
+    {
+        const DownloadCache& cache = download_cache;
+        return cache.valid &&
+            cache.BITBLTBUF.source_base == BITBLTBUF.source_base &&
+            cache.BITBLTBUF.source_width == BITBLTBUF.source_width &&
+            cache.BITBLTBUF.source_format == BITBLTBUF.source_format &&
+            cache.TRXREG.width == TRXREG.width &&
+            cache.TRXREG.height == TRXREG.height &&
+            cache.start_pos.source_x == TRXPOS.source_x &&
+            cache.start_pos.source_y == TRXPOS.source_y &&
+            cache.start_pos.int_source_x == TRXPOS.int_source_x &&
+            cache.start_pos.int_source_y == TRXPOS.int_source_y &&
+            cache.pixels_transferred == pixels_transferred &&
+            cache.start_PSMCT24_color == PSMCT24_color &&
+            cache.start_PSMCT24_count == PSMCT24_unpacked_count;
+    }
+
+    //Drops the cached download if a write to the given pages can touch the pages it read
+    void GraphicsSynthesizerThread::invalidate_download_cache(uint32_t first_page, uint32_t last_page)
+    {
+        if (download_cache.valid && first_page <= download_cache.last_page && download_cache.first_page <= last_page)
+            download_cache.valid = false;
+    }
+
     void GraphicsSynthesizerThread::unpack_PSMCT24(uint64_t data, int offset, bool z_format)
     {
         int bytes_unpacked = 0;
@@ -3370,6 +5176,13 @@ namespace gs
                 Errors::die("[GS_t] Unrecognized local-to-local transmission order $%02X", TRXPOS.trans_order);
         }
 
+        if (local_to_local_fast())
+        {
+            pixels_transferred = 0;
+            TRXDIR = 3;
+            return;
+        }
+
         while (pixels_transferred < max_pixels)
         {
             uint32_t data;
@@ -3476,27 +5289,346 @@ namespace gs
                     Errors::die("[GS_t] Unrecognized local-to-local dest format $%02X", BITBLTBUF.dest_format);
             }
 
-            pixels_transferred++;
-            TRXPOS.int_source_x += x_step;
-            TRXPOS.int_dest_x += x_step;
+            pixels_transferred++;
+            TRXPOS.int_source_x += x_step;
+            TRXPOS.int_dest_x += x_step;
+
+            if (pixels_transferred % TRXREG.width == 0)
+            {
+                TRXPOS.int_source_x = src_start_x;
+                TRXPOS.int_source_y += y_step;
+
+                TRXPOS.int_dest_x = dest_start_x;
+                TRXPOS.int_dest_y += y_step;
+            }
+
+            //Coordinates wrap at 2048 pixels
+            TRXPOS.int_source_x %= 2048;
+            TRXPOS.int_source_y %= 2048;
+            TRXPOS.int_dest_x %= 2048;
+            TRXPOS.int_dest_y %= 2048;
+        }
+        pixels_transferred = 0;
+        TRXDIR = 3;
+    }
+
+    //Returns the bits of each destination pixel that a same-layout local-to-local copy replaces,
+    //or 0 if the formats need a conversion that can't be done on raw memory.
+    static uint32_t local_copy_mask(uint8_t source_format, uint8_t dest_format)
+    {
+        switch (dest_format)
+        {
+            case 0x00:
+                return (source_format == 0x00 || source_format == 0x01) ? 0xFFFFFFFF : 0;
+            case 0x01:
+                return (source_format == 0x00 || source_format == 0x01) ? 0x00FFFFFF : 0;
+            case 0x30:
+                return (source_format == 0x30 || source_format == 0x31) ? 0xFFFFFFFF : 0;
+            case 0x31:
+                return (source_format == 0x30 || source_format == 0x31) ? 0x00FFFFFF : 0;
+            case 0x1B:
+                return (source_format == 0x1B) ? 0xFF000000 : 0;
+            case 0x2C:
+                return (source_format == 0x2C) ? 0xF0000000 : 0;
+            case 0x02:
+            case 0x0A:
+            case 0x13:
+            case 0x14:
+                return (source_format == dest_format) ? 0xFFFFFFFF : 0;
+            default:
+                return 0;
+        }
+    }
+
+    //Calculates the range of local memory a rectangle can touch, rounded out to whole pages.
+    //Returns false if the rectangle wraps around the buffer width or the end of local memory.
+    bool GraphicsSynthesizerThread::get_local_mem_range(const PSMLayout& layout, uint32_t base, uint32_t width,
+        uint32_t x, uint32_t y, uint32_t w, uint32_t h, uint32_t& start, uint32_t& end)
+    {
+        uint32_t pages_per_row = width / layout.page_width;
+        if (!pages_per_row || (width % layout.page_width) || x + w > width)
+            return false;
+
+        uint32_t x2 = x + w - 1;
+        uint32_t y2 = y + h - 1;
+        uint32_t first_page = (base / 8192) + (y / layout.page_height) * pages_per_row + (x / layout.page_width);
+        uint32_t last_page = (base / 8192) + (y2 / layout.page_height) * pages_per_row + (x2 / layout.page_width);
+
+        //A base pointer that isn't page aligned spills the last page into the next one
+        if (base & 0x1FFF)
+            last_page++;
+
+        if (last_page >= 512)
+            return false;
+
+        start = first_page * 8192;
+        end = (last_page + 1) * 8192;
+        return true;
+    }
+
+    //Attempts to perform the current local-to-local transfer with whole blocks or whole rows at a time.
+    //Returns false if the transfer has to go through the generic pixel-by-pixel loop.
+    bool GraphicsSynthesizerThread::local_to_local_fast()
+    {
+        const PSMLayout* src = get_PSM_layout(BITBLTBUF.source_format);
+        const PSMLayout* dest = get_PSM_layout(BITBLTBUF.dest_format);
+        if (!src || !dest)
+            return false;
+
+        if (TRXPOS.source_x + TRXREG.width > 2048 || TRXPOS.dest_x + TRXREG.width > 2048)
+            return false;
+        if (TRXPOS.source_y + TRXREG.height > 2048 || TRXPOS.dest_y + TRXREG.height > 2048)
+            return false;
+
+        uint32_t src_start, src_end, dest_start, dest_end;
+        if (!get_local_mem_range(*src, BITBLTBUF.source_base, BITBLTBUF.source_width,
+                                 TRXPOS.source_x, TRXPOS.source_y, TRXREG.width, TRXREG.height, src_start, src_end))
+            return false;
+        if (!get_local_mem_range(*dest, BITBLTBUF.dest_base, BITBLTBUF.dest_width,
+                                 TRXPOS.dest_x, TRXPOS.dest_y, TRXREG.width, TRXREG.height, dest_start, dest_end))
+            return false;
+
+        bool disjoint = src_end <= dest_start || dest_end <= src_start;
+
+        uint32_t mask = local_copy_mask(BITBLTBUF.source_format, BITBLTBUF.dest_format);
+        if (mask && src == dest)
+        {
+            bool aligned = !((TRXPOS.source_x | TRXPOS.dest_x | TRXREG.width) % src->block_width) &&
+                           !((TRXPOS.source_y | TRXPOS.dest_y | TRXREG.height) % src->block_height);
+
+            //When both rectangles live in the same buffer, a block-aligned move is a pure translation.
+            //Walking the blocks in TRXPOS order then reads and writes every pixel in the same order
+            //the hardware would, so overlapping moves are still safe.
+            bool same_buffer = BITBLTBUF.source_base == BITBLTBUF.dest_base &&
+                               BITBLTBUF.source_width == BITBLTBUF.dest_width;
+
+            if (aligned && (disjoint || same_buffer))
+            {
+                local_to_local_blocks(*src, mask);
+                return true;
+            }
+        }
+
+        //Row buffering reorders reads and writes, so it is only safe when the rectangles can't alias
+        if (!disjoint)
+            return false;
 
-            if (pixels_transferred % TRXREG.width == 0)
+        switch (BITBLTBUF.source_format)
+        {
+            case 0x00:
+            case 0x01:
+            case 0x02:
+            case 0x0A:
+            case 0x13:
+            case 0x14:
+            case 0x1B:
+            case 0x2C:
+            case 0x30:
+            case 0x31:
+                break;
+            default:
+                return false;
+        }
+
+        local_to_local_rows();
+        return true;
+    }
+
+    //Copies whole 256-byte blocks between two rectangles that share the same memory layout
+    void GraphicsSynthesizerThread::local_to_local_blocks(const PSMLayout& layout, uint32_t mask)
+    {
+        int blocks_x = TRXREG.width / layout.block_width;
+        int blocks_y = TRXREG.height / layout.block_height;
+
+        bool reverse_x = TRXPOS.trans_order & 0x2;
+        bool reverse_y = TRXPOS.trans_order & 0x1;
+
+        for (int i = 0; i < blocks_y; i++)
+        {
+            int by = reverse_y ? (blocks_y - 1 - i) : i;
+            uint32_t src_y = TRXPOS.source_y + by * layout.block_height;
+            uint32_t dest_y = TRXPOS.dest_y + by * layout.block_height;
+
+            for (int j = 0; j < blocks_x; j++)
             {
-                TRXPOS.int_source_x = src_start_x;
-                TRXPOS.int_source_y += y_step;
+                int bx = reverse_x ? (blocks_x - 1 - j) : j;
+                uint32_t src_x = TRXPOS.source_x + bx * layout.block_width;
+                uint32_t dest_x = TRXPOS.dest_x + bx * layout.block_width;
 
-                TRXPOS.int_dest_x = dest_start_x;
-                TRXPOS.int_dest_y += y_step;
+                uint8_t* src_block = &local_mem[layout.block_offset(BITBLTBUF.source_base, BITBLTBUF.source_width,
+                                                                    src_x, src_y)];
+                uint8_t* dest_block = &local_mem[layout.block_offset(BITBLTBUF.dest_base, BITBLTBUF.dest_width,
+                                                                     dest_x, dest_y)];
+
+                if (src_block == dest_block)
+                    continue;
+
+                if (mask == 0xFFFFFFFF)
+                {
+                    memcpy(dest_block, src_block, 256);
+                    continue;
+                }
+
+                //Partial copies (PSMCT24, PSMT8H, PSMT4HH) keep the untouched bits of the destination
+                auto src_mask = simd::fill<uint32_t>(mask);
+                auto dest_mask = simd::fill<uint32_t>(~mask);
+                for (int k = 0; k < 256; k += 32)
+                {
+                    auto src_data = simd::load<uint32_t>(src_block + k);
+                    auto dest_data = simd::load<uint32_t>(dest_block + k);
+                    simd::store((src_data & src_mask) | (dest_data & dest_mask), dest_block + k);
+                }
             }
+        }
+    }
 
-            //Coordinates wrap at 2048 pixels
-            TRXPOS.int_source_x %= 2048;
-            TRXPOS.int_source_y %= 2048;
-            TRXPOS.int_dest_x %= 2048;
-            TRXPOS.int_dest_y %= 2048;
+    //Copies a transfer one row at a time, converting each row between formats in bulk.
+    //Only used when the source and destination don't overlap, so the transfer order doesn't matter.
+    void GraphicsSynthesizerThread::local_to_local_rows()
+    {
+        //Padded to a multiple of the vector width so the tail can be processed in bulk
+        alignas(32) uint32_t row[2048 + 8];
+        alignas(32) uint32_t old_row[2048 + 8];
+        uint32_t dest_addr[2048 + 8];
+
+        const uint32_t sbase = BITBLTBUF.source_base, swidth = BITBLTBUF.source_width;
+        const uint32_t dbase = BITBLTBUF.dest_base, dwidth = BITBLTBUF.dest_width;
+        const int width = TRXREG.width;
+        const int vec_width = (width + 7) & ~7;
+
+        //Destinations stored in a 32-bit layout are merged with the existing pixel:
+        //dest = ((data << shift) & data_mask) | (old & keep_mask)
+        bool merge_32bit = true;
+        bool z_layout = false;
+        int shift = 0;
+        uint32_t data_mask = 0xFFFFFFFF, keep_mask = 0;
+        switch (BITBLTBUF.dest_format)
+        {
+            case 0x00:
+                break;
+            case 0x01:
+                data_mask = 0x00FFFFFF;
+                keep_mask = 0xFF000000;
+                break;
+            case 0x1B:
+                shift = 24;
+                keep_mask = 0x00FFFFFF;
+                break;
+            case 0x24:
+                shift = 24;
+                keep_mask = 0xF0FFFFFF;
+                break;
+            case 0x2C:
+                shift = 28;
+                keep_mask = 0x0FFFFFFF;
+                break;
+            case 0x30:
+                z_layout = true;
+                break;
+            case 0x31:
+                z_layout = true;
+                data_mask = 0x00FFFFFF;
+                keep_mask = 0xFF000000;
+                break;
+            default:
+                merge_32bit = false;
+                break;
+        }
+
+        //The source format is picked once per transfer, and each reader gets its own copy of the row loop
+        auto copy_rows = [&](auto read_pixel)
+        {
+            for (int y = 0; y < TRXREG.height; y++)
+            {
+                uint32_t src_y = TRXPOS.source_y + y;
+                uint32_t dest_y = TRXPOS.dest_y + y;
+
+                for (int x = 0; x < width; x++)
+                    row[x] = read_pixel(TRXPOS.source_x + x, src_y);
+
+                if (merge_32bit)
+                {
+                    for (int x = 0; x < width; x++)
+                    {
+                        uint32_t dest_x = TRXPOS.dest_x + x;
+                        if (z_layout)
+                            dest_addr[x] = addr_PSMCT32Z(dbase / 256, dwidth / 64, dest_x, dest_y);
+                        else
+                            dest_addr[x] = addr_PSMCT32(dbase / 256, dwidth / 64, dest_x, dest_y);
+                        old_row[x] = *(uint32_t*)&local_mem[dest_addr[x]];
+                    }
+
+                    auto vdata_mask = simd::fill<uint32_t>(data_mask);
+                    auto vkeep_mask = simd::fill<uint32_t>(keep_mask);
+                    for (int x = 0; x < vec_width; x += 8)
+                    {
+                        auto data = simd::load<uint32_t>(&row[x]);
+                        auto old = simd::load<uint32_t>(&old_row[x]);
+                        data = ((data << (uint32_t)shift) & vdata_mask) | (old & vkeep_mask);
+                        simd::store(data, &row[x]);
+                    }
+
+                    for (int x = 0; x < width; x++)
+                        *(uint32_t*)&local_mem[dest_addr[x]] = row[x];
+                    continue;
+                }
+
+                for (int x = 0; x < width; x++)
+                {
+                    uint32_t dest_x = TRXPOS.dest_x + x;
+                    switch (BITBLTBUF.dest_format)
+                    {
+                        case 0x02:
+                            write_PSMCT16_block(dbase, dwidth, dest_x, dest_y, row[x]);
+                            break;
+                        case 0x0A:
+                            write_PSMCT16S_block(dbase, dwidth, dest_x, dest_y, row[x]);
+                            break;
+                        case 0x13:
+                            write_PSMCT8_block(dbase, dwidth, dest_x, dest_y, row[x]);
+                            break;
+                        case 0x14:
+                            write_PSMCT4_block(dbase, dwidth, dest_x, dest_y, row[x]);
+                            break;
+                        case 0x3A:
+                            write_PSMCT16SZ_block(dbase, dwidth, dest_x, dest_y, row[x]);
+                            break;
+                        default:
+                            Errors::die("[GS_t] Unrecognized local-to-local dest format $%02X", BITBLTBUF.dest_format);
+                    }
+                }
+            }
+        };
+
+        switch (BITBLTBUF.source_format)
+        {
+            case 0x00:
+            case 0x01:
+                copy_rows([&](uint32_t x, uint32_t y) -> uint32_t { return read_PSMCT32_block(sbase, swidth, x, y); });
+                break;
+            case 0x02:
+                copy_rows([&](uint32_t x, uint32_t y) -> uint32_t { return read_PSMCT16_block(sbase, swidth, x, y); });
+                break;
+            case 0x0A:
+                copy_rows([&](uint32_t x, uint32_t y) -> uint32_t { return read_PSMCT16S_block(sbase, swidth, x, y); });
+                break;
+            case 0x13:
+                copy_rows([&](uint32_t x, uint32_t y) -> uint32_t { return read_PSMCT8_block(sbase, swidth, x, y); });
+                break;
+            case 0x14:
+                copy_rows([&](uint32_t x, uint32_t y) -> uint32_t { return read_PSMCT4_block(sbase, swidth, x, y); });
+                break;
+            case 0x1B:
+                copy_rows([&](uint32_t x, uint32_t y) -> uint32_t { return read_PSMCT32_block(sbase, swidth, x, y) >> 24; });
+                break;
+            case 0x2C:
+                copy_rows([&](uint32_t x, uint32_t y) -> uint32_t { return read_PSMCT32_block(sbase, swidth, x, y) >> 28; });
+                break;
+            case 0x30:
+            case 0x31:
+                copy_rows([&](uint32_t x, uint32_t y) -> uint32_t { return read_PSMCT32Z_block(sbase, swidth, x, y); });
+                break;
         }
-        pixels_transferred = 0;
-        TRXDIR = 3;
     }
 
     uint8_t GraphicsSynthesizerThread::get_16bit_alpha(uint16_t color)
@@ -3651,32 +5783,7 @@ namespace gs
         }
 
         if (bilinear_filter)
-        {
-            RGBAQ_REG a, b, c, d;
-            int16_t uu = (u - 8) >> 4;
-            int16_t vv = (v - 8) >> 4;
-
-            tex_lookup_int(uu, vv, info, true);
-            a = info.srctex_color;
-
-            tex_lookup_int(uu + 1, vv, info, true);
-            b = info.srctex_color;
-
-            tex_lookup_int(uu, vv + 1, info, true);
-            c = info.srctex_color;
-
-            tex_lookup_int(uu + 1, vv + 1, info, true);
-            d = info.srctex_color;
-
-            double alpha = (double)((u - 8) & 0xF) * (1.0 / 16.0);
-            double beta = (double)((v - 8) & 0xF) * (1.0 / 16.0);
-            double alpha_s = 1.0 - alpha;
-            double beta_s = 1.0 - beta;
-            info.srctex_color.r = alpha_s * beta_s*a.r + alpha * beta_s*b.r + alpha_s * beta*c.r + alpha * beta*d.r;
-            info.srctex_color.g = alpha_s * beta_s*a.g + alpha * beta_s*b.g + alpha_s * beta*c.g + alpha * beta*d.g;
-            info.srctex_color.b = alpha_s * beta_s*a.b + alpha * beta_s*b.b + alpha_s * beta*c.b + alpha * beta*d.b;
-            info.srctex_color.a = alpha_s * beta_s*a.a + alpha * beta_s*b.a + alpha_s * beta*c.a + alpha * beta*d.a;
-        }
+            tex_lookup_bilinear(u, v, info);
         else //If we already have looked up the texture at this location and messed with it, no point in doing it again
             tex_lookup_int(u >> 4, v >> 4, info);
 
@@ -3733,6 +5840,78 @@ namespace gs
     }
 
     void GraphicsSynthesizerThread::tex_lookup_int(int16_t u, int16_t v, TexLookupInfo& info, bool forced_lookup)
+    {
+        u = wrap_tex_u(u, info);
+        v = wrap_tex_v(v, info);
+
+        if (!info.new_lookup && !forced_lookup)
+        {
+            //if it's the same texture position, we already have the info, no need to look it up again
+            if (u == info.lastu && v == info.lastv)
+                return;
+        }
+        info.lastu = u;
+        info.lastv = v;
+        info.new_lookup = forced_lookup;
+
+        fetch_texel(u, v, info, info.srctex_color);
+    }
+
+    //Blends the 2x2 texels around (u, v) in 8.8 fixed point. The weights are multiples of 1/16 that sum to 1,
+    //so this is exact - every channel of all four texels is scaled in one vector and the sums shifted down.
+    void GraphicsSynthesizerThread::tex_lookup_bilinear(int16_t u, int16_t v, TexLookupInfo& info)
+    {
+        int16_t uu = (u - 8) >> 4;
+        int16_t vv = (v - 8) >> 4;
+        uint16_t alpha = (u - 8) & 0xF;
+        uint16_t beta = (v - 8) & 0xF;
+
+        //Each texel's neighbours share its wrapped rows and columns
+        int16_t u0 = wrap_tex_u(uu, info);
+        int16_t u1 = wrap_tex_u(uu + 1, info);
+        int16_t v0 = wrap_tex_v(vv, info);
+        int16_t v1 = wrap_tex_v(vv + 1, info);
+
+        RGBAQ_REG texels[4];
+        fetch_texel(u0, v0, info, texels[0]);
+        fetch_texel(u1, v0, info, texels[1]);
+        fetch_texel(u0, v1, info, texels[2]);
+        fetch_texel(u1, v1, info, texels[3]);
+
+        const uint16_t weights[4] =
+        {
+            (uint16_t)((16 - alpha) * (16 - beta)), (uint16_t)(alpha * (16 - beta)),
+            (uint16_t)((16 - alpha) * beta), (uint16_t)(alpha * beta)
+        };
+
+        //Lanes hold r, g, b, a of each texel in turn. No product or sum can exceed 255 * 256.
+        alignas(32) uint16_t channels[16];
+        alignas(32) uint16_t lane_weights[16];
+        for (int i = 0; i < 4; i++)
+        {
+            channels[i * 4 + 0] = texels[i].r;
+            channels[i * 4 + 1] = texels[i].g;
+            channels[i * 4 + 2] = texels[i].b;
+            channels[i * 4 + 3] = texels[i].a;
+            for (int j = 0; j < 4; j++)
+                lane_weights[i * 4 + j] = weights[i];
+        }
+
+        auto products = simd::load<uint16_t>(channels) * simd::load<uint16_t>(lane_weights);
+        simd::store(products, channels);
+
+        info.srctex_color.r = (channels[0] + channels[4] + channels[8] + channels[12]) >> 8;
+        info.srctex_color.g = (channels[1] + channels[5] + channels[9] + channels[13]) >> 8;
+        info.srctex_color.b = (channels[2] + channels[6] + channels[10] + channels[14]) >> 8;
+        info.srctex_color.a = (channels[3] + channels[7] + channels[11] + channels[15]) >> 8;
+
+        //The source color no longer belongs to a single texel, so the next point lookup can't reuse it
+        info.lastu = u1;
+        info.lastv = v1;
+        info.new_lookup = true;
+    }
+
+    int16_t GraphicsSynthesizerThread::wrap_tex_u(int16_t u, const TexLookupInfo& info)
     {
         switch (current_ctx->clamp.wrap_s)
         {
@@ -3756,6 +5935,11 @@ namespace gs
                 u = (u & (current_ctx->clamp.min_u >> info.mipmap_level)) | (current_ctx->clamp.max_u >> info.mipmap_level);
                 break;
         }
+        return u;
+    }
+
+    int16_t GraphicsSynthesizerThread::wrap_tex_v(int16_t v, const TexLookupInfo& info)
+    {
         switch (current_ctx->clamp.wrap_t)
         {
             case 0:
@@ -3777,151 +5961,130 @@ namespace gs
                 v = (v & (current_ctx->clamp.min_v >> info.mipmap_level)) | (current_ctx->clamp.max_v >> info.mipmap_level);
                 break;
         }
+        return v;
+    }
 
-        if (!info.new_lookup && !forced_lookup)
-        {
-            //if it's the same texture position, we already have the info, no need to look it up again
-            if (u == info.lastu && v == info.lastv)
-                return;
-        }
-        info.lastu = u;
-        info.lastv = v;
-        info.new_lookup = forced_lookup; //If we're forcing a lookup, it's bilinear filtering, so the src will get polluted
-
+    void GraphicsSynthesizerThread::fetch_texel(int16_t u, int16_t v, const TexLookupInfo& info, RGBAQ_REG& color)
+    {
         uint32_t tex_base = info.tex_base;
         uint32_t width = info.buffer_width;
         switch (current_ctx->tex0.format)
         {
             case 0x00:
             {
-                uint32_t color = read_PSMCT32_block(tex_base, width, u, v);
-                info.srctex_color.r = color & 0xFF;
-                info.srctex_color.g = (color >> 8) & 0xFF;
-                info.srctex_color.b = (color >> 16) & 0xFF;
-                info.srctex_color.a = color >> 24;
+                uint32_t texel = read_PSMCT32_block(tex_base, width, u, v);
+                color.r = texel & 0xFF;
+                color.g = (texel >> 8) & 0xFF;
+                color.b = (texel >> 16) & 0xFF;
+                color.a = texel >> 24;
             }
                 break;
             case 0x01:
             {
-                uint32_t color = read_PSMCT32_block(tex_base, width, u, v);
-                info.srctex_color.r = color & 0xFF;
-                info.srctex_color.g = (color >> 8) & 0xFF;
-                info.srctex_color.b = (color >> 16) & 0xFF;
+                uint32_t texel = read_PSMCT32_block(tex_base, width, u, v);
+                color.r = texel & 0xFF;
+                color.g = (texel >> 8) & 0xFF;
+                color.b = (texel >> 16) & 0xFF;
 
-                if (!(color & 0xFFFFFF) && TEXA.trans_black)
-                    info.srctex_color.a = 0;
+                if (!(texel & 0xFFFFFF) && TEXA.trans_black)
+                    color.a = 0;
                 else
-                    info.srctex_color.a = TEXA.alpha0;
+                    color.a = TEXA.alpha0;
             }
                 break;
             case 0x02:
             {
-                uint16_t color = read_PSMCT16_block(tex_base, width, u, v);
-                info.srctex_color.r = (color & 0x1F) << 3;
-                info.srctex_color.g = ((color >> 5) & 0x1F) << 3;
-                info.srctex_color.b = ((color >> 10) & 0x1F) << 3;
-                info.srctex_color.a = get_16bit_alpha(color);
+                uint16_t texel = read_PSMCT16_block(tex_base, width, u, v);
+                color.r = (texel & 0x1F) << 3;
+                color.g = ((texel >> 5) & 0x1F) << 3;
+                color.b = ((texel >> 10) & 0x1F) << 3;
+                color.a = get_16bit_alpha(texel);
             }
                 break;
             case 0x09: //Invalid format??? FFX uses it
-                info.srctex_color.r = 0;
-                info.srctex_color.g = 0;
-                info.srctex_color.b = 0;
-                info.srctex_color.a = 0;
+                color.r = 0;
+                color.g = 0;
+                color.b = 0;
+                color.a = 0;
                 break;
             case 0x0A:
             {
-                uint16_t color = read_PSMCT16S_block(tex_base, width, u, v);
-                info.srctex_color.r = (color & 0x1F) << 3;
-                info.srctex_color.g = ((color >> 5) & 0x1F) << 3;
-                info.srctex_color.b = ((color >> 10) & 0x1F) << 3;
-                info.srctex_color.a = get_16bit_alpha(color);
+                uint16_t texel = read_PSMCT16S_block(tex_base, width, u, v);
+                color.r = (texel & 0x1F) << 3;
+                color.g = ((texel >> 5) & 0x1F) << 3;
+                color.b = ((texel >> 10) & 0x1F) << 3;
+                color.a = get_16bit_alpha(texel);
             }
                 break;
             case 0x13:
             {
                 uint8_t entry = read_PSMCT8_block(tex_base, width, u, v);
-                if (current_ctx->tex0.use_CSM2)
-                    clut_CSM2_lookup(entry, info.srctex_color);
-                else
-                    clut_lookup(entry, info.srctex_color);
+                clut_lookup(entry, color);
             }
                 break;
             case 0x14:
             {
                 uint8_t entry = read_PSMCT4_block(tex_base, width, u, v);
-                if (current_ctx->tex0.use_CSM2)
-                    clut_CSM2_lookup(entry, info.srctex_color);
-                else
-                    clut_lookup(entry, info.srctex_color);
+                clut_lookup(entry, color);
             }
                 break;
             case 0x1B:
             {
                 uint8_t entry = read_PSMCT32_block(tex_base, width, u, v) >> 24;
-                if (current_ctx->tex0.use_CSM2)
-                    clut_CSM2_lookup(entry, info.srctex_color);
-                else
-                    clut_lookup(entry, info.srctex_color);
+                clut_lookup(entry, color);
             }
                 break;
             case 0x24:
             {
                 //printf("[GS_t] Format $24: Read from $%08X\n", tex_base + (coord << 2));
                 uint8_t entry = (read_PSMCT32_block(tex_base, width, u, v) >> 24) & 0xF;
-                if (current_ctx->tex0.use_CSM2)
-                    clut_CSM2_lookup(entry, info.srctex_color);
-                else
-                    clut_lookup(entry, info.srctex_color);
+                clut_lookup(entry, color);
                 break;
             }
                 break;
             case 0x2C:
             {
                 uint8_t entry = read_PSMCT32_block(tex_base, width, u, v) >> 28;
-                if (current_ctx->tex0.use_CSM2)
-                    clut_CSM2_lookup(entry, info.srctex_color);
-                else
-                    clut_lookup(entry, info.srctex_color);
+                clut_lookup(entry, color);
             }
                 break;
             case 0x30:
             {
-                uint32_t color = read_PSMCT32Z_block(tex_base, width, u, v);
-                info.srctex_color.r = color & 0xFF;
-                info.srctex_color.g = (color >> 8) & 0xFF;
-                info.srctex_color.b = (color >> 16) & 0xFF;
-                info.srctex_color.a = color >> 24;
+                uint32_t texel = read_PSMCT32Z_block(tex_base, width, u, v);
+                color.r = texel & 0xFF;
+                color.g = (texel >> 8) & 0xFF;
+                color.b = (texel >> 16) & 0xFF;
+                color.a = texel >> 24;
             }
                 break;
             case 0x31:
             {
-                uint32_t color = read_PSMCT32Z_block(tex_base, width, u, v);
-                info.srctex_color.r = color & 0xFF;
-                info.srctex_color.g = (color >> 8) & 0xFF;
-                info.srctex_color.b = (color >> 16) & 0xFF;
-                if (!(color & 0xFFFFFF) && TEXA.trans_black)
-                    info.srctex_color.a = 0;
+                uint32_t texel = read_PSMCT32Z_block(tex_base, width, u, v);
+                color.r = texel & 0xFF;
+                color.g = (texel >> 8) & 0xFF;
+                color.b = (texel >> 16) & 0xFF;
+                if (!(texel & 0xFFFFFF) && TEXA.trans_black)
+                    color.a = 0;
                 else
-                    info.srctex_color.a = TEXA.alpha0;
+                    color.a = TEXA.alpha0;
             }
                 break;
             case 0x32:
             {
-                uint16_t color = read_PSMCT16Z_block(tex_base, width, u, v);
-                info.srctex_color.r = (color & 0x1F) << 3;
-                info.srctex_color.g = ((color >> 5) & 0x1F) << 3;
-                info.srctex_color.b = ((color >> 10) & 0x1F) << 3;
-                info.srctex_color.a = get_16bit_alpha(color);
+                uint16_t texel = read_PSMCT16Z_block(tex_base, width, u, v);
+                color.r = (texel & 0x1F) << 3;
+                color.g = ((texel >> 5) & 0x1F) << 3;
+                color.b = ((texel >> 10) & 0x1F) << 3;
+                color.a = get_16bit_alpha(texel);
             }
                 break;
             case 0x3A:
             {
-                uint16_t color = read_PSMCT16SZ_block(tex_base, width, u, v);
-                info.srctex_color.r = (color & 0x1F) << 3;
-                info.srctex_color.g = ((color >> 5) & 0x1F) << 3;
-                info.srctex_color.b = ((color >> 10) & 0x1F) << 3;
-                info.srctex_color.a = get_16bit_alpha(color);
+                uint16_t texel = read_PSMCT16SZ_block(tex_base, width, u, v);
+                color.r = (texel & 0x1F) << 3;
+                color.g = ((texel >> 5) & 0x1F) << 3;
+                color.b = ((texel >> 10) & 0x1F) << 3;
+                color.a = get_16bit_alpha(texel);
             }
                 break;
             default:
@@ -3972,45 +6135,11 @@ namespace gs
 
     void GraphicsSynthesizerThread::clut_lookup(uint8_t entry, RGBAQ_REG &tex_color)
     {
-        uint32_t clut_addr = current_ctx->tex0.CLUT_offset;
-
-        switch (current_ctx->tex0.CLUT_format)
-        {
-            //PSMCT32
-            case 0x00:
-            case 0x01:
-            {
-                uint32_t color = *(uint32_t*)&clut_cache[(clut_addr + (entry << 2)) & 0x3FF];
-                tex_color.r = color & 0xFF;
-                tex_color.g = (color >> 8) & 0xFF;
-                tex_color.b = (color >> 16) & 0xFF;
-                tex_color.a = color >> 24;
-            }
-                break;
-            //PSMCT16
-            case 0x02:
-            //PSMCT16S
-            case 0x0A:
-            {
-                uint16_t color = *(uint16_t*)&clut_cache[(clut_addr + (entry << 1)) & 0x3FF];
-                tex_color.r = (color & 0x1F) << 3;
-                tex_color.g = ((color >> 5) & 0x1F) << 3;
-                tex_color.b = ((color >> 10) & 0x1F) << 3;
-                tex_color.a = get_16bit_alpha(color);
-            }
-                break;
-            default:
-                Errors::die("[GS_t] Unrecognized CLUT format $%02X\n", current_ctx->tex0.CLUT_format);
-        }
-    }
-
-    void GraphicsSynthesizerThread::clut_CSM2_lookup(uint8_t entry, RGBAQ_REG &tex_color)
-    {
-        uint16_t color = *(uint16_t*)&clut_cache[entry << 1];
-        tex_color.r = (color & 0x1F) << 3;
-        tex_color.g = ((color >> 5) & 0x1F) << 3;
-        tex_color.b = ((color >> 10) & 0x1F) << 3;
-        tex_color.a = get_16bit_alpha(color);
+        uint32_t color = clut_rgba[entry];
+        tex_color.r = color & 0xFF;
+        tex_color.g = (color >> 8) & 0xFF;
+        tex_color.b = (color >> 16) & 0xFF;
+        tex_color.a = color >> 24;
     }
 
     void GraphicsSynthesizerThread::reload_clut(GSContext& context)
@@ -4066,7 +6195,34 @@ namespace gs
 
         if (reload)
         {
+            if (context.tex0.use_CSM2)
+                mark_sampled_pages(&layout_PSMCT16, current_ctx->tex0.CLUT_base, TEXCLUT.width,
+                                   TEXCLUT.x, TEXCLUT.y, TEXCLUT.x + 256, TEXCLUT.y + 1);
+            else
+                mark_sampled_pages(get_PSM_layout(context.tex0.CLUT_format), clut_addr, 64, 0, 0, 16, 16);
+
+            //Everything the entries loaded depend on besides local memory
+            uint64_t key = context.tex0.CLUT_offset;
+            key |= (uint64_t)context.tex0.CLUT_format << 10;
+            key |= (uint64_t)context.tex0.use_CSM2 << 14;
+            key |= (uint64_t)eight_bit << 15;
+            if (context.tex0.use_CSM2)
+            {
+                key |= (uint64_t)current_ctx->tex0.CLUT_base << 16;
+                key |= (uint64_t)(TEXCLUT.width / 64) << 38;
+                key |= (uint64_t)(TEXCLUT.x / 16) << 44;
+                key |= (uint64_t)TEXCLUT.y << 50;
+            }
+            else
+                key |= (uint64_t)clut_addr << 16;
+
+            //The destination of a host to local transfer that's still going can change after the load
+            bool cacheable = TRXDIR != 0;
+            if (cacheable && load_cached_clut(key))
+                return;
+
             printf("[GS_t] Reloading CLUT cache!\n");
+            frame_stats.clut_reloads++;
 
             uint32_t cache_addr = context.tex0.CLUT_offset;
             uint32_t offset = (context.tex0.CLUT_offset / (context.tex0.CLUT_format ? 2 : 4));
@@ -4074,6 +6230,7 @@ namespace gs
             uint32_t max_entries = (context.tex0.CLUT_format < 0x2 ? 256 : 512);
 
             max_entries = std::min(max_entries, offset + entries);
+            uint32_t size = 0;
 
             for (uint32_t i = offset; i < max_entries; i++)
             {
@@ -4083,6 +6240,7 @@ namespace gs
                                                         TEXCLUT.x + (i & (entries-1)), TEXCLUT.y);
                     *(uint16_t*)&clut_cache[cache_addr] = value;
                     cache_addr = (cache_addr + 2) & 0x3FF;
+                    size += 2;
                 }
                 else
                 {
@@ -4112,6 +6270,7 @@ namespace gs
                             //printf("[GS_t] Reload cache $%04X: $%08X\n", cache_addr, value);
                         }
                             cache_addr += 4;
+                            size += 4;
                             break;
                         case 0x02:
                         {
@@ -4119,6 +6278,7 @@ namespace gs
                             *(uint16_t*)&clut_cache[cache_addr] = value;
                         }
                             cache_addr += 2;
+                            size += 2;
                             break;
                         case 0x0A:
                         {
@@ -4126,13 +6286,143 @@ namespace gs
                             *(uint16_t*)&clut_cache[cache_addr] = value;
                         }
                             cache_addr += 2;
+                            size += 2;
                             break;
                     }
                 }
 
                 cache_addr &= 0x3FF;
             }
+
+            clut_rgba_valid = false;
+            clut_palette_loaded = -1;
+            if (cacheable)
+            {
+                uint32_t first, last;
+                if (context.tex0.use_CSM2)
+                    get_page_range(&layout_PSMCT16, current_ctx->tex0.CLUT_base, TEXCLUT.width,
+                                   TEXCLUT.x, TEXCLUT.y, TEXCLUT.x + 256, TEXCLUT.y + 1, first, last);
+                else
+                    get_page_range(get_PSM_layout(context.tex0.CLUT_format), clut_addr, 64, 0, 0, 16, 16, first, last);
+
+                store_clut_palette(key, first, last, context.tex0.CLUT_offset, size);
+            }
+        }
+    }
+
+    //Copies the entries of a cached palette back into the CLUT buffer.
+    //Returns false if the palette has to be read from local memory.
+    bool GraphicsSynthesizerThread::load_cached_clut(uint64_t key)
+    {
+        for (int i = 0; i < 16; i++)
+        {
+            ClutPalette& palette = clut_palettes[i];
+            if (!palette.valid || palette.key != key)
+                continue;
+
+            //Nothing has touched the CLUT buffer since this palette was last loaded
+            if (i == clut_palette_loaded)
+                return true;
+
+            uint32_t first_part = std::min(palette.size, 1024 - palette.offset);
+            memcpy(&clut_cache[palette.offset], palette.entries, first_part);
+            memcpy(clut_cache, &palette.entries[first_part], palette.size - first_part);
+            clut_rgba_valid = false;
+            clut_palette_loaded = i;
+            return true;
+        }
+        return false;
+    }
+
+    void GraphicsSynthesizerThread::store_clut_palette(uint64_t key, uint32_t first_page, uint32_t last_page,
+                                                       uint32_t offset, uint32_t size)
+    {
+        ClutPalette& palette = clut_palettes[clut_palette_next];
+        palette.valid = true;
+        palette.key = key;
+        palette.first_page = first_page;
+        palette.last_page = last_page;
+        palette.offset = offset;
+        palette.size = size;
+
+        uint32_t first_part = std::min(size, 1024 - offset);
+        memcpy(palette.entries, &clut_cache[offset], first_part);
+        memcpy(&palette.entries[first_part], clut_cache, size - first_part);
+
+        clut_palette_loaded = clut_palette_next;
+        clut_palette_next = (clut_palette_next + 1) % 16;
+    }
+
+    void GraphicsSynthesizerThread::reset_clut_palettes()
+    {
+        for (ClutPalette& palette : clut_palettes)
+            palette.valid = false;
+        clut_palette_next = 0;
+        clut_palette_loaded = -1;
+    }
+
+    //Drops the cached palettes a write to the given pages can touch the pages of
+    void GraphicsSynthesizerThread::invalidate_clut_palettes(uint32_t first_page, uint32_t last_page)
+    {
+        for (ClutPalette& palette : clut_palettes)
+        {
+            if (palette.valid && first_page <= palette.last_page && palette.first_page <= last_page)
+                palette.valid = false;
+        }
+    }
+
+    //Expands the part of the CLUT buffer the current context looks up into 32-bit colors,
+    //so that CLUT texel lookups are a single load whatever the CLUT format
+    void GraphicsSynthesizerThread::update_clut_rgba()
+    {
+        TEX0& tex0 = current_ctx->tex0;
+        uint64_t key = tex0.CLUT_offset;
+        key |= (uint64_t)tex0.CLUT_format << 10;
+        key |= (uint64_t)tex0.use_CSM2 << 14;
+        key |= (uint64_t)TEXA.alpha0 << 16;
+        key |= (uint64_t)TEXA.alpha1 << 24;
+        key |= (uint64_t)TEXA.trans_black << 32;
+
+        if (clut_rgba_valid && clut_rgba_key == key)
+            return;
+
+        if (tex0.use_CSM2)
+        {
+            for (int i = 0; i < 256; i++)
+            {
+                uint16_t color = *(uint16_t*)&clut_cache[i << 1];
+                clut_rgba[i] = ((color & 0x1F) << 3) | ((color & (0x1F << 5)) << 6) |
+                               ((color & (0x1F << 10)) << 9) | ((uint32_t)get_16bit_alpha(color) << 24);
+            }
+        }
+        else
+        {
+            switch (tex0.CLUT_format)
+            {
+                //PSMCT32
+                case 0x00:
+                case 0x01:
+                    for (int i = 0; i < 256; i++)
+                        clut_rgba[i] = *(uint32_t*)&clut_cache[(tex0.CLUT_offset + (i << 2)) & 0x3FF];
+                    break;
+                //PSMCT16
+                case 0x02:
+                //PSMCT16S
+                case 0x0A:
+                    for (int i = 0; i < 256; i++)
+                    {
+                        uint16_t color = *(uint16_t*)&clut_cache[(tex0.CLUT_offset + (i << 1)) & 0x3FF];
+                        clut_rgba[i] = ((color & 0x1F) << 3) | ((color & (0x1F << 5)) << 6) |
+                                       ((color & (0x1F << 10)) << 9) | ((uint32_t)get_16bit_alpha(color) << 24);
+                    }
+                    break;
+                default:
+                    Errors::die("[GS_t] Unrecognized CLUT format $%02X\n", tex0.CLUT_format);
+            }
         }
+
+        clut_rgba_key = key;
+        clut_rgba_valid = true;
     }
 
     void GraphicsSynthesizerThread::update_draw_pixel_state()
@@ -4154,7 +6444,6 @@ namespace gs
         draw_pixel_state |= (uint64_t)current_ctx->alpha.spec_B << 29UL;
         draw_pixel_state |= (uint64_t)current_ctx->alpha.spec_C << 31UL;
         draw_pixel_state |= (uint64_t)current_ctx->alpha.spec_D << 33UL;
-        draw_pixel_state |= (uint64_t)DTHE << 34UL;
         draw_pixel_state |= (uint64_t)COLCLAMP << 35UL;
         draw_pixel_state |= (uint64_t)current_ctx->zbuf.format << 36UL;
         draw_pixel_state |= (uint64_t)SCANMSK << 42UL;
@@ -4164,6 +6453,9 @@ namespace gs
         draw_pixel_state |= (uint64_t)(current_ctx == &context1) << 54UL;
         draw_pixel_state |= (uint64_t)(current_ctx->frame.mask != 0) << 55UL;
         draw_pixel_state |= (uint64_t)(current_ctx->FBA) << 56UL;
+        draw_pixel_state |= (uint64_t)DTHE << 57UL;
+        if (pixel_stats)
+            draw_pixel_state |= DRAW_PIXEL_STATS_BIT;
     }
 
     void GraphicsSynthesizerThread::update_tex_lookup_state()
@@ -4186,6 +6478,8 @@ namespace gs
         tex_lookup_state |= (uint64_t)current_ctx->tex0.color_function << 39UL;
         tex_lookup_state |= (uint64_t)current_ctx->tex0.use_alpha << 41UL;
         tex_lookup_state |= (uint64_t)current_PRMODE->fog << 42UL;
+        if (pixel_stats)
+            tex_lookup_state |= TEX_LOOKUP_STATS_BIT;
     }
 
     uint8_t* GraphicsSynthesizerThread::get_jitted_draw_pixel(uint64_t state)
@@ -4195,6 +6489,8 @@ namespace gs
         {
             printf("[GS_t] RECOMPILING DRAW PIXEL %llX\n", state);
             found_block = recompile_draw_pixel(state);
+            record_jit_pipeline(JIT_DRAW_PIXEL, state);
+            frame_stats.jit_compiles++;
         }
         return (uint8_t*)found_block->code_start;
     }
@@ -4206,10 +6502,213 @@ namespace gs
         {
             printf("[GS_t] RECOMPILING TEX LOOKUP %llX\n", state);
             found_block = recompile_tex_lookup(state);
+            record_jit_pipeline(JIT_TEX_LOOKUP, state);
+            frame_stats.jit_compiles++;
         }
         return (uint8_t*)found_block->code_start;
     }
 
+    //Sets the registers a draw pixel key is built from. Returns false if the key doesn't round-trip.
+    bool GraphicsSynthesizerThread::decode_draw_pixel_state(uint64_t state)
+    {
+        current_PRMODE = (state & (1ULL << 53)) ? &PRIM : &PRMODE;
+        current_ctx = (state & (1ULL << 54)) ? &context1 : &context2;
+
+        current_ctx->test.alpha_ref = state & 0xFF;
+        current_ctx->test.alpha_test = (state >> 8) & 0x1;
+        current_ctx->test.alpha_method = (state >> 9) & 0x7;
+        current_ctx->test.alpha_fail_method = (state >> 12) & 0x3;
+        current_ctx->test.depth_test = (state >> 14) & 0x1;
+        current_ctx->test.depth_method = (state >> 15) & 0x3;
+        current_ctx->test.dest_alpha_test = (state >> 17) & 0x1;
+        current_ctx->test.dest_alpha_method = (state >> 18) & 0x1;
+        current_ctx->frame.format = (state >> 19) & 0x3F;
+        current_PRMODE->alpha_blend = (state >> 25) & 0x1;
+        PABE = (state >> 26) & 0x1;
+        current_ctx->alpha.spec_A = (state >> 27) & 0x3;
+        current_ctx->alpha.spec_B = (state >> 29) & 0x3;
+        current_ctx->alpha.spec_C = (state >> 31) & 0x3;
+        current_ctx->alpha.spec_D = (state >> 33) & 0x3;
+        COLCLAMP = (state >> 35) & 0x1;
+        current_ctx->zbuf.format = (state >> 36) & 0x3F;
+        SCANMSK = (state >> 42) & 0x3;
+        current_ctx->zbuf.no_update = (state >> 44) & 0x1;
+        current_ctx->alpha.fixed_alpha = (state >> 45) & 0xFF;
+        current_ctx->frame.mask = (state & (1ULL << 55)) ? 0xFFFFFFFF : 0;
+        current_ctx->FBA = (state >> 56) & 0x1;
+        DTHE = (state >> 57) & 0x1;
+
+        update_draw_pixel_state();
+        return draw_pixel_state == state;
+    }
+
+    bool GraphicsSynthesizerThread::decode_tex_lookup_state(uint64_t state)
+    {
+        current_PRMODE = (state & 0x1) ? &PRIM : &PRMODE;
+        current_ctx = (state & (1ULL << 38)) ? &context1 : &context2;
+
+        current_PRMODE->use_UV = (state >> 1) & 0x1;
+        current_ctx->tex1.filter_larger = (state >> 2) & 0x1;
+        current_ctx->tex1.filter_smaller = (state >> 3) & 0x7;
+        current_ctx->clamp.wrap_s = (state >> 6) & 0x3;
+        current_ctx->clamp.wrap_t = (state >> 8) & 0x3;
+        current_ctx->tex0.format = (state >> 10) & 0x3F;
+        TEXA.alpha0 = (state >> 16) & 0xFF;
+        TEXA.alpha1 = (state >> 24) & 0xFF;
+        TEXA.trans_black = (state >> 32) & 0x1;
+        current_ctx->tex0.use_CSM2 = (state >> 33) & 0x1;
+        current_ctx->tex0.CLUT_format = (state >> 34) & 0xF;
+        current_ctx->tex0.color_function = (state >> 39) & 0x3;
+        current_ctx->tex0.use_alpha = (state >> 41) & 0x1;
+        current_PRMODE->fog = (state >> 42) & 0x1;
+
+        update_tex_lookup_state();
+        return tex_lookup_state == state;
+    }
+
+    //Warm-up lists start with this header. Bump the version whenever the layout of a pipeline key changes.
+    static const char JIT_WARMUP_MAGIC[8] = { 'D', 'S', 'G', 'S', 'J', 'I', 'T', '\0' };
+    constexpr static uint32_t JIT_WARMUP_VERSION = 1;
+
+    void GraphicsSynthesizerThread::load_jit_warmup(const char* serial)
+    {
+        jit_warmup_file.close();
+        jit_warmup_queue.clear();
+        jit_warmup_pos = 0;
+        jit_warmup_known[JIT_DRAW_PIXEL].clear();
+        jit_warmup_known[JIT_TEX_LOOKUP].clear();
+
+        if (!serial[0])
+            return;
+
+        std::string name = "gs_jit_";
+        for (size_t i = 0; i < sizeof(GSMessagePayload::jit_warmup_payload.serial) && serial[i]; i++)
+            name += isalnum((unsigned char)serial[i]) ? serial[i] : '_';
+        name += ".bin";
+
+        std::ifstream list(name, std::ios::binary);
+        if (list.is_open())
+        {
+            char magic[sizeof(JIT_WARMUP_MAGIC)];
+            uint32_t version;
+            list.read(magic, sizeof(magic));
+            list.read((char*)&version, sizeof(version));
+
+            //Lists from builds with a different key layout are dropped
+            if (list && !memcmp(magic, JIT_WARMUP_MAGIC, sizeof(magic)) && version == JIT_WARMUP_VERSION)
+            {
+                uint8_t record[9];
+                while (list.read((char*)record, sizeof(record)))
+                {
+                    JitWarmupEntry entry;
+                    entry.type = (JitPipeline)record[0];
+                    memcpy(&entry.state, &record[1], sizeof(entry.state));
+                    if (entry.type > JIT_TEX_LOOKUP)
+                        continue;
+                    if (jit_warmup_known[entry.type].insert(entry.state).second)
+                        jit_warmup_queue.push_back(entry);
+                }
+            }
+        }
+        list.close();
+
+        //Rewrite the list so that duplicates and a record cut short by a crash don't carry over
+        jit_warmup_file.open(name, std::ios::binary | std::ios::trunc);
+        if (!jit_warmup_file.is_open())
+        {
+            printf("[GS_t] Failed to open JIT warm-up list %s\n", name.c_str());
+            return;
+        }
+        jit_warmup_file.write(JIT_WARMUP_MAGIC, sizeof(JIT_WARMUP_MAGIC));
+        jit_warmup_file.write((const char*)&JIT_WARMUP_VERSION, sizeof(JIT_WARMUP_VERSION));
+        for (const JitWarmupEntry& entry : jit_warmup_queue)
+        {
+            uint8_t record[9];
+            record[0] = entry.type;
+            memcpy(&record[1], &entry.state, sizeof(entry.state));
+            jit_warmup_file.write((char*)record, sizeof(record));
+        }
+        jit_warmup_file.flush();
+
+        printf("[GS_t] %d JIT pipelines to warm up from %s\n", (int)jit_warmup_queue.size(), name.c_str());
+    }
+
+    void GraphicsSynthesizerThread::record_jit_pipeline(JitPipeline type, uint64_t state)
+    {
+        if (!jit_warmup_file.is_open() || !jit_warmup_known[type].insert(state).second)
+            return;
+
+        uint8_t record[9];
+        record[0] = type;
+        memcpy(&record[1], &state, sizeof(state));
+        jit_warmup_file.write((char*)record, sizeof(record));
+        jit_warmup_file.flush();
+    }
+
+    //Compiles the next pipeline on the warm-up list that isn't in the cache yet.
+    //Returns false if there was nothing left to compile.
+    bool GraphicsSynthesizerThread::warm_up_jit()
+    {
+        while (jit_warmup_pos < jit_warmup_queue.size())
+        {
+            JitWarmupEntry entry = jit_warmup_queue[jit_warmup_pos++];
+            bool draw_pixel = entry.type == JIT_DRAW_PIXEL;
+
+            //Never let the warm-up be the reason the heap gets flushed
+            if (draw_pixel ? jit_draw_pixel_heap.heap_is_full() : jit_tex_lookup_heap.heap_is_full())
+                continue;
+            if (draw_pixel ? jit_draw_pixel_heap.find_block(entry.state) : jit_tex_lookup_heap.find_block(entry.state))
+                continue;
+
+            //Compiling can flush the heap under the pipelines the batch looked up
+            flush_draw_batch();
+
+            //The recompilers read the registers the key was built from, so borrow them for the duration
+            GSContext saved_context1 = context1, saved_context2 = context2;
+            GSContext* saved_ctx = current_ctx;
+            PRMODE_REG saved_PRIM = PRIM, saved_PRMODE = PRMODE;
+            PRMODE_REG* saved_current_PRMODE = current_PRMODE;
+            TEXA_REG saved_TEXA = TEXA;
+            bool saved_PABE = PABE, saved_DTHE = DTHE, saved_COLCLAMP = COLCLAMP;
+            uint8_t saved_SCANMSK = SCANMSK;
+            uint64_t saved_draw_pixel_state = draw_pixel_state, saved_tex_lookup_state = tex_lookup_state;
+
+            bool compiled = false;
+            if (draw_pixel && decode_draw_pixel_state(entry.state))
+            {
+                recompile_draw_pixel(entry.state);
+                compiled = true;
+            }
+            else if (!draw_pixel && decode_tex_lookup_state(entry.state))
+            {
+                recompile_tex_lookup(entry.state);
+                compiled = true;
+            }
+
+            context1 = saved_context1;
+            context2 = saved_context2;
+            current_ctx = saved_ctx;
+            PRIM = saved_PRIM;
+            PRMODE = saved_PRMODE;
+            current_PRMODE = saved_current_PRMODE;
+            TEXA = saved_TEXA;
+            PABE = saved_PABE;
+            DTHE = saved_DTHE;
+            COLCLAMP = saved_COLCLAMP;
+            SCANMSK = saved_SCANMSK;
+            draw_pixel_state = saved_draw_pixel_state;
+            tex_lookup_state = saved_tex_lookup_state;
+
+            if (compiled)
+            {
+                if (jit_warmup_pos == jit_warmup_queue.size())
+                    printf("[GS_t] JIT warm-up complete\n");
+                return true;
+            }
+        }
+        return false;
+    }
+
     GSPixelJitBlockRecord* GraphicsSynthesizerThread::recompile_draw_pixel(uint64_t state)
     {
         jit_draw_pixel_block.clear();
@@ -4231,6 +6730,9 @@ namespace gs
 
         //R12 = x  R13 = y  R14 = z  R15 = color
 
+        if (state & DRAW_PIXEL_STATS_BIT)
+            jit_add_counter(emitter_dp, &frame_stats.pixels_tested, 1);
+
         //Shift x and y to the right by 4 (remove fractional component)
         emitter_dp.SAR32_REG_IMM(4, R12);
         emitter_dp.SAR32_REG_IMM(4, R13);
@@ -4389,6 +6891,9 @@ namespace gs
         if (current_ctx->test.depth_test)
             recompile_depth_test();
 
+        if (state & DRAW_PIXEL_STATS_BIT)
+            jit_add_counter(emitter_dp, &frame_stats.pixels_written, 1);
+
         emitter_dp.TEST32_REG_IMM(0x1, RBX);
         uint8_t* do_not_update_rgba = emitter_dp.JCC_NEAR_DEFERRED(ConditionCode::NE);
 
@@ -4825,101 +7330,293 @@ namespace gs
             emitter_dp.PSRAD(7, XMM0);
             emitter_dp.PACKSSDW(XMM0, XMM0);
         }
-        else
+        else
+        {
+            //If B is 0, the calculation simplifies to (A * C) >> 7
+            emitter_dp.PMULLW(XMM2, XMM0);
+            emitter_dp.PSRLW(7, XMM0);
+        }
+
+        //If D is not 0, add it to the blend result
+        if (current_ctx->alpha.spec_D < 2)
+            emitter_dp.PADDW(XMM3, XMM0);
+
+        //Clamp color
+        if (!COLCLAMP)
+        {
+            //Extract the lower 8 bits from the blend result before packing
+            emitter_dp.load_addr((uint64_t)&and_const, RAX);
+            emitter_dp.PAND_XMM_FROM_MEM(RAX, XMM0);
+        }
+
+        //Convert 16-bit color components to 8-bit and clamp to a 0-0xFF range
+        emitter_dp.PACKUSWB(XMM0, XMM0);
+
+        //Return color in R14. We need to replace the alpha component with the source alpha.
+        emitter_dp.MOVD_FROM_XMM(XMM0, R14);
+        emitter_dp.AND32_REG_IMM(0xFFFFFF, R14);
+        emitter_dp.MOV64_MR(R15, RAX);
+        emitter_dp.SHR64_REG_IMM(24, RAX);
+        emitter_dp.AND32_REG_IMM(0xFF000000, RAX);
+        emitter_dp.OR32_REG(RAX, R14);
+
+        if (PABE)
+            emitter_dp.set_jump_dest(pabe_fail_end);
+    }
+
+    void GraphicsSynthesizerThread::jit_call_func(Emitter64& emitter, uint64_t addr)
+    {
+    #ifdef _MSC_VER
+        emitter.SUB64_REG_IMM(0x20, RSP);
+        emitter.MOV64_OI(addr, RAX);
+        emitter.CALL_INDIR(RAX);
+        emitter.ADD64_REG_IMM(0x20, RSP);
+    #else
+        emitter.MOV64_OI(addr, RAX);
+        emitter.CALL_INDIR(RAX);
+    #endif
+    }
+
+    //Adds amount to a 64-bit counter. Clobbers RAX and R11.
+    void GraphicsSynthesizerThread::jit_add_counter(Emitter64& emitter, uint64_t* counter, uint32_t amount)
+    {
+        emitter.load_addr((uint64_t)counter, RAX);
+        emitter.MOV64_FROM_MEM(RAX, R11);
+        emitter.ADD64_REG_IMM(amount, R11);
+        emitter.MOV64_TO_MEM(R11, RAX);
+    }
+
+    void GraphicsSynthesizerThread::jit_epilogue_draw_pixel()
+    {
+        emitter_dp.MOVAPS_FROM_MEM(RBP, XMM0, 0);
+        emitter_dp.MOVAPS_FROM_MEM(RBP, XMM1, 0x10);
+        emitter_dp.MOVAPS_FROM_MEM(RBP, XMM2, 0x20);
+        emitter_dp.MOVAPS_FROM_MEM(RBP, XMM3, 0x30);
+        emitter_dp.MOVAPS_FROM_MEM(RBP, XMM4, 0x40);
+
+        emitter_dp.MOV64_FROM_MEM(RBP, RBX, 0x50);
+        emitter_dp.MOV64_FROM_MEM(RBP, RDI, 0x58);
+        emitter_dp.MOV64_FROM_MEM(RBP, RSI, 0x60);
+        emitter_dp.ADD64_REG_IMM(0xF0, RSP);
+        emitter_dp.POP(RBP);
+        emitter_dp.RET();
+    }
+
+    GSTextureJitBlockRecord* GraphicsSynthesizerThread::recompile_tex_lookup(uint64_t state)
+    {
+        jit_tex_lookup_block.clear();
+
+        emitter_tex.PUSH(RBP);
+        emitter_tex.SUB64_REG_IMM(0x100, RSP);
+        emitter_tex.MOV64_MR(RSP, RBP);
+
+        //Preserve used XMM registers on the stack
+        emitter_tex.MOVAPS_TO_MEM(XMM0, RBP, 0);
+        emitter_tex.MOVAPS_TO_MEM(XMM1, RBP, 0x10);
+
+        //And preserve integer registers
+        emitter_tex.MOV64_TO_MEM(RBX, RBP, 0x20);
+        emitter_tex.MOV64_TO_MEM(RDI, RBP, 0x28);
+        emitter_tex.MOV64_TO_MEM(RSI, RBP, 0x30);
+        emitter_tex.MOV64_TO_MEM(R10, RBP, 0x38);
+        emitter_tex.MOV64_TO_MEM(RDX, RBP, 0x40);
+
+        //Bilinear filtering is used when set to 1 or 4 and above
+        bool bilinear_larger = current_ctx->tex1.filter_larger;
+        bool bilinear_smaller = current_ctx->tex1.filter_smaller == 0x1 || current_ctx->tex1.filter_smaller >= 4;
+        bool bilinear = bilinear_larger || bilinear_smaller;
+        if (bilinear)
+        {
+            emitter_tex.MOVAPS_TO_MEM(XMM2, RBP, 0x50);
+            emitter_tex.MOVAPS_TO_MEM(XMM3, RBP, 0x60);
+            emitter_tex.MOVAPS_TO_MEM(XMM4, RBP, 0x70);
+            emitter_tex.MOVAPS_TO_MEM(XMM5, RBP, 0x80);
+        }
+
+        //R12 = signed 16-bit u  R13 = signed 16-bit v  R14 = pointer to TexLookupInfo
+        if (state & TEX_LOOKUP_STATS_BIT)
+            jit_add_counter(emitter_tex, &frame_stats.texels_fetched, 1);
+
+        emitter_tex.MOVSX16_TO_32(R12, R12);
+        emitter_tex.MOVSX16_TO_32(R13, R13);
+
+        if (current_PRMODE->use_UV)
+        {
+            emitter_tex.MOV32_FROM_MEM(R14, RCX, offsetof(TexLookupInfo, mipmap_level));
+            emitter_tex.SAR32_CL(R12);
+            emitter_tex.SAR32_CL(R13);
+        }
+
+        std::vector<uint8_t*> point_sample;
+        uint8_t* lookup_end = nullptr;
+        if (bilinear)
+        {
+            //The texture must be at least 8x8 to be filtered
+            emitter_tex.MOV32_FROM_MEM(R14, RAX, offsetof(TexLookupInfo, tex_width));
+            emitter_tex.MOV32_REG(RAX, RCX);
+            emitter_tex.AND32_REG_IMM(0xFFFF, RCX);
+            emitter_tex.CMP32_IMM(8, RCX);
+            point_sample.push_back(emitter_tex.JCC_NEAR_DEFERRED(ConditionCode::B));
+            emitter_tex.SHR32_REG_IMM(16, RAX);
+            emitter_tex.CMP32_IMM(8, RAX);
+            point_sample.push_back(emitter_tex.JCC_NEAR_DEFERRED(ConditionCode::B));
+
+            //Magnification (LOD < 0) and minification (LOD >= 0) each pick their own filter
+            emitter_tex.MOV32_FROM_MEM(R14, RAX, offsetof(TexLookupInfo, LOD));
+            emitter_tex.MOVD_TO_XMM(RAX, XMM2);
+            emitter_tex.XORPS(XMM3, XMM3);
+            emitter_tex.UCOMISS(XMM3, XMM2);
+            point_sample.push_back(emitter_tex.JCC_NEAR_DEFERRED(ConditionCode::P));
+            if (!bilinear_smaller)
+                point_sample.push_back(emitter_tex.JCC_NEAR_DEFERRED(ConditionCode::AE));
+            if (!bilinear_larger)
+                point_sample.push_back(emitter_tex.JCC_NEAR_DEFERRED(ConditionCode::B));
+
+            recompile_tex_lookup_bilinear();
+            lookup_end = emitter_tex.JMP_NEAR_DEFERRED();
+        }
+
+        for (uint8_t* jump : point_sample)
+            emitter_tex.set_jump_dest(jump);
+        emitter_tex.SAR32_REG_IMM(4, R12);
+        emitter_tex.SAR32_REG_IMM(4, R13);
+        recompile_tex_fetch();
+        if (lookup_end)
+            emitter_tex.set_jump_dest(lookup_end);
+
+        //Expand the texture color to 64-bit (16 bits for each color)
+        emitter_tex.MOVD_TO_XMM(RAX, XMM0);
+        emitter_tex.PMOVZX8_TO_16(XMM0, XMM0);
+        emitter_tex.MOVQ_FROM_XMM(XMM0, RSI);
+
+        //Read the vertex color
+        //Since the vertex color is first, and each component is 16-bit, we can simply do a 64-bit move
+        emitter_tex.MOV64_FROM_MEM(R14, RCX, 0);
+        emitter_tex.MOVQ_TO_XMM(RCX, XMM1);
+
+        switch (current_ctx->tex0.color_function)
+        {
+            case 0: //Modulate
+                //tex_color = (tex_color * vtx_color) >> 7
+                emitter_tex.PMULLW(XMM1, XMM0);
+                emitter_tex.PSRLW(7, XMM0);
+
+                //Clamp colors and re-convert back to 16-bit
+                emitter_tex.PACKUSWB(XMM0, XMM0);
+                emitter_tex.PMOVZX8_TO_16(XMM0, XMM0);
+                emitter_tex.MOVQ_FROM_XMM(XMM0, RAX);
+                break;
+            case 1: //Decal
+                emitter_tex.MOVQ_FROM_XMM(XMM0, RAX);
+                break;
+            case 2: //Highlight
+            case 3: //Highlight2
+                //tex_color = ((tex_color * vtx_color) >> 7) + vtx_alpha
+                emitter_tex.PMULLW(XMM1, XMM0);
+                emitter_tex.PSRLW(7, XMM0);
+
+                emitter_tex.MOV64_MR(RCX, RDX);
+                emitter_tex.SHR64_REG_IMM(48, RDX);
+                emitter_tex.MOVQ_TO_XMM(RDX, XMM1);
+                emitter_tex.PSHUFLW(0, XMM1, XMM1);
+                emitter_tex.PADDW(XMM1, XMM0);
+
+                emitter_tex.PACKUSWB(XMM0, XMM0);
+                emitter_tex.PMOVZX8_TO_16(XMM0, XMM0);
+                emitter_tex.MOVQ_FROM_XMM(XMM0, RAX);
+                break;
+            default:
+                Errors::die("[GS JIT] Unrecognized color function $%02X", current_ctx->tex0.color_function);
+        }
+
+        //Do fogging texcolor = ((texcolor * fog) >> 8) + (((0xff - fog) * FOGCOL) >> 8)
+        if (current_PRMODE->fog)
+        {
+            //(texcolor * fog) >> 8
+            emitter_tex.MOV32_FROM_MEM(R14, RBX, offsetof(TexLookupInfo, fog));
+            emitter_tex.AND32_REG_IMM(0xFF, RBX);
+            emitter_tex.MOVQ_TO_XMM(RBX, XMM1);
+            emitter_tex.PSHUFLW(0, XMM1, XMM1); //Fog
+            emitter_tex.PMULLW(XMM1, XMM0); //XMM0 = texcolor
+            emitter_tex.PSRLW(8, XMM0); // >> 8
+            emitter_tex.MOV64_MR(RAX, RDI); //Backup texture so we can extract the alpha later
+            emitter_tex.MOVQ_FROM_XMM(XMM0, RAX); //Move calc back to texture
+
+            //((0xFF-fog) * FOGCOL) >> 8
+            emitter_tex.MOV32_REG_IMM(0xFF, RDX);
+            emitter_tex.SUB32_REG(RBX, RDX);
+            emitter_tex.MOVQ_TO_XMM(RDX, XMM1); //XMM1 = 0xFF - Fog
+            emitter_tex.PSHUFLW(0, XMM1, XMM1);
+
+            emitter_tex.load_addr((uint64_t)&FOGCOL, RBX);
+            emitter_tex.MOV64_FROM_MEM(RBX, RBX);
+            emitter_tex.MOVQ_TO_XMM(RBX, XMM0);
+
+            emitter_tex.PMULLW(XMM1, XMM0); //((0xFF-fog) * FOGCOL)
+            emitter_tex.PSRLW(8, XMM0); // >> 8
+            emitter_tex.MOVQ_TO_XMM(RAX, XMM1); //Retrieve texcolor again
+            emitter_tex.PADDUSW(XMM0, XMM1); //Add them together
+            emitter_tex.MOVQ_FROM_XMM(XMM1, RAX); //Move calc back to texture
+        }
+
+        //Store tex_color in the TexLookupInfo struct
+        emitter_tex.MOV64_TO_MEM(RAX, R14, sizeof(RGBAQ_REG));
+
+        if (!current_ctx->tex0.use_alpha)
+        {
+            //tex_color.a = vtx_color.a
+            emitter_tex.SHR64_REG_IMM(48, RCX);
+            emitter_tex.MOV16_TO_MEM(RCX, R14, sizeof(RGBAQ_REG) + (sizeof(uint16_t) * 3));
+        }
+        else if (current_ctx->tex0.color_function == 2)
+        {
+            //tex_color.a += vtx_color.a
+            //TODO: clamp
+            emitter_tex.ADD64_REG(RSI, RCX);
+            emitter_tex.SHR64_REG_IMM(48, RCX);
+            emitter_tex.MOV16_TO_MEM(RCX, R14, sizeof(RGBAQ_REG) + (sizeof(uint16_t) * 3));
+        }
+        else if (current_ctx->tex0.color_function == 3)
         {
-            //If B is 0, the calculation simplifies to (A * C) >> 7
-            emitter_dp.PMULLW(XMM2, XMM0);
-            emitter_dp.PSRLW(7, XMM0);
+            //Keep tex_color.a unmodified (modulation equation affected alpha)
+            emitter_tex.SHR64_REG_IMM(48, RSI);
+            emitter_tex.MOV16_TO_MEM(RSI, R14, sizeof(RGBAQ_REG) + (sizeof(uint16_t) * 3));
         }
-
-        //If D is not 0, add it to the blend result
-        if (current_ctx->alpha.spec_D < 2)
-            emitter_dp.PADDW(XMM3, XMM0);
-
-        //Clamp color
-        if (!COLCLAMP)
+        else if (current_PRMODE->fog)
         {
-            //Extract the lower 8 bits from the blend result before packing
-            emitter_dp.load_addr((uint64_t)&and_const, RAX);
-            emitter_dp.PAND_XMM_FROM_MEM(RAX, XMM0);
+            //Recover backed up texcolor so we can get the old alpha back
+            emitter_tex.MOV64_MR(RDI, RBX);
+            emitter_tex.SHR64_REG_IMM(48, RBX);
+            emitter_tex.MOV16_TO_MEM(RBX, R14, sizeof(RGBAQ_REG) + (sizeof(uint16_t) * 3));
         }
 
-        //Convert 16-bit color components to 8-bit and clamp to a 0-0xFF range
-        emitter_dp.PACKUSWB(XMM0, XMM0);
-
-        //Return color in R14. We need to replace the alpha component with the source alpha.
-        emitter_dp.MOVD_FROM_XMM(XMM0, R14);
-        emitter_dp.AND32_REG_IMM(0xFFFFFF, R14);
-        emitter_dp.MOV64_MR(R15, RAX);
-        emitter_dp.SHR64_REG_IMM(24, RAX);
-        emitter_dp.AND32_REG_IMM(0xFF000000, RAX);
-        emitter_dp.OR32_REG(RAX, R14);
-
-        if (PABE)
-            emitter_dp.set_jump_dest(pabe_fail_end);
-    }
+        emitter_tex.MOVAPS_FROM_MEM(RBP, XMM0, 0);
+        emitter_tex.MOVAPS_FROM_MEM(RBP, XMM1, 0x10);
+        if (bilinear)
+        {
+            emitter_tex.MOVAPS_FROM_MEM(RBP, XMM2, 0x50);
+            emitter_tex.MOVAPS_FROM_MEM(RBP, XMM3, 0x60);
+            emitter_tex.MOVAPS_FROM_MEM(RBP, XMM4, 0x70);
+            emitter_tex.MOVAPS_FROM_MEM(RBP, XMM5, 0x80);
+        }
+        emitter_tex.MOV64_FROM_MEM(RBP, RBX, 0x20);
+        emitter_tex.MOV64_FROM_MEM(RBP, RDI, 0x28);
+        emitter_tex.MOV64_FROM_MEM(RBP, RSI, 0x30);
+        emitter_tex.MOV64_FROM_MEM(RBP, R10, 0x38);
+        emitter_tex.MOV64_FROM_MEM(RBP, RDX, 0x40);
 
-    void GraphicsSynthesizerThread::jit_call_func(Emitter64& emitter, uint64_t addr)
-    {
-    #ifdef _MSC_VER
-        emitter.SUB64_REG_IMM(0x20, RSP);
-        emitter.MOV64_OI(addr, RAX);
-        emitter.CALL_INDIR(RAX);
-        emitter.ADD64_REG_IMM(0x20, RSP);
-    #else
-        emitter.MOV64_OI(addr, RAX);
-        emitter.CALL_INDIR(RAX);
-    #endif
-    }
+        emitter_tex.ADD64_REG_IMM(0x100, RSP);
 
-    void GraphicsSynthesizerThread::jit_epilogue_draw_pixel()
-    {
-        emitter_dp.MOVAPS_FROM_MEM(RBP, XMM0, 0);
-        emitter_dp.MOVAPS_FROM_MEM(RBP, XMM1, 0x10);
-        emitter_dp.MOVAPS_FROM_MEM(RBP, XMM2, 0x20);
-        emitter_dp.MOVAPS_FROM_MEM(RBP, XMM3, 0x30);
-        emitter_dp.MOVAPS_FROM_MEM(RBP, XMM4, 0x40);
+        emitter_tex.POP(RBP);
+        emitter_tex.RET();
 
-        emitter_dp.MOV64_FROM_MEM(RBP, RBX, 0x50);
-        emitter_dp.MOV64_FROM_MEM(RBP, RDI, 0x58);
-        emitter_dp.MOV64_FROM_MEM(RBP, RSI, 0x60);
-        emitter_dp.ADD64_REG_IMM(0xF0, RSP);
-        emitter_dp.POP(RBP);
-        emitter_dp.RET();
+        return jit_tex_lookup_heap.insert_block(state, &jit_tex_lookup_block);
     }
 
-    GSTextureJitBlockRecord* GraphicsSynthesizerThread::recompile_tex_lookup(uint64_t state)
+    void GraphicsSynthesizerThread::recompile_tex_fetch()
     {
-        jit_tex_lookup_block.clear();
-
-        emitter_tex.PUSH(RBP);
-        emitter_tex.SUB64_REG_IMM(0x100, RSP);
-        emitter_tex.MOV64_MR(RSP, RBP);
-
-        //Preserve used XMM registers on the stack
-        emitter_tex.MOVAPS_TO_MEM(XMM0, RBP, 0);
-        emitter_tex.MOVAPS_TO_MEM(XMM1, RBP, 0x10);
-
-        //And preserve integer registers
-        emitter_tex.MOV64_TO_MEM(RBX, RBP, 0x20);
-        emitter_tex.MOV64_TO_MEM(RDI, RBP, 0x28);
-        emitter_tex.MOV64_TO_MEM(RSI, RBP, 0x30);
-        emitter_tex.MOV64_TO_MEM(R10, RBP, 0x38);
-        emitter_tex.MOV64_TO_MEM(RDX, RBP, 0x40);
-
-        //R12 = signed 16-bit u  R13 = signed 16-bit v  R14 = pointer to TexLookupInfo
-        emitter_tex.MOVSX16_TO_32(R12, R12);
-        emitter_tex.MOVSX16_TO_32(R13, R13);
-        emitter_tex.SAR32_REG_IMM(4, R12);
-        emitter_tex.SAR32_REG_IMM(4, R13);
-
-        if (current_PRMODE->use_UV)
-        {
-            emitter_tex.MOV32_FROM_MEM(R14, RCX, offsetof(TexLookupInfo, mipmap_level));
-            emitter_tex.SAR32_CL(R12);
-            emitter_tex.SAR32_CL(R13);
-        }
-
+        //Input: R12 (u), R13 (v), R14 (pointer to TexLookupInfo)
+        //Output: RAX (color in 32-bit format)
         //Load tex width and height
         //RBX = width - 1, R15 = height - 1
         emitter_tex.MOV32_FROM_MEM(R14, RBX, offsetof(TexLookupInfo, tex_width));
@@ -5045,7 +7742,6 @@ namespace gs
         }
 
         //Load the texture pixel
-        //TODO: bilinear filtering
         emitter_tex.MOV32_FROM_MEM(R14, abi_args[0], (sizeof(RGBAQ_REG) * 3) + (4 * 2));
         emitter_tex.SHR32_REG_IMM(8, abi_args[0]);
         emitter_tex.MOV32_FROM_MEM(R14, abi_args[1], (sizeof(RGBAQ_REG) * 3) + (4 * 3));
@@ -5120,10 +7816,7 @@ namespace gs
                 emitter_tex.MOV32_FROM_MEM(RAX, RDI);
                 emitter_tex.AND32_REG_IMM(0xFF, RDI);
 
-                if (current_ctx->tex0.use_CSM2)
-                    recompile_csm2_lookup();
-                else
-                    recompile_clut_lookup();
+                recompile_clut_lookup();
                 break;
             case 0x14:
                 jit_call_func(emitter_tex, (uint64_t)&addr_PSMCT4);
@@ -5140,10 +7833,7 @@ namespace gs
                 emitter_tex.SHR32_CL(RDI);
                 emitter_tex.AND32_REG_IMM(0xF, RDI);
 
-                if (current_ctx->tex0.use_CSM2)
-                    recompile_csm2_lookup();
-                else
-                    recompile_clut_lookup();
+                recompile_clut_lookup();
                 break;
             case 0x1B:
                 jit_call_func(emitter_tex, (uint64_t)&addr_PSMCT32);
@@ -5152,10 +7842,7 @@ namespace gs
                 emitter_tex.MOV32_FROM_MEM(RAX, RDI);
                 emitter_tex.SHR32_REG_IMM(24, RDI);
 
-                if (current_ctx->tex0.use_CSM2)
-                    recompile_csm2_lookup();
-                else
-                    recompile_clut_lookup();
+                recompile_clut_lookup();
                 break;
             case 0x24:
                 jit_call_func(emitter_tex, (uint64_t)&addr_PSMCT32);
@@ -5165,10 +7852,7 @@ namespace gs
                 emitter_tex.SHR32_REG_IMM(24, RDI);
                 emitter_tex.AND32_REG_IMM(0xF, RDI);
 
-                if (current_ctx->tex0.use_CSM2)
-                    recompile_csm2_lookup();
-                else
-                    recompile_clut_lookup();
+                recompile_clut_lookup();
                 break;
             case 0x2C:
                 jit_call_func(emitter_tex, (uint64_t)&addr_PSMCT32);
@@ -5177,135 +7861,99 @@ namespace gs
                 emitter_tex.MOV32_FROM_MEM(RAX, RDI);
                 emitter_tex.SHR32_REG_IMM(28, RDI);
 
-                if (current_ctx->tex0.use_CSM2)
-                    recompile_csm2_lookup();
-                else
-                    recompile_clut_lookup();
+                recompile_clut_lookup();
                 break;
             default:
                 Errors::die("[GS JIT] Unrecognized texture format $%02X", current_ctx->tex0.format);
         }
+    }
 
-        //Expand the texture color to 64-bit (16 bits for each color)
-        emitter_tex.MOVD_TO_XMM(RAX, XMM0);
-        emitter_tex.PMOVZX8_TO_16(XMM0, XMM0);
-        emitter_tex.MOVQ_FROM_XMM(XMM0, RSI);
-
-        //Read the vertex color
-        //Since the vertex color is first, and each component is 16-bit, we can simply do a 64-bit move
-        emitter_tex.MOV64_FROM_MEM(R14, RCX, 0);
-        emitter_tex.MOVQ_TO_XMM(RCX, XMM1);
-
-        switch (current_ctx->tex0.color_function)
-        {
-            case 0: //Modulate
-                //tex_color = (tex_color * vtx_color) >> 7
-                emitter_tex.PMULLW(XMM1, XMM0);
-                emitter_tex.PSRLW(7, XMM0);
-
-                //Clamp colors and re-convert back to 16-bit
-                emitter_tex.PACKUSWB(XMM0, XMM0);
-                emitter_tex.PMOVZX8_TO_16(XMM0, XMM0);
-                emitter_tex.MOVQ_FROM_XMM(XMM0, RAX);
-                break;
-            case 1: //Decal
-                emitter_tex.MOVQ_FROM_XMM(XMM0, RAX);
-                break;
-            case 2: //Highlight
-            case 3: //Highlight2
-                //tex_color = ((tex_color * vtx_color) >> 7) + vtx_alpha
-                emitter_tex.PMULLW(XMM1, XMM0);
-                emitter_tex.PSRLW(7, XMM0);
-
-                emitter_tex.MOV64_MR(RCX, RDX);
-                emitter_tex.SHR64_REG_IMM(48, RDX);
-                emitter_tex.MOVQ_TO_XMM(RDX, XMM1);
-                emitter_tex.PSHUFLW(0, XMM1, XMM1);
-                emitter_tex.PADDW(XMM1, XMM0);
-
-                emitter_tex.PACKUSWB(XMM0, XMM0);
-                emitter_tex.PMOVZX8_TO_16(XMM0, XMM0);
-                emitter_tex.MOVQ_FROM_XMM(XMM0, RAX);
-                break;
-            default:
-                Errors::die("[GS JIT] Unrecognized color function $%02X", current_ctx->tex0.color_function);
-        }
-
-        //Do fogging texcolor = ((texcolor * fog) >> 8) + (((0xff - fog) * FOGCOL) >> 8)
-        if (current_PRMODE->fog)
-        {
-            //(texcolor * fog) >> 8
-            emitter_tex.MOV32_FROM_MEM(R14, RBX, offsetof(TexLookupInfo, fog));
-            emitter_tex.AND32_REG_IMM(0xFF, RBX);
-            emitter_tex.MOVQ_TO_XMM(RBX, XMM1);
-            emitter_tex.PSHUFLW(0, XMM1, XMM1); //Fog
-            emitter_tex.PMULLW(XMM1, XMM0); //XMM0 = texcolor
-            emitter_tex.PSRLW(8, XMM0); // >> 8
-            emitter_tex.MOV64_MR(RAX, RDI); //Backup texture so we can extract the alpha later
-            emitter_tex.MOVQ_FROM_XMM(XMM0, RAX); //Move calc back to texture
-
-            //((0xFF-fog) * FOGCOL) >> 8
-            emitter_tex.MOV32_REG_IMM(0xFF, RDX);
-            emitter_tex.SUB32_REG(RBX, RDX);
-            emitter_tex.MOVQ_TO_XMM(RDX, XMM1); //XMM1 = 0xFF - Fog
-            emitter_tex.PSHUFLW(0, XMM1, XMM1);
-
-            emitter_tex.load_addr((uint64_t)&FOGCOL, RBX);
-            emitter_tex.MOV64_FROM_MEM(RBX, RBX);
-            emitter_tex.MOVQ_TO_XMM(RBX, XMM0);
-
-            emitter_tex.PMULLW(XMM1, XMM0); //((0xFF-fog) * FOGCOL)
-            emitter_tex.PSRLW(8, XMM0); // >> 8
-            emitter_tex.MOVQ_TO_XMM(RAX, XMM1); //Retrieve texcolor again
-            emitter_tex.PADDUSW(XMM0, XMM1); //Add them together
-            emitter_tex.MOVQ_FROM_XMM(XMM1, RAX); //Move calc back to texture
-        }
-
-        //Store tex_color in the TexLookupInfo struct
-        emitter_tex.MOV64_TO_MEM(RAX, R14, sizeof(RGBAQ_REG));
+    void GraphicsSynthesizerThread::recompile_tex_lookup_bilinear()
+    {
+        //Input: R12 (u - mipmapped, with 4 fractional bits), R13 (v), R14 (pointer to TexLookupInfo)
+        //Output: RAX (filtered color in 32-bit format)
+        //Same 8.8 fixed point blend as tex_lookup_bilinear. Texels go to [RBP + 0x90], fractions to 0xA0/0xA4
+        //and the top left texel's coordinates to 0xA8/0xAC, as fetching calls out and clobbers volatile registers.
+        //recompile_tex_lookup already counted one of the four texels.
+        if (tex_lookup_state & TEX_LOOKUP_STATS_BIT)
+            jit_add_counter(emitter_tex, &frame_stats.texels_fetched, 3);
+        emitter_tex.ADD32_REG_IMM(-8, R12);
+        emitter_tex.ADD32_REG_IMM(-8, R13);
+        emitter_tex.MOV32_REG(R12, RAX);
+        emitter_tex.AND32_REG_IMM(0xF, RAX);
+        emitter_tex.MOV32_TO_MEM(RAX, RBP, 0xA0);
+        emitter_tex.MOV32_REG(R13, RAX);
+        emitter_tex.AND32_REG_IMM(0xF, RAX);
+        emitter_tex.MOV32_TO_MEM(RAX, RBP, 0xA4);
+        emitter_tex.SAR32_REG_IMM(4, R12);
+        emitter_tex.SAR32_REG_IMM(4, R13);
+        emitter_tex.MOV32_TO_MEM(R12, RBP, 0xA8);
+        emitter_tex.MOV32_TO_MEM(R13, RBP, 0xAC);
 
-        if (!current_ctx->tex0.use_alpha)
-        {
-            //tex_color.a = vtx_color.a
-            emitter_tex.SHR64_REG_IMM(48, RCX);
-            emitter_tex.MOV16_TO_MEM(RCX, R14, sizeof(RGBAQ_REG) + (sizeof(uint16_t) * 3));
-        }
-        else if (current_ctx->tex0.color_function == 2)
-        {
-            //tex_color.a += vtx_color.a
-            //TODO: clamp
-            emitter_tex.ADD64_REG(RSI, RCX);
-            emitter_tex.SHR64_REG_IMM(48, RCX);
-            emitter_tex.MOV16_TO_MEM(RCX, R14, sizeof(RGBAQ_REG) + (sizeof(uint16_t) * 3));
-        }
-        else if (current_ctx->tex0.color_function == 3)
-        {
-            //Keep tex_color.a unmodified (modulation equation affected alpha)
-            emitter_tex.SHR64_REG_IMM(48, RSI);
-            emitter_tex.MOV16_TO_MEM(RSI, R14, sizeof(RGBAQ_REG) + (sizeof(uint16_t) * 3));
-        }
-        else if (current_PRMODE->fog)
+        for (int i = 0; i < 4; i++)
         {
-            //Recover backed up texcolor so we can get the old alpha back
-            emitter_tex.MOV64_MR(RDI, RBX);
-            emitter_tex.SHR64_REG_IMM(48, RBX);
-            emitter_tex.MOV16_TO_MEM(RBX, R14, sizeof(RGBAQ_REG) + (sizeof(uint16_t) * 3));
+            emitter_tex.MOV32_FROM_MEM(RBP, R12, 0xA8);
+            emitter_tex.MOV32_FROM_MEM(RBP, R13, 0xAC);
+            if (i & 1)
+                emitter_tex.ADD32_REG_IMM(1, R12);
+            if (i & 2)
+                emitter_tex.ADD32_REG_IMM(1, R13);
+            recompile_tex_fetch();
+            emitter_tex.MOV32_TO_MEM(RAX, RBP, 0x90 + (i * 4));
         }
 
-        emitter_tex.MOVAPS_FROM_MEM(RBP, XMM0, 0);
-        emitter_tex.MOVAPS_FROM_MEM(RBP, XMM1, 0x10);
-        emitter_tex.MOV64_FROM_MEM(RBP, RBX, 0x20);
-        emitter_tex.MOV64_FROM_MEM(RBP, RDI, 0x28);
-        emitter_tex.MOV64_FROM_MEM(RBP, RSI, 0x30);
-        emitter_tex.MOV64_FROM_MEM(RBP, R10, 0x38);
-        emitter_tex.MOV64_FROM_MEM(RBP, RDX, 0x40);
-
-        emitter_tex.ADD64_REG_IMM(0x100, RSP);
-
-        emitter_tex.POP(RBP);
-        emitter_tex.RET();
-
-        return jit_tex_lookup_heap.insert_block(state, &jit_tex_lookup_block);
+        //XMM2 = u weights (16 - fu, fu, 16 - fu, fu)
+        emitter_tex.MOV32_FROM_MEM(RBP, RAX, 0xA0);
+        emitter_tex.MOV32_REG_IMM(16, RCX);
+        emitter_tex.SUB32_REG(RAX, RCX);
+        emitter_tex.MOV32_REG(RAX, RDX);
+        emitter_tex.SHL64_REG_IMM(16, RDX);
+        emitter_tex.OR64_REG(RCX, RDX);
+        emitter_tex.MOV64_MR(RDX, RSI);
+        emitter_tex.SHL64_REG_IMM(32, RSI);
+        emitter_tex.OR64_REG(RSI, RDX);
+        emitter_tex.MOVQ_TO_XMM(RDX, XMM2);
+
+        //XMM3 = v weights (16 - fv, 16 - fv, fv, fv)
+        emitter_tex.MOV32_FROM_MEM(RBP, RAX, 0xA4);
+        emitter_tex.MOV32_REG_IMM(16, RCX);
+        emitter_tex.SUB32_REG(RAX, RCX);
+        emitter_tex.MOV32_REG(RCX, RDX);
+        emitter_tex.SHL64_REG_IMM(16, RDX);
+        emitter_tex.OR64_REG(RCX, RDX);
+        emitter_tex.MOV32_REG(RAX, RSI);
+        emitter_tex.SHL64_REG_IMM(16, RSI);
+        emitter_tex.OR64_REG(RAX, RSI);
+        emitter_tex.SHL64_REG_IMM(32, RSI);
+        emitter_tex.OR64_REG(RSI, RDX);
+        emitter_tex.MOVQ_TO_XMM(RDX, XMM3);
+
+        //XMM2 = per texel weights, then spread them over each texel's four channels
+        emitter_tex.PMULLW(XMM3, XMM2);
+        emitter_tex.PSHUFLW(0x00, XMM2, XMM3);
+        emitter_tex.PSHUFLW(0x55, XMM2, XMM4);
+        emitter_tex.MOVQ_FROM_XMM(XMM4, RAX);
+        emitter_tex.PINSRQ_XMM(1, RAX, XMM3);
+        emitter_tex.PSHUFLW(0xAA, XMM2, XMM4);
+        emitter_tex.PSHUFLW(0xFF, XMM2, XMM5);
+        emitter_tex.MOVQ_FROM_XMM(XMM5, RAX);
+        emitter_tex.PINSRQ_XMM(1, RAX, XMM4);
+
+        //XMM0 = top texels, XMM1 = bottom texels, 16 bits per channel
+        emitter_tex.MOVAPS_FROM_MEM(RBP, XMM5, 0x90);
+        emitter_tex.PMOVZX8_TO_16(XMM5, XMM0);
+        emitter_tex.PSHUFD(0xEE, XMM5, XMM1);
+        emitter_tex.PMOVZX8_TO_16(XMM1, XMM1);
+
+        //Weight and sum all four texels. No product or sum can exceed 255 * 256.
+        emitter_tex.PMULLW(XMM3, XMM0);
+        emitter_tex.PMULLW(XMM4, XMM1);
+        emitter_tex.PADDW(XMM1, XMM0);
+        emitter_tex.PSHUFD(0xEE, XMM0, XMM1);
+        emitter_tex.PADDW(XMM1, XMM0);
+        emitter_tex.PSRLW(8, XMM0);
+        emitter_tex.PACKUSWB(XMM0, XMM0);
+        emitter_tex.MOVD_FROM_XMM(XMM0, RAX);
     }
 
     void GraphicsSynthesizerThread::recompile_clut_lookup()
@@ -5313,47 +7961,11 @@ namespace gs
         //Input: RDI (index)
         //Output: RAX (color in 32-bit format)
 
-        //RCX = current_ctx->tex0.CLUT_offset
-        emitter_tex.load_addr((uint64_t)&current_ctx->tex0.CLUT_offset, RCX);
-        emitter_tex.MOV32_FROM_MEM(RCX, RCX);
-        emitter_tex.load_addr((uint64_t)&clut_cache, RAX);
-
-        switch (current_ctx->tex0.CLUT_format)
-        {
-            case 0x00:
-            case 0x01:
-                emitter_tex.SHL32_REG_IMM(2, RDI);
-                emitter_tex.ADD32_REG(RDI, RCX);
-                emitter_tex.AND32_REG_IMM(0x3FF, RCX);
-                emitter_tex.ADD64_REG(RCX, RAX);
-                emitter_tex.MOV32_FROM_MEM(RAX, RAX);
-                break;
-            case 0x02:
-            case 0x0A:
-                emitter_tex.SHL32_REG_IMM(1, RDI);
-                emitter_tex.ADD32_REG(RDI, RCX);
-                emitter_tex.AND32_REG_IMM(0x3FF, RCX);
-                emitter_tex.ADD64_REG(RCX, RAX);
-                emitter_tex.MOV32_FROM_MEM(RAX, RAX);
-                emitter_tex.AND32_EAX(0xFFFF);
-
-                recompile_convert_16bit_tex(RAX, RCX, RDI);
-                break;
-            default:
-                Errors::die("[GS JIT] Unrecognized CLUT format $%02X", current_ctx->tex0.CLUT_format);
-        }
-    }
-
-    void GraphicsSynthesizerThread::recompile_csm2_lookup()
-    {
-        //color = *(uint16_t*)&clut_cache[index << 1]
-        emitter_tex.load_addr((uint64_t)&clut_cache, RAX);
-        emitter_tex.SHL32_REG_IMM(1, RDI);
+        //The palette is expanded before the batch is drawn, so this is just color = clut_rgba[index]
+        emitter_tex.load_addr((uint64_t)&clut_rgba, RAX);
+        emitter_tex.SHL32_REG_IMM(2, RDI);
         emitter_tex.ADD64_REG(RDI, RAX);
         emitter_tex.MOV32_FROM_MEM(RAX, RAX);
-        emitter_tex.AND32_EAX(0xFFFF);
-
-        recompile_convert_16bit_tex(RAX, RDI, RSI);
     }
 
     void GraphicsSynthesizerThread::recompile_convert_16bit_tex(REG_64 color, REG_64 temp, REG_64 temp2)
@@ -5406,6 +8018,10 @@ namespace gs
     void GraphicsSynthesizerThread::load_state(std::ifstream *state)
     {
         state->read((char*)local_mem, 1024 * 1024 * 4);
+        reset_zbounds();
+        download_cache.valid = false;
+        reset_clut_palettes();
+        crt_registers_changed = true;
         state->read((char*)&IMR, sizeof(IMR));
         state->read((char*)&context1, sizeof(context1));
         state->read((char*)&context2, sizeof(context2));
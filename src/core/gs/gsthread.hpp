@@ -1,13 +1,20 @@
 #pragma once
+#include <atomic>
+#include <chrono>
 #include <cstdint>
+#include <fstream>
 #include <thread>
 #include <mutex>
 #include <condition_variable>
 #include <cstdint>
 #include <memory>
+#include <string>
+#include <unordered_set>
+#include <vector>
 #include "gscontext.hpp"
 #include "gsregisters.hpp"
 #include <util/circularFIFO.hpp>
+#include <util/commandring.hpp>
 #include <util/int128.hpp>
 #include "jitcommon/emitter64.hpp"
 
@@ -35,7 +42,15 @@ namespace gs
         write64_t, write64_privileged_t, write32_privileged_t,
         set_rgba_t, set_st_t, set_uv_t, set_xyz_t, set_xyzf_t, set_crt_t,
         render_crt_t, assert_finish_t, assert_hblank_t, assert_vsync_t, swap_field_t, memdump_t, die_t,
-        save_state_t, load_state_t, gsdump_t, request_local_host_tx,
+        save_state_t, load_state_t, gsdump_t, request_local_host_tx, gif_data_t, set_frameskip_t,
+        jit_warmup_t, set_pixel_stats_t,
+    };
+
+    enum class FrameskipMode :uint8_t
+    {
+        Off,
+        Fixed, //Draw one of every N frames
+        Auto   //Skip frames while the emulator is slower than real time
     };
 
     union GSMessagePayload
@@ -103,6 +118,19 @@ namespace gs
             std::ifstream* state;
         } load_state_payload;
         struct
+        {
+            FrameskipMode mode;
+            uint8_t interval;
+        } frameskip_payload;
+        struct
+        {
+            char serial[16]; //Empty to stop recording
+        } jit_warmup_payload;
+        struct
+        {
+            bool enabled;
+        } pixel_stats_payload;
+        struct
         {
             uint8_t BLANK;
         } no_payload;//C++ doesn't like the empty struct
@@ -114,6 +142,40 @@ namespace gs
         GSMessagePayload payload;
     };
 
+    //gif_data_t records carry raw GIF quadwords, tags included, for the GS thread to decode.
+    //The header is the state of the path before the first quadword of the record.
+    struct GIFDataHeader
+    {
+        uint64_t regs;
+        uint32_t data_left;
+        float Q;
+        uint8_t format;
+        uint8_t reg_count;
+        uint8_t regs_left;
+        uint8_t path;
+    };
+
+    //Counters the GS thread keeps for a frame, sent back with render_complete_t.
+    //Times are in nanoseconds. Transfer time leaves out primitives drawn in the same GIF packet.
+    struct GSFrameStats
+    {
+        uint32_t primitives[8]; //By PRIM type
+        uint32_t primitives_skipped; //Dropped by frameskip
+        uint32_t jit_compiles;
+        uint32_t clut_reloads; //Read from local memory, not served from the palette cache
+        uint64_t pixels_tested;
+        uint64_t pixels_written; //Passed every test
+        uint64_t texels_fetched; //Four per bilinear lookup. Pixels and texels are only counted with set_pixel_stats_t.
+        uint64_t host_to_local_bytes;
+        uint64_t local_to_host_bytes;
+        uint64_t local_to_local_bytes;
+        uint64_t raster_ns;
+        uint64_t transfer_ns;
+        uint64_t crt_ns;
+
+        std::string to_json() const;
+    };
+
     //Commands sent from the GS thread to the main thread.
     enum GSReturn :uint8_t
     {
@@ -143,6 +205,11 @@ namespace gs
         {
             uint32_t quad_count;
         } download_payload;
+        struct
+        {
+            bool skipped; //Nothing was drawn to the target, present the previous frame again
+            GSFrameStats stats;
+        } render_payload;
 
     };
 
@@ -152,7 +219,10 @@ namespace gs
         GSReturnMessagePayload payload;
     };
 
-    typedef CircularFifo<GSMessage, 1024 * 1024 * 16> gs_fifo;
+    //GSMessages are stored with only as much payload as their command needs.
+    //Consecutive write64_t messages to the same register are packed into one record of
+    //an address followed by the values, which is how image data reaches HWREG.
+    typedef CommandRing<1024 * 1024 * 8> gs_fifo;
     typedef CircularFifo<GSReturnMessage, 1024> gs_return_fifo;
 
     struct PRMODE_REG
@@ -222,6 +292,55 @@ namespace gs
         uint16_t width, x, y;
     };
 
+    //Conservative range of the z values stored in one 256-byte block of local memory
+    struct ZBlockBounds
+    {
+        uint32_t min, max;
+        uint8_t format; //ZBUF format the range was recorded with, 0xFF if unknown
+    };
+
+    //A finished local->host transfer, reused for the same readback while nothing writes to the pages it read
+    struct DownloadCache
+    {
+        bool valid = false;
+        uint32_t first_page, last_page;
+        BITBLTBUF_REG BITBLTBUF;
+        TRXREG_REG TRXREG;
+        TRXPOS_REG start_pos, end_pos;
+        int pixels_transferred;
+        uint32_t start_PSMCT24_color, end_PSMCT24_color;
+        int start_PSMCT24_count, end_PSMCT24_count;
+        uint32_t qwc;
+        std::vector<uint128_t> data;
+    };
+
+    //The entries a CLUT load last read from local memory, so loading the same palette again
+    //while its pages are unchanged can copy them back into the CLUT buffer instead
+    struct ClutPalette
+    {
+        bool valid = false;
+        uint64_t key;
+        uint32_t first_page, last_page;
+        uint32_t offset, size;
+        uint8_t entries[1024];
+    };
+
+    //An output buffer render_CRT drew into, and the oldest render whose local memory it shows
+    struct CRTOutput
+    {
+        uint32_t* target;
+        uint64_t render, source_render;
+        bool field, weave;
+    };
+
+    //Outcome of testing a primitive's z range against a block's bounds
+    enum class ZBlockTest
+    {
+        Reject, //No pixel can pass the depth test
+        Test,   //Pixels must be tested one by one
+        Pass    //Every pixel passes the depth test
+    };
+
     struct Vertex
     {
         int32_t x, y;
@@ -264,6 +383,27 @@ namespace gs
     uint32_t addr_PSMCT8(uint32_t block, uint32_t width, uint32_t x, uint32_t y);
     uint32_t addr_PSMCT4(uint32_t block, uint32_t width, uint32_t x, uint32_t y);
 
+    //Describes how a pixel storage format is laid out in local memory.
+    //Blocks are always 256 bytes and pages 8 KB, regardless of the format.
+    struct PSMLayout
+    {
+        uint32_t (*addr)(uint32_t block, uint32_t width, uint32_t x, uint32_t y);
+        uint16_t block_width, block_height;
+        uint16_t page_width, page_height;
+        uint8_t bpp;
+
+        //Byte offset in local memory of the block containing (x, y)
+        uint32_t block_offset(uint32_t base, uint32_t width, uint32_t x, uint32_t y) const
+        {
+            uint32_t offset = addr(base / 256, width / 64, x, y);
+            if (bpp == 4)
+                offset >>= 1;
+            return offset & ~0xFF;
+        }
+    };
+
+    const PSMLayout* get_PSM_layout(uint8_t format);
+
     struct VertexF
     {
         union {
@@ -358,12 +498,29 @@ namespace gs
 
         std::mutex data_mutex;
 
-        bool send_data = false;
         bool recieve_data = false;
 
+        //The GS thread spins for a while when it runs out of messages before sleeping on message_signal.
+        //The spin count adapts to how often spinning was enough.
+        constexpr static int MIN_SPIN_COUNT = 64;
+        constexpr static int MAX_SPIN_COUNT = 16384;
+        constexpr static int RETURN_SPIN_COUNT = 4096;
+        std::atomic<bool> thread_sleeping{ false };
+        std::atomic<uint32_t> message_signal{ 0 };
+
+        //Return messages popped while waiting for a different type
+        std::vector<GSReturnMessage> stashed_returns;
+
         std::unique_ptr<gs_fifo> message_queue{ nullptr };
         std::unique_ptr<gs_return_fifo> return_queue{ nullptr };
 
+        //Emu thread side of message batching
+        constexpr static size_t MESSAGE_BATCH_SIZE = 4096;
+        constexpr static uint32_t NO_PACKED_WRITE = 0xFFFFFFFF;
+        uint32_t packed_write_addr = NO_PACKED_WRITE;
+        int gif_data_path = -1;
+        std::atomic<bool> thread_died{ false };
+
         bool frame_complete;
         int frame_count;
         uint8_t* local_mem;
@@ -372,6 +529,14 @@ namespace gs
         uint8_t clut_cache[1024];
         uint32_t CBP0, CBP1;
 
+        //clut_cache expanded to 32-bit colors for the CSA, CPSM, CSM and TEXA of the current batch
+        alignas(16) uint32_t clut_rgba[256];
+        uint64_t clut_rgba_key;
+        bool clut_rgba_valid;
+        ClutPalette clut_palettes[16];
+        int clut_palette_next;
+        int clut_palette_loaded;
+
         //CSR/IMR stuff - to be merged into structs
 
         GS_IMR IMR;
@@ -424,6 +589,8 @@ namespace gs
         uint32_t PSMCT24_color;
         int PSMCT24_unpacked_count;
 
+        DownloadCache download_cache;
+
         GS_REGISTERS reg;
 
         Vertex current_vtx;
@@ -437,6 +604,69 @@ namespace gs
 
         float log2_lookup[32768][4];
 
+        //Hierarchical z - per-block bounds for the active ZBUF, plus the state of the primitive being drawn
+        ZBlockBounds zblock_bounds[1024 * 1024 * 4 / 256];
+        uint64_t zbounds_pages[512 / 64]; //Pages which may hold known bounds
+        const PSMLayout* hz_layout;
+        bool hz_enabled, hz_valid, hz_bypass, hz_z_writes, hz_frame_writes, hz_aliased;
+        uint8_t hz_depth_method;
+        uint32_t hz_min, hz_max, hz_format_max;
+        int32_t hz_x1, hz_y1, hz_x2, hz_y2;
+        uint8_t* jit_draw_pixel_depth_func;
+        uint8_t* jit_draw_pixel_nodepth_func;
+
+        //Primitives are drawn in batches that share setup until a register write changes draw state
+        bool batch_open, batch_drawn, batch_skipped;
+
+        //Frameskip - while skip_frame is set, primitives that only draw to pages being scanned out are dropped.
+        //Pages read back by textures, CLUT loads, and transfers are tracked so draws into them still happen.
+        constexpr static int MAX_AUTO_FRAMESKIP = 3;
+        FrameskipMode frameskip_mode;
+        int frameskip_interval;
+        int frameskip_counter;
+        int frameskip_warmup;
+        double frameskip_lag; //Seconds behind real time, for FrameskipMode::Auto
+        bool skip_frame;
+        uint64_t displayed_pages[512 / 64]; //Scanned out this frame or the last one
+        uint64_t last_displayed_pages[512 / 64];
+        uint64_t sampled_pages[512 / 64];
+        uint64_t last_sampled_pages[512 / 64];
+        std::chrono::steady_clock::time_point last_frame_time;
+
+        //Unchanged frame detection - pages written and whether the CRT registers changed since the last render_CRT
+        uint64_t crt_dirty_pages[512 / 64];
+        bool crt_registers_changed;
+        uint64_t crt_render_count;
+        uint64_t crt_last_change; //Latest render with a change to what's displayed
+        uint64_t crt_field_render[2];
+        CRTOutput crt_outputs[2];
+
+        //Frame statistics. Times are accumulated in TSC ticks and converted when the frame ends.
+        GSFrameStats frame_stats;
+        uint64_t raster_ticks, transfer_ticks, crt_ticks;
+
+        //Counting pixels and texels costs the JIT pipelines a memory add per pixel, so it's off unless asked for.
+        //It's part of both pipeline keys.
+        bool pixel_stats;
+        constexpr static uint64_t DRAW_PIXEL_STATS_BIT = 1ULL << 58;
+        constexpr static uint64_t TEX_LOOKUP_STATS_BIT = 1ULL << 43;
+        uint64_t stats_start_ticks;
+        std::chrono::steady_clock::time_point stats_start_time;
+        bool hwreg_written;
+
+        //JIT warm-up - the key of every pipeline compiled for the running game is appended to a per-game list.
+        //Keys listed by earlier runs are compiled ahead of time whenever the GS thread has nothing else to do.
+        enum JitPipeline :uint8_t { JIT_DRAW_PIXEL, JIT_TEX_LOOKUP };
+        struct JitWarmupEntry
+        {
+            JitPipeline type;
+            uint64_t state;
+        };
+        std::vector<JitWarmupEntry> jit_warmup_queue;
+        size_t jit_warmup_pos;
+        std::unordered_set<uint64_t> jit_warmup_known[2];
+        std::ofstream jit_warmup_file;
+
         void soft_reset();
         void event_loop();
 
@@ -475,12 +705,25 @@ namespace gs
         void calculate_LOD(TexLookupInfo& info);
         void tex_lookup(int16_t u, int16_t v, TexLookupInfo& info);
         void tex_lookup_int(int16_t u, int16_t v, TexLookupInfo& info, bool forced_lookup = false);
+        void tex_lookup_bilinear(int16_t u, int16_t v, TexLookupInfo& info);
+        int16_t wrap_tex_u(int16_t u, const TexLookupInfo& info);
+        int16_t wrap_tex_v(int16_t v, const TexLookupInfo& info);
+        void fetch_texel(int16_t u, int16_t v, const TexLookupInfo& info, RGBAQ_REG& color);
         void clut_lookup(uint8_t entry, RGBAQ_REG& tex_color);
-        void clut_CSM2_lookup(uint8_t entry, RGBAQ_REG& tex_color);
         void reload_clut(GSContext& context);
+        bool load_cached_clut(uint64_t key);
+        void store_clut_palette(uint64_t key, uint32_t first_page, uint32_t last_page, uint32_t offset, uint32_t size);
+        void reset_clut_palettes();
+        void invalidate_clut_palettes(uint32_t first_page, uint32_t last_page);
+        void update_clut_rgba();
         void update_draw_pixel_state();
         void update_tex_lookup_state();
         uint8_t* get_jitted_draw_pixel(uint64_t state);
+        bool decode_draw_pixel_state(uint64_t state);
+        bool decode_tex_lookup_state(uint64_t state);
+        void load_jit_warmup(const char* serial);
+        void record_jit_pipeline(JitPipeline type, uint64_t state);
+        bool warm_up_jit();
 
         void recompile_draw_pixel_prologue();
         GSPixelJitBlockRecord* recompile_draw_pixel(uint64_t state);
@@ -493,8 +736,9 @@ namespace gs
         void recompile_tex_lookup_prologue();
         uint8_t* get_jitted_tex_lookup(uint64_t state);
         GSTextureJitBlockRecord* recompile_tex_lookup(uint64_t state);
+        void recompile_tex_fetch();
+        void recompile_tex_lookup_bilinear();
         void recompile_clut_lookup();
-        void recompile_csm2_lookup();
         void recompile_convert_16bit_tex(REG_64 color, REG_64 temp, REG_64 temp2);
 
         void vertex_kick(bool drawing_kick);
@@ -503,6 +747,8 @@ namespace gs
         uint32_t lookup_frame_color(int32_t x, int32_t y);
         bool is_32bit_texture();
         void render_primitive();
+        void begin_draw_batch();
+        void flush_draw_batch();
         void render_point();
         void render_line();
         void render_triangle();
@@ -510,17 +756,57 @@ namespace gs
         void render_half_triangle(float x0, float x1, int y0, int y1, VertexF& x_step, VertexF& y_step, VertexF& init,
             float step_x0, float step_x1, float scx1, float scx2, TexLookupInfo& tex_info);
         void render_sprite();
+        bool render_sprite_fast(int32_t x1, int32_t y1, int32_t x2, int32_t y2, const Vertex& vtx, TexLookupInfo& tex_info,
+            int32_t u, int32_t v, int32_t u_step, int32_t v_step);
+        void fill_rect(const PSMLayout& layout, uint32_t base, uint32_t width, int32_t x1, int32_t y1,
+            int32_t x2, int32_t y2, uint32_t value, uint32_t keep_mask);
+        void blit_sprite(const PSMLayout& frame_layout, int32_t x1, int32_t y1, int32_t x2, int32_t y2,
+            int32_t u1, int32_t v1, TexLookupInfo& tex_info, bool use_tex_alpha, uint8_t vtx_alpha, uint32_t keep_mask);
         void write_HWREG(uint64_t data);
         uint32_t local_to_host(uint128_t* target);
+        bool download_cache_matches();
+        void invalidate_download_cache(uint32_t first_page, uint32_t last_page);
         void unpack_PSMCT24(uint64_t data, int offset, bool z_format);
         uint64_t pack_PSMCT24(bool z_format);
         void local_to_local();
+        bool local_to_local_fast();
+        void local_to_local_blocks(const PSMLayout& layout, uint32_t mask);
+        void local_to_local_rows();
+        bool get_local_mem_range(const PSMLayout& layout, uint32_t base, uint32_t width, uint32_t x, uint32_t y,
+            uint32_t w, uint32_t h, uint32_t& start, uint32_t& end);
+
+        void reset_zbounds();
+        void invalidate_zbounds(uint32_t first_page, uint32_t last_page);
+        void invalidate_zbounds(const PSMLayout* layout, uint32_t base, uint32_t width,
+            int32_t x1, int32_t y1, int32_t x2, int32_t y2);
+        void begin_zbounds_primitive();
+        void end_zbounds_primitive();
+        void local_mem_written(const PSMLayout* layout, uint32_t base, uint32_t width,
+            int32_t x1, int32_t y1, int32_t x2, int32_t y2, bool zbounds = true);
+        void set_zbounds_range(int64_t min, int64_t max);
+        void update_zbounds(int32_t x1, int32_t y1, int32_t x2, int32_t y2, bool exact);
+        bool zbounds_exact_writes();
+        ZBlockTest test_zblock(int32_t x, int32_t y);
+        void set_depth_test_bypass(bool bypass);
+
+        bool get_displayed_pages(uint64_t* pages);
+        void mark_crt_dirty(uint32_t first_page, uint32_t last_page);
+        bool crt_output_unchanged(uint32_t* target, bool field, bool weave);
+        void set_frameskip(FrameskipMode mode, int interval);
+        bool end_frameskip_frame();
+        void mark_sampled_pages(const PSMLayout* layout, uint32_t base, uint32_t width,
+            int32_t x1, int32_t y1, int32_t x2, int32_t y2);
+        bool can_skip_primitive();
+        void reset_frame_stats();
+        void finish_frame_stats(GSFrameStats& stats);
+        void jit_add_counter(Emitter64& emitter, uint64_t* counter, uint32_t amount);
 
         int32_t orient2D(const Vertex& v1, const Vertex& v2, const Vertex& v3);
         void memdump(uint32_t* target, uint16_t& width, uint16_t& height);
 
         bool is_in_display(DISPLAY& display, int32_t x_start, int32_t y_start, int32_t x, int32_t y);
         uint32_t get_CRT_color(DISPFB& dispfb, int32_t x, int32_t y);
+        void read_CRT_row(const DISPFB& dispfb, int32_t x, int32_t y, int32_t count, uint32_t* row);
         void render_CRT(uint32_t* target);
 
         void write64(uint32_t addr, uint64_t value);
@@ -533,12 +819,22 @@ namespace gs
 
         void load_state(std::ifstream* state);
         void save_state(std::ofstream* state);
+
+        uint8_t* reserve_message(GSCommand type, size_t size);
+        void publish_messages();
+        void wait_for_messages(int& spin_count);
+        void send_return(GSReturnMessage data);
+
+        void process_register_message(const GSMessage& data, std::ofstream* gsdump);
+        void process_gif_data(const uint8_t* data, uint32_t size, std::ofstream* gsdump);
     public:
         GraphicsSynthesizerThread();
         ~GraphicsSynthesizerThread();
 
         // safe to access from emu thread
         void send_message(GSMessage message);
+        bool append_gif_data(int path, const uint128_t& data);
+        void send_gif_data(const GIFDataHeader& header, const uint128_t& data);
         void wake_thread();
         void wait_for_return(GSReturn type, GSReturnMessage& data);
         void reset();
@@ -0,0 +1,60 @@
+#include <algorithm>
+#include <cstring>
+#include "blockcache.hpp"
+
+namespace iop
+{
+    BlockCache::BlockCache()
+    {
+        flush();
+    }
+
+    CachedBlock* BlockCache::add_block(std::unique_ptr<CachedBlock> block, uint32_t phys_start)
+    {
+        CachedBlock* added = block.get();
+        uint32_t PC = block->PC;
+
+        if (phys_start < RAM_SIZE)
+        {
+            uint32_t phys_end = phys_start + (uint32_t)block->ops.size() * 4 - 1;
+            for (uint32_t page = phys_start >> PAGE_SHIFT; page <= (phys_end >> PAGE_SHIFT) && page < RAM_PAGES; page++)
+            {
+                //The block may still be listed in a page it covers that wasn't written to when it was last thrown away
+                std::vector<uint32_t>& list = page_blocks[page];
+                if (std::find(list.begin(), list.end(), PC) == list.end())
+                    list.push_back(PC);
+            }
+        }
+
+        blocks[PC] = std::move(block);
+        lookup_cache[(PC >> 2) & (LOOKUP_SIZE - 1)] = added;
+        return added;
+    }
+
+    void BlockCache::invalidate_page(uint32_t page)
+    {
+        //A block covering several pages is listed in each of them, and may already be gone
+        for (uint32_t PC : page_blocks[page])
+        {
+            auto it = blocks.find(PC);
+            if (it == blocks.end())
+                continue;
+
+            CachedBlock*& cached = lookup_cache[(PC >> 2) & (LOOKUP_SIZE - 1)];
+            if (cached == it->second.get())
+                cached = nullptr;
+            blocks.erase(it);
+        }
+        page_blocks[page].clear();
+        invalidated = true;
+    }
+
+    void BlockCache::flush()
+    {
+        blocks.clear();
+        std::memset(lookup_cache, 0, sizeof(lookup_cache));
+        for (uint32_t i = 0; i < RAM_PAGES; i++)
+            page_blocks[i].clear();
+        invalidated = true;
+    }
+}
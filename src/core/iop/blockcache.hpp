@@ -0,0 +1,101 @@
+#pragma once
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+namespace iop
+{
+    class IOP;
+
+    namespace interpreter
+    {
+        using InterpreterFunc = void(*)(IOP&, uint32_t);
+    }
+
+    //An instruction decoded ahead of time, with everything the interpreter loop used to work out on each step
+    struct CachedOp
+    {
+        interpreter::InterpreterFunc handler;
+        uint32_t instruction;
+        uint8_t cycles; //One to execute, plus the waitstate for uncached fetches
+        bool putc;      //One of the BIOS putc entry points
+    };
+
+    //A basic block: it ends with the delay slot of its first branch or jump
+    struct CachedBlock
+    {
+        uint32_t PC;
+        std::vector<CachedOp> ops;
+    };
+
+    //Decoded blocks of IOP code from RAM and the BIOS. RAM is tracked in small pages, since modules keep their data
+    //right next to their code, and a write to a page throws away every block that covers it.
+    class BlockCache
+    {
+        public:
+            constexpr static int PAGE_SHIFT = 8;
+            constexpr static uint32_t RAM_SIZE = 2 * 1024 * 1024;
+            constexpr static uint32_t RAM_PAGES = RAM_SIZE >> PAGE_SHIFT;
+            constexpr static int MAX_BLOCK_SIZE = 64;
+
+            BlockCache();
+
+            CachedBlock* find_block(uint32_t PC);
+            CachedBlock* add_block(std::unique_ptr<CachedBlock> block, uint32_t phys_start);
+
+            //addr is a physical address, anything outside of RAM is ignored
+            void invalidate(uint32_t addr, uint32_t size);
+            void flush();
+
+            //Set whenever a block is thrown away, so the interpreter knows to stop running the block it's in
+            bool blocks_invalidated() const;
+            void clear_invalidated();
+        private:
+            constexpr static int LOOKUP_SIZE = 0x4000;
+
+            std::unordered_map<uint32_t, std::unique_ptr<CachedBlock>> blocks;
+            CachedBlock* lookup_cache[LOOKUP_SIZE];
+            std::vector<uint32_t> page_blocks[RAM_PAGES]; //PCs of the blocks covering each page
+            bool invalidated;
+
+            void invalidate_page(uint32_t page);
+    };
+
+    inline CachedBlock* BlockCache::find_block(uint32_t PC)
+    {
+        CachedBlock* block = lookup_cache[(PC >> 2) & (LOOKUP_SIZE - 1)];
+        if (block && block->PC == PC)
+            return block;
+
+        auto it = blocks.find(PC);
+        if (it == blocks.end())
+            return nullptr;
+        lookup_cache[(PC >> 2) & (LOOKUP_SIZE - 1)] = it->second.get();
+        return it->second.get();
+    }
+
+    inline void BlockCache::invalidate(uint32_t addr, uint32_t size)
+    {
+        if (addr >= RAM_SIZE)
+            return;
+
+        uint32_t last = std::min(addr + size - 1, RAM_SIZE - 1) >> PAGE_SHIFT;
+        for (uint32_t page = addr >> PAGE_SHIFT; page <= last; page++)
+        {
+            if (!page_blocks[page].empty())
+                invalidate_page(page);
+        }
+    }
+
+    inline bool BlockCache::blocks_invalidated() const
+    {
+        return invalidated;
+    }
+
+    inline void BlockCache::clear_invalidated()
+    {
+        invalidated = false;
+    }
+}
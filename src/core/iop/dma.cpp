@@ -71,6 +71,7 @@ namespace iop
         fmt::print("[IOP][DMA] CDVD bytes: {:#x}\n", count);
         
         uint32_t bytes_read = cdvd->read_to_RAM(e->iop->ram + channels[IOP_CDVD].addr, count);
+        e->iop->invalidate_code(channels[IOP_CDVD].addr, bytes_read);
         if (count <= bytes_read)
         {
             transfer_end(IOP_CDVD);
@@ -107,6 +108,7 @@ namespace iop
                 {
                     uint32_t value = spu->read_DMA();
                     *(uint32_t*)&e->iop->ram[channels[IOP_SPU].addr] = value;
+                    e->iop->invalidate_code(channels[IOP_SPU].addr, 4);
                 }
                 channels[IOP_SPU].size--;
                 channels[IOP_SPU].addr += 4;
@@ -152,6 +154,7 @@ namespace iop
                 {
                     uint32_t value = spu2->read_DMA();
                     *(uint32_t*)&e->iop->ram[channels[IOP_SPU2].addr] = value;
+                    e->iop->invalidate_code(channels[IOP_SPU2].addr, 4);
                 }
                 channels[IOP_SPU2].size--;
                 channels[IOP_SPU2].addr += 4;
@@ -232,6 +235,7 @@ namespace iop
             uint32_t data = sif->read_SIF1();
 
             *(uint32_t*)&e->iop->ram[channels[IOP_SIF1].addr] = data;
+            e->iop->invalidate_code(channels[IOP_SIF1].addr, 4);
             channels[IOP_SIF1].addr += 4;
             channels[IOP_SIF1].word_count--;
             if (!channels[IOP_SIF1].word_count && channels[IOP_SIF1].tag_end)
@@ -280,6 +284,7 @@ namespace iop
         while (size)
         {
             e->iop->ram[channels[IOP_SIO2out].addr] = sio2->read_serial();
+            e->iop->invalidate_code(channels[IOP_SIO2out].addr, 1);
             channels[IOP_SIO2out].addr++;
             size--;
         }
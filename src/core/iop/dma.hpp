@@ -121,6 +121,7 @@ namespace iop
 
         void reset();
         void run(int cycles);
+        bool is_idle();
 
         uint32_t get_DPCR();
         uint32_t get_DPCR2();
@@ -149,4 +150,9 @@ namespace iop
         void load_state(std::ifstream& state);
         void save_state(std::ofstream& state);
     };
-}
\ No newline at end of file
+
+    inline bool DMA::is_idle()
+    {
+        return !active_channel;
+    }
+}
@@ -7,6 +7,10 @@ namespace iop
     {
         void interpret(IOP& cpu, uint32_t instruction);
 
+        //The function interpret() would end up calling for an instruction
+        InterpreterFunc lookup(uint32_t instruction);
+        void nop(IOP& cpu, uint32_t instruction);
+
         void j(IOP& cpu, uint32_t instruction);
         void jal(IOP& cpu, uint32_t instruction);
         void beq(IOP& cpu, uint32_t instruction);
@@ -3,21 +3,29 @@
 #include <ee/interpreter/emotiondisasm.hpp>
 #include <emulator.hpp>
 #include <util/errors.hpp>
+#include <util/hostmem.hpp>
 #include <algorithm>
 #include <cstring>
 #include <fmt/core.h>
 
 namespace iop
 {
+    //A backward branch taken this many times in a row gets checked for being a busy-wait
+    constexpr int BUSY_WAIT_THRESHOLD = 16;
+
     IOP::IOP(core::Emulator* e) : 
-        e(e)
+        e(e), jit_enabled(false), flush_jit_cache(false)
     {
-        ram = new uint8_t[2 * 1024 * 1024];
+        ram = HostMemory::alloc_guest(2 * 1024 * 1024);
+        read_map = new uint8_t*[PHYSICAL_PAGES];
+        write_map = new uint8_t*[PHYSICAL_PAGES];
     }
 
     IOP::~IOP()
     {
-        delete[] ram;
+        HostMemory::free_guest(ram, 2 * 1024 * 1024);
+        delete[] read_map;
+        delete[] write_map;
     }
 
     void IOP::reset()
@@ -32,10 +40,69 @@ namespace iop
         wait_for_IRQ = false;
         muldiv_delay = 0;
         cycles_to_run = 0;
+        reset_busy_wait();
+        block_cache.flush();
+        flush_jit_cache = true;
 
         /* HLE method to zero out IOP memory */
         std::memset(ram, 0, 2 * 1024 * 1024);
         scratchpad_start = 0x1F800000;
+        init_page_map();
+    }
+
+    void IOP::map_pages(uint32_t start, uint32_t size, uint8_t* mem, bool writable)
+    {
+        for (uint32_t offset = 0; offset < size; offset += 1 << PAGE_SHIFT)
+        {
+            read_map[(start + offset) >> PAGE_SHIFT] = mem + offset;
+            if (writable)
+                write_map[(start + offset) >> PAGE_SHIFT] = mem + offset;
+        }
+    }
+
+    void IOP::unmap_pages(uint32_t start, uint32_t size)
+    {
+        for (uint32_t offset = 0; offset < size; offset += 1 << PAGE_SHIFT)
+        {
+            read_map[(start + offset) >> PAGE_SHIFT] = nullptr;
+            write_map[(start + offset) >> PAGE_SHIFT] = nullptr;
+        }
+    }
+
+    //Must match the RAM and BIOS devices in Emulator::map_iop_mmio
+    void IOP::init_page_map()
+    {
+        std::memset(read_map, 0, PHYSICAL_PAGES * sizeof(uint8_t*));
+        std::memset(write_map, 0, PHYSICAL_PAGES * sizeof(uint8_t*));
+
+        map_pages(0x00000000, 2 * 1024 * 1024, ram, true);
+        map_pages(0x1FC00000, 4 * 1024 * 1024, e->BIOS, false);
+
+        mapped_scratchpad_start = 0xFFFFFFFF;
+        map_scratchpad();
+    }
+
+    //The scratchpad can be moved anywhere, but it only gets a page of its own where nothing else answers.
+    //Otherwise it's left to the fallback in Emulator::map_iop_mmio, which checks scratchpad_start on every access.
+    void IOP::map_scratchpad()
+    {
+        if (mapped_scratchpad_start != 0xFFFFFFFF)
+            unmap_pages(mapped_scratchpad_start, sizeof(scratchpad));
+        mapped_scratchpad_start = 0xFFFFFFFF;
+
+        if ((scratchpad_start & PAGE_MASK) || scratchpad_start >= PHYSICAL_MEMORY_SIZE)
+            return;
+        if (e->iop_mmio.is_mapped(scratchpad_start))
+            return;
+
+        map_pages(scratchpad_start, sizeof(scratchpad), scratchpad, true);
+        mapped_scratchpad_start = scratchpad_start;
+    }
+
+    void IOP::set_scratchpad_start(uint32_t start)
+    {
+        scratchpad_start = start;
+        map_scratchpad();
     }
 
     uint32_t IOP::translate_addr(uint32_t addr)
@@ -56,49 +123,410 @@ namespace iop
         if (!wait_for_IRQ)
         {
             cycles_to_run += cycles;
-            while (cycles_to_run > 0)
+            if (can_disassemble)
+                run_interpreter();
+            else if (jit_enabled)
+                run_jit();
+            else
+                run_cached();
+        }
+        else if (muldiv_delay)
+            muldiv_delay--;
+
+        if (cop0.status.IEc && (cop0.status.Im & cop0.cause.int_pending))
+            interrupt();
+    }
+
+    void IOP::run_interpreter()
+    {
+        while (cycles_to_run > 0)
+        {
+            cycles_to_run--;
+            if (muldiv_delay > 0)
+                muldiv_delay--;
+            uint32_t instr = read_instr(PC);
+            if (can_disassemble)
             {
-                cycles_to_run--;
-                if (muldiv_delay > 0)
-                    muldiv_delay--;
-                uint32_t instr = read_instr(PC);
-                if (can_disassemble)
+                fmt::print("[IOP] [{:#x}] {:#x} - {}\n", PC, instr, ee::interpreter::disasm_instr(instr, PC).c_str());
+                //print_state();
+            }
+
+            interpreter::interpret(*this, instr);
+
+            /* Detect calls to the putc function and handle them */
+            if (PC == 0x00012C48 || PC == 0x0001420C || PC == 0x0001430C)
+            {
+                e->iop_puts();
+            }
+
+            advance_PC();
+        }
+    }
+
+    //Same as run_interpreter, but with instructions decoded once per block instead of on every step
+    void IOP::run_cached()
+    {
+        while (cycles_to_run > 0)
+        {
+            CachedBlock* block = block_cache.find_block(PC);
+            if (!block)
+                block = decode_block(PC);
+            if (!block)
+            {
+                //Code outside of RAM and the BIOS isn't worth caching
+                step();
+                continue;
+            }
+
+            const CachedOp* ops = block->ops.data();
+            size_t op_count = block->ops.size();
+            uint32_t op_PC = PC;
+            block_cache.clear_invalidated();
+            for (size_t i = 0; i < op_count && cycles_to_run > 0; i++)
+            {
+                const CachedOp op = ops[i];
+                cycles_to_run -= op.cycles;
+                muldiv_delay = std::max(muldiv_delay - op.cycles, 0);
+
+                op.handler(*this, op.instruction);
+
+                if (op.putc && PC == op_PC)
+                    e->iop_puts();
+
+                advance_PC();
+                op_PC += 4;
+
+                //Leave the block on a taken branch or an exception, or if a store threw the block away
+                if (PC != op_PC || block_cache.blocks_invalidated())
+                    break;
+            }
+        }
+    }
+
+    //The recompiler hands back to the interpreter for code it can't run, and for delay slots it couldn't fit in
+    //a block, so the loop only enters it when no branch is pending
+    void IOP::run_jit()
+    {
+        while (cycles_to_run > 0)
+        {
+            if (flush_jit_cache)
+            {
+                jit::reset(true);
+                flush_jit_cache = false;
+            }
+
+            if (!will_branch)
+                jit::run(this);
+
+            if (cycles_to_run > 0)
+                step();
+        }
+    }
+
+    //Runs a single instruction the way run_interpreter does
+    void IOP::step()
+    {
+        cycles_to_run--;
+        if (muldiv_delay > 0)
+            muldiv_delay--;
+        uint32_t instr = read_instr(PC);
+        interpreter::interpret(*this, instr);
+
+        if (PC == 0x00012C48 || PC == 0x0001420C || PC == 0x0001430C)
+            e->iop_puts();
+
+        advance_PC();
+    }
+
+    CachedBlock* IOP::decode_block(uint32_t addr)
+    {
+        uint32_t phys = addr & 0x1FFFFFFF;
+        uint32_t phys_start = phys;
+        if (phys >= BlockCache::RAM_SIZE && phys < 0x1FC00000)
+            return nullptr;
+        if (!read_map[phys >> PAGE_SHIFT])
+            return nullptr;
+
+        //Same waitstate as read_instr
+        uint8_t cycles = (addr >= 0xA0000000 || !(cache_control & (1 << 11))) ? 5 : 1;
+
+        auto block = std::make_unique<CachedBlock>();
+        block->PC = addr;
+        bool delay_slot = false;
+        for (int i = 0; i < BlockCache::MAX_BLOCK_SIZE; i++)
+        {
+            if (phys >= PHYSICAL_MEMORY_SIZE)
+                break;
+            uint8_t* mem = read_map[phys >> PAGE_SHIFT];
+            if (!mem)
+                break;
+            uint32_t instr = *(uint32_t*)&mem[phys & PAGE_MASK];
+
+            CachedOp op;
+            op.handler = interpreter::lookup(instr);
+            op.instruction = instr;
+            op.cycles = cycles;
+            op.putc = addr == 0x00012C48 || addr == 0x0001420C || addr == 0x0001430C;
+            block->ops.push_back(op);
+
+            if (delay_slot)
+                break;
+
+            uint8_t opcode = instr >> 26;
+            if ((opcode >= 0x01 && opcode <= 0x07) || (!opcode && ((instr & 0x3F) == 0x08 || (instr & 0x3F) == 0x09)))
+                delay_slot = true;
+
+            addr += 4;
+            phys += 4;
+        }
+
+        return block_cache.add_block(std::move(block), phys_start);
+    }
+
+    void IOP::advance_PC()
+    {
+        PC += 4;
+
+        if (will_branch)
+        {
+            if (!branch_delay)
+            {
+                uint32_t branch_PC = PC - 8;
+                will_branch = false;
+                PC = new_PC;
+                if (PC & 0x3)
                 {
-                    fmt::print("[IOP] [{:#x}] {:#x} - {}\n", PC, instr, ee::interpreter::disasm_instr(instr, PC).c_str());
-                    //print_state();
+                    Errors::die("[IOP] Invalid PC address $%08X!\n", PC);
                 }
-                
-                interpreter::interpret(*this, instr);
+                if (PC <= branch_PC && branch_PC - PC < MAX_BUSY_WAIT_SIZE * 4)
+                    detect_busy_wait(branch_PC);
+            }
+            else
+                branch_delay--;
+        }
+    }
+
+    void IOP::reset_busy_wait()
+    {
+        spin_PC = 0xFFFFFFFF;
+        spin_branch_PC = 0xFFFFFFFF;
+        spin_count = 0;
+        spin_idle = false;
+    }
+
+    //Called after a short loop branches back to PC. Once it has spun long enough to be checked and turns out
+    //to only poll, nothing it reads can change until an interrupt, a DMA or another component runs, all of which
+    //happen between timeslices. So the IOP sits out the rest of the timeslice instead of stepping through it.
+    void IOP::detect_busy_wait(uint32_t branch_PC)
+    {
+        if (PC != spin_PC || branch_PC != spin_branch_PC)
+        {
+            spin_PC = PC;
+            spin_branch_PC = branch_PC;
+            spin_count = 0;
+            spin_idle = false;
+            return;
+        }
 
-                /* Detect calls to the putc function and handle them */
-                if (PC == 0x00012C48 || PC == 0x0001420C || PC == 0x0001430C)
+        if (spin_count < BUSY_WAIT_THRESHOLD)
+        {
+            spin_count++;
+            if (spin_count == BUSY_WAIT_THRESHOLD)
+                spin_idle = is_idle_loop(branch_PC);
+        }
+        else if (spin_idle)
+        {
+            //The loop may have been left and entered again, such as a shared poll helper called with another
+            //address, and the verdict depends on the registers it was made with. Skipping ends the timeslice,
+            //so this runs at most once per timeslice.
+            spin_idle = is_idle_loop(branch_PC);
+        }
+
+        if (spin_idle)
+        {
+            muldiv_delay = std::max(muldiv_delay - cycles_to_run, 0);
+            cycles_to_run = 0;
+        }
+    }
+
+    //What an instruction reads and writes, or false if it does something other than compute, load or branch.
+    //Bit 0 is never set, as $zero never carries anything.
+    static bool busy_wait_op(uint32_t instr, uint32_t& reads, uint32_t& writes, bool& is_load, bool& is_branch)
+    {
+        uint32_t rs = 1u << ((instr >> 21) & 0x1F);
+        uint32_t rt = 1u << ((instr >> 16) & 0x1F);
+        uint32_t rd = 1u << ((instr >> 11) & 0x1F);
+        reads = writes = 0;
+        is_load = is_branch = false;
+
+        switch (instr >> 26)
+        {
+            case 0x00:
+                switch (instr & 0x3F)
                 {
-                    e->iop_puts();
+                    case 0x00: //SLL
+                    case 0x02: //SRL
+                    case 0x03: //SRA
+                        reads = rt;
+                        writes = rd;
+                        break;
+                    case 0x04: //SLLV
+                    case 0x06: //SRLV
+                    case 0x07: //SRAV
+                    case 0x21: //ADDU
+                    case 0x23: //SUBU
+                    case 0x24: //AND
+                    case 0x25: //OR
+                    case 0x26: //XOR
+                    case 0x27: //NOR
+                    case 0x2A: //SLT
+                    case 0x2B: //SLTU
+                        reads = rs | rt;
+                        writes = rd;
+                        break;
+                    case 0x10: //MFHI
+                    case 0x12: //MFLO
+                        writes = rd;
+                        break;
+                    default:
+                        return false;
                 }
+                break;
+            case 0x01: //BLTZ, BGEZ
+                if (((instr >> 16) & 0x1F) > 0x01)
+                    return false;
+                reads = rs;
+                is_branch = true;
+                break;
+            case 0x02: //J
+                is_branch = true;
+                break;
+            case 0x04: //BEQ
+            case 0x05: //BNE
+                reads = rs | rt;
+                is_branch = true;
+                break;
+            case 0x06: //BLEZ
+            case 0x07: //BGTZ
+                reads = rs;
+                is_branch = true;
+                break;
+            case 0x09: //ADDIU
+            case 0x0A: //SLTI
+            case 0x0B: //SLTIU
+            case 0x0C: //ANDI
+            case 0x0D: //ORI
+            case 0x0E: //XORI
+                reads = rs;
+                writes = rt;
+                break;
+            case 0x0F: //LUI
+                writes = rt;
+                break;
+            case 0x20: //LB
+            case 0x21: //LH
+            case 0x23: //LW
+            case 0x24: //LBU
+            case 0x25: //LHU
+                reads = rs;
+                writes = rt;
+                is_load = true;
+                break;
+            default:
+                return false;
+        }
+        reads &= ~1u;
+        writes &= ~1u;
+        return true;
+    }
+
+    //A loop only polls if every pass does the same thing: no stores, loads from fixed addresses without side effects,
+    //and no register read before the loop writes it, which would carry a value over from the previous pass
+    bool IOP::is_idle_loop(uint32_t branch_PC)
+    {
+        uint32_t start = PC;
+        uint32_t end = branch_PC + 4;
+        uint32_t reads, writes;
+        bool is_load, is_branch;
+
+        uint32_t loop_writes = 0;
+        for (uint32_t addr = start; addr <= end; addr += 4)
+        {
+            if (!busy_wait_op(read32(addr), reads, writes, is_load, is_branch))
+                return false;
+            if (is_branch != (addr == branch_PC))
+                return false;
+            loop_writes |= writes;
+        }
+
+        //Registers the loop never writes keep their current values while it spins
+        bool known[32];
+        uint32_t value[32];
+        for (int i = 0; i < 32; i++)
+        {
+            known[i] = !(loop_writes & (1u << i));
+            value[i] = gpr[i];
+        }
+
+        uint32_t written = 0;
+        for (uint32_t addr = start; addr <= end; addr += 4)
+        {
+            uint32_t instr = read32(addr);
+            busy_wait_op(instr, reads, writes, is_load, is_branch);
+
+            if (reads & loop_writes & ~written)
+                return false;
 
-                PC += 4;
+            int rs = (instr >> 21) & 0x1F;
+            if (is_load && (!known[rs] || !can_poll(value[rs] + (int16_t)instr)))
+                return false;
 
-                if (will_branch)
+            written |= writes;
+            for (int i = 1; i < 32; i++)
+            {
+                if (!(writes & (1u << i)))
+                    continue;
+                switch (instr >> 26)
                 {
-                    if (!branch_delay)
-                    {
-                        will_branch = false;
-                        PC = new_PC;
-                        if (PC & 0x3)
-                        {
-                            Errors::die("[IOP] Invalid PC address $%08X!\n", PC);
-                        }
-                    }
-                    else
-                        branch_delay--;
+                    case 0x09: //ADDIU
+                        known[i] = known[rs];
+                        value[i] = value[rs] + (int16_t)instr;
+                        break;
+                    case 0x0D: //ORI
+                        known[i] = known[rs];
+                        value[i] = value[rs] | (instr & 0xFFFF);
+                        break;
+                    case 0x0F: //LUI
+                        known[i] = true;
+                        value[i] = instr << 16;
+                        break;
+                    default:
+                        known[i] = false;
+                        break;
                 }
             }
         }
-        else if (muldiv_delay)
-            muldiv_delay--;
+        return true;
+    }
 
-        if (cop0.status.IEc && (cop0.status.Im & cop0.cause.int_pending))
-            interrupt();
+    //Memory, and the registers games poll that don't change when read. FIFOs and I_CTRL are left out.
+    bool IOP::can_poll(uint32_t addr)
+    {
+        addr = translate_addr(addr);
+        if (addr < PHYSICAL_MEMORY_SIZE && read_map[addr >> PAGE_SHIFT])
+            return true;
+
+        if (addr == 0x1F801070 || addr == 0x1F801074) //I_STAT, I_MASK
+            return true;
+        if ((addr >= 0x1F801080 && addr < 0x1F801100) || (addr >= 0x1F801500 && addr < 0x1F801580)) //DMA
+            return true;
+        if ((addr >= 0x1F801100 && addr < 0x1F801130) || (addr >= 0x1F801480 && addr < 0x1F8014B0)) //Timers
+            return true;
+        if (addr >= 0x1D000000 && addr < 0x1D000050) //SIF mailboxes and flags
+            return true;
+        if (addr == 0x1F402005 || addr == 0x1F402008 || addr == 0x1F402017) //CDVD N/S status, I_STAT
+            return true;
+        return false;
     }
 
     void IOP::print_state()
@@ -121,6 +549,12 @@ namespace iop
         can_disassemble = dis;
     }
 
+    void IOP::set_jit(bool enabled)
+    {
+        jit_enabled = enabled;
+        flush_jit_cache = true;
+    }
+
     void IOP::jp(uint32_t addr)
     {
         if (!will_branch)
@@ -178,6 +612,7 @@ namespace iop
         fmt::print("[IOP] Processing interrupt!\n");
         handle_exception(0x80000084, 0x00);
         unhalt();
+        reset_busy_wait();
     }
 
     void IOP::mfc(int cop_id, int cop_reg, int reg)
@@ -216,7 +651,14 @@ namespace iop
 
     uint8_t IOP::read8(uint32_t addr)
     {
-        return e->iop_read8(translate_addr(addr));
+        addr = translate_addr(addr);
+        if (addr < PHYSICAL_MEMORY_SIZE)
+        {
+            uint8_t* mem = read_map[addr >> PAGE_SHIFT];
+            if (mem)
+                return mem[addr & PAGE_MASK];
+        }
+        return e->iop_read8(addr);
     }
 
     uint16_t IOP::read16(uint32_t addr)
@@ -225,7 +667,14 @@ namespace iop
         {
             Errors::die("[IOP] Invalid read16 from $%08X!\n", addr);
         }
-        return e->iop_read16(translate_addr(addr));
+        addr = translate_addr(addr);
+        if (addr < PHYSICAL_MEMORY_SIZE)
+        {
+            uint8_t* mem = read_map[addr >> PAGE_SHIFT];
+            if (mem)
+                return *(uint16_t*)&mem[addr & PAGE_MASK];
+        }
+        return e->iop_read16(addr);
     }
 
     uint32_t IOP::read32(uint32_t addr)
@@ -236,7 +685,14 @@ namespace iop
         }
         if (addr == 0xFFFE0130)
             return cache_control;
-        return e->iop_read32(translate_addr(addr));
+        addr = translate_addr(addr);
+        if (addr < PHYSICAL_MEMORY_SIZE)
+        {
+            uint8_t* mem = read_map[addr >> PAGE_SHIFT];
+            if (mem)
+                return *(uint32_t*)&mem[addr & PAGE_MASK];
+        }
+        return e->iop_read32(addr);
     }
 
     uint32_t IOP::read_instr(uint32_t addr)
@@ -268,14 +724,29 @@ namespace iop
                 icache[index].tag = tag;
             }
         }*/
-        return e->iop_read32(addr & 0x1FFFFFFF);
+        addr &= 0x1FFFFFFF;
+        uint8_t* mem = read_map[addr >> PAGE_SHIFT];
+        if (mem)
+            return *(uint32_t*)&mem[addr & PAGE_MASK];
+        return e->iop_read32(addr);
     }
 
     void IOP::write8(uint32_t addr, uint8_t value)
     {
         if (cop0.status.IsC)
             return;
-        e->iop_write8(translate_addr(addr), value);
+        addr = translate_addr(addr);
+        if (addr < PHYSICAL_MEMORY_SIZE)
+        {
+            uint8_t* mem = write_map[addr >> PAGE_SHIFT];
+            if (mem)
+            {
+                mem[addr & PAGE_MASK] = value;
+                invalidate_code(addr, 1);
+                return;
+            }
+        }
+        e->iop_write8(addr, value);
     }
 
     void IOP::write16(uint32_t addr, uint16_t value)
@@ -286,7 +757,18 @@ namespace iop
         {
             Errors::die("[IOP] Invalid write16 to $%08X!\n", addr);
         }
-        e->iop_write16(translate_addr(addr), value);
+        addr = translate_addr(addr);
+        if (addr < PHYSICAL_MEMORY_SIZE)
+        {
+            uint8_t* mem = write_map[addr >> PAGE_SHIFT];
+            if (mem)
+            {
+                *(uint16_t*)&mem[addr & PAGE_MASK] = value;
+                invalidate_code(addr, 2);
+                return;
+            }
+        }
+        e->iop_write16(addr, value);
     }
 
     void IOP::write32(uint32_t addr, uint32_t value)
@@ -303,7 +785,26 @@ namespace iop
         }
         //Check for cache control here, as it's used internally by the IOP
         if (addr == 0xFFFE0130)
+        {
+            //Blocks have the fetch waitstate baked in
+            if ((cache_control ^ value) & (1 << 11))
+            {
+                block_cache.flush();
+                flush_jit_cache = true;
+            }
             cache_control = value;
-        e->iop_write32(translate_addr(addr), value);
+        }
+        addr = translate_addr(addr);
+        if (addr < PHYSICAL_MEMORY_SIZE)
+        {
+            uint8_t* mem = write_map[addr >> PAGE_SHIFT];
+            if (mem)
+            {
+                *(uint32_t*)&mem[addr & PAGE_MASK] = value;
+                invalidate_code(addr, 4);
+                return;
+            }
+        }
+        e->iop_write32(addr, value);
     }
 }
\ No newline at end of file
@@ -1,5 +1,7 @@
 #pragma once
+#include <iop/blockcache.hpp>
 #include <iop/cop0.hpp>
+#include <iop/jit/iop_jit.hpp>
 #include <cstdint>
 #include <cstdlib>
 #include <cstdio>
@@ -24,6 +26,15 @@ namespace iop
         "gp", "sp", "fp", "ra"
     };
 
+    //Physical memory is mapped in 1 KB pages, small enough for the scratchpad to get pages of its own
+    constexpr int PAGE_SHIFT = 10;
+    constexpr uint32_t PAGE_MASK = (1 << PAGE_SHIFT) - 1;
+    constexpr uint32_t PHYSICAL_MEMORY_SIZE = 0x20000000;
+    constexpr uint32_t PHYSICAL_PAGES = PHYSICAL_MEMORY_SIZE >> PAGE_SHIFT;
+
+    //Backward branches to no more than this many instructions back are checked for busy-waits
+    constexpr uint32_t MAX_BUSY_WAIT_SIZE = 8;
+
     struct IOP_ICacheLine
     {
         bool valid;
@@ -44,9 +55,17 @@ namespace iop
         uint8_t scratchpad[1024] = {};
         uint32_t scratchpad_start = 0x1F800000;
 
+        //Host pointers for every physical page that is plain memory. nullptr means the page holds registers,
+        //so the access goes through Emulator::iop_read*/iop_write*. BIOS pages are only in read_map.
+        uint8_t** read_map = nullptr;
+        uint8_t** write_map = nullptr;
+        uint32_t mapped_scratchpad_start;
+
         //4 KB bytes / 16 bytes per line = 256 cache lines
         IOP_ICacheLine icache[256];
 
+        BlockCache block_cache;
+
         uint32_t new_PC;
         uint32_t cache_control;
         int branch_delay;
@@ -54,10 +73,37 @@ namespace iop
         bool will_branch;
         bool wait_for_IRQ;
 
+        //The recompiler's blocks have the fetch waitstate baked in too. They're thrown away on the next run,
+        //as the block doing the write may be running.
+        bool jit_enabled;
+        bool flush_jit_cache;
+
         int muldiv_delay;
         int cycles_to_run;
 
+        //Busy-wait detection: the last backward branch taken, how many times in a row it was taken,
+        //and whether the loop it closes was found to have no side effects
+        uint32_t spin_PC, spin_branch_PC;
+        int spin_count;
+        bool spin_idle;
+
         uint32_t translate_addr(uint32_t addr);
+        void map_pages(uint32_t start, uint32_t size, uint8_t* mem, bool writable);
+        void unmap_pages(uint32_t start, uint32_t size);
+        void init_page_map();
+        void map_scratchpad();
+
+        void run_interpreter();
+        void run_cached();
+        void run_jit();
+        void step();
+        CachedBlock* decode_block(uint32_t addr);
+        void advance_PC();
+
+        void detect_busy_wait(uint32_t branch_PC);
+        bool is_idle_loop(uint32_t branch_PC);
+        bool can_poll(uint32_t addr);
+        void reset_busy_wait();
     
     public:
         IOP(core::Emulator* e);
@@ -65,11 +111,15 @@ namespace iop
 
         void reset();
         void run(int cycles);
+        bool is_halted();
         void halt();
         void unhalt();
         void print_state();
         void set_disassembly(bool dis);
+        void set_jit(bool enabled);
         void set_muldiv_delay(int delay);
+        void set_scratchpad_start(uint32_t start);
+        void invalidate_code(uint32_t addr, uint32_t size);
 
         void jp(uint32_t addr);
         void branch(bool condition, int32_t offset);
@@ -115,6 +165,20 @@ namespace iop
         wait_for_IRQ = false;
     }
 
+    //True when run() would do nothing: waiting for an IRQ that isn't pending
+    inline bool IOP::is_halted()
+    {
+        return wait_for_IRQ && !muldiv_delay && !(cop0.status.IEc && (cop0.status.Im & cop0.cause.int_pending));
+    }
+
+    //For anything that writes to IOP RAM without going through the IOP, such as DMA. addr is an offset into RAM.
+    inline void IOP::invalidate_code(uint32_t addr, uint32_t size)
+    {
+        block_cache.invalidate(addr, size);
+        if (jit_enabled)
+            jit::invalidate(addr, size);
+    }
+
     inline uint32_t IOP::get_PC()
     {
         return PC;
@@ -0,0 +1,26 @@
+#include "iop_jit.hpp"
+#include "iop_jit64.hpp"
+#include <iop/iop.hpp>
+
+namespace iop
+{
+    namespace jit
+    {
+        IOP_JIT64 jit64;
+
+        void run(IOP* iop)
+        {
+            jit64.run(*iop);
+        }
+
+        void reset(bool clear_cache)
+        {
+            jit64.reset(clear_cache);
+        }
+
+        void invalidate(uint32_t addr, uint32_t size)
+        {
+            jit64.invalidate(addr, size);
+        }
+    }
+}
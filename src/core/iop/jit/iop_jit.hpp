@@ -0,0 +1,13 @@
+#pragma once
+#include <cstdint>
+
+namespace iop
+{
+    class IOP;
+    namespace jit
+    {
+        void run(IOP* iop);
+        void reset(bool clear_cache);
+        void invalidate(uint32_t addr, uint32_t size);
+    }
+}
@@ -0,0 +1,903 @@
+#include <algorithm>
+#include "iop_jit64.hpp"
+#include <iop/iop.hpp>
+#include <util/errors.hpp>
+
+/**
+    * See the calling convention notes in ee_jit64.cpp. The IOP recompiler only passes integer arguments.
+    *
+    * The prologue reserves the stack space for every call a block makes: 32 bytes of shadow space on Windows.
+    * The return address and the registers it pushes (seven on Windows, five elsewhere) already leave RSP
+    * 16-byte aligned, so the reserve has to stay a multiple of 16.
+    */
+#ifdef _WIN32
+constexpr REG_64 ARG0 = REG_64::RCX;
+constexpr REG_64 ARG1 = REG_64::RDX;
+constexpr REG_64 ARG2 = REG_64::R8;
+constexpr uint32_t STACK_RESERVE = 0x20;
+#else
+constexpr REG_64 ARG0 = REG_64::RDI;
+constexpr REG_64 ARG1 = REG_64::RSI;
+constexpr REG_64 ARG2 = REG_64::RDX;
+constexpr uint32_t STACK_RESERVE = 0;
+#endif
+
+extern "C"
+uint8_t* exec_block_iop(iop::jit::IOP_JIT64& jit, iop::IOP& iop)
+{
+    //Blocks that were written over are only freed here, where none of them can be running: every block leaves
+    //through the slow path in the prologue block
+    jit.free_stale_blocks();
+
+    if (!jit.can_recompile(iop, iop.PC))
+        return jit.dispatcher_exit;
+
+    IOPJitBlockRecord* recompiledBlock = jit.jit_heap.find_block(iop.PC);
+    if (recompiledBlock == nullptr)
+    {
+        IR::Block block = jit.ir.translate(iop);
+        recompiledBlock = jit.recompile_block(iop, block);
+    }
+    jit.jit_heap.lookup_cache[(iop.PC >> 2) & 0x7FFF] = recompiledBlock;
+    return (uint8_t*)recompiledBlock->code_start;
+}
+
+namespace iop
+{
+    namespace jit
+    {
+        //Registers are 32-bit and the JIT only uses the low half of the x64 registers, so RAX etc. stand for EAX etc.
+        //R13: Fast lookup cache
+        //R14: JIT64 object
+        //R15: IOP object
+        static uint32_t get_gpr_offset(int index)
+        {
+            return offsetof(IOP, gpr) + index * sizeof(uint32_t);
+        }
+
+        IOP_JIT64::IOP_JIT64() : jit_block("IOP"), emitter(&jit_block), prologue_block(nullptr),
+            dispatcher_slow_path(nullptr), dispatcher_exit(nullptr)
+        {
+        }
+
+        void IOP_JIT64::reset(bool clear_cache)
+        {
+            cycles_synced = 0;
+
+            if (clear_cache)
+            {
+                jit_heap.flush_all_blocks();
+                for (uint32_t i = 0; i < BlockCache::RAM_PAGES; i++)
+                    page_blocks[i].clear();
+                stale_blocks.clear();
+                prologue_block = create_prologue_block();
+            }
+        }
+
+        void IOP_JIT64::run(IOP& iop)
+        {
+            prologue_block(*this, iop, &jit_heap.lookup_cache[0]);
+        }
+
+        //Same rules as IOP::decode_block
+        bool IOP_JIT64::can_recompile(IOP& iop, uint32_t PC) const
+        {
+            uint32_t phys = PC & 0x1FFFFFFF;
+            if (phys >= BlockCache::RAM_SIZE && phys < 0x1FC00000)
+                return false;
+            return iop.read_map[phys >> PAGE_SHIFT] != nullptr;
+        }
+
+        //addr is a physical address, anything outside of RAM is ignored. The block doing the write may be one of those
+        //thrown away, so they're only unhooked from the dispatcher here.
+        void IOP_JIT64::invalidate(uint32_t addr, uint32_t size)
+        {
+            if (addr >= BlockCache::RAM_SIZE)
+                return;
+
+            uint32_t last = std::min(addr + size - 1, BlockCache::RAM_SIZE - 1) >> BlockCache::PAGE_SHIFT;
+            for (uint32_t page = addr >> BlockCache::PAGE_SHIFT; page <= last; page++)
+            {
+                for (uint32_t PC : page_blocks[page])
+                {
+                    jit_heap.lookup_cache[(PC >> 2) & 0x7FFF] = nullptr;
+                    stale_blocks.push_back(PC);
+                }
+                page_blocks[page].clear();
+            }
+        }
+
+        void IOP_JIT64::free_stale_blocks()
+        {
+            for (uint32_t PC : stale_blocks)
+                jit_heap.invalidate_block(PC);
+            stale_blocks.clear();
+        }
+
+        IOPJitPrologue IOP_JIT64::create_prologue_block()
+        {
+            jit_block.clear();
+
+            emit_prologue();
+
+            //Store the JIT64/IOP objects in R14/R15 respectively
+            emitter.MOV64_MR(ARG0, REG_64::R14);
+            emitter.MOV64_MR(ARG1, REG_64::R15);
+            emitter.MOV64_MR(ARG2, REG_64::R13);
+
+            //With no slow path yet, the dispatcher emits it here
+            dispatcher_slow_path = nullptr;
+            uint8_t* exit = emit_dispatcher();
+            std::size_t slow_path_offset = dispatcher_slow_path - jit_block.get_code_start();
+            std::size_t exit_offset = exit - jit_block.get_code_start();
+
+            //Reserve 0xFFFFFFFF as the PC.
+            //Because this is an invalid address, it doesn't matter that the prologue block has this.
+            IOPJitBlockRecord* record = jit_heap.insert_block(0xFFFFFFFF, &jit_block);
+            dispatcher_slow_path = (uint8_t*)record->code_start + slow_path_offset;
+            dispatcher_exit = (uint8_t*)record->code_start + exit_offset;
+            return (IOPJitPrologue)record->code_start;
+        }
+
+        //Returns where the dispatcher returns to run(), which is the start of the epilogue
+        uint8_t* IOP_JIT64::emit_dispatcher()
+        {
+            emitter.CMP32_IMM_MEM(0, REG_64::R15, offsetof(IOP, cycles_to_run));
+            uint8_t* exit_cyclecount = emitter.JCC_NEAR_DEFERRED(ConditionCode::LE);
+
+            //ptr = lookup_cache[(PC >> 2) & 0x7FFF], see EE_JIT64::emit_dispatcher
+            emitter.MOV32_FROM_MEM(REG_64::R15, REG_64::RCX, offsetof(IOP, PC));
+            emitter.MOV32_REG(REG_64::RCX, REG_64::RAX);
+            emitter.AND32_EAX(0x7FFF << 2);
+            emitter.LEA64_REG(REG_64::RAX, REG_64::R13, REG_64::RAX, 0, 1);
+            emitter.MOV64_FROM_MEM(REG_64::RAX, REG_64::RAX);
+
+            emitter.CMP64_IMM(0, REG_64::RAX);
+            uint8_t* slow_path_dest1 = emitter.JCC_NEAR_DEFERRED(ConditionCode::E);
+
+            emitter.MOV32_FROM_MEM(REG_64::RAX, REG_64::RDX,
+                                   offsetof(IOPJitBlockRecord, block_data) + offsetof(EEJitBlockRecordData, pc));
+            emitter.CMP32_REG(REG_64::RCX, REG_64::RDX);
+            uint8_t* slow_path_dest2 = emitter.JCC_NEAR_DEFERRED(ConditionCode::NE);
+
+            emitter.MOV64_FROM_MEM(REG_64::RAX, REG_64::RAX, offsetof(IOPJitBlockRecord, code_start));
+
+            //Tail-call optimization
+            emitter.JMP_INDIR(REG_64::RAX);
+
+            //Find, or recompile, the block the slow way
+            emitter.set_jump_dest(slow_path_dest1);
+            emitter.set_jump_dest(slow_path_dest2);
+            if (dispatcher_slow_path)
+            {
+                emitter.MOV64_OI((uint64_t)dispatcher_slow_path, REG_64::RAX);
+                emitter.JMP_INDIR(REG_64::RAX);
+            }
+            else
+            {
+                dispatcher_slow_path = jit_block.get_code_pos();
+                emitter.MOV64_MR(REG_64::R14, ARG0);
+                emitter.MOV64_MR(REG_64::R15, ARG1);
+                call_func((uint64_t)exec_block_iop);
+                emitter.JMP_INDIR(REG_64::RAX);
+            }
+
+            emitter.set_jump_dest(exit_cyclecount);
+            uint8_t* exit = jit_block.get_code_pos();
+            emit_epilogue();
+            return exit;
+        }
+
+        IOPJitBlockRecord* IOP_JIT64::recompile_block(IOP& iop, IR::Block& block)
+        {
+            cycles_synced = 0;
+            bool syscall = false;
+
+            jit_block.clear();
+
+            while (block.get_instruction_count() > 0)
+            {
+                IR::Instruction instr = block.get_next_instr();
+                syscall = instr.op == IR::Opcode::SystemCall;
+                emit_instruction(iop, instr);
+            }
+
+            cleanup_recompiler(iop, block, syscall);
+
+            //A block listed in a page it doesn't cover anymore is harmless, it just gets recompiled
+            uint32_t PC = iop.get_PC();
+            uint32_t phys_start = PC & 0x1FFFFFFF;
+            if (phys_start < BlockCache::RAM_SIZE)
+            {
+                uint32_t phys_end = phys_start + (ir.get_end_PC() - PC) - 1;
+                for (uint32_t page = phys_start >> BlockCache::PAGE_SHIFT;
+                     page <= (phys_end >> BlockCache::PAGE_SHIFT) && page < BlockCache::RAM_PAGES; page++)
+                {
+                    std::vector<uint32_t>& list = page_blocks[page];
+                    if (std::find(list.begin(), list.end(), PC) == list.end())
+                        list.push_back(PC);
+                }
+            }
+
+            return jit_heap.insert_block(PC, &jit_block);
+        }
+
+        void IOP_JIT64::emit_instruction(IOP& iop, IR::Instruction& instr)
+        {
+            switch (instr.op)
+            {
+                case IR::Opcode::Null:
+                    break;
+                case IR::Opcode::AddWordImm:
+                    add_word_imm(iop, instr);
+                    break;
+                case IR::Opcode::AddWordReg:
+                    add_word_reg(iop, instr);
+                    break;
+                case IR::Opcode::AndImm:
+                    and_imm(iop, instr);
+                    break;
+                case IR::Opcode::AndReg:
+                    and_reg(iop, instr);
+                    break;
+                case IR::Opcode::BranchEqual:
+                    branch_equal(iop, instr);
+                    break;
+                case IR::Opcode::BranchEqualZero:
+                    branch_equal_zero(iop, instr);
+                    break;
+                case IR::Opcode::BranchGreaterThanOrEqualZero:
+                    branch_greater_than_or_equal_zero(iop, instr);
+                    break;
+                case IR::Opcode::BranchGreaterThanZero:
+                    branch_greater_than_zero(iop, instr);
+                    break;
+                case IR::Opcode::BranchLessThanOrEqualZero:
+                    branch_less_than_or_equal_zero(iop, instr);
+                    break;
+                case IR::Opcode::BranchLessThanZero:
+                    branch_less_than_zero(iop, instr);
+                    break;
+                case IR::Opcode::BranchNotEqual:
+                    branch_not_equal(iop, instr);
+                    break;
+                case IR::Opcode::BranchNotEqualZero:
+                    branch_not_equal_zero(iop, instr);
+                    break;
+                case IR::Opcode::Jump:
+                    jump(iop, instr);
+                    break;
+                case IR::Opcode::JumpIndirect:
+                    jump_indirect(iop, instr);
+                    break;
+                case IR::Opcode::LoadByte:
+                    load_byte(iop, instr);
+                    break;
+                case IR::Opcode::LoadByteUnsigned:
+                    load_byte_unsigned(iop, instr);
+                    break;
+                case IR::Opcode::LoadConst:
+                    load_const(iop, instr);
+                    break;
+                case IR::Opcode::LoadHalfword:
+                    load_halfword(iop, instr);
+                    break;
+                case IR::Opcode::LoadHalfwordUnsigned:
+                    load_halfword_unsigned(iop, instr);
+                    break;
+                case IR::Opcode::LoadWord:
+                    load_word(iop, instr);
+                    break;
+                case IR::Opcode::NorReg:
+                    nor_reg(iop, instr);
+                    break;
+                case IR::Opcode::OrImm:
+                    or_imm(iop, instr);
+                    break;
+                case IR::Opcode::OrReg:
+                    or_reg(iop, instr);
+                    break;
+                case IR::Opcode::SetOnLessThan:
+                    set_on_less_than(iop, instr);
+                    break;
+                case IR::Opcode::SetOnLessThanUnsigned:
+                    set_on_less_than_unsigned(iop, instr);
+                    break;
+                case IR::Opcode::SetOnLessThanImmediate:
+                    set_on_less_than_immediate(iop, instr);
+                    break;
+                case IR::Opcode::SetOnLessThanImmediateUnsigned:
+                    set_on_less_than_immediate_unsigned(iop, instr);
+                    break;
+                case IR::Opcode::ShiftLeftLogical:
+                    shift_left_logical(iop, instr);
+                    break;
+                case IR::Opcode::ShiftLeftLogicalVariable:
+                    shift_left_logical_variable(iop, instr);
+                    break;
+                case IR::Opcode::ShiftRightArithmetic:
+                    shift_right_arithmetic(iop, instr);
+                    break;
+                case IR::Opcode::ShiftRightArithmeticVariable:
+                    shift_right_arithmetic_variable(iop, instr);
+                    break;
+                case IR::Opcode::ShiftRightLogical:
+                    shift_right_logical(iop, instr);
+                    break;
+                case IR::Opcode::ShiftRightLogicalVariable:
+                    shift_right_logical_variable(iop, instr);
+                    break;
+                case IR::Opcode::StoreByte:
+                    store_byte(iop, instr);
+                    break;
+                case IR::Opcode::StoreHalfword:
+                    store_halfword(iop, instr);
+                    break;
+                case IR::Opcode::StoreWord:
+                    store_word(iop, instr);
+                    break;
+                case IR::Opcode::SubWordReg:
+                    sub_word_reg(iop, instr);
+                    break;
+                case IR::Opcode::SystemCall:
+                    system_call(iop, instr);
+                    break;
+                case IR::Opcode::XorImm:
+                    xor_imm(iop, instr);
+                    break;
+                case IR::Opcode::XorReg:
+                    xor_reg(iop, instr);
+                    break;
+                case IR::Opcode::FallbackInterpreter:
+                    fallback_interpreter(iop, instr);
+                    break;
+                default:
+                    Errors::die("[IOP_JIT] Unknown IR instruction");
+            }
+        }
+
+        //Works out where execution continues, the way IOP::advance_PC does once the delay slot has run
+        void IOP_JIT64::cleanup_recompiler(IOP& iop, IR::Block& block, bool syscall)
+        {
+            uint32_t branch_PC = ir.get_branch_PC();
+            uint32_t end_PC = ir.get_end_PC();
+
+            sync_cycles(block.get_cycle_count());
+
+            if (syscall)
+            {
+                //The exception left PC on the instruction before the vector
+                emitter.MOV32_FROM_MEM(REG_64::R15, REG_64::RAX, offsetof(IOP, PC));
+                emitter.ADD32_REG_IMM(4, REG_64::RAX);
+                emitter.MOV32_TO_MEM(REG_64::RAX, REG_64::R15, offsetof(IOP, PC));
+            }
+            else if (branch_PC + 4 == end_PC)
+            {
+                //The delay slot couldn't go in the block. Let the interpreter run it with the branch still pending.
+                emitter.MOV32_IMM_MEM(end_PC, REG_64::R15, offsetof(IOP, PC));
+                emit_epilogue();
+                return;
+            }
+            else if (branch_PC != 0xFFFFFFFF)
+            {
+                emitter.CMP8_IMM_MEM(0, REG_64::R15, offsetof(IOP, will_branch));
+                uint8_t* not_taken = emitter.JCC_NEAR_DEFERRED(ConditionCode::E);
+
+                emitter.MOV8_IMM_MEM(false, REG_64::R15, offsetof(IOP, will_branch));
+                emitter.MOV32_FROM_MEM(REG_64::R15, REG_64::RCX, offsetof(IOP, new_PC));
+                emitter.MOV32_TO_MEM(REG_64::RCX, REG_64::R15, offsetof(IOP, PC));
+
+                emitter.TEST32_REG_IMM(0x3, REG_64::RCX);
+                uint8_t* aligned = emitter.JCC_NEAR_DEFERRED(ConditionCode::E);
+                emitter.MOV64_MR(REG_64::R15, ARG0);
+                call_func((uint64_t)iop_invalid_PC);
+                emitter.set_jump_dest(aligned);
+
+                //PC <= branch_PC && branch_PC - PC < MAX_BUSY_WAIT_SIZE * 4
+                emitter.MOV32_REG_IMM(branch_PC, REG_64::RAX);
+                emitter.MOV32_FROM_MEM(REG_64::R15, REG_64::RCX, offsetof(IOP, PC));
+                emitter.SUB32_REG(REG_64::RCX, REG_64::RAX);
+                emitter.CMP32_IMM(MAX_BUSY_WAIT_SIZE * 4, REG_64::RAX);
+                uint8_t* not_loop = emitter.JCC_NEAR_DEFERRED(ConditionCode::AE);
+                emitter.MOV64_MR(REG_64::R15, ARG0);
+                emitter.MOV32_REG_IMM(branch_PC, ARG1);
+                call_func((uint64_t)iop_detect_busy_wait);
+                emitter.set_jump_dest(not_loop);
+
+                uint8_t* done = emitter.JMP_NEAR_DEFERRED();
+                emitter.set_jump_dest(not_taken);
+                emitter.MOV32_IMM_MEM(end_PC, REG_64::R15, offsetof(IOP, PC));
+                emitter.set_jump_dest(done);
+            }
+            else
+                emitter.MOV32_IMM_MEM(end_PC, REG_64::R15, offsetof(IOP, PC));
+
+            //Go back to the dispatcher to potentially execute another block
+            emit_dispatcher();
+        }
+
+        void IOP_JIT64::emit_prologue()
+        {
+            emitter.PUSH(REG_64::RBX);
+            emitter.PUSH(REG_64::R12);
+            emitter.PUSH(REG_64::R13);
+            emitter.PUSH(REG_64::R14);
+            emitter.PUSH(REG_64::R15);
+        #ifdef _WIN32
+            emitter.PUSH(REG_64::RDI);
+            emitter.PUSH(REG_64::RSI);
+        #endif
+            if (STACK_RESERVE)
+                emitter.SUB64_REG_IMM(STACK_RESERVE, REG_64::RSP);
+        }
+
+        void IOP_JIT64::emit_epilogue()
+        {
+            if (STACK_RESERVE)
+                emitter.ADD64_REG_IMM(STACK_RESERVE, REG_64::RSP);
+        #ifdef _WIN32
+            emitter.POP(REG_64::RSI);
+            emitter.POP(REG_64::RDI);
+        #endif
+            emitter.POP(REG_64::R15);
+            emitter.POP(REG_64::R14);
+            emitter.POP(REG_64::R13);
+            emitter.POP(REG_64::R12);
+            emitter.POP(REG_64::RBX);
+            emitter.RET();
+        }
+
+        void IOP_JIT64::load_gpr(int index, REG_64 dest)
+        {
+            if (!index)
+                emitter.XOR32_REG(dest, dest);
+            else
+                emitter.MOV32_FROM_MEM(REG_64::R15, dest, get_gpr_offset(index));
+        }
+
+        void IOP_JIT64::store_gpr(REG_64 source, int index)
+        {
+            if (index)
+                emitter.MOV32_TO_MEM(source, REG_64::R15, get_gpr_offset(index));
+        }
+
+        //Loads and stores: the IOP goes in the first argument and base + offset in the second
+        void IOP_JIT64::load_address(const IR::Instruction& instr)
+        {
+            int32_t offset = (int32_t)instr.get_source2();
+            load_gpr((int)instr.get_source(), ARG1);
+            if (offset)
+                emitter.ADD32_REG_IMM(offset, ARG1);
+            emitter.MOV64_MR(REG_64::R15, ARG0);
+        }
+
+        void IOP_JIT64::call_func(uint64_t addr)
+        {
+            emitter.MOV64_OI(addr, REG_64::RAX);
+            emitter.CALL_INDIR(REG_64::RAX);
+        }
+
+        //Takes what the block has run up to and including the current instruction off cycles_to_run and muldiv_delay,
+        //as the interpreter would have by now. Only needed before calling out of the block.
+        void IOP_JIT64::sync_cycles(uint16_t cycle_count)
+        {
+            uint32_t cycles = cycle_count - cycles_synced;
+            if (!cycles)
+                return;
+
+            emitter.SUB32_MEM_IMM(cycles, REG_64::R15, offsetof(IOP, cycles_to_run));
+
+            //muldiv_delay = max(muldiv_delay - cycles, 0)
+            emitter.MOV32_FROM_MEM(REG_64::R15, REG_64::RAX, offsetof(IOP, muldiv_delay));
+            emitter.XOR32_REG(REG_64::RCX, REG_64::RCX);
+            emitter.ADD32_REG_IMM(-cycles, REG_64::RAX);
+            emitter.CMOVCC32_REG(ConditionCode::L, REG_64::RCX, REG_64::RAX);
+            emitter.MOV32_TO_MEM(REG_64::RAX, REG_64::R15, offsetof(IOP, muldiv_delay));
+
+            cycles_synced = cycle_count;
+        }
+
+        //Expects the flags to be set. A taken branch leaves the IOP as IOP::jp and IOP::advance_PC would after the
+        //branch itself, so exceptions in the delay slot and the interpreter see the same state.
+        void IOP_JIT64::emit_branch(const IR::Instruction& instr, ConditionCode fail)
+        {
+            uint8_t* not_taken = emitter.JCC_NEAR_DEFERRED(fail);
+            emitter.MOV32_IMM_MEM(instr.get_jump_dest(), REG_64::R15, offsetof(IOP, new_PC));
+            emitter.MOV8_IMM_MEM(true, REG_64::R15, offsetof(IOP, will_branch));
+            emitter.MOV32_IMM_MEM(0, REG_64::R15, offsetof(IOP, branch_delay));
+            emitter.set_jump_dest(not_taken);
+        }
+
+        void IOP_JIT64::emit_link(const IR::Instruction& instr, int index)
+        {
+            if (instr.get_is_link() && index)
+                emitter.MOV32_IMM_MEM(instr.get_return_addr(), REG_64::R15, get_gpr_offset(index));
+        }
+
+        void IOP_JIT64::add_word_imm(IOP& iop, IR::Instruction& instr)
+        {
+            load_gpr((int)instr.get_source(), REG_64::RAX);
+            emitter.ADD32_REG_IMM((uint32_t)instr.get_source2(), REG_64::RAX);
+            store_gpr(REG_64::RAX, instr.get_dest());
+        }
+
+        void IOP_JIT64::add_word_reg(IOP& iop, IR::Instruction& instr)
+        {
+            load_gpr((int)instr.get_source(), REG_64::RAX);
+            load_gpr((int)instr.get_source2(), REG_64::RCX);
+            emitter.ADD32_REG(REG_64::RCX, REG_64::RAX);
+            store_gpr(REG_64::RAX, instr.get_dest());
+        }
+
+        void IOP_JIT64::and_imm(IOP& iop, IR::Instruction& instr)
+        {
+            load_gpr((int)instr.get_source(), REG_64::RAX);
+            emitter.AND32_EAX((uint32_t)instr.get_source2());
+            store_gpr(REG_64::RAX, instr.get_dest());
+        }
+
+        void IOP_JIT64::and_reg(IOP& iop, IR::Instruction& instr)
+        {
+            load_gpr((int)instr.get_source(), REG_64::RAX);
+            load_gpr((int)instr.get_source2(), REG_64::RCX);
+            emitter.AND32_REG(REG_64::RCX, REG_64::RAX);
+            store_gpr(REG_64::RAX, instr.get_dest());
+        }
+
+        void IOP_JIT64::branch_equal(IOP& iop, IR::Instruction& instr)
+        {
+            load_gpr((int)instr.get_source(), REG_64::RAX);
+            load_gpr((int)instr.get_source2(), REG_64::RCX);
+            emitter.CMP32_REG(REG_64::RCX, REG_64::RAX);
+            emit_branch(instr, ConditionCode::NE);
+        }
+
+        void IOP_JIT64::branch_equal_zero(IOP& iop, IR::Instruction& instr)
+        {
+            load_gpr((int)instr.get_source(), REG_64::RAX);
+            emitter.TEST32_REG(REG_64::RAX, REG_64::RAX);
+            emit_branch(instr, ConditionCode::NE);
+        }
+
+        void IOP_JIT64::branch_greater_than_or_equal_zero(IOP& iop, IR::Instruction& instr)
+        {
+            load_gpr((int)instr.get_source(), REG_64::RAX);
+            emit_link(instr, 31);
+            emitter.TEST32_REG(REG_64::RAX, REG_64::RAX);
+            emit_branch(instr, ConditionCode::L);
+        }
+
+        void IOP_JIT64::branch_greater_than_zero(IOP& iop, IR::Instruction& instr)
+        {
+            load_gpr((int)instr.get_source(), REG_64::RAX);
+            emitter.TEST32_REG(REG_64::RAX, REG_64::RAX);
+            emit_branch(instr, ConditionCode::LE);
+        }
+
+        void IOP_JIT64::branch_less_than_or_equal_zero(IOP& iop, IR::Instruction& instr)
+        {
+            load_gpr((int)instr.get_source(), REG_64::RAX);
+            emitter.TEST32_REG(REG_64::RAX, REG_64::RAX);
+            emit_branch(instr, ConditionCode::G);
+        }
+
+        void IOP_JIT64::branch_less_than_zero(IOP& iop, IR::Instruction& instr)
+        {
+            load_gpr((int)instr.get_source(), REG_64::RAX);
+            emit_link(instr, 31);
+            emitter.TEST32_REG(REG_64::RAX, REG_64::RAX);
+            emit_branch(instr, ConditionCode::GE);
+        }
+
+        void IOP_JIT64::branch_not_equal(IOP& iop, IR::Instruction& instr)
+        {
+            load_gpr((int)instr.get_source(), REG_64::RAX);
+            load_gpr((int)instr.get_source2(), REG_64::RCX);
+            emitter.CMP32_REG(REG_64::RCX, REG_64::RAX);
+            emit_branch(instr, ConditionCode::E);
+        }
+
+        void IOP_JIT64::branch_not_equal_zero(IOP& iop, IR::Instruction& instr)
+        {
+            load_gpr((int)instr.get_source(), REG_64::RAX);
+            emitter.TEST32_REG(REG_64::RAX, REG_64::RAX);
+            emit_branch(instr, ConditionCode::E);
+        }
+
+        void IOP_JIT64::jump(IOP& iop, IR::Instruction& instr)
+        {
+            //A J to itself is how the BIOS waits for an interrupt, see interpreter::j
+            if ((instr.get_opcode() >> 26) == 0x02 && instr.get_jump_dest() == instr.get_return_addr() - 8)
+                emitter.MOV8_IMM_MEM(true, REG_64::R15, offsetof(IOP, wait_for_IRQ));
+
+            emitter.MOV32_IMM_MEM(instr.get_jump_dest(), REG_64::R15, offsetof(IOP, new_PC));
+            emitter.MOV8_IMM_MEM(true, REG_64::R15, offsetof(IOP, will_branch));
+            emitter.MOV32_IMM_MEM(0, REG_64::R15, offsetof(IOP, branch_delay));
+            emit_link(instr, 31);
+        }
+
+        void IOP_JIT64::jump_indirect(IOP& iop, IR::Instruction& instr)
+        {
+            //The source is read before JALR writes the link register, which may be the same one
+            load_gpr((int)instr.get_source(), REG_64::RAX);
+            emitter.MOV32_TO_MEM(REG_64::RAX, REG_64::R15, offsetof(IOP, new_PC));
+            emitter.MOV8_IMM_MEM(true, REG_64::R15, offsetof(IOP, will_branch));
+            emitter.MOV32_IMM_MEM(0, REG_64::R15, offsetof(IOP, branch_delay));
+            emit_link(instr, instr.get_dest());
+        }
+
+        void IOP_JIT64::load_byte(IOP& iop, IR::Instruction& instr)
+        {
+            load_address(instr);
+            call_func((uint64_t)iop_read8);
+            emitter.MOVSX8_TO_64(REG_64::RAX, REG_64::RAX);
+            store_gpr(REG_64::RAX, instr.get_dest());
+        }
+
+        void IOP_JIT64::load_byte_unsigned(IOP& iop, IR::Instruction& instr)
+        {
+            load_address(instr);
+            call_func((uint64_t)iop_read8);
+            emitter.MOVZX8_TO_32(REG_64::RAX, REG_64::RAX);
+            store_gpr(REG_64::RAX, instr.get_dest());
+        }
+
+        void IOP_JIT64::load_const(IOP& iop, IR::Instruction& instr)
+        {
+            if (instr.get_dest())
+                emitter.MOV32_IMM_MEM((uint32_t)instr.get_source(), REG_64::R15, get_gpr_offset(instr.get_dest()));
+        }
+
+        void IOP_JIT64::load_halfword(IOP& iop, IR::Instruction& instr)
+        {
+            load_address(instr);
+            call_func((uint64_t)iop_read16);
+            emitter.MOVSX16_TO_32(REG_64::RAX, REG_64::RAX);
+            store_gpr(REG_64::RAX, instr.get_dest());
+        }
+
+        void IOP_JIT64::load_halfword_unsigned(IOP& iop, IR::Instruction& instr)
+        {
+            load_address(instr);
+            call_func((uint64_t)iop_read16);
+            emitter.MOVZX16_TO_64(REG_64::RAX, REG_64::RAX);
+            store_gpr(REG_64::RAX, instr.get_dest());
+        }
+
+        void IOP_JIT64::load_word(IOP& iop, IR::Instruction& instr)
+        {
+            load_address(instr);
+            call_func((uint64_t)iop_read32);
+            store_gpr(REG_64::RAX, instr.get_dest());
+        }
+
+        void IOP_JIT64::nor_reg(IOP& iop, IR::Instruction& instr)
+        {
+            load_gpr((int)instr.get_source(), REG_64::RAX);
+            load_gpr((int)instr.get_source2(), REG_64::RCX);
+            emitter.OR32_REG(REG_64::RCX, REG_64::RAX);
+            emitter.NOT32(REG_64::RAX);
+            store_gpr(REG_64::RAX, instr.get_dest());
+        }
+
+        void IOP_JIT64::or_imm(IOP& iop, IR::Instruction& instr)
+        {
+            load_gpr((int)instr.get_source(), REG_64::RAX);
+            emitter.OR32_EAX((uint32_t)instr.get_source2());
+            store_gpr(REG_64::RAX, instr.get_dest());
+        }
+
+        void IOP_JIT64::or_reg(IOP& iop, IR::Instruction& instr)
+        {
+            load_gpr((int)instr.get_source(), REG_64::RAX);
+            load_gpr((int)instr.get_source2(), REG_64::RCX);
+            emitter.OR32_REG(REG_64::RCX, REG_64::RAX);
+            store_gpr(REG_64::RAX, instr.get_dest());
+        }
+
+        void IOP_JIT64::set_on_less_than(IOP& iop, IR::Instruction& instr)
+        {
+            load_gpr((int)instr.get_source(), REG_64::RAX);
+            load_gpr((int)instr.get_source2(), REG_64::RCX);
+            emitter.CMP32_REG(REG_64::RCX, REG_64::RAX);
+            emitter.SETCC_REG(ConditionCode::L, REG_64::RAX);
+            emitter.MOVZX8_TO_32(REG_64::RAX, REG_64::RAX);
+            store_gpr(REG_64::RAX, instr.get_dest());
+        }
+
+        void IOP_JIT64::set_on_less_than_unsigned(IOP& iop, IR::Instruction& instr)
+        {
+            load_gpr((int)instr.get_source(), REG_64::RAX);
+            load_gpr((int)instr.get_source2(), REG_64::RCX);
+            emitter.CMP32_REG(REG_64::RCX, REG_64::RAX);
+            emitter.SETCC_REG(ConditionCode::B, REG_64::RAX);
+            emitter.MOVZX8_TO_32(REG_64::RAX, REG_64::RAX);
+            store_gpr(REG_64::RAX, instr.get_dest());
+        }
+
+        void IOP_JIT64::set_on_less_than_immediate(IOP& iop, IR::Instruction& instr)
+        {
+            load_gpr((int)instr.get_source(), REG_64::RAX);
+            emitter.CMP32_IMM((uint32_t)instr.get_source2(), REG_64::RAX);
+            emitter.SETCC_REG(ConditionCode::L, REG_64::RAX);
+            emitter.MOVZX8_TO_32(REG_64::RAX, REG_64::RAX);
+            store_gpr(REG_64::RAX, instr.get_dest());
+        }
+
+        void IOP_JIT64::set_on_less_than_immediate_unsigned(IOP& iop, IR::Instruction& instr)
+        {
+            load_gpr((int)instr.get_source(), REG_64::RAX);
+            emitter.CMP32_IMM((uint32_t)instr.get_source2(), REG_64::RAX);
+            emitter.SETCC_REG(ConditionCode::B, REG_64::RAX);
+            emitter.MOVZX8_TO_32(REG_64::RAX, REG_64::RAX);
+            store_gpr(REG_64::RAX, instr.get_dest());
+        }
+
+        void IOP_JIT64::shift_left_logical(IOP& iop, IR::Instruction& instr)
+        {
+            load_gpr((int)instr.get_source(), REG_64::RAX);
+            emitter.SHL32_REG_IMM((uint8_t)instr.get_source2(), REG_64::RAX);
+            store_gpr(REG_64::RAX, instr.get_dest());
+        }
+
+        //x86 only looks at the low 5 bits of CL for 32-bit shifts, same as the IOP
+        void IOP_JIT64::shift_left_logical_variable(IOP& iop, IR::Instruction& instr)
+        {
+            load_gpr((int)instr.get_source2(), REG_64::RCX);
+            load_gpr((int)instr.get_source(), REG_64::RAX);
+            emitter.SHL32_CL(REG_64::RAX);
+            store_gpr(REG_64::RAX, instr.get_dest());
+        }
+
+        void IOP_JIT64::shift_right_arithmetic(IOP& iop, IR::Instruction& instr)
+        {
+            load_gpr((int)instr.get_source(), REG_64::RAX);
+            emitter.SAR32_REG_IMM((uint8_t)instr.get_source2(), REG_64::RAX);
+            store_gpr(REG_64::RAX, instr.get_dest());
+        }
+
+        void IOP_JIT64::shift_right_arithmetic_variable(IOP& iop, IR::Instruction& instr)
+        {
+            load_gpr((int)instr.get_source2(), REG_64::RCX);
+            load_gpr((int)instr.get_source(), REG_64::RAX);
+            emitter.SAR32_CL(REG_64::RAX);
+            store_gpr(REG_64::RAX, instr.get_dest());
+        }
+
+        void IOP_JIT64::shift_right_logical(IOP& iop, IR::Instruction& instr)
+        {
+            load_gpr((int)instr.get_source(), REG_64::RAX);
+            emitter.SHR32_REG_IMM((uint8_t)instr.get_source2(), REG_64::RAX);
+            store_gpr(REG_64::RAX, instr.get_dest());
+        }
+
+        void IOP_JIT64::shift_right_logical_variable(IOP& iop, IR::Instruction& instr)
+        {
+            load_gpr((int)instr.get_source2(), REG_64::RCX);
+            load_gpr((int)instr.get_source(), REG_64::RAX);
+            emitter.SHR32_CL(REG_64::RAX);
+            store_gpr(REG_64::RAX, instr.get_dest());
+        }
+
+        //Stores: the IOP, address and value go in the first three arguments
+        void IOP_JIT64::store_byte(IOP& iop, IR::Instruction& instr)
+        {
+            load_gpr((int)instr.get_source(), ARG2);
+            load_gpr(instr.get_dest(), ARG1);
+            if ((int32_t)instr.get_source2())
+                emitter.ADD32_REG_IMM((uint32_t)instr.get_source2(), ARG1);
+            emitter.MOV64_MR(REG_64::R15, ARG0);
+            call_func((uint64_t)iop_write8);
+        }
+
+        void IOP_JIT64::store_halfword(IOP& iop, IR::Instruction& instr)
+        {
+            load_gpr((int)instr.get_source(), ARG2);
+            load_gpr(instr.get_dest(), ARG1);
+            if ((int32_t)instr.get_source2())
+                emitter.ADD32_REG_IMM((uint32_t)instr.get_source2(), ARG1);
+            emitter.MOV64_MR(REG_64::R15, ARG0);
+            call_func((uint64_t)iop_write16);
+        }
+
+        void IOP_JIT64::store_word(IOP& iop, IR::Instruction& instr)
+        {
+            load_gpr((int)instr.get_source(), ARG2);
+            load_gpr(instr.get_dest(), ARG1);
+            if ((int32_t)instr.get_source2())
+                emitter.ADD32_REG_IMM((uint32_t)instr.get_source2(), ARG1);
+            emitter.MOV64_MR(REG_64::R15, ARG0);
+            call_func((uint64_t)iop_write32);
+        }
+
+        void IOP_JIT64::sub_word_reg(IOP& iop, IR::Instruction& instr)
+        {
+            load_gpr((int)instr.get_source(), REG_64::RAX);
+            load_gpr((int)instr.get_source2(), REG_64::RCX);
+            emitter.SUB32_REG(REG_64::RCX, REG_64::RAX);
+            store_gpr(REG_64::RAX, instr.get_dest());
+        }
+
+        void IOP_JIT64::system_call(IOP& iop, IR::Instruction& instr)
+        {
+            sync_cycles(instr.get_cycle_count());
+
+            // Update PC before calling exception handler
+            emitter.MOV32_IMM_MEM(instr.get_return_addr(), REG_64::R15, offsetof(IOP, PC));
+            emitter.MOV64_MR(REG_64::R15, ARG0);
+            call_func((uint64_t)iop_syscall_exception);
+        }
+
+        void IOP_JIT64::xor_imm(IOP& iop, IR::Instruction& instr)
+        {
+            load_gpr((int)instr.get_source(), REG_64::RAX);
+            emitter.XOR32_EAX((uint32_t)instr.get_source2());
+            store_gpr(REG_64::RAX, instr.get_dest());
+        }
+
+        void IOP_JIT64::xor_reg(IOP& iop, IR::Instruction& instr)
+        {
+            load_gpr((int)instr.get_source(), REG_64::RAX);
+            load_gpr((int)instr.get_source2(), REG_64::RCX);
+            emitter.XOR32_REG(REG_64::RCX, REG_64::RAX);
+            store_gpr(REG_64::RAX, instr.get_dest());
+        }
+
+        void IOP_JIT64::fallback_interpreter(IOP& iop, const IR::Instruction& instr)
+        {
+            sync_cycles(instr.get_cycle_count());
+
+            emitter.MOV32_IMM_MEM(instr.get_return_addr(), REG_64::R15, offsetof(IOP, PC));
+            emitter.MOV64_MR(REG_64::R15, ARG0);
+            emitter.MOV32_REG_IMM(instr.get_opcode(), ARG1);
+            call_func((uint64_t)instr.get_iop_interpreter_fallback());
+        }
+
+        //Small values are passed and returned in full registers, so the generated code doesn't depend on
+        //whether the compiler extends them
+        uint8_t iop_read8(IOP& iop, uint32_t addr)
+        {
+            return iop.read8(addr);
+        }
+
+        uint16_t iop_read16(IOP& iop, uint32_t addr)
+        {
+            return iop.read16(addr);
+        }
+
+        uint32_t iop_read32(IOP& iop, uint32_t addr)
+        {
+            return iop.read32(addr);
+        }
+
+        void iop_write8(IOP& iop, uint32_t addr, uint32_t value)
+        {
+            iop.write8(addr, value & 0xFF);
+        }
+
+        void iop_write16(IOP& iop, uint32_t addr, uint32_t value)
+        {
+            iop.write16(addr, value & 0xFFFF);
+        }
+
+        void iop_write32(IOP& iop, uint32_t addr, uint32_t value)
+        {
+            iop.write32(addr, value);
+        }
+
+        void iop_syscall_exception(IOP& iop)
+        {
+            iop.syscall_exception();
+        }
+
+        void iop_detect_busy_wait(IOP& iop, uint32_t branch_PC)
+        {
+            iop.detect_busy_wait(branch_PC);
+        }
+
+        void iop_invalid_PC(IOP& iop)
+        {
+            Errors::die("[IOP] Invalid PC address $%08X!\n", iop.PC);
+        }
+    }
+}
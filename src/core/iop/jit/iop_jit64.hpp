@@ -0,0 +1,138 @@
+#pragma once
+#include <jitcommon/emitter64.hpp>
+#include <jitcommon/ir_block.hpp>
+#include <jitcommon/jitcache.hpp>
+#include <iop/blockcache.hpp>
+#include "iop_jittrans.hpp"
+#include <cstddef>
+#include <vector>
+
+namespace iop
+{
+    class IOP;
+    namespace jit
+    {
+        class IOP_JIT64;
+    }
+}
+
+extern "C" uint8_t* exec_block_iop(iop::jit::IOP_JIT64& jit, iop::IOP& iop);
+
+namespace iop
+{
+    namespace jit
+    {
+        typedef void (*IOPJitPrologue)(IOP_JIT64& jit, IOP& iop, IOPJitBlockRecord** cache);
+
+        //There's no register allocation: guest registers live in the IOP object and every op loads and stores them,
+        //using RAX, RCX and the argument registers as scratch. The blocks are small enough that the win is in not
+        //decoding and dispatching each instruction.
+        class IOP_JIT64
+        {
+        public:
+            JitBlock jit_block;
+            IOPJitHeap jit_heap;
+            Emitter64 emitter;
+            IOP_JitTranslator ir;
+
+            //Pointer to the dispatcher prologue that begins execution of recompiled code
+            IOPJitPrologue prologue_block;
+
+            //Both live in the prologue block. Blocks leave through the shared slow path so exec_block_iop never
+            //returns into a block it may have just freed. The exit returns to run(), for code the recompiler doesn't handle.
+            uint8_t* dispatcher_slow_path;
+            uint8_t* dispatcher_exit;
+
+            //Cycles of the block being recompiled that have already been taken off cycles_to_run
+            uint16_t cycles_synced;
+
+            //PCs of the blocks translated from each page of RAM, in the interpreter's BlockCache pages,
+            //and the blocks that were written over since the dispatcher last ran
+            std::vector<uint32_t> page_blocks[BlockCache::RAM_PAGES];
+            std::vector<uint32_t> stale_blocks;
+
+            // Instructions
+            void add_word_imm(IOP& iop, IR::Instruction& instr);
+            void add_word_reg(IOP& iop, IR::Instruction& instr);
+            void and_imm(IOP& iop, IR::Instruction& instr);
+            void and_reg(IOP& iop, IR::Instruction& instr);
+            void branch_equal(IOP& iop, IR::Instruction& instr);
+            void branch_equal_zero(IOP& iop, IR::Instruction& instr);
+            void branch_greater_than_or_equal_zero(IOP& iop, IR::Instruction& instr);
+            void branch_greater_than_zero(IOP& iop, IR::Instruction& instr);
+            void branch_less_than_or_equal_zero(IOP& iop, IR::Instruction& instr);
+            void branch_less_than_zero(IOP& iop, IR::Instruction& instr);
+            void branch_not_equal(IOP& iop, IR::Instruction& instr);
+            void branch_not_equal_zero(IOP& iop, IR::Instruction& instr);
+            void jump(IOP& iop, IR::Instruction& instr);
+            void jump_indirect(IOP& iop, IR::Instruction& instr);
+            void load_byte(IOP& iop, IR::Instruction& instr);
+            void load_byte_unsigned(IOP& iop, IR::Instruction& instr);
+            void load_const(IOP& iop, IR::Instruction& instr);
+            void load_halfword(IOP& iop, IR::Instruction& instr);
+            void load_halfword_unsigned(IOP& iop, IR::Instruction& instr);
+            void load_word(IOP& iop, IR::Instruction& instr);
+            void nor_reg(IOP& iop, IR::Instruction& instr);
+            void or_imm(IOP& iop, IR::Instruction& instr);
+            void or_reg(IOP& iop, IR::Instruction& instr);
+            void set_on_less_than(IOP& iop, IR::Instruction& instr);
+            void set_on_less_than_unsigned(IOP& iop, IR::Instruction& instr);
+            void set_on_less_than_immediate(IOP& iop, IR::Instruction& instr);
+            void set_on_less_than_immediate_unsigned(IOP& iop, IR::Instruction& instr);
+            void shift_left_logical(IOP& iop, IR::Instruction& instr);
+            void shift_left_logical_variable(IOP& iop, IR::Instruction& instr);
+            void shift_right_arithmetic(IOP& iop, IR::Instruction& instr);
+            void shift_right_arithmetic_variable(IOP& iop, IR::Instruction& instr);
+            void shift_right_logical(IOP& iop, IR::Instruction& instr);
+            void shift_right_logical_variable(IOP& iop, IR::Instruction& instr);
+            void store_byte(IOP& iop, IR::Instruction& instr);
+            void store_halfword(IOP& iop, IR::Instruction& instr);
+            void store_word(IOP& iop, IR::Instruction& instr);
+            void sub_word_reg(IOP& iop, IR::Instruction& instr);
+            void system_call(IOP& iop, IR::Instruction& instr);
+            void xor_imm(IOP& iop, IR::Instruction& instr);
+            void xor_reg(IOP& iop, IR::Instruction& instr);
+            void fallback_interpreter(IOP& iop, const IR::Instruction& instr);
+
+            // Helpers
+            void load_gpr(int index, REG_64 dest);
+            void store_gpr(REG_64 source, int index);
+            void load_address(const IR::Instruction& instr);
+            void call_func(uint64_t addr);
+            void sync_cycles(uint16_t cycle_count);
+            void emit_branch(const IR::Instruction& instr, ConditionCode fail);
+            void emit_link(const IR::Instruction& instr, int index);
+
+            // Recompile + Cleanup
+            IOPJitPrologue create_prologue_block();
+            void emit_prologue();
+            uint8_t* emit_dispatcher();
+            void emit_instruction(IOP& iop, IR::Instruction& instr);
+            IOPJitBlockRecord* recompile_block(IOP& iop, IR::Block& block);
+            void cleanup_recompiler(IOP& iop, IR::Block& block, bool syscall);
+            void emit_epilogue();
+
+            bool can_recompile(IOP& iop, uint32_t PC) const;
+            void free_stale_blocks();
+        public:
+            IOP_JIT64();
+
+            void reset(bool clear_cache = true);
+            void run(IOP& iop);
+            void invalidate(uint32_t addr, uint32_t size);
+
+            friend uint8_t* exec_block_iop(IOP_JIT64& jit, IOP& iop);
+        };
+
+        // Various wrapper functions
+        uint8_t iop_read8(IOP& iop, uint32_t addr);
+        uint16_t iop_read16(IOP& iop, uint32_t addr);
+        uint32_t iop_read32(IOP& iop, uint32_t addr);
+        void iop_write8(IOP& iop, uint32_t addr, uint32_t value);
+        void iop_write16(IOP& iop, uint32_t addr, uint32_t value);
+        void iop_write32(IOP& iop, uint32_t addr, uint32_t value);
+        void iop_syscall_exception(IOP& iop);
+        void iop_detect_busy_wait(IOP& iop, uint32_t branch_PC);
+        void iop_invalid_PC(IOP& iop);
+    }
+}
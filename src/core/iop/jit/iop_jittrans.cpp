@@ -0,0 +1,535 @@
+#include "iop_jittrans.hpp"
+#include <iop/iop.hpp>
+#include <iop/interpreter/iop_interpreter.hpp>
+#include <emulator.hpp>
+
+namespace iop
+{
+    namespace jit
+    {
+        //The interpreter checks for the BIOS putc entry points after every instruction
+        static void bios_putc(IOP& iop, uint32_t opcode)
+        {
+            iop.e->iop_puts();
+        }
+
+        static uint32_t branch_offset(uint32_t opcode, uint32_t PC)
+        {
+            return PC + 4 + ((int32_t)(int16_t)(opcode & 0xFFFF) << 2);
+        }
+
+        static uint32_t jump_offset(uint32_t opcode, uint32_t PC)
+        {
+            return ((PC + 4) & 0xF0000000) + ((opcode & 0x3FFFFFF) << 2);
+        }
+
+        IR::Block IOP_JitTranslator::translate(IOP& iop)
+        {
+            IR::Block block;
+            uint32_t pc = iop.get_PC();
+            uint32_t phys = pc & 0x1FFFFFFF;
+
+            //Same waitstate as IOP::read_instr, paid on every instruction
+            uint16_t cycles = (pc >= 0xA0000000 || !(iop.cache_control & (1 << 11))) ? 5 : 1;
+            uint16_t cycle_count = 0;
+
+            branch_PC = 0xFFFFFFFF;
+            bool delay_slot = false;
+            for (int i = 0; i < MAX_BLOCK_SIZE || delay_slot; i++)
+            {
+                if (phys >= PHYSICAL_MEMORY_SIZE)
+                    break;
+                uint8_t* mem = iop.read_map[phys >> PAGE_SHIFT];
+                if (!mem)
+                    break;
+                uint32_t opcode = *(uint32_t*)&mem[phys & PAGE_MASK];
+
+                //A branch in a delay slot only counts if the first branch isn't taken, which the interpreter handles
+                if (delay_slot && is_branch(opcode))
+                    break;
+
+                std::vector<IR::Instruction> instrs;
+                translate_op(opcode, pc, instrs);
+
+                bool is_syscall = !(opcode >> 26) && (opcode & 0x3F) == 0x0C;
+                if (!is_syscall && (pc == 0x00012C48 || pc == 0x0001420C || pc == 0x0001430C))
+                {
+                    IR::Instruction putc;
+                    putc.op = IR::Opcode::FallbackInterpreter;
+                    putc.set_opcode(opcode);
+                    putc.set_return_addr(pc);
+                    putc.set_interpreter_fallback(&bios_putc);
+                    instrs.push_back(putc);
+                }
+
+                cycle_count += cycles;
+                for (IR::Instruction& instr : instrs)
+                {
+                    instr.set_cycle_count(cycle_count);
+                    block.add_instr(instr);
+                }
+
+                pc += 4;
+                phys += 4;
+
+                if (delay_slot || is_syscall)
+                    break;
+                if (is_branch(opcode))
+                {
+                    branch_PC = pc - 4;
+                    delay_slot = true;
+                }
+            }
+
+            end_PC = pc;
+            block.set_cycle_count(cycle_count);
+            return block;
+        }
+
+        bool IOP_JitTranslator::is_branch(uint32_t opcode)
+        {
+            uint8_t op = opcode >> 26;
+            if (!op)
+                return (opcode & 0x3F) == 0x08 || (opcode & 0x3F) == 0x09;
+            return op >= 0x01 && op <= 0x07;
+        }
+
+        void IOP_JitTranslator::translate_op(uint32_t opcode, uint32_t PC, std::vector<IR::Instruction>& instrs) const
+        {
+            uint8_t op = opcode >> 26;
+            IR::Instruction instr;
+
+            if (!opcode)
+                return;
+
+            // Set up fallback properties
+            fallback_interpreter(instr, opcode);
+            instr.set_return_addr(PC);
+
+            switch (op)
+            {
+                case 0x00:
+                    // Special Operation
+                    translate_op_special(opcode, PC, instrs);
+                    break;
+                case 0x01:
+                    // Regimm Operation
+                    translate_op_regimm(opcode, PC, instrs);
+                    break;
+                case 0x02:
+                    // J
+                    instr.op = IR::Opcode::Jump;
+                    instr.set_jump_dest(jump_offset(opcode, PC));
+                    instr.set_return_addr(PC + 8);
+                    instr.set_is_link(false);
+                    instrs.push_back(instr);
+                    break;
+                case 0x03:
+                    // JAL
+                    instr.op = IR::Opcode::Jump;
+                    instr.set_jump_dest(jump_offset(opcode, PC));
+                    instr.set_return_addr(PC + 8);
+                    instr.set_is_link(true);
+                    instrs.push_back(instr);
+                    break;
+                case 0x04:
+                    // BEQ
+                {
+                    uint8_t source = (opcode >> 21) & 0x1F;
+                    uint8_t source2 = (opcode >> 16) & 0x1F;
+                    instr.set_jump_dest(branch_offset(opcode, PC));
+                    instr.set_jump_fail_dest(PC + 8);
+                    if (source == source2)
+                    {
+                        // B
+                        instr.op = IR::Opcode::Jump;
+                        instr.set_return_addr(PC + 8);
+                        instr.set_is_link(false);
+                    }
+                    else if (!source || !source2)
+                    {
+                        // BEQZ
+                        instr.op = IR::Opcode::BranchEqualZero;
+                        instr.set_source(source ? source : source2);
+                    }
+                    else
+                    {
+                        instr.op = IR::Opcode::BranchEqual;
+                        instr.set_source(source);
+                        instr.set_source2(source2);
+                    }
+                    instrs.push_back(instr);
+                    break;
+                }
+                case 0x05:
+                    // BNE
+                {
+                    uint8_t source = (opcode >> 21) & 0x1F;
+                    uint8_t source2 = (opcode >> 16) & 0x1F;
+                    if (source == source2)
+                    {
+                        // Never taken, only the delay slot is left
+                        break;
+                    }
+                    instr.set_jump_dest(branch_offset(opcode, PC));
+                    instr.set_jump_fail_dest(PC + 8);
+                    if (!source || !source2)
+                    {
+                        // BNEZ
+                        instr.op = IR::Opcode::BranchNotEqualZero;
+                        instr.set_source(source ? source : source2);
+                    }
+                    else
+                    {
+                        instr.op = IR::Opcode::BranchNotEqual;
+                        instr.set_source(source);
+                        instr.set_source2(source2);
+                    }
+                    instrs.push_back(instr);
+                    break;
+                }
+                case 0x06:
+                    // BLEZ
+                    instr.op = IR::Opcode::BranchLessThanOrEqualZero;
+                    instr.set_source((opcode >> 21) & 0x1F);
+                    instr.set_jump_dest(branch_offset(opcode, PC));
+                    instr.set_jump_fail_dest(PC + 8);
+                    instrs.push_back(instr);
+                    break;
+                case 0x07:
+                    // BGTZ
+                    instr.op = IR::Opcode::BranchGreaterThanZero;
+                    instr.set_source((opcode >> 21) & 0x1F);
+                    instr.set_jump_dest(branch_offset(opcode, PC));
+                    instr.set_jump_fail_dest(PC + 8);
+                    instrs.push_back(instr);
+                    break;
+                case 0x08:
+                    // ADDI
+                    // The interpreter doesn't raise overflow exceptions either
+                case 0x09:
+                    // ADDIU
+                {
+                    uint8_t dest = (opcode >> 16) & 0x1F;
+                    uint8_t source = (opcode >> 21) & 0x1F;
+                    int16_t immediate = opcode & 0xFFFF;
+                    if (!dest)
+                    {
+                        // NOP
+                        break;
+                    }
+                    if (!source)
+                    {
+                        instr.op = IR::Opcode::LoadConst;
+                        instr.set_dest(dest);
+                        instr.set_source((int64_t)immediate);
+                        instrs.push_back(instr);
+                        break;
+                    }
+                    instr.op = IR::Opcode::AddWordImm;
+                    instr.set_dest(dest);
+                    instr.set_source(source);
+                    instr.set_source2((int64_t)immediate);
+                    instrs.push_back(instr);
+                    break;
+                }
+                case 0x0A:
+                    // SLTI
+                case 0x0B:
+                    // SLTIU
+                {
+                    uint8_t dest = (opcode >> 16) & 0x1F;
+                    if (!dest)
+                    {
+                        // NOP
+                        break;
+                    }
+                    instr.op = (op == 0x0A) ? IR::Opcode::SetOnLessThanImmediate : IR::Opcode::SetOnLessThanImmediateUnsigned;
+                    instr.set_dest(dest);
+                    instr.set_source((opcode >> 21) & 0x1F);
+                    instr.set_source2((int64_t)(int16_t)(opcode & 0xFFFF));
+                    instrs.push_back(instr);
+                    break;
+                }
+                case 0x0C:
+                    // ANDI
+                case 0x0D:
+                    // ORI
+                case 0x0E:
+                    // XORI
+                {
+                    uint8_t dest = (opcode >> 16) & 0x1F;
+                    if (!dest)
+                    {
+                        // NOP
+                        break;
+                    }
+                    if (op == 0x0C)
+                        instr.op = IR::Opcode::AndImm;
+                    else if (op == 0x0D)
+                        instr.op = IR::Opcode::OrImm;
+                    else
+                        instr.op = IR::Opcode::XorImm;
+                    instr.set_dest(dest);
+                    instr.set_source((opcode >> 21) & 0x1F);
+                    instr.set_source2(opcode & 0xFFFF);
+                    instrs.push_back(instr);
+                    break;
+                }
+                case 0x0F:
+                    // LUI
+                {
+                    uint8_t dest = (opcode >> 16) & 0x1F;
+                    if (!dest)
+                    {
+                        // NOP
+                        break;
+                    }
+                    instr.op = IR::Opcode::LoadConst;
+                    instr.set_dest(dest);
+                    instr.set_source((int64_t)(int32_t)((opcode & 0xFFFF) << 16));
+                    instrs.push_back(instr);
+                    break;
+                }
+                case 0x20:
+                    // LB
+                case 0x21:
+                    // LH
+                case 0x23:
+                    // LW
+                case 0x24:
+                    // LBU
+                case 0x25:
+                    // LHU
+                    // The load still happens when the destination is $zero, it may be a register with side effects
+                    if (op == 0x20)
+                        instr.op = IR::Opcode::LoadByte;
+                    else if (op == 0x21)
+                        instr.op = IR::Opcode::LoadHalfword;
+                    else if (op == 0x23)
+                        instr.op = IR::Opcode::LoadWord;
+                    else if (op == 0x24)
+                        instr.op = IR::Opcode::LoadByteUnsigned;
+                    else
+                        instr.op = IR::Opcode::LoadHalfwordUnsigned;
+                    instr.set_dest((opcode >> 16) & 0x1F);
+                    instr.set_source((opcode >> 21) & 0x1F);
+                    instr.set_source2((int64_t)(int16_t)(opcode & 0xFFFF));
+                    instrs.push_back(instr);
+                    break;
+                case 0x28:
+                    // SB
+                case 0x29:
+                    // SH
+                case 0x2B:
+                    // SW
+                    if (op == 0x28)
+                        instr.op = IR::Opcode::StoreByte;
+                    else if (op == 0x29)
+                        instr.op = IR::Opcode::StoreHalfword;
+                    else
+                        instr.op = IR::Opcode::StoreWord;
+                    instr.set_dest((opcode >> 21) & 0x1F);
+                    instr.set_source((opcode >> 16) & 0x1F);
+                    instr.set_source2((int64_t)(int16_t)(opcode & 0xFFFF));
+                    instrs.push_back(instr);
+                    break;
+                default:
+                    // COP0, LWL, LWR, SWL, SWR, and anything the interpreter should die on
+                    instrs.push_back(instr);
+                    break;
+            }
+        }
+
+        void IOP_JitTranslator::translate_op_special(uint32_t opcode, uint32_t PC, std::vector<IR::Instruction>& instrs) const
+        {
+            uint8_t op = opcode & 0x3F;
+            uint8_t rs = (opcode >> 21) & 0x1F;
+            uint8_t rt = (opcode >> 16) & 0x1F;
+            uint8_t rd = (opcode >> 11) & 0x1F;
+            IR::Instruction instr;
+
+            fallback_interpreter(instr, opcode);
+            instr.set_return_addr(PC);
+
+            switch (op)
+            {
+                case 0x00:
+                    // SLL
+                case 0x02:
+                    // SRL
+                case 0x03:
+                    // SRA
+                    if (!rd)
+                    {
+                        // NOP
+                        break;
+                    }
+                    if (op == 0x00)
+                        instr.op = IR::Opcode::ShiftLeftLogical;
+                    else if (op == 0x02)
+                        instr.op = IR::Opcode::ShiftRightLogical;
+                    else
+                        instr.op = IR::Opcode::ShiftRightArithmetic;
+                    instr.set_dest(rd);
+                    instr.set_source(rt);
+                    instr.set_source2((opcode >> 6) & 0x1F);
+                    instrs.push_back(instr);
+                    break;
+                case 0x04:
+                    // SLLV
+                case 0x06:
+                    // SRLV
+                case 0x07:
+                    // SRAV
+                    if (!rd)
+                    {
+                        // NOP
+                        break;
+                    }
+                    if (op == 0x04)
+                        instr.op = IR::Opcode::ShiftLeftLogicalVariable;
+                    else if (op == 0x06)
+                        instr.op = IR::Opcode::ShiftRightLogicalVariable;
+                    else
+                        instr.op = IR::Opcode::ShiftRightArithmeticVariable;
+                    instr.set_dest(rd);
+                    instr.set_source(rt);
+                    instr.set_source2(rs);
+                    instrs.push_back(instr);
+                    break;
+                case 0x08:
+                    // JR
+                    instr.op = IR::Opcode::JumpIndirect;
+                    instr.set_source(rs);
+                    instr.set_is_link(false);
+                    instrs.push_back(instr);
+                    break;
+                case 0x09:
+                    // JALR
+                    instr.op = IR::Opcode::JumpIndirect;
+                    instr.set_source(rs);
+                    instr.set_dest(rd);
+                    instr.set_return_addr(PC + 8);
+                    instr.set_is_link(true);
+                    instrs.push_back(instr);
+                    break;
+                case 0x0C:
+                    // SYSCALL
+                    instr.op = IR::Opcode::SystemCall;
+                    instrs.push_back(instr);
+                    break;
+                case 0x20:
+                    // ADD
+                    // The interpreter doesn't raise overflow exceptions either
+                case 0x21:
+                    // ADDU
+                case 0x22:
+                    // SUB
+                case 0x23:
+                    // SUBU
+                case 0x24:
+                    // AND
+                case 0x25:
+                    // OR
+                case 0x26:
+                    // XOR
+                case 0x27:
+                    // NOR
+                case 0x2A:
+                    // SLT
+                case 0x2B:
+                    // SLTU
+                    if (!rd)
+                    {
+                        // NOP
+                        break;
+                    }
+                    switch (op)
+                    {
+                        case 0x20:
+                        case 0x21:
+                            instr.op = IR::Opcode::AddWordReg;
+                            break;
+                        case 0x22:
+                        case 0x23:
+                            instr.op = IR::Opcode::SubWordReg;
+                            break;
+                        case 0x24:
+                            instr.op = IR::Opcode::AndReg;
+                            break;
+                        case 0x25:
+                            instr.op = IR::Opcode::OrReg;
+                            break;
+                        case 0x26:
+                            instr.op = IR::Opcode::XorReg;
+                            break;
+                        case 0x27:
+                            instr.op = IR::Opcode::NorReg;
+                            break;
+                        case 0x2A:
+                            instr.op = IR::Opcode::SetOnLessThan;
+                            break;
+                        default:
+                            instr.op = IR::Opcode::SetOnLessThanUnsigned;
+                            break;
+                    }
+                    instr.set_dest(rd);
+                    instr.set_source(rs);
+                    instr.set_source2(rt);
+                    instrs.push_back(instr);
+                    break;
+                default:
+                    // MFHI, MTHI, MFLO, MTLO, MULT(U), DIV(U) go through the interpreter so the muldiv delay is kept
+                    instrs.push_back(instr);
+                    break;
+            }
+        }
+
+        void IOP_JitTranslator::translate_op_regimm(uint32_t opcode, uint32_t PC, std::vector<IR::Instruction>& instrs) const
+        {
+            uint8_t op = (opcode >> 16) & 0x1F;
+            IR::Instruction instr;
+
+            fallback_interpreter(instr, opcode);
+            instr.set_return_addr(PC);
+
+            switch (op)
+            {
+                case 0x00:
+                    // BLTZ
+                case 0x10:
+                    // BLTZAL
+                    instr.op = IR::Opcode::BranchLessThanZero;
+                    break;
+                case 0x01:
+                    // BGEZ
+                case 0x11:
+                    // BGEZAL
+                    instr.op = IR::Opcode::BranchGreaterThanOrEqualZero;
+                    break;
+                default:
+                    instrs.push_back(instr);
+                    return;
+            }
+
+            // The link register is written whether or not the branch is taken
+            instr.set_source((opcode >> 21) & 0x1F);
+            instr.set_jump_dest(branch_offset(opcode, PC));
+            instr.set_jump_fail_dest(PC + 8);
+            if (op & 0x10)
+            {
+                instr.set_return_addr(PC + 8);
+                instr.set_is_link(true);
+            }
+            instrs.push_back(instr);
+        }
+
+        void IOP_JitTranslator::fallback_interpreter(IR::Instruction& instr, uint32_t opcode) const
+        {
+            instr.op = IR::Opcode::FallbackInterpreter;
+            instr.set_opcode(opcode);
+            instr.set_interpreter_fallback(interpreter::lookup(opcode));
+        }
+    }
+}
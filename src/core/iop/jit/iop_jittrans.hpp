@@ -0,0 +1,49 @@
+#pragma once
+#include <cstdint>
+#include <vector>
+#include <jitcommon/ir_block.hpp>
+
+namespace iop
+{
+    class IOP;
+
+    namespace jit
+    {
+        class IOP_JitTranslator
+        {
+        public:
+            //A branch at the limit still gets its delay slot
+            constexpr static int MAX_BLOCK_SIZE = 64;
+
+            IR::Block translate(IOP& iop);
+
+            //Address after the last instruction translated
+            uint32_t get_end_PC() const;
+
+            //Address of the block's branch, or 0xFFFFFFFF if it has none. If the block stops right after it,
+            //the delay slot is left to the interpreter.
+            uint32_t get_branch_PC() const;
+        private:
+            uint32_t end_PC;
+            uint32_t branch_PC;
+
+            static bool is_branch(uint32_t opcode);
+
+            void translate_op(uint32_t opcode, uint32_t PC, std::vector<IR::Instruction>& instrs) const;
+            void translate_op_special(uint32_t opcode, uint32_t PC, std::vector<IR::Instruction>& instrs) const;
+            void translate_op_regimm(uint32_t opcode, uint32_t PC, std::vector<IR::Instruction>& instrs) const;
+
+            void fallback_interpreter(IR::Instruction& instr, uint32_t opcode) const;
+        };
+
+        inline uint32_t IOP_JitTranslator::get_end_PC() const
+        {
+            return end_PC;
+        }
+
+        inline uint32_t IOP_JitTranslator::get_branch_PC() const
+        {
+            return branch_PC;
+        }
+    }
+}
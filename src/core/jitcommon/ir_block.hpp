@@ -10,6 +10,7 @@ class Block
     private:
         std::deque<Instruction> instructions;
         int cycle_count;
+        bool idle_loop;
     public:
         Block();
 
@@ -17,9 +18,11 @@ class Block
 
         unsigned int get_instruction_count() const;
         int get_cycle_count() const;
+        bool is_idle_loop() const;
         Instruction get_next_instr();
 
         void set_cycle_count(int cycles);
+        void set_idle_loop(bool idle);
 };
 
 };
\ No newline at end of file
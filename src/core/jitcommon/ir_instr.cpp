@@ -18,6 +18,9 @@ Instruction::Instruction(Opcode op) : op(op)
     field2 = 0;
     is_likely = 0;
     is_link = 0;
+    opcode = 0;
+    interpreter_fallback = nullptr;
+    iop_interpreter_fallback = nullptr;
 }
 
 uint32_t Instruction::get_jump_dest() const
@@ -95,6 +98,11 @@ void (*Instruction::get_interpreter_fallback(void) const)(ee::EmotionEngine&, ui
     return interpreter_fallback;
 };
 
+void (*Instruction::get_iop_interpreter_fallback(void) const)(iop::IOP&, uint32_t)
+{
+    return iop_interpreter_fallback;
+};
+
 void Instruction::set_jump_dest(uint32_t addr)
 {
     jump_dest = addr;
@@ -170,6 +178,11 @@ void Instruction::set_interpreter_fallback(void(*value)(ee::EmotionEngine&, uint
     interpreter_fallback = value;
 }
 
+void Instruction::set_interpreter_fallback(void(*value)(iop::IOP&, uint32_t))
+{
+    iop_interpreter_fallback = value;
+}
+
 bool Instruction::is_jump()
 {
     return op == Opcode::Jump ||
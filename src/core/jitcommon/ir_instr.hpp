@@ -3,6 +3,11 @@
 #include <vector>
 #include <ee/emotion.hpp>
 
+namespace iop
+{
+    class IOP;
+}
+
 namespace IR
 {
 
@@ -28,6 +33,7 @@ class Instruction
         // interpreter fallback
         uint32_t opcode;
         void(*interpreter_fallback)(ee::EmotionEngine&, uint32_t);
+        void(*iop_interpreter_fallback)(iop::IOP&, uint32_t);
     public:
         Opcode op;
 
@@ -48,6 +54,7 @@ class Instruction
         bool get_is_link() const;
         uint32_t get_opcode() const;
         void(*get_interpreter_fallback() const)(ee::EmotionEngine&, uint32_t);
+        void(*get_iop_interpreter_fallback() const)(iop::IOP&, uint32_t);
 
         void set_jump_dest(uint32_t addr);
         void set_jump_fail_dest(uint32_t addr);
@@ -64,6 +71,7 @@ class Instruction
         void set_is_link(bool value);
         void set_opcode(uint32_t value);
         void set_interpreter_fallback(void(*value)(ee::EmotionEngine&, uint32_t));
+        void set_interpreter_fallback(void(*value)(iop::IOP&, uint32_t));
 
         bool is_jump();
 };
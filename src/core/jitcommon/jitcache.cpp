@@ -1,5 +1,7 @@
 #ifdef _WIN32
+#ifndef NOMINMAX
 #define NOMINMAX
+#endif
 #include <Windows.h>
 #include <algorithm>
 #else
@@ -10,6 +12,7 @@
 #include <cstring>
 
 #include <util/errors.hpp>
+#include <util/hostmem.hpp>
 #include "jitcache.hpp"
 
 //////////////
@@ -116,6 +119,8 @@ void* JitHeap::rwx_alloc(std::size_t size)
     result = (void *)VirtualAlloc(NULL, size, MEM_COMMIT | MEM_RESERVE, PAGE_EXECUTE_READWRITE);
 #else
     result = (void*)mmap(nullptr, size, PROT_READ | PROT_WRITE | PROT_EXEC, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (result != MAP_FAILED)
+        HostMemory::advise_huge_pages(result, size);
 #endif
     return result;
 }
@@ -552,6 +557,24 @@ void EEJitHeap::invalidate_ee_page(uint32_t page)
 
 }
 
+/*!
+ * Free memory for the block starting at PC, if there is one, and remove it from the lookup.
+ * Must not be called while that block is running, as the allocator writes into freed memory.
+ */
+void EEJitHeap::invalidate_block(uint32_t PC)
+{
+    EEJitBlockRecord* record = find_block(PC);
+    if(!record)
+        return;
+
+    jit_free(record->literals_start);
+    record->literals_start = nullptr;
+
+    EEJitBlockRecord*& cached = lookup_cache[(PC >> 2) & 0x7FFF];
+    if(cached == record)
+        cached = nullptr;
+}
+
 /*!
  * Return a matching block
  * returns nullptr if the block isn't found.
@@ -368,5 +368,10 @@ public:
     EEJitBlockRecord *insert_block(uint32_t PC, JitBlock* block);
     void flush_all_blocks();
     void invalidate_ee_page(uint32_t page);
+    void invalidate_block(uint32_t PC);
     EEJitBlockRecord *find_block(uint32_t PC);
-};
\ No newline at end of file
+};
+
+// The IOP recompiler keys its blocks by PC the same way
+using IOPJitBlockRecord = EEJitBlockRecord;
+using IOPJitHeap = EEJitHeap;
\ No newline at end of file
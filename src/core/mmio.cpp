@@ -0,0 +1,1266 @@
+#include <emulator.hpp>
+#include <util/errors.hpp>
+#include <ee/dmac.hpp>
+#include <ee/emotion.hpp>
+#include <ee/intc.hpp>
+#include <ee/ipu/ipu.hpp>
+#include <ee/timers.hpp>
+#include <ee/vu/vif.hpp>
+#include <ee/vu/vu.hpp>
+#include <iop/iop.hpp>
+#include <iop/dma.hpp>
+#include <iop/intc.hpp>
+#include <iop/timers.hpp>
+#include <iop/sio2/sio2.hpp>
+#include <iop/spu/spu.hpp>
+#include <iop/sio2/firewire.hpp>
+#include <gs/gs.hpp>
+#include <gs/gif.hpp>
+#include <sif.hpp>
+#include <cstdio>
+#include <fmt/core.h>
+
+/**
+Registers the EE and IOP physical address spaces with their MMIOMaps. Devices own whole 4 KB pages.
+Where several devices share a page (the GIF and VIFs, INTC/SIF/MCH, the IOP's 0x1F801000 block...),
+the page's handler picks the register and hands anything it doesn't know to the fallback.
+**/
+
+namespace core
+{
+    void Emulator::map_ee_mmio()
+    {
+        EEMMIOMap::Device unmapped;
+        unmapped.on_read<uint8_t>([](uint32_t address) -> uint8_t
+        {
+            fmt::print("[CORE] Unrecognized read8 at physical address {:#x}\n", address);
+            return 0;
+        });
+        unmapped.on_read<uint16_t>([](uint32_t address) -> uint16_t
+        {
+            fmt::print("[CORE] Unrecognized read16 at physical address {:#x}\n", address);
+            return 0;
+        });
+        unmapped.on_read<uint32_t>([](uint32_t address) -> uint32_t
+        {
+            fmt::print("[CORE] Unrecognized read32 at physical addr {:#x}\n", address);
+            return 0;
+        });
+        unmapped.on_read<uint64_t>([](uint32_t address) -> uint64_t
+        {
+            fmt::print("[CORE] Unrecognized read64 at physical address {:#x}\n", address);
+            return 0;
+        });
+        unmapped.on_read<uint128_t>([](uint32_t address)
+        {
+            fmt::print("[CORE] Unrecognized read128 at physical address {:#x}\n", address);
+            return uint128_t::from_u32(0);
+        });
+        unmapped.on_write<uint8_t>([](uint32_t address, uint8_t value)
+        {
+            fmt::print("[CORE] Unrecognized write8 at physical address {:#x} of {:#x}\n", address, value);
+        });
+        unmapped.on_write<uint16_t>([](uint32_t address, uint16_t value)
+        {
+            fmt::print("[CORE] Unrecognized write16 at physical address {:#x} of {:#x}\n", address, value);
+        });
+        unmapped.on_write<uint32_t>([](uint32_t address, uint32_t value)
+        {
+            fmt::print("[CORE] Unrecognized write32 at physical address {:#x} of {:#x}\n", address, value);
+        });
+        unmapped.on_write<uint64_t>([](uint32_t address, uint64_t value)
+        {
+            fmt::print("[CORE] Unrecognized write64 at physical address {:#x} of {:#x}\n", address, value);
+        });
+        unmapped.on_write<uint128_t>([](uint32_t address, uint128_t value)
+        {
+            fmt::print("[CORE] Unrecognized write128 at physical address {:#x} of {:#x}{:016x}\n", address, value._u64[1], value._u64[0]);
+        });
+        ee_mmio.set_fallback(unmapped);
+
+        EEMMIOMap::Device timer_regs;
+        timer_regs.on_read<uint8_t>([this](uint32_t address) { return timers->read32(address & ~0xF) >> (8 * (address & 0x3)); });
+        timer_regs.on_read<uint16_t>([this](uint32_t address) { return timers->read32(address); });
+        timer_regs.on_read<uint32_t>([this](uint32_t address) { return timers->read32(address); });
+        timer_regs.on_read<uint64_t>([this](uint32_t address) { return timers->read32(address); });
+        timer_regs.on_write<uint32_t>([this](uint32_t address, uint32_t value) { timers->write32(address, value); });
+        timer_regs.on_write<uint64_t>([this](uint32_t address, uint64_t value) { timers->write32(address, value); });
+        ee_mmio.map(0x10000000, 0x10002000, timer_regs);
+
+        EEMMIOMap::Device ipu_regs;
+        ipu_regs.on_read<uint32_t>([this](uint32_t address) -> uint32_t
+        {
+            switch (address)
+            {
+                case 0x10002000:
+                    return ipu->read_command();
+                case 0x10002010:
+                    return ipu->read_control();
+                case 0x10002020:
+                    return ipu->read_BP();
+                case 0x10002030:
+                    return ipu->read_top();
+            }
+            return ee_mmio.unmapped_read<uint32_t>(address);
+        });
+        ipu_regs.on_read<uint64_t>([this](uint32_t address) -> uint64_t
+        {
+            switch (address)
+            {
+                case 0x10002000:
+                    return ipu->read_command();
+                case 0x10002010:
+                    return ipu->read_control();
+                case 0x10002020:
+                    return ipu->read_BP();
+                case 0x10002030:
+                    return ipu->read_top();
+            }
+            return ee_mmio.unmapped_read<uint64_t>(address);
+        });
+        ipu_regs.on_write<uint32_t>([this](uint32_t address, uint32_t value)
+        {
+            switch (address)
+            {
+                case 0x10002000:
+                    ipu->write_command(value);
+                    return;
+                case 0x10002010:
+                    ipu->write_control(value);
+                    return;
+            }
+            ee_mmio.unmapped_write<uint32_t>(address, value);
+        });
+        ee_mmio.map(0x10002000, 0x10003000, ipu_regs);
+
+        EEMMIOMap::Device gif_vif_regs;
+        gif_vif_regs.on_read<uint16_t>([this](uint32_t address) -> uint16_t
+        {
+            if (address == 0x10003C30)
+                return vif1->get_mark() & 0xFFFF;
+            return ee_mmio.unmapped_read<uint16_t>(address);
+        });
+        gif_vif_regs.on_read<uint32_t>([this](uint32_t address) -> uint32_t
+        {
+            switch (address)
+            {
+                case 0x10003020:
+                    return gif->read_STAT();
+                case 0x10003800:
+                    return vif0->get_stat();
+                case 0x10003850:
+                    return vif0->get_mode();
+                case 0x10003900:
+                case 0x10003910:
+                case 0x10003920:
+                case 0x10003930:
+                    return vif0->get_row(address);
+                case 0x10003C00:
+                    return vif1->get_stat();
+                case 0x10003C20:
+                    return vif1->get_err();
+                case 0x10003C30:
+                    return vif1->get_mark();
+                case 0x10003C50:
+                    return vif1->get_mode();
+                case 0x10003C80:
+                    return vif1->get_code();
+                case 0x10003CE0:
+                    return vif1->get_top();
+                case 0x10003D00:
+                case 0x10003D10:
+                case 0x10003D20:
+                case 0x10003D30:
+                    return vif1->get_row(address);
+            }
+            return ee_mmio.unmapped_read<uint32_t>(address);
+        });
+        gif_vif_regs.on_write<uint32_t>([this](uint32_t address, uint32_t value)
+        {
+            switch (address)
+            {
+                case 0x10003000:
+                    gif->write_CTRL(value);
+                    return;
+                case 0x10003010:
+                    gif->write_MODE(value);
+                    return;
+                case 0x10003810:
+                    vif0->set_fbrst(value);
+                    return;
+                case 0x10003820:
+                    vif0->set_err(value);
+                    return;
+                case 0x10003830:
+                    vif0->set_mark(value);
+                    return;
+                case 0x10003c00:
+                    vif1->set_stat(value);
+                    return;
+                case 0x10003C10:
+                    vif1->set_fbrst(value);
+                    return;
+                case 0x10003C20:
+                    vif1->set_err(value);
+                    return;
+                case 0x10003C30:
+                    vif1->set_mark(value);
+                    return;
+            }
+            ee_mmio.unmapped_write<uint32_t>(address, value);
+        });
+        ee_mmio.map(0x10003000, 0x10004000, gif_vif_regs);
+
+        //VIF0, VIF1, GIF and IPU FIFOs
+        EEMMIOMap::Device fifos;
+        fifos.on_read<uint128_t>([this](uint32_t address)
+        {
+            if (address == 0x10005000)
+                return std::get<0>(vif1->readFIFO());
+            return ee_mmio.unmapped_read<uint128_t>(address);
+        });
+        fifos.on_write<uint32_t>([this](uint32_t address, uint32_t value)
+        {
+            switch (address)
+            {
+                case 0x10004000:
+                    vif0->transfer_word(value);
+                    return;
+                case 0x10005000:
+                    vif1->transfer_word(value);
+                    return;
+            }
+            ee_mmio.unmapped_write<uint32_t>(address, value);
+        });
+        fifos.on_write<uint128_t>([this](uint32_t address, uint128_t value)
+        {
+            switch (address)
+            {
+                case 0x10004000:
+                    vif0->feed_DMA(value);
+                    return;
+                case 0x10005000:
+                    vif1->feed_DMA(value);
+                    return;
+                case 0x10006000:
+                    gif->send_PATH3_FIFO(value);
+                    return;
+                case 0x10007010:
+                    ipu->write_FIFO(value);
+                    return;
+            }
+            ee_mmio.unmapped_write<uint128_t>(address, value);
+        });
+        ee_mmio.map(0x10004000, 0x10008000, fifos);
+
+        EEMMIOMap::Device dmac_regs;
+        dmac_regs.on_read<uint8_t>([this](uint32_t address) { return dmac->read<uint8_t>(address); });
+        dmac_regs.on_read<uint16_t>([this](uint32_t address) { return dmac->read<uint16_t>(address); });
+        dmac_regs.on_read<uint32_t>([this](uint32_t address) { return dmac->read<uint32_t>(address); });
+        dmac_regs.on_read<uint64_t>([this](uint32_t address) { return dmac->read<uint32_t>(address); });
+        dmac_regs.on_write<uint8_t>([this](uint32_t address, uint8_t value) { dmac->write<uint8_t>(address, value); });
+        dmac_regs.on_write<uint16_t>([this](uint32_t address, uint16_t value) { dmac->write<uint16_t>(address, value); });
+        dmac_regs.on_write<uint32_t>([this](uint32_t address, uint32_t value) { dmac->write<uint32_t>(address, value); });
+        dmac_regs.on_write<uint64_t>([this](uint32_t address, uint64_t value) { dmac->write<uint32_t>(address, value); });
+        ee_mmio.map(0x10008000, 0x1000F000, dmac_regs);
+
+        //INTC, SIF, the RDRAM controller and the DMAC's master disable
+        EEMMIOMap::Device system_regs;
+        system_regs.on_read<uint32_t>([this](uint32_t address) -> uint32_t
+        {
+            switch (address)
+            {
+                case 0x1000F000:
+                    //printf("\nRead32 INTC_STAT: $%08X", intc->read_stat());
+                    return intc->read_stat();
+                case 0x1000F010:
+                    printf("Read32 INTC_MASK: $%08X\n", intc->read_mask());
+                    return intc->read_mask();
+                case 0x1000F130:
+                    return 0;
+                case 0x1000F200:
+                    return sif->get_mscom();
+                case 0x1000F210:
+                    return sif->get_smcom();
+                case 0x1000F220:
+                    return sif->get_msflag();
+                case 0x1000F230:
+                    return sif->get_smflag();
+                case 0x1000F240:
+                    printf("[EE] Read BD4: $%08X\n", sif->get_control() | 0xF0000102);
+                    return sif->get_control() | 0xF0000102;
+                case 0x1000F430:
+                    //printf("Read from MCH_RICM\n");
+                    return 0;
+                case 0x1000F440:
+                    //printf("Read from MCH_DRD\n");
+                    if (!((MCH_RICM >> 6) & 0xF))
+                    {
+                        switch ((MCH_RICM >> 16) & 0xFFF)
+                        {
+                            case 0x21:
+                                //printf("Init\n");
+                                if (rdram_sdevid < 2)
+                                {
+                                    rdram_sdevid++;
+                                    return 0x1F;
+                                }
+                                return 0;
+                            case 0x23:
+                                //printf("ConfigA\n");
+                                return 0x0D0D;
+                            case 0x24:
+                                //printf("ConfigB\n");
+                                return 0x0090;
+                            case 0x40:
+                                //printf("Devid\n");
+                                return MCH_RICM & 0x1F;
+                        }
+                    }
+                    return 0;
+                case 0x1000F520:
+                    return dmac->read_master_disable();
+            }
+            return ee_mmio.unmapped_read<uint32_t>(address);
+        });
+        system_regs.on_write<uint8_t>([this](uint32_t address, uint8_t value)
+        {
+            if (address == 0x1000F180)
+            {
+                ee_log << value;
+                ee_log.flush();
+                return;
+            }
+            ee_mmio.unmapped_write<uint8_t>(address, value);
+        });
+        system_regs.on_write<uint32_t>([this](uint32_t address, uint32_t value)
+        {
+            switch (address)
+            {
+                case 0x1000F000:
+                    printf("Write32 INTC_STAT: $%08X\n", value);
+                    intc->write_stat(value);
+                    return;
+                case 0x1000F010:
+                    printf("Write32 INTC_MASK: $%08X\n", value);
+                    intc->write_mask(value);
+                    return;
+                case 0x1000F200:
+                    sif->set_mscom(value);
+                    return;
+                case 0x1000F210:
+                    return;
+                case 0x1000F220:
+                    printf("[EE] Write32 msflag: $%08X\n", value);
+                    sif->set_msflag(value);
+                    return;
+                case 0x1000F230:
+                    printf("[EE] Write32 smflag: $%08X\n", value);
+                    sif->reset_smflag(value);
+                    return;
+                case 0x1000F240:
+                    printf("[EE] Write BD4: $%08X\n", value);
+                    sif->set_control_EE(value);
+                    return;
+                case 0x1000F430:
+                    //printf("Write to MCH_RICM: $%08X\n", value);
+                    if ((((value >> 16) & 0xFFF) == 0x21) && (((value >> 6) & 0xF) == 1) &&
+                            (((MCH_DRD >> 7) & 1) == 0))
+                        rdram_sdevid = 0;
+                    MCH_RICM = value & ~0x80000000;
+                    return;
+                case 0x1000F440:
+                    //printf("Write to MCH_DRD: $%08X\n", value);
+                    MCH_DRD = value;
+                    return;
+                case 0x1000F590:
+                    dmac->write_master_disable(value);
+                    return;
+            }
+            ee_mmio.unmapped_write<uint32_t>(address, value);
+        });
+        ee_mmio.map(0x1000F000, 0x10010000, system_regs);
+
+        //VU0 only decodes the low 12 bits of 128-bit writes
+        EEMMIOMap::Device vu0_instr;
+        vu0_instr.on_read<uint8_t>([this](uint32_t address) { return vu0->read_instr<uint8_t>(address); });
+        vu0_instr.on_read<uint16_t>([this](uint32_t address) { return vu0->read_instr<uint16_t>(address); });
+        vu0_instr.on_read<uint32_t>([this](uint32_t address) { return vu0->read_instr<uint32_t>(address); });
+        vu0_instr.on_read<uint64_t>([this](uint32_t address) { return vu0->read_instr<uint64_t>(address); });
+        vu0_instr.on_read<uint128_t>([this](uint32_t address) { return vu0->read_instr<uint128_t>(address); });
+        vu0_instr.on_write<uint8_t>([this](uint32_t address, uint8_t value) { vu0->write_instr<uint8_t>(address, value); });
+        vu0_instr.on_write<uint16_t>([this](uint32_t address, uint16_t value) { vu0->write_instr<uint16_t>(address, value); });
+        vu0_instr.on_write<uint32_t>([this](uint32_t address, uint32_t value) { vu0->write_instr<uint32_t>(address, value); });
+        vu0_instr.on_write<uint64_t>([this](uint32_t address, uint64_t value) { vu0->write_instr<uint64_t>(address, value); });
+        vu0_instr.on_write<uint128_t>([this](uint32_t address, uint128_t value) { vu0->write_instr<uint128_t>(address & 0xFFF, value); });
+        ee_mmio.map(0x11000000, 0x11004000, vu0_instr);
+
+        EEMMIOMap::Device vu0_mem;
+        vu0_mem.on_read<uint8_t>([this](uint32_t address) { return vu0->read_mem<uint8_t>(address); });
+        vu0_mem.on_read<uint16_t>([this](uint32_t address) { return vu0->read_mem<uint16_t>(address); });
+        vu0_mem.on_read<uint32_t>([this](uint32_t address) { return vu0->read_mem<uint32_t>(address); });
+        vu0_mem.on_read<uint64_t>([this](uint32_t address) { return vu0->read_mem<uint64_t>(address); });
+        vu0_mem.on_read<uint128_t>([this](uint32_t address) { return vu0->read_mem<uint128_t>(address); });
+        vu0_mem.on_write<uint8_t>([this](uint32_t address, uint8_t value) { vu0->write_mem<uint8_t>(address, value); });
+        vu0_mem.on_write<uint16_t>([this](uint32_t address, uint16_t value) { vu0->write_mem<uint16_t>(address, value); });
+        vu0_mem.on_write<uint32_t>([this](uint32_t address, uint32_t value) { vu0->write_mem<uint32_t>(address, value); });
+        vu0_mem.on_write<uint64_t>([this](uint32_t address, uint64_t value) { vu0->write_mem<uint64_t>(address, value); });
+        vu0_mem.on_write<uint128_t>([this](uint32_t address, uint128_t value) { vu0->write_mem<uint128_t>(address & 0xFFF, value); });
+        ee_mmio.map(0x11004000, 0x11008000, vu0_mem);
+
+        EEMMIOMap::Device vu1_instr;
+        vu1_instr.on_read<uint8_t>([this](uint32_t address) { return vu1->read_instr<uint8_t>(address); });
+        vu1_instr.on_read<uint16_t>([this](uint32_t address) { return vu1->read_instr<uint16_t>(address); });
+        vu1_instr.on_read<uint32_t>([this](uint32_t address) { return vu1->read_instr<uint32_t>(address); });
+        vu1_instr.on_read<uint64_t>([this](uint32_t address) { return vu1->read_instr<uint64_t>(address); });
+        vu1_instr.on_read<uint128_t>([this](uint32_t address) { return vu1->read_instr<uint128_t>(address); });
+        vu1_instr.on_write<uint8_t>([this](uint32_t address, uint8_t value) { vu1->write_instr<uint8_t>(address, value); });
+        vu1_instr.on_write<uint16_t>([this](uint32_t address, uint16_t value) { vu1->write_instr<uint16_t>(address, value); });
+        vu1_instr.on_write<uint32_t>([this](uint32_t address, uint32_t value) { vu1->write_instr<uint32_t>(address, value); });
+        vu1_instr.on_write<uint64_t>([this](uint32_t address, uint64_t value) { vu1->write_instr<uint64_t>(address, value); });
+        vu1_instr.on_write<uint128_t>([this](uint32_t address, uint128_t value) { vu1->write_instr<uint128_t>(address, value); });
+        ee_mmio.map(0x11008000, 0x1100C000, vu1_instr);
+
+        EEMMIOMap::Device vu1_mem;
+        vu1_mem.on_read<uint8_t>([this](uint32_t address) { return vu1->read_mem<uint8_t>(address); });
+        vu1_mem.on_read<uint16_t>([this](uint32_t address) { return vu1->read_mem<uint16_t>(address); });
+        vu1_mem.on_read<uint32_t>([this](uint32_t address) { return vu1->read_mem<uint32_t>(address); });
+        vu1_mem.on_read<uint64_t>([this](uint32_t address) { return vu1->read_mem<uint64_t>(address); });
+        vu1_mem.on_read<uint128_t>([this](uint32_t address) { return vu1->read_mem<uint128_t>(address); });
+        vu1_mem.on_write<uint8_t>([this](uint32_t address, uint8_t value) { vu1->write_mem<uint8_t>(address, value); });
+        vu1_mem.on_write<uint16_t>([this](uint32_t address, uint16_t value) { vu1->write_mem<uint16_t>(address, value); });
+        vu1_mem.on_write<uint32_t>([this](uint32_t address, uint32_t value) { vu1->write_mem<uint32_t>(address, value); });
+        vu1_mem.on_write<uint64_t>([this](uint32_t address, uint64_t value) { vu1->write_mem<uint64_t>(address, value); });
+        vu1_mem.on_write<uint128_t>([this](uint32_t address, uint128_t value) { vu1->write_mem<uint128_t>(address, value); });
+        ee_mmio.map(0x1100C000, 0x11010000, vu1_mem);
+
+        //Writes to the GS can unmask HBLANK, which needs an event to raise it
+        EEMMIOMap::Device gs_regs;
+        gs_regs.on_read<uint8_t>([this](uint32_t address) { return gs->read32_privileged(address & ~0x3) >> (8 * (address & 0x3)); });
+        gs_regs.on_read<uint16_t>([this](uint32_t address) { return gs->read32_privileged(address & ~0x3) >> (8 * (address & 0x2)); });
+        gs_regs.on_read<uint32_t>([this](uint32_t address) { return gs->read32_privileged(address); });
+        gs_regs.on_read<uint64_t>([this](uint32_t address) { return gs->read64_privileged(address); });
+        gs_regs.on_write<uint32_t>([this](uint32_t address, uint32_t value)
+        {
+            gs->write32_privileged(address, value);
+            gs->wake_gs_thread();
+            schedule_HBLANK_event();
+        });
+        gs_regs.on_write<uint64_t>([this](uint32_t address, uint64_t value)
+        {
+            gs->write64_privileged(address, value);
+            gs->wake_gs_thread();
+            schedule_HBLANK_event();
+        });
+        ee_mmio.map(0x12000000, 0x13000000, gs_regs);
+
+        //The EE can see the IOP's address space, but only its RAM and a few CDVD registers are emulated
+        EEMMIOMap::Device iop_space;
+        iop_space.on_read<uint16_t>([this](uint32_t address) -> uint16_t
+        {
+            if (address == 0x1A000006)
+                return 1;
+            return ee_mmio.unmapped_read<uint16_t>(address);
+        });
+        iop_space.on_write<uint16_t>([](uint32_t address, uint16_t value)
+        {
+            fmt::print("[EE] Unrecognized write16 to IOP address {:#x} of {:#x}\n", address, value);
+        });
+        iop_space.on_write<uint32_t>([](uint32_t address, uint32_t value)
+        {
+            fmt::print("[EE] Unrecognized write32 to IOP address {:#x} of {:#x}\n", address, value);
+        });
+        ee_mmio.map(0x1A000000, 0x1FC00000, iop_space);
+
+        EEMMIOMap::Device iop_ram = iop_space;
+        iop_ram.on_read<uint8_t>([this](uint32_t address) { return iop->ram[address & 0x1FFFFF]; });
+        iop_ram.on_read<uint16_t>([this](uint32_t address) { return *(uint16_t*)&iop->ram[address & 0x1FFFFF]; });
+        iop_ram.on_read<uint32_t>([this](uint32_t address) { return *(uint32_t*)&iop->ram[address & 0x1FFFFF]; });
+        iop_ram.on_read<uint64_t>([this](uint32_t address) { return *(uint64_t*)&iop->ram[address & 0x1FFFFF]; });
+        iop_ram.on_write<uint8_t>([this](uint32_t address, uint8_t value)
+        {
+            iop->ram[address & 0x1FFFFF] = value;
+            iop->invalidate_code(address & 0x1FFFFF, 1);
+        });
+        iop_ram.on_write<uint16_t>([this](uint32_t address, uint16_t value)
+        {
+            *(uint16_t*)&iop->ram[address & 0x1FFFFF] = value;
+            iop->invalidate_code(address & 0x1FFFFF, 2);
+        });
+        iop_ram.on_write<uint32_t>([this](uint32_t address, uint32_t value)
+        {
+            *(uint32_t*)&iop->ram[address & 0x1FFFFF] = value;
+            iop->invalidate_code(address & 0x1FFFFF, 4);
+        });
+        iop_ram.on_write<uint64_t>([this](uint32_t address, uint64_t value)
+        {
+            *(uint64_t*)&iop->ram[address & 0x1FFFFF] = value;
+            iop->invalidate_code(address & 0x1FFFFF, 8);
+        });
+        ee_mmio.map(0x1C000000, 0x1C200000, iop_ram);
+
+        EEMMIOMap::Device iop_cdvd = iop_space;
+        iop_cdvd.on_read<uint8_t>([this](uint32_t address) -> uint8_t
+        {
+            switch (address)
+            {
+                case 0x1F40200F:
+                    return cdvd->read_disc_type();
+                case 0x1F402017:
+                    return cdvd->read_S_status();
+                case 0x1F402018:
+                    return cdvd->read_S_data();
+            }
+            return ee_mmio.unmapped_read<uint8_t>(address);
+        });
+        ee_mmio.map(0x1F402000, 0x1F403000, iop_cdvd);
+    }
+
+    void Emulator::map_iop_mmio()
+    {
+        //Anything unmapped may still be the scratchpad, which the IOP can move around
+        IOPMMIOMap::Device unmapped;
+        unmapped.on_read<uint8_t>([this](uint32_t address) -> uint8_t
+        {
+            if (address >= iop->scratchpad_start && address < iop->scratchpad_start + 0x400)
+                return iop->scratchpad[address & 0x3FF];
+
+            fmt::print("[CORE] Unrecognized IOP read8 from physical address {:#x}\n", address);
+            return 0;
+        });
+        unmapped.on_read<uint16_t>([this](uint32_t address) -> uint16_t
+        {
+            if (address >= iop->scratchpad_start && address < iop->scratchpad_start + 0x400)
+                return *(uint16_t*)&iop->scratchpad[address & 0x3FF];
+
+            fmt::print("[CORE] Unrecognized IOP read16 from physical address {:#x}\n", address);
+            return 0;
+        });
+        unmapped.on_read<uint32_t>([this](uint32_t address) -> uint32_t
+        {
+            if (address == 0xFFFE0130) //Cache control?
+                return 0;
+            if (address >= iop->scratchpad_start && address < iop->scratchpad_start + 0x400)
+                return *(uint32_t*)&iop->scratchpad[address & 0x3FF];
+            fmt::print("[CORE] Unrecognized IOP read32 from physical addr {:#x}\n", address);
+            return 0;
+        });
+        unmapped.on_write<uint8_t>([this](uint32_t address, uint8_t value)
+        {
+            if (address >= iop->scratchpad_start && address < iop->scratchpad_start + 0x400)
+            {
+                iop->scratchpad[address & 0x3FF] = value;
+                return;
+            }
+            fmt::print("[CORE] Unrecognized IOP write8 to physical address {:#x} of {:#x}\n", address, value);
+        });
+        unmapped.on_write<uint16_t>([this](uint32_t address, uint16_t value)
+        {
+            if (address >= iop->scratchpad_start && address < iop->scratchpad_start + 0x400)
+            {
+                *(uint16_t*)&iop->scratchpad[address & 0x3FF] = value;
+                return;
+            }
+
+            fmt::print("Unrecognized IOP write16 to physical address {:#x} of {:#x}\n", address, value);
+        });
+        unmapped.on_write<uint32_t>([this](uint32_t address, uint32_t value)
+        {
+            //Cache control?
+            if (address == 0xFFFE0130)
+                return;
+            if (address == 0xFFFE0144)
+            {
+                fmt::print("[IOP] Scratchpad start: {:#x}\n", value);
+                iop->set_scratchpad_start(value);
+                return;
+            }
+            if (address >= iop->scratchpad_start && address < iop->scratchpad_start + 0x400)
+            {
+                *(uint32_t*)&iop->scratchpad[address & 0x3FF] = value;
+                return;
+            }
+
+            fmt::print("[CORE] Unrecognized IOP write32 to physical address {:#x} of {:#x}\n", address, value);
+        });
+        iop_mmio.set_fallback(unmapped);
+
+        IOPMMIOMap::Device ram;
+        ram.on_read<uint8_t>([this](uint32_t address) { return iop->ram[address]; });
+        ram.on_read<uint16_t>([this](uint32_t address) { return *(uint16_t*)&iop->ram[address]; });
+        ram.on_read<uint32_t>([this](uint32_t address) { return *(uint32_t*)&iop->ram[address]; });
+        ram.on_write<uint8_t>([this](uint32_t address, uint8_t value) { iop->ram[address] = value; });
+        ram.on_write<uint16_t>([this](uint32_t address, uint16_t value) { *(uint16_t*)&iop->ram[address] = value; });
+        ram.on_write<uint32_t>([this](uint32_t address, uint32_t value) { *(uint32_t*)&iop->ram[address] = value; });
+        iop_mmio.map(0x00000000, 0x00200000, ram);
+
+        IOPMMIOMap::Device sif_regs;
+        sif_regs.on_read<uint32_t>([this](uint32_t address) -> uint32_t
+        {
+            switch (address)
+            {
+                case 0x1D000000:
+                    return sif->get_mscom();
+                case 0x1D000010:
+                    return sif->get_smcom();
+                case 0x1D000020:
+                    return sif->get_msflag();
+                case 0x1D000030:
+                    return sif->get_smflag();
+                case 0x1D000040:
+                    fmt::print("[IOP] Read BD4: {:#x}\n", sif->get_control() | 0xF0000002);
+                    return sif->get_control() | 0xF0000002;
+            }
+            return iop_mmio.unmapped_read<uint32_t>(address);
+        });
+        sif_regs.on_write<uint32_t>([this](uint32_t address, uint32_t value)
+        {
+            switch (address)
+            {
+                case 0x1D000000:
+                    //Read only
+                    return;
+                case 0x1D000010:
+                    sif->set_smcom(value);
+                    return;
+                case 0x1D000020:
+                    sif->reset_msflag(value);
+                    return;
+                case 0x1D000030:
+                    fmt::print("[IOP] Set smflag: {:#x}\n", value);
+                    sif->set_smflag(value);
+                    return;
+                case 0x1D000040:
+                    fmt::print("[IOP] Write BD4: {:#x}\n", value);
+                    sif->set_control_IOP(value);
+                    return;
+            }
+            iop_mmio.unmapped_write<uint32_t>(address, value);
+        });
+        iop_mmio.map(0x1D000000, 0x1D001000, sif_regs);
+
+        IOPMMIOMap::Device cdvd_regs;
+        cdvd_regs.on_read<uint8_t>([this](uint32_t address) -> uint8_t
+        {
+            switch (address)
+            {
+                case 0x1F402004:
+                    return cdvd->read_N_command();
+                case 0x1F402005:
+                    return cdvd->read_N_status();
+                case 0x1F402008:
+                    return cdvd->read_ISTAT();
+                case 0x1F40200A:
+                    return cdvd->read_drive_status();
+                case 0x1F40200F:
+                    return cdvd->read_disc_type();
+                case 0x1F402013:
+                    return 4;
+                case 0x1F402016:
+                    return cdvd->read_S_command();
+                case 0x1F402017:
+                    return cdvd->read_S_status();
+                case 0x1F402018:
+                    return cdvd->read_S_data();
+                case 0x1F402020:
+                case 0x1F402021:
+                case 0x1F402022:
+                case 0x1F402023:
+                case 0x1F402024:
+                    return cdvd->read_cdkey(address - 0x1F402020);
+                case 0x1F402028:
+                case 0x1F402029:
+                case 0x1F40202A:
+                case 0x1F40202B:
+                case 0x1F40202C:
+                    return cdvd->read_cdkey(address - 0x1F402023);
+                case 0x1F402030:
+                case 0x1F402031:
+                case 0x1F402032:
+                case 0x1F402033:
+                case 0x1F402034:
+                    return cdvd->read_cdkey(address - 0x1F402026);
+                case 0x1F402038:
+                    return cdvd->read_cdkey(15);
+            }
+            return iop_mmio.unmapped_read<uint8_t>(address);
+        });
+        cdvd_regs.on_write<uint8_t>([this](uint32_t address, uint8_t value)
+        {
+            switch (address)
+            {
+                case 0x1F402004:
+                    cdvd->send_N_command(value);
+                    return;
+                case 0x1F402005:
+                    cdvd->write_N_data(value);
+                    return;
+                case 0x1F402006:
+                    fmt::print("[CDVD] Write to mode: {:#x}\n", value);
+                    return;
+                case 0x1F402007:
+                    cdvd->write_BREAK();
+                    return;
+                case 0x1F402008:
+                    cdvd->write_ISTAT(value);
+                    return;
+                case 0x1F402016:
+                    cdvd->send_S_command(value);
+                    return;
+                case 0x1F402017:
+                    cdvd->write_S_data(value);
+                    return;
+                case 0x1F40203A:
+                    cdvd->write_mecha_decode(value);
+                    return;
+            }
+            iop_mmio.unmapped_write<uint8_t>(address, value);
+        });
+        iop_mmio.map(0x1F402000, 0x1F403000, cdvd_regs);
+
+        //INTC, DMA and timers
+        IOPMMIOMap::Device system_regs;
+        system_regs.on_read<uint16_t>([this](uint32_t address) -> uint16_t
+        {
+            switch (address)
+            {
+                case 0x1F801100:
+                    return iop_timers->read_counter(0);
+                case 0x1F801104:
+                    return iop_timers->read_control(0);
+                case 0x1F801108:
+                    return iop_timers->read_target(0);
+                case 0x1F801110:
+                    return iop_timers->read_counter(1);
+                case 0x1F801114:
+                    return iop_timers->read_control(1);
+                case 0x1F801118:
+                    return iop_timers->read_target(1);
+                case 0x1F801120:
+                    return iop_timers->read_counter(2);
+                case 0x1F801124:
+                    return iop_timers->read_control(2);
+                case 0x1F801128:
+                    return iop_timers->read_target(2);
+                case 0x1F801480:
+                    return iop_timers->read_counter(3) & 0xFFFF;
+                case 0x1F801482:
+                    return iop_timers->read_counter(3) >> 16;
+                case 0x1F801484:
+                    return iop_timers->read_control(3);
+                case 0x1F801488:
+                    return iop_timers->read_target(3) & 0xFFFF;
+                case 0x1F80148A:
+                    return iop_timers->read_target(3) >> 16;
+                case 0x1F801490:
+                    return iop_timers->read_counter(4) & 0xFFFF;
+                case 0x1F801492:
+                    return iop_timers->read_counter(4) >> 16;
+                case 0x1F801494:
+                    return iop_timers->read_control(4);
+                case 0x1F801498:
+                    return iop_timers->read_target(4) & 0xFFFF;
+                case 0x1F80149A:
+                    return iop_timers->read_target(4) >> 16;
+                case 0x1F8014A0:
+                    return iop_timers->read_counter(5) & 0xFFFF;
+                case 0x1F8014A2:
+                    return iop_timers->read_counter(5) >> 16;
+                case 0x1F8014A4:
+                    return iop_timers->read_control(5);
+                case 0x1F8014A8:
+                    return iop_timers->read_target(5) & 0xFFFF;
+                case 0x1F8014AA:
+                    return iop_timers->read_target(5) >> 16;
+            }
+            return iop_mmio.unmapped_read<uint16_t>(address);
+        });
+        system_regs.on_read<uint32_t>([this](uint32_t address) -> uint32_t
+        {
+            switch (address)
+            {
+                case 0x1F801070:
+                    return iop_intc->read_istat();
+                case 0x1F801074:
+                    return iop_intc->read_imask();
+                case 0x1F801078:
+                    return iop_intc->read_ictrl();
+                case 0x1F8010B0:
+                    return iop_dma->get_chan_addr(3);
+                case 0x1F8010B8:
+                    return iop_dma->get_chan_control(3);
+                case 0x1F8010C0:
+                    return iop_dma->get_chan_addr(4);
+                case 0x1F8010C8:
+                    return iop_dma->get_chan_control(4);
+                case 0x1F8010F0:
+                    return iop_dma->get_DPCR();
+                case 0x1F8010F4:
+                    return iop_dma->get_DICR();
+                case 0x1F801100:
+                    return iop_timers->read_counter(0);
+                case 0x1F801104:
+                    return iop_timers->read_control(0);
+                case 0x1F801108:
+                    return iop_timers->read_target(0);
+                case 0x1F801110:
+                    return iop_timers->read_counter(1);
+                case 0x1F801114:
+                    return iop_timers->read_control(1);
+                case 0x1F801118:
+                    return iop_timers->read_target(1);
+                case 0x1F801120:
+                    return iop_timers->read_counter(2);
+                case 0x1F801124:
+                    return iop_timers->read_control(2);
+                case 0x1F801128:
+                    return iop_timers->read_target(2);
+                case 0x1F801450:
+                    return 0;
+                case 0x1F801480:
+                    return iop_timers->read_counter(3);
+                case 0x1F801484:
+                    return iop_timers->read_control(3);
+                case 0x1F801488:
+                    return iop_timers->read_target(3);
+                case 0x1F801490:
+                    return iop_timers->read_counter(4);
+                case 0x1F801494:
+                    return iop_timers->read_control(4);
+                case 0x1F801498:
+                    return iop_timers->read_target(4);
+                case 0x1F8014A0:
+                    return iop_timers->read_counter(5);
+                case 0x1F8014A4:
+                    return iop_timers->read_control(5);
+                case 0x1F8014A8:
+                    return iop_timers->read_target(5);
+                case 0x1F801500:
+                    return iop_dma->get_chan_addr(8);
+                case 0x1F801508:
+                    return iop_dma->get_chan_control(8);
+                case 0x1F801528:
+                    return iop_dma->get_chan_control(10);
+                case 0x1F801548:
+                    return iop_dma->get_chan_control(12);
+                case 0x1F801558:
+                    return iop_dma->get_chan_control(13);
+                case 0x1F801570:
+                    return iop_dma->get_DPCR2();
+                case 0x1F801574:
+                    return iop_dma->get_DICR2();
+                case 0x1F801578:
+                    return 0; //No clue
+            }
+            return iop_mmio.unmapped_read<uint32_t>(address);
+        });
+        system_regs.on_write<uint16_t>([this](uint32_t address, uint16_t value)
+        {
+            switch (address)
+            {
+                case 0x1F8010B4:
+                    iop_dma->set_chan_size(3, value);
+                    return;
+                case 0x1F8010B6:
+                    iop_dma->set_chan_count(3, value);
+                    return;
+                case 0x1F8010C4:
+                    iop_dma->set_chan_size(4, value);
+                    return;
+                case 0x1F8010C6:
+                    iop_dma->set_chan_count(4, value);
+                    return;
+                case 0x1F801100:
+                    iop_timers->write_counter(0, value);
+                    return;
+                case 0x1F801104:
+                    iop_timers->write_control(0, value);
+                    return;
+                case 0x1F801108:
+                    iop_timers->write_target(0, value);
+                    return;
+                case 0x1F801110:
+                    iop_timers->write_counter(1, value);
+                    return;
+                case 0x1F801114:
+                    iop_timers->write_control(1, value);
+                    return;
+                case 0x1F801118:
+                    iop_timers->write_target(1, value);
+                    return;
+                case 0x1F801120:
+                    iop_timers->write_counter(2, value);
+                    return;
+                case 0x1F801124:
+                    iop_timers->write_control(2, value);
+                    return;
+                case 0x1F801128:
+                    iop_timers->write_target(2, value);
+                    return;
+                case 0x1F801480:
+                    iop_timers->write_counter(3, value | (iop_timers->read_counter(3) & 0xFFFF0000));
+                    return;
+                case 0x1F801482:
+                    iop_timers->write_counter(3, ((uint32_t)value << 16) | (iop_timers->read_counter(3) & 0xFFFF));
+                    return;
+                case 0x1F801484:
+                    iop_timers->write_control(3, value);
+                    return;
+                case 0x1F801488:
+                    iop_timers->write_target(3, value | (iop_timers->read_target(3) & 0xFFFF0000));
+                    return;
+                case 0x1F80148A:
+                    iop_timers->write_target(3, ((uint32_t)value << 16) | (iop_timers->read_target(3) & 0xFFFF));
+                    return;
+                case 0x1F801490:
+                    iop_timers->write_counter(4, value | (iop_timers->read_counter(4) & 0xFFFF0000));
+                    return;
+                case 0x1F801492:
+                    iop_timers->write_counter(4, ((uint32_t)value << 16) | (iop_timers->read_counter(4) & 0xFFFF));
+                    return;
+                case 0x1F801494:
+                    iop_timers->write_control(4, value);
+                    return;
+                case 0x1F801498:
+                    iop_timers->write_target(4, value | (iop_timers->read_target(4) & 0xFFFF0000));
+                    return;
+                case 0x1F80149A:
+                    iop_timers->write_target(4, (uint32_t)(value << 16) | (iop_timers->read_target(4) & 0xFFFF));
+                    return;
+                case 0x1F8014A0:
+                    iop_timers->write_counter(5, value | (iop_timers->read_counter(5) & 0xFFFF0000));
+                    return;
+                case 0x1F8014A2:
+                    iop_timers->write_counter(5, ((uint32_t)value << 16) | (iop_timers->read_counter(5) & 0xFFFF));
+                    return;
+                case 0x1F8014A4:
+                    iop_timers->write_control(5, value);
+                    return;
+                case 0x1F8014A8:
+                    iop_timers->write_target(5, value | (iop_timers->read_target(5) & 0xFFFF0000));
+                    return;
+                case 0x1F8014AA:
+                    iop_timers->write_target(5, ((uint32_t)value << 16) | (iop_timers->read_target(5) & 0xFFFF));
+                    return;
+                case 0x1F801504:
+                    iop_dma->set_chan_size(8, value);
+                    return;
+                case 0x1F801506:
+                    iop_dma->set_chan_count(8, value);
+                    return;
+                case 0x1F801524:
+                    iop_dma->set_chan_size(10, value);
+                    return;
+                case 0x1F801534:
+                    iop_dma->set_chan_size(11, value);
+                    return;
+                case 0x1F801536:
+                    iop_dma->set_chan_count(11, value);
+                    return;
+            }
+            iop_mmio.unmapped_write<uint16_t>(address, value);
+        });
+        system_regs.on_write<uint32_t>([this](uint32_t address, uint32_t value)
+        {
+            switch (address)
+            {
+                case 0x1F801010:
+                    fmt::print("[IOP] SIF2/GPU SSBUS: {:#x}\n", value);
+                    return;
+                case 0x1F801014:
+                    fmt::print("[IOP] SPU SSBUS: {:#x}\n", value);
+                    return;
+                case 0x1F801070:
+                    iop_intc->write_istat(value);
+                    return;
+                case 0x1F801074:
+                    iop_intc->write_imask(value);
+                    return;
+                case 0x1F801078:
+                    iop_intc->write_ictrl(value);
+                    return;
+                //CDVD DMA
+                case 0x1F8010B0:
+                    iop_dma->set_chan_addr(3, value);
+                    return;
+                case 0x1F8010B4:
+                    iop_dma->set_chan_block(3, value);
+                    return;
+                case 0x1F8010B8:
+                    iop_dma->set_chan_control(3, value);
+                    return;
+                //SPU DMA
+                case 0x1F8010C0:
+                    iop_dma->set_chan_addr(4, value);
+                    return;
+                case 0x1F8010C4:
+                    iop_dma->set_chan_block(4, value);
+                    return;
+                case 0x1F8010C8:
+                    iop_dma->set_chan_control(4, value);
+                    return;
+                case 0x1F8010F0:
+                    iop_dma->set_DPCR(value);
+                    return;
+                case 0x1F8010F4:
+                    iop_dma->set_DICR(value);
+                    return;
+                case 0x1F801100:
+                    iop_timers->write_counter(0, value);
+                    return;
+                case 0x1F801104:
+                    iop_timers->write_control(0, value);
+                    return;
+                case 0x1F801108:
+                    iop_timers->write_target(0, value);
+                    return;
+                case 0x1F801110:
+                    iop_timers->write_counter(1, value);
+                    return;
+                case 0x1F801114:
+                    iop_timers->write_control(1, value);
+                    return;
+                case 0x1F801118:
+                    iop_timers->write_target(1, value);
+                    return;
+                case 0x1F801120:
+                    iop_timers->write_counter(2, value);
+                    return;
+                case 0x1F801124:
+                    iop_timers->write_control(2, value);
+                    return;
+                case 0x1F801128:
+                    iop_timers->write_target(2, value);
+                    return;
+                case 0x1F801404:
+                    return;
+                case 0x1F801450:
+                    //Config reg? Do nothing to prevent log spam
+                    return;
+                case 0x1F801480:
+                    iop_timers->write_counter(3, value);
+                    return;
+                case 0x1F801484:
+                    iop_timers->write_control(3, value);
+                    return;
+                case 0x1F801488:
+                    iop_timers->write_target(3, value);
+                    return;
+                case 0x1F801490:
+                    iop_timers->write_counter(4, value);
+                    return;
+                case 0x1F801494:
+                    iop_timers->write_control(4, value);
+                    return;
+                case 0x1F801498:
+                    iop_timers->write_target(4, value);
+                    return;
+                case 0x1F8014A0:
+                    iop_timers->write_counter(5, value);
+                    return;
+                case 0x1F8014A4:
+                    iop_timers->write_control(5, value);
+                    return;
+                case 0x1F8014A8:
+                    iop_timers->write_target(5, value);
+                    return;
+                //SPU2 DMA
+                case 0x1F801500:
+                    iop_dma->set_chan_addr(8, value);
+                    return;
+                case 0x1F801504:
+                    iop_dma->set_chan_block(8, value);
+                    return;
+                case 0x1F801508:
+                    iop_dma->set_chan_control(8, value);
+                    return;
+                //SIF0 DMA
+                case 0x1F801520:
+                    iop_dma->set_chan_addr(10, value);
+                    return;
+                case 0x1F801524:
+                    iop_dma->set_chan_block(10, value);
+                    return;
+                case 0x1F801528:
+                    iop_dma->set_chan_control(10, value);
+                    return;
+                case 0x1F80152C:
+                    iop_dma->set_chan_tag_addr(10, value);
+                    return;
+                //SIF1 DMA
+                case 0x1F801530:
+                    iop_dma->set_chan_addr(11, value);
+                    return;
+                case 0x1F801534:
+                    iop_dma->set_chan_block(11, value);
+                    return;
+                case 0x1F801538:
+                    iop_dma->set_chan_control(11, value);
+                    return;
+                //SIO2in DMA
+                case 0x1F801540:
+                    iop_dma->set_chan_addr(12, value);
+                    return;
+                case 0x1F801544:
+                    iop_dma->set_chan_block(12, value);
+                    return;
+                case 0x1F801548:
+                    iop_dma->set_chan_control(12, value);
+                    return;
+                //SIO2out DMA
+                case 0x1F801550:
+                    iop_dma->set_chan_addr(13, value);
+                    return;
+                case 0x1F801554:
+                    iop_dma->set_chan_block(13, value);
+                    return;
+                case 0x1F801558:
+                    iop_dma->set_chan_control(13, value);
+                    return;
+                case 0x1F801570:
+                    iop_dma->set_DPCR2(value);
+                    return;
+                case 0x1F801574:
+                    iop_dma->set_DICR2(value);
+                    return;
+                case 0x1F801578:
+                    return;
+            }
+            iop_mmio.unmapped_write<uint32_t>(address, value);
+        });
+        iop_mmio.map(0x1F801000, 0x1F802000, system_regs);
+
+        //POST2?
+        IOPMMIOMap::Device post2;
+        post2.on_write<uint8_t>([this](uint32_t address, uint8_t value)
+        {
+            if (address != 0x1F802070)
+                iop_mmio.unmapped_write<uint8_t>(address, value);
+        });
+        post2.on_write<uint32_t>([this](uint32_t address, uint32_t value)
+        {
+            if (address != 0x1F802070)
+                iop_mmio.unmapped_write<uint32_t>(address, value);
+        });
+        iop_mmio.map(0x1F802000, 0x1F803000, post2);
+
+        //SIO2 and FireWire
+        IOPMMIOMap::Device sio2_regs;
+        sio2_regs.on_read<uint8_t>([this](uint32_t address) -> uint8_t
+        {
+            if (address == 0x1F808264)
+                return sio2->read_serial();
+            return iop_mmio.unmapped_read<uint8_t>(address);
+        });
+        sio2_regs.on_read<uint32_t>([this](uint32_t address) -> uint32_t
+        {
+            if (address >= 0x1F808400 && address < 0x1F808550)
+                return firewire->read32(address);
+            switch (address)
+            {
+                case 0x1F808268:
+                    return sio2->get_control();
+                case 0x1F80826C:
+                    return sio2->get_RECV1();
+                case 0x1F808270:
+                    return sio2->get_RECV2();
+                case 0x1F808274:
+                    return sio2->get_RECV3();
+            }
+            return iop_mmio.unmapped_read<uint32_t>(address);
+        });
+        sio2_regs.on_write<uint8_t>([this](uint32_t address, uint8_t value)
+        {
+            if (address == 0x1F808260)
+            {
+                sio2->write_serial(value);
+                return;
+            }
+            iop_mmio.unmapped_write<uint8_t>(address, value);
+        });
+        sio2_regs.on_write<uint32_t>([this](uint32_t address, uint32_t value)
+        {
+            //SIO2 send buffers
+            if (address >= 0x1F808200 && address < 0x1F808240)
+            {
+                int index = address - 0x1F808200;
+                sio2->set_send3(index >> 2, value);
+                return;
+            }
+            if (address >= 0x1F808240 && address < 0x1F808260)
+            {
+                int index = address - 0x1F808240;
+                if (address & 0x4)
+                    sio2->set_send2(index >> 3, value);
+                else
+                    sio2->set_send1(index >> 3, value);
+                return;
+            }
+            if (address >= 0x1F808400 && address < 0x1F808550)
+            {
+                firewire->write32(address, value);
+                return;
+            }
+            if (address == 0x1F808268)
+            {
+                sio2->set_control(value);
+                return;
+            }
+            iop_mmio.unmapped_write<uint32_t>(address, value);
+        });
+        iop_mmio.map(0x1F808000, 0x1F809000, sio2_regs);
+
+        //SPU2 core 0 also answers to the shared registers at 0x1F900760
+        IOPMMIOMap::Device spu_regs;
+        spu_regs.on_read<uint16_t>([this](uint32_t address) -> uint16_t
+        {
+            if (address < 0x1F900400)
+                return spu->read16(address);
+            if (address < 0x1F900800)
+                return spu2->read16(address);
+            return iop_mmio.unmapped_read<uint16_t>(address);
+        });
+        spu_regs.on_write<uint16_t>([this](uint32_t address, uint16_t value)
+        {
+            if (address < 0x1F900400 || (address >= 0x1F900760 && address < 0x1F900788))
+            {
+                spu->write16(address, value);
+                return;
+            }
+            if (address < 0x1F900800)
+            {
+                spu2->write16(address, value);
+                return;
+            }
+            iop_mmio.unmapped_write<uint16_t>(address, value);
+        });
+        iop_mmio.map(0x1F900000, 0x1F901000, spu_regs);
+
+        IOPMMIOMap::Device post;
+        post.on_read<uint8_t>([this](uint32_t address) -> uint8_t
+        {
+            if (address == 0x1FA00000)
+                return IOP_POST;
+            return iop_mmio.unmapped_read<uint8_t>(address);
+        });
+        post.on_write<uint8_t>([this](uint32_t address, uint8_t value)
+        {
+            if (address == 0x1FA00000)
+            {
+                //Register intended to be displayed on an external 7 segment display
+                //Used to indicate how far along the boot process is
+                IOP_POST = value;
+                fmt::print("[IOP] POST: {:#x}\n", value);
+                return;
+            }
+            iop_mmio.unmapped_write<uint8_t>(address, value);
+        });
+        iop_mmio.map(0x1FA00000, 0x1FA01000, post);
+
+        IOPMMIOMap::Device bios;
+        bios.on_read<uint8_t>([this](uint32_t address) { return BIOS[address & 0x3FFFFF]; });
+        bios.on_read<uint16_t>([this](uint32_t address) { return *(uint16_t*)&BIOS[address & 0x3FFFFF]; });
+        bios.on_read<uint32_t>([this](uint32_t address) { return *(uint32_t*)&BIOS[address & 0x3FFFFF]; });
+        iop_mmio.map(0x1FC00000, 0x20000000, bios);
+    }
+}
@@ -8,7 +8,7 @@ namespace core
 {
     using TimestampLimit = std::numeric_limits<int64_t>;
 
-    Scheduler::Scheduler()
+    Scheduler::Scheduler() : max_run_cycles(DEFAULT_RUN_CYCLES)
     {
 
     }
@@ -28,7 +28,7 @@ namespace core
 
         closest_event_time = TimestampLimit::max();
 
-        events.clear();
+        clear_events();
         timers.clear();
 
         timer_event_id = register_function([this](uint64_t param) { timer_event(param); });
@@ -36,11 +36,10 @@ namespace core
 
     unsigned int Scheduler::calculate_run_cycles()
     {
-        if (!events.size())
+        if (event_heap.empty())
             Errors::die("[Scheduler] No events registered");
-        const static int MAX_CYCLES = 32;
-        if (ee_cycles.count + MAX_CYCLES <= closest_event_time)
-            run_cycles = MAX_CYCLES;
+        if (ee_cycles.count + max_run_cycles <= closest_event_time)
+            run_cycles = max_run_cycles;
         else
         {
             int64_t delta = closest_event_time - ee_cycles.count;
@@ -53,6 +52,11 @@ namespace core
         return run_cycles;
     }
 
+    void Scheduler::set_max_run_cycles(unsigned int cycles)
+    {
+        max_run_cycles = std::max(cycles, 1U);
+    }
+
     unsigned int Scheduler::get_bus_run_cycles()
     {
         unsigned int bus_run_cycles = run_cycles >> 1;
@@ -89,33 +93,137 @@ namespace core
     {
         if (func_id < 0 || func_id >= registered_funcs.size())
             Errors::die("[Scheduler] Out-of-bounds func_id given in add_event");
-        SchedulerEvent event;
+
+        uint32_t slot;
+        if (!free_event_slots.empty())
+        {
+            slot = free_event_slots.back();
+            free_event_slots.pop_back();
+        }
+        else
+        {
+            slot = event_slots.size();
+            if (slot > EVENT_SLOT_MASK)
+                Errors::die("[Scheduler] Too many pending events");
+            event_slots.emplace_back();
+            event_heap_pos.push_back(NO_HEAP_POS);
+        }
+
+        SchedulerEvent& event = event_slots[slot];
         event.func_id = func_id;
         event.time_to_run = ee_cycles.count + delta;
         event.param = param;
-        event.event_id = next_event_id;
+        event.event_id = (next_event_id << EVENT_SLOT_BITS) | slot;
+        event.pulse = false;
 
         next_event_id++;
 
         closest_event_time = std::min(event.time_to_run, closest_event_time);
 
-        events.push_back(event);
+        event_heap_pos[slot] = event_heap.size();
+        event_heap.push_back(slot);
+        sift_event_up(event_heap_pos[slot]);
 
         return event.event_id;
     }
 
     void Scheduler::delete_event(uint64_t event_id)
     {
-        for (auto it = events.begin(); it != events.end(); it++)
+        remove_event_at(event_heap_pos[get_event_slot(event_id)]);
+    }
+
+    //Returns the slot of a pending event
+    uint32_t Scheduler::get_event_slot(uint64_t event_id)
+    {
+        uint32_t slot = event_id & EVENT_SLOT_MASK;
+        if (slot >= event_slots.size() || event_heap_pos[slot] == NO_HEAP_POS || event_slots[slot].event_id != event_id)
+            Errors::die("[Scheduler] No event ID %lld found", event_id);
+        return slot;
+    }
+
+    void Scheduler::set_event_time(uint64_t event_id, int64_t time)
+    {
+        uint32_t slot = get_event_slot(event_id);
+        int64_t old_time = event_slots[slot].time_to_run;
+        event_slots[slot].time_to_run = time;
+        if (time < old_time)
+            sift_event_up(event_heap_pos[slot]);
+        else
+            sift_event_down(event_heap_pos[slot]);
+    }
+
+    bool Scheduler::event_before(uint32_t slot_a, uint32_t slot_b) const
+    {
+        const SchedulerEvent& a = event_slots[slot_a];
+        const SchedulerEvent& b = event_slots[slot_b];
+        if (a.time_to_run != b.time_to_run)
+            return a.time_to_run < b.time_to_run;
+        return a.event_id < b.event_id;
+    }
+
+    void Scheduler::sift_event_up(uint32_t pos)
+    {
+        uint32_t slot = event_heap[pos];
+        while (pos > 0)
         {
-            if (it->event_id == event_id)
-            {
-                events.erase(it);
-                return;
-            }
+            uint32_t parent = (pos - 1) / 2;
+            if (!event_before(slot, event_heap[parent]))
+                break;
+            event_heap[pos] = event_heap[parent];
+            event_heap_pos[event_heap[pos]] = pos;
+            pos = parent;
+        }
+        event_heap[pos] = slot;
+        event_heap_pos[slot] = pos;
+    }
+
+    void Scheduler::sift_event_down(uint32_t pos)
+    {
+        uint32_t slot = event_heap[pos];
+        uint32_t size = event_heap.size();
+        while (true)
+        {
+            uint32_t child = pos * 2 + 1;
+            if (child >= size)
+                break;
+            if (child + 1 < size && event_before(event_heap[child + 1], event_heap[child]))
+                child++;
+            if (!event_before(event_heap[child], slot))
+                break;
+            event_heap[pos] = event_heap[child];
+            event_heap_pos[event_heap[pos]] = pos;
+            pos = child;
+        }
+        event_heap[pos] = slot;
+        event_heap_pos[slot] = pos;
+    }
+
+    void Scheduler::remove_event_at(uint32_t pos)
+    {
+        uint32_t slot = event_heap[pos];
+        uint32_t last = event_heap.back();
+        event_heap.pop_back();
+
+        if (pos < event_heap.size())
+        {
+            event_heap[pos] = last;
+            event_heap_pos[last] = pos;
+            if (pos > 0 && event_before(last, event_heap[(pos - 1) / 2]))
+                sift_event_up(pos);
+            else
+                sift_event_down(pos);
         }
 
-        Errors::die("[Scheduler] No event ID %lld found in delete_event", event_id);
+        event_heap_pos[slot] = NO_HEAP_POS;
+        free_event_slots.push_back(slot);
+    }
+
+    void Scheduler::clear_events()
+    {
+        event_slots.clear();
+        event_heap_pos.clear();
+        free_event_slots.clear();
+        event_heap.clear();
     }
 
     uint64_t Scheduler::convert_to_ee_cycles(uint64_t cycles, uint64_t clockrate)
@@ -150,8 +258,7 @@ namespace core
     void Scheduler::update_timer_event_time(uint64_t timer_id)
     {
         int64_t time = ee_cycles.count + calculate_timer_event_delta(timer_id);
-        SchedulerEvent* event = get_event_ptr(timers[timer_id].event_id);
-        event->time_to_run = time;
+        set_event_time(timers[timer_id].event_id, time);
         closest_event_time = std::min(time, closest_event_time);
     }
 
@@ -204,17 +311,6 @@ namespace core
         restart_timer(index);
     }
 
-    SchedulerEvent* Scheduler::get_event_ptr(uint64_t event_id)
-    {
-        for (auto it = events.begin(); it != events.end(); it++)
-        {
-            if (it->event_id == event_id)
-                return &(*it);
-        }
-
-        Errors::die("[Scheduler] No event ID %lld found in get_event_ptr", event_id);
-    }
-
     uint64_t Scheduler::create_timer(int callback_id, uint64_t overflow_mask, uint64_t param)
     {
         if (callback_id < 0 || callback_id >= timer_callbacks.size())
@@ -260,8 +356,7 @@ namespace core
         if (paused)
         {
             update_timer_counter(timer_id);
-            SchedulerEvent* event = get_event_ptr(timers[timer_id].event_id);
-            event->time_to_run = TimestampLimit::max();
+            set_event_time(timers[timer_id].event_id, TimestampLimit::max());
         }
         else
         {
@@ -331,22 +426,28 @@ namespace core
     {
         if (ee_cycles.count >= closest_event_time)
         {
-            int64_t new_time = 0x7FFFFFFFULL << 32ULL;
-            for (auto it = events.begin(); it != events.end(); )
+            //Callbacks can add events, which may be due right away
+            while (!event_heap.empty())
             {
-                if (it->time_to_run <= closest_event_time)
-                {
-                    std::function<void(uint64_t)> func = registered_funcs[it->func_id];
-                    func(it->param);
-                    it = events.erase(it);
-                }
-                else
-                {
-                    new_time = std::min(it->time_to_run, new_time);
-                    it++;
-                }
+                uint32_t slot = event_heap[0];
+                if (event_slots[slot].time_to_run > closest_event_time)
+                    break;
+
+                int func_id = event_slots[slot].func_id;
+                uint64_t param = event_slots[slot].param;
+                uint64_t event_id = event_slots[slot].event_id;
+
+                //The event stays pending while its callback runs, as timer callbacks look it up.
+                //The callback may also have deleted it already.
+                registered_funcs[func_id](param);
+                if (event_heap_pos[slot] != NO_HEAP_POS && event_slots[slot].event_id == event_id)
+                    remove_event_at(event_heap_pos[slot]);
             }
-            closest_event_time = new_time;
+
+            if (event_heap.empty())
+                closest_event_time = 0x7FFFFFFFULL << 32ULL;
+            else
+                closest_event_time = event_slots[event_heap[0]].time_to_run;
         }
     }
 }
\ No newline at end of file
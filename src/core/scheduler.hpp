@@ -1,7 +1,6 @@
 #pragma once
 #include <cstdint>
 #include <functional>
-#include <list>
 #include <vector>
 
 namespace core
@@ -34,11 +33,16 @@ namespace core
     class Scheduler
     {
     private:
+        constexpr static int EVENT_SLOT_BITS = 16;
+        constexpr static uint64_t EVENT_SLOT_MASK = (1 << EVENT_SLOT_BITS) - 1;
+        constexpr static uint32_t NO_HEAP_POS = 0xFFFFFFFF;
+
         CycleCount ee_cycles;
         CycleCount bus_cycles;
         CycleCount iop_cycles;
 
         unsigned int run_cycles;
+        unsigned int max_run_cycles;
         uint64_t next_event_id;
 
         uint64_t timer_event_id;
@@ -46,7 +50,14 @@ namespace core
         std::vector<std::function<void(uint64_t)> > registered_funcs;
         std::vector<std::function<void(uint64_t, bool)> > timer_callbacks;
         std::vector<SchedulerTimer> timers;
-        std::list<SchedulerEvent> events;
+
+        //Events live in slots that don't move while they're pending. An event ID is its slot plus the
+        //sequence number it was added with, which keeps events due at the same time in the order they were added.
+        //event_heap is a binary min-heap of slots ordered by time_to_run, then ID.
+        std::vector<SchedulerEvent> event_slots;
+        std::vector<uint32_t> event_heap_pos;
+        std::vector<uint32_t> free_event_slots;
+        std::vector<uint32_t> event_heap;
 
         int64_t closest_event_time;
 
@@ -58,17 +69,27 @@ namespace core
 
         void timer_event(uint64_t index);
 
-        SchedulerEvent* get_event_ptr(uint64_t event_id);
+        uint32_t get_event_slot(uint64_t event_id);
+        void set_event_time(uint64_t event_id, int64_t time);
+        bool event_before(uint32_t slot_a, uint32_t slot_b) const;
+        void sift_event_up(uint32_t pos);
+        void sift_event_down(uint32_t pos);
+        void remove_event_at(uint32_t pos);
+        void clear_events();
     public:
         constexpr static uint64_t EE_CLOCKRATE = 294912000; //294.912 MHz
         constexpr static uint64_t BUS_CLOCKRATE = EE_CLOCKRATE / 2;
         constexpr static uint64_t IOP_CLOCKRATE = EE_CLOCKRATE / 8;
 
+        //Longest timeslice, in EE cycles, unless set_max_run_cycles says otherwise
+        constexpr static unsigned int DEFAULT_RUN_CYCLES = 32;
+
         Scheduler();
 
         void reset();
 
         unsigned int calculate_run_cycles();
+        void set_max_run_cycles(unsigned int cycles);
         unsigned int get_bus_run_cycles();
         unsigned int get_iop_run_cycles();
 
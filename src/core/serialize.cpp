@@ -19,13 +19,14 @@
 #include <gs/gs.hpp>
 #include <gs/gif.hpp>
 #include <sif.hpp>
+#include <algorithm>
 #include <fstream>
 #include <cstring>
 
 /* DobieStation version */
 constexpr uint32_t VER_MAJOR = 0;
 constexpr uint32_t VER_MINOR = 0;
-constexpr uint32_t VER_REV = 50;
+constexpr uint32_t VER_REV = 51;
 
 namespace core
 {
@@ -89,6 +90,7 @@ namespace core
         //Emulator info
         state.read((char*)&VBLANK_sent, sizeof(VBLANK_sent));
         state.read((char*)&frames, sizeof(frames));
+        state.read((char*)&hblank_event_pending, sizeof(hblank_event_pending));
 
         //RAM
         state.read((char*)cpu->rdram, 1024 * 1024 * 32);
@@ -96,7 +98,9 @@ namespace core
         state.read((char*)SPU_RAM, 1024 * 1024 * 2);
         state.read((char*)cpu->scratchpad, 1024 * 16);
         state.read((char*)iop->scratchpad, 1024);
-        state.read((char*)&iop->scratchpad_start, sizeof(iop->scratchpad_start));
+        uint32_t iop_scratchpad_start;
+        state.read((char*)&iop_scratchpad_start, sizeof(iop_scratchpad_start));
+        iop->set_scratchpad_start(iop_scratchpad_start);
 
         //CPUs
         cpu->load_state(state);
@@ -132,6 +136,7 @@ namespace core
         gs->load_state(state);
 
         scheduler->load_state(state);
+        gs->sync_HBLANK();
         pad->load_state(state);
         spu->load_state(state);
         spu2->load_state(state);
@@ -164,6 +169,7 @@ namespace core
         //Emulator info
         state.write((char*)&VBLANK_sent, sizeof(VBLANK_sent));
         state.write((char*)&frames, sizeof(frames));
+        state.write((char*)&hblank_event_pending, sizeof(hblank_event_pending));
 
         //RAM
         state.write((char*)cpu->rdram, 1024 * 1024 * 32);
@@ -279,18 +285,19 @@ namespace core
         state.read((char*)&run_cycles, sizeof(run_cycles));
         state.read((char*)&closest_event_time, sizeof(closest_event_time));
 
-        events.clear();
+        clear_events();
 
+        //Events are stored in the order they were added. Their IDs are handed out again from slot 0,
+        //so the IDs the timers hold have to be translated.
         int event_size = 0;
         state.read((char*)&event_size, sizeof(event_size));
 
+        std::vector<SchedulerEvent> loaded_events(event_size);
         for (int i = 0; i < event_size; i++)
-        {
-            SchedulerEvent event;
-            state.read((char*)&event, sizeof(event));
+            state.read((char*)&loaded_events[i], sizeof(SchedulerEvent));
 
-            events.push_back(event);
-        }
+        std::sort(loaded_events.begin(), loaded_events.end(),
+                  [](const SchedulerEvent& a, const SchedulerEvent& b) { return a.event_id < b.event_id; });
 
         state.read((char*)&next_event_id, sizeof(next_event_id));
 
@@ -306,6 +313,28 @@ namespace core
 
             timers.push_back(timer);
         }
+
+        //Re-adding the events in order gives them the same relative order as before
+        //A new ID can equal an old one that hasn't been translated yet, so every timer is translated only once.
+        int64_t saved_closest_event_time = closest_event_time;
+        std::vector<bool> timer_remapped(timers.size(), false);
+        next_event_id = 0;
+        for (SchedulerEvent& event : loaded_events)
+        {
+            uint64_t old_id = event.event_id;
+            uint64_t new_id = add_event(event.func_id, 0, event.param);
+            set_event_time(new_id, event.time_to_run);
+
+            for (size_t i = 0; i < timers.size(); i++)
+            {
+                if (!timer_remapped[i] && timers[i].event_id == old_id)
+                {
+                    timers[i].event_id = new_id;
+                    timer_remapped[i] = true;
+                }
+            }
+        }
+        closest_event_time = saved_closest_event_time;
     }
 
     void Scheduler::save_state(std::ofstream& state)
@@ -316,14 +345,18 @@ namespace core
         state.write((char*)&run_cycles, sizeof(run_cycles));
         state.write((char*)&closest_event_time, sizeof(closest_event_time));
 
-        int event_size = events.size();
+        //Events are written in the order they were added
+        std::vector<SchedulerEvent> pending_events;
+        for (uint32_t slot : event_heap)
+            pending_events.push_back(event_slots[slot]);
+        std::sort(pending_events.begin(), pending_events.end(),
+                  [](const SchedulerEvent& a, const SchedulerEvent& b) { return a.event_id < b.event_id; });
+
+        int event_size = pending_events.size();
         state.write((char*)&event_size, sizeof(event_size));
 
-        for (auto it = events.begin(); it != events.end(); it++)
-        {
-            SchedulerEvent event = *it;
+        for (const SchedulerEvent& event : pending_events)
             state.write((char*)&event, sizeof(event));
-        }
 
         state.write((char*)&next_event_id, sizeof(next_event_id));
 
@@ -535,6 +568,10 @@ namespace iop
         state.read((char*)&cop0.status, sizeof(cop0.status));
         state.read((char*)&cop0.cause, sizeof(cop0.cause));
         state.read((char*)&cop0.EPC, sizeof(cop0.EPC));
+
+        reset_busy_wait();
+        block_cache.flush();
+        flush_jit_cache = true;
     }
 
     void IOP::save_state(std::ofstream& state)
@@ -0,0 +1,181 @@
+/**
+Single-producer single-consumer ring of variable-length commands.
+
+Each record is a 4-byte header (8-bit type, 24-bit payload size) followed by
+its payload, padded to 4 bytes. Records never straddle the end of the buffer;
+the producer writes a WRAP marker and restarts at the beginning instead.
+
+Reserved records are invisible to the consumer until publish() is called, so
+the producer can write any number of commands and hand them over with a single
+release store. The most recently reserved record can also be grown in place
+with extend() until it is published, which allows packing repeated writes.
+**/
+#pragma once
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+template<size_t Size>
+class CommandRing
+{
+    static_assert((Size & (Size - 1)) == 0, "CommandRing size must be a power of two");
+public:
+    enum { WRAP = 0xFF, MAX_PAYLOAD = 0xFFFFFF };
+
+    struct Record
+    {
+        uint8_t type;
+        uint32_t size;
+        const uint8_t* data;
+    };
+
+    CommandRing() : write_pos(0), cached_head(0), last_record(NO_RECORD), tail(0),
+        read_pos(0), cached_tail(0), head(0) {}
+
+    //Producer
+    uint8_t* reserve(uint8_t type, size_t size);
+    uint8_t* extend(size_t size);
+    void publish();
+    size_t pending() const;
+
+    //Consumer
+    bool peek(Record& record);
+    void pop(const Record& record);
+    bool was_empty() const;
+
+private:
+    constexpr static size_t NO_RECORD = ~(size_t)0;
+
+    static size_t align(size_t size) { return (size + 3) & ~(size_t)3; }
+    bool has_space(size_t size);
+    void write_header(size_t pos, uint8_t type, uint32_t size);
+
+    //Producer state. write_pos runs ahead of tail until the batch is published.
+    alignas(64) size_t write_pos;
+    size_t cached_head;
+    size_t last_record;
+    std::atomic<size_t> tail;
+
+    //Consumer state
+    alignas(64) size_t read_pos;
+    size_t cached_tail;
+    std::atomic<size_t> head;
+
+    alignas(64) uint8_t buffer[Size];
+};
+
+template<size_t Size>
+bool CommandRing<Size>::has_space(size_t size)
+{
+    if (write_pos + size - cached_head <= Size)
+        return true;
+    cached_head = head.load(std::memory_order_acquire);
+    return write_pos + size - cached_head <= Size;
+}
+
+template<size_t Size>
+void CommandRing<Size>::write_header(size_t pos, uint8_t type, uint32_t size)
+{
+    uint32_t header = type | (size << 8);
+    memcpy(&buffer[pos & (Size - 1)], &header, sizeof(header));
+}
+
+//Returns a pointer to size bytes of payload, or nullptr if the consumer hasn't freed enough room yet
+template<size_t Size>
+uint8_t* CommandRing<Size>::reserve(uint8_t type, size_t size)
+{
+    size_t record_size = 4 + align(size);
+    size_t offset = write_pos & (Size - 1);
+    size_t skip = (offset + record_size > Size) ? Size - offset : 0;
+
+    if (size > MAX_PAYLOAD || record_size > Size || !has_space(skip + record_size))
+        return nullptr;
+
+    if (skip)
+    {
+        write_header(write_pos, WRAP, 0);
+        write_pos += skip;
+    }
+
+    write_header(write_pos, type, size);
+    last_record = write_pos;
+    write_pos += record_size;
+    return &buffer[(last_record + 4) & (Size - 1)];
+}
+
+//Appends size bytes to the payload of the last reserved record if it hasn't been published.
+//The previous payload size must be a multiple of 4.
+template<size_t Size>
+uint8_t* CommandRing<Size>::extend(size_t size)
+{
+    if (last_record == NO_RECORD)
+        return nullptr;
+
+    uint32_t header;
+    memcpy(&header, &buffer[last_record & (Size - 1)], sizeof(header));
+    size_t old_size = header >> 8;
+    size_t new_size = old_size + size;
+    size_t end = (last_record & (Size - 1)) + 4 + align(new_size);
+
+    if (new_size > MAX_PAYLOAD || end > Size || !has_space(align(new_size) - old_size))
+        return nullptr;
+
+    write_header(last_record, header & 0xFF, new_size);
+    write_pos = last_record + 4 + align(new_size);
+    return &buffer[(last_record + 4 + old_size) & (Size - 1)];
+}
+
+template<size_t Size>
+void CommandRing<Size>::publish()
+{
+    last_record = NO_RECORD;
+    tail.store(write_pos, std::memory_order_release);
+}
+
+template<size_t Size>
+size_t CommandRing<Size>::pending() const
+{
+    return write_pos - tail.load(std::memory_order_relaxed);
+}
+
+template<size_t Size>
+bool CommandRing<Size>::peek(Record& record)
+{
+    while (true)
+    {
+        if (read_pos == cached_tail)
+        {
+            cached_tail = tail.load(std::memory_order_acquire);
+            if (read_pos == cached_tail)
+                return false;
+        }
+
+        uint32_t header;
+        memcpy(&header, &buffer[read_pos & (Size - 1)], sizeof(header));
+        if ((header & 0xFF) != WRAP)
+        {
+            record.type = header & 0xFF;
+            record.size = header >> 8;
+            record.data = &buffer[(read_pos + 4) & (Size - 1)];
+            return true;
+        }
+
+        read_pos += Size - (read_pos & (Size - 1));
+    }
+}
+
+//The payload of record must not be accessed after it is popped
+template<size_t Size>
+void CommandRing<Size>::pop(const Record& record)
+{
+    read_pos += 4 + align(record.size);
+    head.store(read_pos, std::memory_order_release);
+}
+
+// snapshot with acceptance that this comparison is not atomic
+template<size_t Size>
+bool CommandRing<Size>::was_empty() const
+{
+    return head.load() == tail.load();
+}
@@ -0,0 +1,88 @@
+#include "hostmem.hpp"
+#include "errors.hpp"
+
+#ifdef __linux__
+#include <sys/mman.h>
+#endif
+
+static HugePageMode huge_page_mode = HugePageMode::Transparent;
+
+void HostMemory::set_huge_page_mode(HugePageMode mode)
+{
+    huge_page_mode = mode;
+}
+
+HugePageMode HostMemory::get_huge_page_mode()
+{
+    return huge_page_mode;
+}
+
+#ifdef __linux__
+
+//Every mapping is rounded up to whole huge pages, so free_guest can unmap it the same way
+//however it ended up being backed
+static std::size_t mapping_size(std::size_t size)
+{
+    return (size + HostMemory::HUGE_PAGE_SIZE - 1) & ~(HostMemory::HUGE_PAGE_SIZE - 1);
+}
+
+uint8_t* HostMemory::alloc_guest(std::size_t size)
+{
+    std::size_t map_size = mapping_size(size);
+
+    if (huge_page_mode == HugePageMode::Explicit)
+    {
+        void* mem = mmap(nullptr, map_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        if (mem != MAP_FAILED)
+            return (uint8_t*)mem;
+    }
+
+    //Transparent huge pages only back ranges aligned to a huge page, so map extra and trim it off
+    std::size_t padded_size = map_size + HUGE_PAGE_SIZE;
+    void* mem = mmap(nullptr, padded_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+    if (mem == MAP_FAILED)
+        Errors::die("[HostMemory] Unable to allocate %zu bytes", size);
+
+    uintptr_t start = (uintptr_t)mem;
+    uintptr_t aligned = (start + HUGE_PAGE_SIZE - 1) & ~(uintptr_t)(HUGE_PAGE_SIZE - 1);
+    if (aligned != start)
+        munmap(mem, aligned - start);
+    std::size_t tail = padded_size - (aligned - start) - map_size;
+    if (tail)
+        munmap((void*)(aligned + map_size), tail);
+
+    if (huge_page_mode != HugePageMode::Off)
+        advise_huge_pages((void*)aligned, map_size);
+    return (uint8_t*)aligned;
+}
+
+void HostMemory::free_guest(uint8_t* mem, std::size_t size)
+{
+    if (mem)
+        munmap(mem, mapping_size(size));
+}
+
+void HostMemory::advise_huge_pages(void* mem, std::size_t size)
+{
+    if (huge_page_mode != HugePageMode::Off)
+        madvise(mem, size, MADV_HUGEPAGE);
+}
+
+#else
+
+uint8_t* HostMemory::alloc_guest(std::size_t size)
+{
+    return new uint8_t[size]();
+}
+
+void HostMemory::free_guest(uint8_t* mem, std::size_t size)
+{
+    delete[] mem;
+}
+
+void HostMemory::advise_huge_pages(void* mem, std::size_t size)
+{
+
+}
+
+#endif
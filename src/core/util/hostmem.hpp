@@ -0,0 +1,29 @@
+#pragma once
+#include <cstddef>
+#include <cstdint>
+
+//How guest memory is backed on the host. Huge pages cut down on host TLB misses when the guest
+//touches memory all over RDRAM. Only Linux supports them here; everywhere else they act like Off.
+enum class HugePageMode : uint8_t
+{
+    Off,         //Normal pages
+    Transparent, //madvise(MADV_HUGEPAGE), so the kernel uses huge pages when it can
+    Explicit     //MAP_HUGETLB from the reserved pool, Transparent if none are left
+};
+
+class HostMemory
+{
+    public:
+        constexpr static std::size_t HUGE_PAGE_SIZE = 2 * 1024 * 1024;
+
+        //Applies to allocations made afterwards
+        static void set_huge_page_mode(HugePageMode mode);
+        static HugePageMode get_huge_page_mode();
+
+        //Zero-filled memory for RDRAM, IOP RAM and GS local memory. Free it with the size it was allocated with.
+        static uint8_t* alloc_guest(std::size_t size);
+        static void free_guest(uint8_t* mem, std::size_t size);
+
+        //For memory allocated some other way, such as the JIT heaps
+        static void advise_huge_pages(void* mem, std::size_t size);
+};
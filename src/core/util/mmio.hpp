@@ -0,0 +1,157 @@
+#pragma once
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <tuple>
+#include <vector>
+
+#include "errors.hpp"
+
+namespace core
+{
+    //Page table for memory-mapped registers. Physical addresses [0, size) are split into 4 KB pages, and each page
+    //points at the device that answers for it, so finding a register's handler is one lookup and one call.
+    //Unmapped pages, widths a device doesn't handle and addresses past the end of the table go to the fallback.
+    template <typename... Widths>
+    class MMIOMap
+    {
+        public:
+            template <typename T> using ReadHandler = std::function<T(uint32_t)>;
+            template <typename T> using WriteHandler = std::function<void(uint32_t, T)>;
+
+            class Device
+            {
+                private:
+                    std::tuple<ReadHandler<Widths>...> reads;
+                    std::tuple<WriteHandler<Widths>...> writes;
+
+                    friend class MMIOMap;
+                public:
+                    template <typename T> Device& on_read(ReadHandler<T> handler);
+                    template <typename T> Device& on_write(WriteHandler<T> handler);
+            };
+
+            constexpr static int PAGE_SHIFT = 12;
+            constexpr static uint32_t PAGE_SIZE = 1 << PAGE_SHIFT;
+
+            MMIOMap(uint32_t size);
+
+            //The fallback must handle every width, and must be set before any device is mapped
+            void set_fallback(const Device& fallback);
+            void map(uint32_t start, uint32_t end, const Device& device);
+
+            template <typename T> T read(uint32_t address) const;
+            template <typename T> void write(uint32_t address, T value) const;
+
+            //True if a device owns the page the address is in
+            bool is_mapped(uint32_t address) const;
+
+            //For devices that only answer to some of the registers in their pages
+            template <typename T> T unmapped_read(uint32_t address) const;
+            template <typename T> void unmapped_write(uint32_t address, T value) const;
+        private:
+            uint32_t pages;
+            std::unique_ptr<uint8_t[]> page_devices;
+            std::vector<Device> devices; //devices[0] is the fallback
+    };
+
+    template <typename... Widths>
+    template <typename T>
+    inline typename MMIOMap<Widths...>::Device& MMIOMap<Widths...>::Device::on_read(ReadHandler<T> handler)
+    {
+        std::get<ReadHandler<T>>(reads) = std::move(handler);
+        return *this;
+    }
+
+    template <typename... Widths>
+    template <typename T>
+    inline typename MMIOMap<Widths...>::Device& MMIOMap<Widths...>::Device::on_write(WriteHandler<T> handler)
+    {
+        std::get<WriteHandler<T>>(writes) = std::move(handler);
+        return *this;
+    }
+
+    template <typename... Widths>
+    inline MMIOMap<Widths...>::MMIOMap(uint32_t size) : pages(size >> PAGE_SHIFT)
+    {
+        page_devices = std::make_unique<uint8_t[]>(pages);
+    }
+
+    template <typename... Widths>
+    inline void MMIOMap<Widths...>::set_fallback(const Device& fallback)
+    {
+        if (devices.size() > 1)
+            Errors::die("[MMIO] Fallback set after devices were mapped");
+
+        bool complete = (std::get<ReadHandler<Widths>>(fallback.reads) && ...) &&
+                        (std::get<WriteHandler<Widths>>(fallback.writes) && ...);
+        if (!complete)
+            Errors::die("[MMIO] Fallback doesn't handle every width");
+
+        devices.clear();
+        devices.push_back(fallback);
+    }
+
+    template <typename... Widths>
+    inline void MMIOMap<Widths...>::map(uint32_t start, uint32_t end, const Device& device)
+    {
+        if (devices.empty())
+            Errors::die("[MMIO] Device mapped at $%08X before the fallback was set", start);
+        if ((start | end) & (PAGE_SIZE - 1) || start >= end || (end >> PAGE_SHIFT) > pages)
+            Errors::die("[MMIO] Can't map device at $%08X-$%08X", start, end);
+        if (devices.size() > 0xFF)
+            Errors::die("[MMIO] Too many devices mapped");
+
+        //Fill in the widths the device doesn't handle so the lookup never has to check
+        Device mapped = device;
+        const Device& fallback = devices[0];
+        ((std::get<ReadHandler<Widths>>(mapped.reads) = std::get<ReadHandler<Widths>>(mapped.reads) ?
+          std::get<ReadHandler<Widths>>(mapped.reads) : std::get<ReadHandler<Widths>>(fallback.reads)), ...);
+        ((std::get<WriteHandler<Widths>>(mapped.writes) = std::get<WriteHandler<Widths>>(mapped.writes) ?
+          std::get<WriteHandler<Widths>>(mapped.writes) : std::get<WriteHandler<Widths>>(fallback.writes)), ...);
+
+        uint8_t index = (uint8_t)devices.size();
+        devices.push_back(std::move(mapped));
+        for (uint32_t page = start >> PAGE_SHIFT; page < (end >> PAGE_SHIFT); page++)
+            page_devices[page] = index;
+    }
+
+    template <typename... Widths>
+    template <typename T>
+    inline T MMIOMap<Widths...>::read(uint32_t address) const
+    {
+        uint32_t page = address >> PAGE_SHIFT;
+        const Device& device = devices[page < pages ? page_devices[page] : 0];
+        return std::get<ReadHandler<T>>(device.reads)(address);
+    }
+
+    template <typename... Widths>
+    template <typename T>
+    inline void MMIOMap<Widths...>::write(uint32_t address, T value) const
+    {
+        uint32_t page = address >> PAGE_SHIFT;
+        const Device& device = devices[page < pages ? page_devices[page] : 0];
+        std::get<WriteHandler<T>>(device.writes)(address, value);
+    }
+
+    template <typename... Widths>
+    inline bool MMIOMap<Widths...>::is_mapped(uint32_t address) const
+    {
+        uint32_t page = address >> PAGE_SHIFT;
+        return page < pages && page_devices[page];
+    }
+
+    template <typename... Widths>
+    template <typename T>
+    inline T MMIOMap<Widths...>::unmapped_read(uint32_t address) const
+    {
+        return std::get<ReadHandler<T>>(devices[0].reads)(address);
+    }
+
+    template <typename... Widths>
+    template <typename T>
+    inline void MMIOMap<Widths...>::unmapped_write(uint32_t address, T value) const
+    {
+        std::get<WriteHandler<T>>(devices[0].writes)(address, value);
+    }
+}
@@ -0,0 +1,298 @@
+#include <chrono>
+#include <cinttypes>
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include "gs/gsthread.hpp"
+#include "util/errors.hpp"
+
+/**
+Replays a gsdump.gsd written by the GS thread without a window, as fast as the GS thread can take it.
+
+A dump is the GS thread's save state, the privileged registers, then every GSMessage the thread
+processed while recording. Each render_crt_t ends a frame. For every frame the wall time, the
+GS statistics and optionally a hash of the output buffer are printed as one line of JSON,
+followed by the totals for the whole dump.
+**/
+
+using namespace std;
+
+constexpr int DUMP_BUFFERED_MESSAGES = 4096;
+constexpr int OUTPUT_BUFFER_SIZE = 1920 * 1280;
+
+struct BenchOptions
+{
+    const char* dump_name = nullptr;
+    bool hash_frames = false;
+    bool quiet = false;
+    bool pixel_stats = false;
+};
+
+class GSBench
+{
+    private:
+        gs::GraphicsSynthesizerThread gs_thread;
+        //Privileged registers as the GS thread sees them, to know how much of the output holds the frame
+        gs::GS_REGISTERS reg;
+
+        ifstream dump;
+        unique_ptr<gs::GSMessage[]> dump_buffer;
+        int buffered_messages, current_message;
+
+        //Output buffers alternate like GraphicsSynthesizer's, so the CRT skips work the way it does in game
+        unique_ptr<uint32_t[]> output_buffers[2];
+        mutex output_mutexes[2];
+        int current_output;
+        unique_ptr<uint128_t[]> download_buffer;
+        mutex download_mutex;
+
+        bool next_message(gs::GSMessage& message);
+        uint64_t hash_frame(const uint32_t* frame);
+    public:
+        GSBench();
+        ~GSBench();
+
+        bool open(const char* name);
+        void set_pixel_stats(bool enabled);
+        int run(const BenchOptions& options);
+};
+
+GSBench::GSBench() : buffered_messages(0), current_message(0), current_output(0)
+{
+    dump_buffer = make_unique<gs::GSMessage[]>(DUMP_BUFFERED_MESSAGES);
+    output_buffers[0] = make_unique<uint32_t[]>(OUTPUT_BUFFER_SIZE);
+    output_buffers[1] = make_unique<uint32_t[]>(OUTPUT_BUFFER_SIZE);
+    download_buffer = make_unique<uint128_t[]>((2048 * 2048) / 4);
+}
+
+GSBench::~GSBench()
+{
+    gs_thread.exit();
+}
+
+bool GSBench::open(const char* name)
+{
+    dump.open(name, ios::binary);
+    if (!dump.is_open())
+        return false;
+
+    gs_thread.reset();
+
+    gs::GSMessagePayload payload;
+    payload.load_state_payload = { &dump };
+    gs_thread.send_message({ gs::load_state_t, payload });
+    gs_thread.wake_thread();
+    gs::GSReturnMessage data;
+    gs_thread.wait_for_return(gs::load_state_done_t, data);
+
+    dump.read((char*)&reg, sizeof(reg));
+    return dump.good();
+}
+
+//Pixel and texel counts slow down the JIT pipelines, so wall times are only representative without them
+void GSBench::set_pixel_stats(bool enabled)
+{
+    gs::GSMessagePayload payload;
+    payload.pixel_stats_payload = { enabled };
+    gs_thread.send_message({ gs::set_pixel_stats_t, payload });
+}
+
+bool GSBench::next_message(gs::GSMessage& message)
+{
+    if (!buffered_messages)
+    {
+        dump.read((char*)dump_buffer.get(), sizeof(gs::GSMessage) * DUMP_BUFFERED_MESSAGES);
+        buffered_messages = (int)(dump.gcount() / sizeof(gs::GSMessage));
+        current_message = 0;
+        if (!buffered_messages)
+            return false;
+    }
+    message = dump_buffer[current_message];
+    current_message++;
+    buffered_messages--;
+    return true;
+}
+
+//FNV-1a over the part of the output buffer render_CRT drew the frame in
+uint64_t GSBench::hash_frame(const uint32_t* frame)
+{
+    int width, height;
+    reg.get_inner_resolution(width, height);
+    size_t size = min((size_t)max(width, 0) * (size_t)max(height, 0), (size_t)OUTPUT_BUFFER_SIZE);
+
+    uint64_t hash = 0xCBF29CE484222325ULL;
+    const uint8_t* bytes = (const uint8_t*)frame;
+    for (size_t i = 0; i < size * sizeof(uint32_t); i++)
+    {
+        hash ^= bytes[i];
+        hash *= 0x100000001B3ULL;
+    }
+    return hash;
+}
+
+int GSBench::run(const BenchOptions& options)
+{
+    using clock = chrono::steady_clock;
+
+    int frames = 0;
+    double total_wall_ms = 0.0;
+    uint64_t total_raster_ns = 0, total_transfer_ns = 0, total_crt_ns = 0;
+    bool finished = false;
+
+    clock::time_point frame_start = clock::now();
+    gs::GSMessage message;
+    while (!finished && next_message(message))
+    {
+        gs::GSMessagePayload& payload = message.payload;
+        switch (message.type)
+        {
+            case gs::render_crt_t:
+            {
+                int output = current_output;
+                current_output ^= 1;
+                payload.render_payload = { output_buffers[output].get(), &output_mutexes[output] };
+                gs_thread.send_message(message);
+                gs_thread.wake_thread();
+
+                gs::GSReturnMessage data;
+                gs_thread.wait_for_return(gs::render_complete_t, data);
+                double wall_ms = chrono::duration<double, milli>(clock::now() - frame_start).count();
+
+                const gs::GSFrameStats& stats = data.payload.render_payload.stats;
+                total_wall_ms += wall_ms;
+                total_raster_ns += stats.raster_ns;
+                total_transfer_ns += stats.transfer_ns;
+                total_crt_ns += stats.crt_ns;
+
+                if (!options.quiet)
+                {
+                    printf("{\"frame\": %d, \"wall_ms\": %.3f", frames, wall_ms);
+                    if (options.hash_frames)
+                    {
+                        lock_guard<mutex> lock(output_mutexes[output]);
+                        printf(", \"hash\": \"%016" PRIx64 "\"", hash_frame(output_buffers[output].get()));
+                    }
+                    printf(", \"stats\": %s}\n", stats.to_json().c_str());
+                }
+                frames++;
+
+                //Hashing and printing don't count towards the next frame
+                frame_start = clock::now();
+                break;
+            }
+            case gs::memdump_t:
+            {
+                int output = current_output;
+                payload.render_payload = { output_buffers[output].get(), &output_mutexes[output] };
+                gs_thread.send_message(message);
+                gs_thread.wake_thread();
+                gs::GSReturnMessage data;
+                gs_thread.wait_for_return(gs::gsdump_render_partial_done_t, data);
+                break;
+            }
+            case gs::request_local_host_tx:
+            {
+                payload.download_payload = { download_buffer.get(), &download_mutex };
+                gs_thread.send_message(message);
+                gs_thread.wake_thread();
+                gs::GSReturnMessage data;
+                gs_thread.wait_for_return(gs::local_host_transfer, data);
+                break;
+            }
+            case gs::write64_privileged_t:
+                reg.write64_privileged(payload.write64_payload.addr, payload.write64_payload.value);
+                gs_thread.send_message(message);
+                break;
+            case gs::write32_privileged_t:
+                reg.write32_privileged(payload.write32_payload.addr, payload.write32_payload.value);
+                gs_thread.send_message(message);
+                break;
+            case gs::set_crt_t:
+                reg.set_CRT(payload.crt_payload.interlaced, payload.crt_payload.mode, payload.crt_payload.frame_mode);
+                gs_thread.send_message(message);
+                break;
+            case gs::swap_field_t:
+                reg.swap_FIELD();
+                gs_thread.send_message(message);
+                break;
+            //The end of the recording
+            case gs::gsdump_t:
+                finished = true;
+                break;
+            //Every frame is drawn, and warm-up lists belong to games, not to benchmark runs
+            case gs::set_frameskip_t:
+            case gs::jit_warmup_t:
+                break;
+            case gs::save_state_t:
+            case gs::load_state_t:
+            case gs::die_t:
+                Errors::die("Unexpected command $%02X in gsdump", message.type);
+            default:
+                gs_thread.send_message(message);
+                break;
+        }
+    }
+
+    if (!finished)
+        Errors::print_warning("gsdump ended without an end of recording marker\n");
+
+    printf("{\"frames\": %d, \"wall_ms\": %.3f, \"fps\": %.2f, \"raster_ms\": %.3f, "
+           "\"transfer_ms\": %.3f, \"crt_ms\": %.3f}\n",
+           frames, total_wall_ms, total_wall_ms > 0.0 ? frames * 1000.0 / total_wall_ms : 0.0,
+           total_raster_ns / 1000000.0, total_transfer_ns / 1000000.0, total_crt_ns / 1000000.0);
+    return frames ? 0 : 1;
+}
+
+static void print_usage()
+{
+    printf("Usage: DobieGSBench [--hash] [--quiet] [--pixel-stats] <gsdump.gsd>\n");
+    printf("  --hash         Print a hash of every frame's output\n");
+    printf("  --quiet        Only print the totals\n");
+    printf("  --pixel-stats  Count pixels and texels, at the cost of slower drawing\n");
+}
+
+int main(int argc, char** argv)
+{
+    BenchOptions options;
+    for (int i = 1; i < argc; i++)
+    {
+        if (!strcmp(argv[i], "--hash"))
+            options.hash_frames = true;
+        else if (!strcmp(argv[i], "--quiet"))
+            options.quiet = true;
+        else if (!strcmp(argv[i], "--pixel-stats"))
+            options.pixel_stats = true;
+        else if (argv[i][0] != '-' && !options.dump_name)
+            options.dump_name = argv[i];
+        else
+        {
+            print_usage();
+            return 1;
+        }
+    }
+
+    if (!options.dump_name)
+    {
+        print_usage();
+        return 1;
+    }
+
+    try
+    {
+        auto bench = make_unique<GSBench>();
+        if (!bench->open(options.dump_name))
+        {
+            fprintf(stderr, "Failed to load gsdump %s\n", options.dump_name);
+            return 1;
+        }
+        bench->set_pixel_stats(options.pixel_stats);
+        return bench->run(options);
+    }
+    catch (Emulation_error& e)
+    {
+        fprintf(stderr, "Fatal emulation error occurred replaying gsdump\n%s\n", e.what());
+        return 1;
+    }
+}
@@ -61,6 +61,21 @@ void EmuThread::set_vu1_mode(core::CPU_MODE mode)
     wait_for_lock([=]() { e.set_vu1_mode(mode); } );
 }
 
+void EmuThread::set_iop_mode(core::CPU_MODE mode)
+{
+    wait_for_lock([=]() { e.set_iop_mode(mode); } );
+}
+
+void EmuThread::set_frameskip(gs::FrameskipMode mode, int interval)
+{
+    wait_for_lock([=]() { e.set_frameskip(mode, interval); });
+}
+
+void EmuThread::set_timeslice_mode(core::TimesliceMode mode, uint32_t max_skew)
+{
+    wait_for_lock([=]() { e.set_timeslice_mode(mode, max_skew); });
+}
+
 void EmuThread::load_BIOS(const uint8_t *BIOS)
 {
     wait_for_lock([=]() { e.load_BIOS(BIOS); } );
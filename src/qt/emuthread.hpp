@@ -49,6 +49,9 @@ class EmuThread : public QThread
         void set_ee_mode(core::CPU_MODE mode);
         void set_vu0_mode(core::CPU_MODE mode);
         void set_vu1_mode(core::CPU_MODE mode);
+        void set_iop_mode(core::CPU_MODE mode);
+        void set_frameskip(gs::FrameskipMode mode, int interval);
+        void set_timeslice_mode(core::TimesliceMode mode, uint32_t max_skew);
         void load_BIOS(const uint8_t* BIOS);
         void load_ELF(QString name, const uint8_t* ELF, uint64_t ELF_size);
         void load_CDVD(const char* name, cdvd::CDVD_CONTAINER type);
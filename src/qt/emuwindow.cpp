@@ -67,6 +67,7 @@ EmuWindow::EmuWindow(QWidget *parent) : QMainWindow(parent)
     ee_mode = new QLabel;
     vu0_mode = new QLabel;
     vu1_mode = new QLabel;
+    iop_mode = new QLabel;
 
     frametime = new QLabel;
     avg_framerate = new QLabel;
@@ -80,6 +81,7 @@ EmuWindow::EmuWindow(QWidget *parent) : QMainWindow(parent)
     statusBar()->addPermanentWidget(ee_mode);
     statusBar()->addPermanentWidget(vu0_mode);
     statusBar()->addPermanentWidget(vu1_mode);
+    statusBar()->addPermanentWidget(iop_mode);
 
     create_menu();
 
@@ -905,4 +907,29 @@ void EmuWindow::update_status()
         vu1_mode->setText("VU1: Interpreter");
     }
     emu_thread.set_vu1_mode(mode);
+
+    if (Settings::instance().iop_jit_enabled)
+    {
+        mode = core::CPU_MODE::JIT;
+        iop_mode->setText("IOP: JIT");
+    }
+    else
+    {
+        mode = core::CPU_MODE::INTERPRETER;
+        iop_mode->setText("IOP: Interpreter");
+    }
+    emu_thread.set_iop_mode(mode);
+
+    int frameskip = Settings::instance().frameskip;
+    if (frameskip == 0)
+        emu_thread.set_frameskip(gs::FrameskipMode::Off, 1);
+    else if (frameskip == 1)
+        emu_thread.set_frameskip(gs::FrameskipMode::Auto, 1);
+    else
+        emu_thread.set_frameskip(gs::FrameskipMode::Fixed, frameskip);
+
+    if (Settings::instance().adaptive_timeslices)
+        emu_thread.set_timeslice_mode(core::TimesliceMode::Adaptive, Settings::instance().timeslice_skew);
+    else
+        emu_thread.set_timeslice_mode(core::TimesliceMode::Fixed, Settings::instance().timeslice_skew);
 }
@@ -1,4 +1,5 @@
 #include "settings.hpp"
+#include "../core/emulator.hpp"
 
 Settings::Settings()
 {
@@ -32,12 +33,16 @@ void Settings::reset()
     ee_jit_enabled = qsettings().value("ee_jit_enabled", true).toBool();
     vu0_jit_enabled = qsettings().value("vu0_jit_enabled", true).toBool();
     vu1_jit_enabled = qsettings().value("vu1_jit_enabled", true).toBool();
+    iop_jit_enabled = qsettings().value("iop_jit_enabled", false).toBool();
     last_used_directory = qsettings().value("last_used_dir", QDir::homePath()).toString();
     screenshot_directory = qsettings().value("screenshot_directory", QDir::homePath()).toString();
     rom_directories_to_add = QStringList();
     rom_directories_to_remove = QStringList();
     memcard_path = qsettings().value("memcard_path", "").toString();
     scaling_factor = qsettings().value("ui_scaling_factor", 1).toInt();
+    frameskip = qsettings().value("frameskip", 0).toInt();
+    adaptive_timeslices = qsettings().value("adaptive_timeslices", false).toBool();
+    timeslice_skew = qsettings().value("timeslice_skew", core::DEFAULT_TIMESLICE_SKEW).toInt();
     d_theme = qsettings().value("Dark Theme", true).toBool();
     l_theme = qsettings().value("Light Theme", false).toBool();
 
@@ -71,9 +76,13 @@ void Settings::save()
     qsettings().setValue("ee_jit_enabled", ee_jit_enabled);
     qsettings().setValue("vu0_jit_enabled", vu0_jit_enabled);
     qsettings().setValue("vu1_jit_enabled", vu1_jit_enabled);
+    qsettings().setValue("iop_jit_enabled", iop_jit_enabled);
     qsettings().setValue("screenshot_directory", screenshot_directory);
     qsettings().setValue("memcard_path", memcard_path);
     qsettings().setValue("ui_scaling_factor", scaling_factor);
+    qsettings().setValue("frameskip", frameskip);
+    qsettings().setValue("adaptive_timeslices", adaptive_timeslices);
+    qsettings().setValue("timeslice_skew", timeslice_skew);
     qsettings().setValue("Dark Theme", d_theme);
     qsettings().setValue("Light Theme", l_theme);
     qsettings().sync();
@@ -30,9 +30,16 @@ class Settings final : public QObject
 
         int scaling_factor;
 
+        //0 = off, 1 = auto, N = draw one of every N frames
+        int frameskip;
+
+        bool adaptive_timeslices;
+        int timeslice_skew; //Longest EE timeslice in adaptive mode, in EE cycles
+
         bool vu0_jit_enabled;
         bool vu1_jit_enabled;
         bool ee_jit_enabled;
+        bool iop_jit_enabled;
         bool d_theme;
         bool l_theme;
 
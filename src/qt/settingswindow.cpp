@@ -11,6 +11,7 @@
 #include <QWidget>
 #include <QGroupBox>
 #include <QRadioButton>
+#include <QCheckBox>
 
 #include "settingswindow.hpp"
 #include "settings.hpp"
@@ -24,13 +25,27 @@ GeneralTab::GeneralTab(QWidget* parent)
     QRadioButton* ee_interpreter_checkbox = new QRadioButton(tr("Interpreter"));
     QRadioButton* vu0_interpreter_checkbox = new QRadioButton(tr("Interpreter"));
     QRadioButton* vu1_interpreter_checkbox = new QRadioButton(tr("Interpreter"));
+    QRadioButton* iop_jit_checkbox = new QRadioButton(tr("JIT - Experimental"));
+    QRadioButton* iop_interpreter_checkbox = new QRadioButton(tr("Interpreter"));
     QRadioButton* light_theme_checkbox = new QRadioButton(tr("Light Theme"));
     QRadioButton*  darktheme_checkbox = new QRadioButton(tr("Dark Theme"));
 
+    //Item index matches Settings::frameskip
+    QComboBox* frameskip_combo = new QComboBox;
+    frameskip_combo->addItem(tr("Off"));
+    frameskip_combo->addItem(tr("Auto"));
+    frameskip_combo->addItem(tr("Draw 1 of 2 frames"));
+    frameskip_combo->addItem(tr("Draw 1 of 3 frames"));
+    frameskip_combo->addItem(tr("Draw 1 of 4 frames"));
+    frameskip_combo->setCurrentIndex(Settings::instance().frameskip);
+
+    QCheckBox* adaptive_timeslices_checkbox = new QCheckBox(tr("Adaptive timeslices (faster, less accurate)"));
+    adaptive_timeslices_checkbox->setChecked(Settings::instance().adaptive_timeslices);
 
     bool ee_jit = Settings::instance().ee_jit_enabled;
     bool vu0_jit = Settings::instance().vu0_jit_enabled;
     bool vu1_jit = Settings::instance().vu1_jit_enabled;
+    bool iop_jit = Settings::instance().iop_jit_enabled;
     bool l_theme = Settings::instance().l_theme;
     bool d_theme = Settings::instance().d_theme;
 
@@ -42,6 +57,8 @@ GeneralTab::GeneralTab(QWidget* parent)
     vu0_interpreter_checkbox->setChecked(!vu0_jit);
     vu1_jit_checkbox->setChecked(vu1_jit);
     vu1_interpreter_checkbox->setChecked(!vu1_jit);
+    iop_jit_checkbox->setChecked(iop_jit);
+    iop_interpreter_checkbox->setChecked(!iop_jit);
 
     connect(ee_jit_checkbox, &QRadioButton::clicked, this, [=]() {
         Settings::instance().ee_jit_enabled = true;
@@ -66,6 +83,14 @@ GeneralTab::GeneralTab(QWidget* parent)
     connect(vu1_interpreter_checkbox, &QRadioButton::clicked, this, [=]() {
         Settings::instance().vu1_jit_enabled = false;
     });
+
+    connect(iop_jit_checkbox, &QRadioButton::clicked, this, [=]() {
+        Settings::instance().iop_jit_enabled = true;
+    });
+
+    connect(iop_interpreter_checkbox, &QRadioButton::clicked, this, [=]() {
+        Settings::instance().iop_jit_enabled = false;
+    });
     connect(light_theme_checkbox, &QRadioButton::clicked, this, [=]() {
         Settings::instance().l_theme = true;
         Settings::instance().d_theme = false;
@@ -76,10 +101,21 @@ GeneralTab::GeneralTab(QWidget* parent)
         Settings::instance().l_theme = false;
     });
 
+    connect(frameskip_combo, QOverload<int>::of(&QComboBox::currentIndexChanged), this, [=](int index) {
+        Settings::instance().frameskip = index;
+    });
+
+    connect(adaptive_timeslices_checkbox, &QCheckBox::toggled, this, [=](bool checked) {
+        Settings::instance().adaptive_timeslices = checked;
+    });
+
     connect(&Settings::instance(), &Settings::reload, this, [=]() {
+        frameskip_combo->setCurrentIndex(Settings::instance().frameskip);
+        adaptive_timeslices_checkbox->setChecked(Settings::instance().adaptive_timeslices);
         bool ee_jit_enabled = Settings::instance().ee_jit_enabled;
         bool vu0_jit_enabled = Settings::instance().vu0_jit_enabled;
         bool vu1_jit_enabled = Settings::instance().vu1_jit_enabled;
+        bool iop_jit_enabled = Settings::instance().iop_jit_enabled;
         bool  l_theme =Settings::instance().l_theme;
         bool  d_theme =Settings::instance().d_theme;
         ee_jit_checkbox->setChecked(ee_jit_enabled);
@@ -88,6 +124,8 @@ GeneralTab::GeneralTab(QWidget* parent)
         vu0_interpreter_checkbox->setChecked(!vu0_jit_enabled);
         vu1_jit_checkbox->setChecked(vu1_jit_enabled);
         vu1_interpreter_checkbox->setChecked(!vu1_jit_enabled);
+        iop_jit_checkbox->setChecked(iop_jit_enabled);
+        iop_interpreter_checkbox->setChecked(!iop_jit_enabled);
         light_theme_checkbox->setChecked(l_theme);
         darktheme_checkbox->setChecked(d_theme);
     });
@@ -114,17 +152,34 @@ GeneralTab::GeneralTab(QWidget* parent)
     QGroupBox* vu1_groupbox = new QGroupBox(tr("VU1"));
     vu1_groupbox->setLayout(vu1_layout);
 
+    QVBoxLayout* iop_layout = new QVBoxLayout;
+    iop_layout->addWidget(iop_jit_checkbox);
+    iop_layout->addWidget(iop_interpreter_checkbox);
+
+    QGroupBox* iop_groupbox = new QGroupBox(tr("IOP"));
+    iop_groupbox->setLayout(iop_layout);
+
     QVBoxLayout* ee_layout = new QVBoxLayout;
     ee_layout->addWidget(ee_jit_checkbox);
     ee_layout->addWidget(ee_interpreter_checkbox);
+    ee_layout->addWidget(adaptive_timeslices_checkbox);
 
     QGroupBox* ee_groupbox = new QGroupBox(tr("EE"));
     ee_groupbox->setLayout(ee_layout);    
 
+    QVBoxLayout* gs_layout = new QVBoxLayout;
+    gs_layout->addWidget(new QLabel(tr("Frameskip")));
+    gs_layout->addWidget(frameskip_combo);
+
+    QGroupBox* gs_groupbox = new QGroupBox(tr("GS"));
+    gs_groupbox->setLayout(gs_layout);
+
     QVBoxLayout* layout = new QVBoxLayout;
     layout->addWidget(ee_groupbox);
     layout->addWidget(vu0_groupbox);
     layout->addWidget(vu1_groupbox);
+    layout->addWidget(iop_groupbox);
+    layout->addWidget(gs_groupbox);
     layout->addWidget(theme_group);
     layout->addStretch(1);
 
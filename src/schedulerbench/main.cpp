@@ -0,0 +1,175 @@
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include "scheduler.hpp"
+#include "util/errors.hpp"
+
+/**
+Microbenchmark for core::Scheduler. Runs the scheduler's side of Emulator::run without any CPUs,
+with the events a game keeps pending: HBLANK, VBLANK, the SPU sample clock, INTC checks,
+CDVD sector reads and the EE and IOP timers.
+**/
+
+using namespace std;
+
+//Same timings as Emulator, EmotionTiming, IOPTiming and CDVD_Drive use
+constexpr uint32_t CYCLES_PER_FRAME = 4920115;
+constexpr uint32_t VBLANK_START_CYCLES = 4489019;
+constexpr uint32_t HBLANK_CYCLES = 18742;
+constexpr uint32_t GS_VBLANK_DELAY = 65622;
+constexpr uint32_t SPU_SAMPLE_CYCLES = 768 * 8;
+constexpr uint32_t CDVD_SECTOR_CYCLES = 13653 * 8; //One 2048-byte block at 4x DVD speed
+
+class SchedulerBench
+{
+    private:
+        core::Scheduler scheduler;
+
+        int vblank_start_id, vblank_end_id, hblank_id, gs_vblank_id, spu_id, int_check_id, cdvd_id;
+        int ee_timer_cb_id, iop_timer_cb_id;
+        uint64_t ee_timers[4], iop_timers[6];
+
+        bool frame_ended;
+        uint64_t events_run, hblanks, timeslices;
+    public:
+        SchedulerBench();
+
+        void reset(unsigned int max_run_cycles);
+        void run_frame();
+        uint64_t get_events_run() const { return events_run; }
+        uint64_t get_timeslices() const { return timeslices; }
+};
+
+SchedulerBench::SchedulerBench() : frame_ended(false), events_run(0), hblanks(0), timeslices(0)
+{
+
+}
+
+void SchedulerBench::reset(unsigned int max_run_cycles)
+{
+    scheduler.reset();
+    scheduler.set_max_run_cycles(max_run_cycles);
+
+    vblank_start_id = scheduler.register_function([this](uint64_t param)
+    {
+        events_run++;
+        scheduler.add_event(gs_vblank_id, GS_VBLANK_DELAY);
+    });
+    vblank_end_id = scheduler.register_function([this](uint64_t param)
+    {
+        events_run++;
+        frame_ended = true;
+    });
+    hblank_id = scheduler.register_function([this](uint64_t param)
+    {
+        events_run++;
+        hblanks++;
+        //Interrupts raised by the GS and the timers it gates make INTC check for pending IRQs
+        if (!(hblanks & 0x3))
+            scheduler.add_event(int_check_id, 8);
+        scheduler.add_event(hblank_id, HBLANK_CYCLES);
+    });
+    gs_vblank_id = scheduler.register_function([this](uint64_t param) { events_run++; });
+    spu_id = scheduler.register_function([this](uint64_t param)
+    {
+        events_run++;
+        scheduler.add_event(spu_id, SPU_SAMPLE_CYCLES);
+    });
+    int_check_id = scheduler.register_function([this](uint64_t param) { events_run++; });
+    cdvd_id = scheduler.register_function([this](uint64_t param)
+    {
+        events_run++;
+        scheduler.add_event(cdvd_id, CDVD_SECTOR_CYCLES);
+    });
+
+    //Timers that clear on their target, like games use for frame pacing and sound
+    ee_timer_cb_id = scheduler.register_timer_callback([this](uint64_t index, bool overflow)
+    {
+        events_run++;
+        if (!overflow)
+            scheduler.set_timer_counter(ee_timers[index], 0);
+    });
+    iop_timer_cb_id = scheduler.register_timer_callback([this](uint64_t index, bool overflow)
+    {
+        events_run++;
+        if (!overflow)
+            scheduler.set_timer_counter(iop_timers[index], 0);
+    });
+
+    const uint64_t ee_clockrates[] = { core::Scheduler::BUS_CLOCKRATE, core::Scheduler::BUS_CLOCKRATE / 16,
+                                       core::Scheduler::BUS_CLOCKRATE / 256, core::Scheduler::BUS_CLOCKRATE / 256 };
+    const uint64_t ee_targets[] = { 0x8000, 0x4000, 0x2400, 0xFFFF };
+    for (int i = 0; i < 4; i++)
+    {
+        ee_timers[i] = scheduler.create_timer(ee_timer_cb_id, 0xFFFF, i);
+        scheduler.set_timer_clockrate(ee_timers[i], ee_clockrates[i]);
+        scheduler.set_timer_target(ee_timers[i], ee_targets[i]);
+        scheduler.set_timer_int_mask(ee_timers[i], true, true);
+        scheduler.set_timer_pause(ee_timers[i], i == 3);
+    }
+
+    for (int i = 0; i < 6; i++)
+    {
+        iop_timers[i] = scheduler.create_timer(iop_timer_cb_id, i < 3 ? 0xFFFF : 0xFFFFFFFF, i);
+        scheduler.set_timer_clockrate(iop_timers[i], core::Scheduler::IOP_CLOCKRATE / (i == 5 ? 256 : 1));
+        scheduler.set_timer_target(iop_timers[i], 0x1000 << i);
+        scheduler.set_timer_int_mask(iop_timers[i], true, true);
+        scheduler.set_timer_pause(iop_timers[i], i == 1 || i == 2);
+    }
+
+    scheduler.add_event(hblank_id, HBLANK_CYCLES);
+    scheduler.add_event(spu_id, SPU_SAMPLE_CYCLES);
+    scheduler.add_event(cdvd_id, CDVD_SECTOR_CYCLES);
+}
+
+void SchedulerBench::run_frame()
+{
+    frame_ended = false;
+
+    scheduler.add_event(vblank_start_id, VBLANK_START_CYCLES);
+    scheduler.add_event(vblank_end_id, CYCLES_PER_FRAME);
+
+    while (!frame_ended)
+    {
+        scheduler.calculate_run_cycles();
+        scheduler.get_bus_run_cycles();
+        scheduler.get_iop_run_cycles();
+        scheduler.update_cycle_counts();
+        scheduler.process_events();
+        timeslices++;
+    }
+}
+
+int main(int argc, char** argv)
+{
+    int frames = argc > 1 ? atoi(argv[1]) : 600;
+    int max_run_cycles = argc > 2 ? atoi(argv[2]) : core::Scheduler::DEFAULT_RUN_CYCLES;
+    if (frames <= 0 || max_run_cycles <= 0)
+    {
+        printf("Usage: DobieSchedulerBench [frames] [max timeslice in EE cycles]\n");
+        return 1;
+    }
+
+    try
+    {
+        SchedulerBench bench;
+        bench.reset(max_run_cycles);
+
+        auto start = chrono::steady_clock::now();
+        for (int i = 0; i < frames; i++)
+            bench.run_frame();
+        double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+        printf("%d frames in %.3f ms (%.1f frames/s)\n", frames, seconds * 1000.0, frames / seconds);
+        printf("%llu timeslices, %.2f ns per timeslice\n", (unsigned long long)bench.get_timeslices(),
+               seconds * 1e9 / bench.get_timeslices());
+        printf("%llu events, %.1f ns per event\n", (unsigned long long)bench.get_events_run(),
+               seconds * 1e9 / bench.get_events_run());
+    }
+    catch (Emulation_error& e)
+    {
+        fprintf(stderr, "%s\n", e.what());
+        return 1;
+    }
+    return 0;
+}
@@ -0,0 +1,201 @@
+#include <chrono>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include "ee/vtlb.hpp"
+#include "util/errors.hpp"
+#include "util/hostmem.hpp"
+
+/**
+Compares the EE's vtlb layouts and the ways RDRAM can be backed on the host, with the access patterns
+that make EE memory accesses expensive. Every access is a vtlb lookup followed by a load or a store,
+like EmotionEngine::read32/write32 without the rest of the EE around it.
+
+The vtlb is set up like Cop0::init_tlb: KSEG0 and KSEG1 over RDRAM, its mirrors, MMIO and the BIOS,
+plus 32 MB of user space mapped to RDRAM through the TLB, which is what most games do.
+**/
+
+using namespace std;
+
+constexpr uint32_t RDRAM_SIZE = 32 * 1024 * 1024;
+constexpr uint32_t BIOS_SIZE = 4 * 1024 * 1024;
+constexpr uint32_t PAGE_SIZE = 4096;
+
+enum class Pattern
+{
+    Sequential, //Word by word through RDRAM
+    Strided,    //One word per page and a cache line over, like walking an array of large structures
+    Random,     //Anywhere in RDRAM through KUSEG, KSEG0 and KSEG1
+    Scatter     //Random read-modify-writes
+};
+
+static const char* pattern_name(Pattern pattern)
+{
+    switch (pattern)
+    {
+        case Pattern::Sequential:
+            return "sequential";
+        case Pattern::Strided:
+            return "strided";
+        case Pattern::Random:
+            return "random";
+        case Pattern::Scatter:
+            return "scatter";
+    }
+    return "";
+}
+
+static const char* huge_page_name(HugePageMode mode)
+{
+    switch (mode)
+    {
+        case HugePageMode::Off:
+            return "off";
+        case HugePageMode::Transparent:
+            return "transparent";
+        case HugePageMode::Explicit:
+            return "explicit";
+    }
+    return "";
+}
+
+template <typename VTLBType>
+class VTLBBench
+{
+    private:
+        unique_ptr<VTLBType> vtlb;
+        uint8_t* rdram;
+        unique_ptr<uint8_t[]> bios;
+
+        uint8_t* get_mem_pointer(uint32_t paddr);
+    public:
+        VTLBBench();
+        ~VTLBBench();
+
+        size_t vtlb_memory_used() const { return vtlb->memory_used(); }
+        uint64_t run(Pattern pattern, uint64_t accesses, uint64_t& slow_accesses);
+};
+
+template <typename VTLBType>
+VTLBBench<VTLBType>::VTLBBench() : vtlb(make_unique<VTLBType>()), bios(make_unique<uint8_t[]>(BIOS_SIZE))
+{
+    rdram = HostMemory::alloc_guest(RDRAM_SIZE);
+    for (uint32_t i = 0; i < RDRAM_SIZE; i += 4)
+        *(uint32_t*)&rdram[i] = i * 0x9E3779B1;
+
+    vtlb->clear();
+    for (uint64_t addr = 0x80000000; addr < 0xC0000000; addr += PAGE_SIZE)
+        vtlb->set((uint32_t)(addr / PAGE_SIZE), get_mem_pointer(addr & 0x1FFFFFFF));
+    vtlb->compact();
+
+    for (uint32_t addr = 0; addr < RDRAM_SIZE; addr += PAGE_SIZE)
+        vtlb->set(addr / PAGE_SIZE, rdram + addr);
+}
+
+template <typename VTLBType>
+VTLBBench<VTLBType>::~VTLBBench()
+{
+    HostMemory::free_guest(rdram, RDRAM_SIZE);
+}
+
+//Same as Cop0::get_mem_pointer
+template <typename VTLBType>
+uint8_t* VTLBBench<VTLBType>::get_mem_pointer(uint32_t paddr)
+{
+    if (paddr < 0x10000000)
+        return rdram + (paddr & (RDRAM_SIZE - 1));
+    if (paddr >= 0x1FC00000 && paddr < 0x20000000)
+        return bios.get() + (paddr & (BIOS_SIZE - 1));
+    return (uint8_t*)1;
+}
+
+template <typename VTLBType>
+uint64_t VTLBBench<VTLBType>::run(Pattern pattern, uint64_t accesses, uint64_t& slow_accesses)
+{
+    const uint32_t segments[] = { 0x00000000, 0x80000000, 0xA0000000 };
+    uint64_t sum = 0;
+    uint32_t seed = 0x12345678;
+    uint32_t offset = 0;
+    slow_accesses = 0;
+
+    for (uint64_t i = 0; i < accesses; i++)
+    {
+        uint32_t address;
+        switch (pattern)
+        {
+            case Pattern::Sequential:
+                address = 0x80000000 | offset;
+                offset = (offset + 4) & (RDRAM_SIZE - 1);
+                break;
+            case Pattern::Strided:
+                address = 0x80000000 | offset;
+                offset = (offset + PAGE_SIZE + 64) & (RDRAM_SIZE - 1);
+                break;
+            default:
+                seed = seed * 1664525 + 1013904223;
+                address = segments[(seed >> 8) % 3] | ((seed >> 4) & (RDRAM_SIZE - 4));
+                break;
+        }
+
+        uint8_t* mem = vtlb->lookup(address);
+        if (mem > (uint8_t*)1)
+        {
+            uint32_t& word = *(uint32_t*)&mem[address & (PAGE_SIZE - 1)];
+            sum += word;
+            if (pattern == Pattern::Scatter)
+                word += (uint32_t)i;
+        }
+        else
+            slow_accesses++;
+    }
+    return sum;
+}
+
+template <typename VTLBType>
+static void run_configuration(const char* vtlb_name, HugePageMode huge_pages, uint64_t accesses)
+{
+    HostMemory::set_huge_page_mode(huge_pages);
+    auto bench = make_unique<VTLBBench<VTLBType>>();
+
+    const Pattern patterns[] = { Pattern::Sequential, Pattern::Strided, Pattern::Random, Pattern::Scatter };
+    for (Pattern pattern : patterns)
+    {
+        uint64_t slow_accesses;
+        auto start = chrono::steady_clock::now();
+        uint64_t sum = bench->run(pattern, accesses, slow_accesses);
+        double seconds = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+
+        printf("{\"vtlb\": \"%s\", \"huge_pages\": \"%s\", \"vtlb_kb\": %zu, \"pattern\": \"%s\", "
+               "\"ns_per_access\": %.3f, \"slow_accesses\": %" PRIu64 ", \"checksum\": \"%016" PRIx64 "\"}\n",
+               vtlb_name, huge_page_name(huge_pages), bench->vtlb_memory_used() / 1024, pattern_name(pattern),
+               seconds * 1e9 / accesses, slow_accesses, sum);
+    }
+}
+
+int main(int argc, char** argv)
+{
+    long long accesses = argc > 1 ? atoll(argv[1]) : 64 * 1024 * 1024;
+    if (accesses <= 0)
+    {
+        printf("Usage: DobieVTLBBench [accesses per pattern]\n");
+        return 1;
+    }
+
+    try
+    {
+        const HugePageMode modes[] = { HugePageMode::Off, HugePageMode::Transparent, HugePageMode::Explicit };
+        for (HugePageMode mode : modes)
+        {
+            run_configuration<ee::FlatVTLB>("flat", mode, accesses);
+            run_configuration<ee::TwoLevelVTLB>("two_level", mode, accesses);
+        }
+    }
+    catch (Emulation_error& e)
+    {
+        fprintf(stderr, "%s\n", e.what());
+        return 1;
+    }
+    return 0;
+}